@@ -673,6 +673,8 @@ void Channel::complete(Message& msg, bool minimal) const
 Message* Channel::message(const char* name, bool minimal, bool data)
 {
     Message* msg = new Message(name);
+    // channel messages carry many short lived parameters with common names
+    msg->setArena();
     if (data)
 	msg->userData(this);
     complete(*msg,minimal);
@@ -22,6 +22,28 @@
 #include <string.h>
 #include <stdlib.h>
 
+#if !defined(_WINDOWS) && defined(__GNUC__)
+#include <pthread.h>
+#define POOL_THREAD_CACHE
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && \
+    ((__GNUC__ > 4) || ((__GNUC__ == 4) && (__GNUC_MINOR__ >= 9)))
+#include <immintrin.h>
+#define G711_SIMD
+#define SIMD_SSE2 __attribute__((target("sse2")))
+#define SIMD_AVX2 __attribute__((target("avx2")))
+#endif
+
+// Number of buffer size classes, larger blocks are allocated directly
+#define POOL_CLASSES 4
+// Maximum number of free blocks of each class cached by a thread
+#define POOL_CACHE 64
+// Maximum number of free blocks of each class kept in the shared pool
+#define POOL_SHARED 2048
+// Thread statistics are added to the shared ones after this many operations
+#define POOL_FOLD 256
+
 using namespace TelEngine;
 
 namespace { // anonymous
@@ -32,10 +54,17 @@ extern "C" {
 #include "u2a.h"
 #include "u2s.h"
 
-static unsigned char s2a[65536];
-static unsigned char s2u[65536];
+// padded so 32 bit gathers at any 16 bit index stay inside the table
+static unsigned char s2a[65536 + 4];
+static unsigned char s2u[65536 + 4];
 }
 
+#ifdef G711_SIMD
+// byte tables widened for 32 bit gathers
+static int a2u32[256];
+static int u2a32[256];
+#endif
+
 class InitG711
 {
 public:
@@ -68,13 +97,329 @@ public:
 		val = (--v) ^ 0xd5;
 	    s2a[i] = val;
 	}
+#ifdef G711_SIMD
+	for (i = 0; i < 256; i++) {
+	    a2u32[i] = a2u[i];
+	    u2a32[i] = u2a[i];
+	}
+#endif
     }
 };
 
 static InitG711 s_initG711;
 
+static const unsigned int s_poolSizes[POOL_CLASSES] = { 160, 320, 640, 1280 };
+
+// Free blocks are linked through their first bytes
+struct PoolBlock
+{
+    PoolBlock* next;
+};
+
+// Free blocks and statistics of a size class
+struct PoolClass
+{
+    PoolBlock* free;
+    unsigned int count;
+    int64_t hits;
+    int64_t misses;
+    int64_t live;
+};
+
+// Blocks cached by a thread, statistics hold changes not yet in the pool
+struct PoolCache
+{
+    PoolClass cls[POOL_CLASSES];
+    unsigned int ops;
+};
+
+// Pool of small data buffers shared by all threads
+class DataPool : public Mutex
+{
+public:
+    DataPool();
+    ~DataPool();
+    void* get(unsigned int cls);
+    void put(unsigned int cls, void* data);
+    void status(String& str, bool details);
+    static int sizeClass(unsigned int len);
+    static void threadExit(void* arg);
+private:
+    PoolCache* cache();
+    void fold(PoolCache* c);
+    void refill(PoolCache* c, unsigned int cls);
+    void spill(PoolCache* c, unsigned int cls);
+    PoolClass m_cls[POOL_CLASSES];
+    bool m_cacheKey;
+#ifdef POOL_THREAD_CACHE
+    pthread_key_t m_key;
+#endif
+};
+
+// True while the pool is constructed and can be used
+static bool s_poolOn = false;
+
+#ifdef POOL_THREAD_CACHE
+// Blocks cached by the current thread, the key is used only to release them
+static __thread PoolCache* s_cache = 0;
+// Set once the thread released its cache, blocks go straight to the pool after
+static __thread bool s_cacheDone = false;
+#endif
+
 }; // anonymous namespace
 
+static DataPool s_pool;
+
+
+DataPool::DataPool()
+    : Mutex(false,"DataPool"),
+      m_cacheKey(false)
+{
+    ::memset(m_cls,0,sizeof(m_cls));
+#ifdef POOL_THREAD_CACHE
+    m_cacheKey = !::pthread_key_create(&m_key,threadExit);
+#endif
+    s_poolOn = true;
+}
+
+DataPool::~DataPool()
+{
+    lock();
+    s_poolOn = false;
+    for (int i = 0; i < POOL_CLASSES; i++) {
+	while (PoolBlock* b = m_cls[i].free) {
+	    m_cls[i].free = b->next;
+	    ::free(b);
+	}
+	m_cls[i].count = 0;
+    }
+    unlock();
+}
+
+// Find the size class holding blocks of at least the requested length
+int DataPool::sizeClass(unsigned int len)
+{
+    for (int i = 0; i < POOL_CLASSES; i++)
+	if (len <= s_poolSizes[i])
+	    return i;
+    return -1;
+}
+
+PoolCache* DataPool::cache()
+{
+#ifdef POOL_THREAD_CACHE
+    PoolCache* c = s_cache;
+    if (c || s_cacheDone || !m_cacheKey)
+	return c;
+    c = static_cast<PoolCache*>(::calloc(1,sizeof(PoolCache)));
+    if (c && ::pthread_setspecific(m_key,c)) {
+	::free(c);
+	c = 0;
+    }
+    s_cache = c;
+    return c;
+#else
+    return 0;
+#endif
+}
+
+// Add the thread statistics to the shared ones, pool must be locked
+void DataPool::fold(PoolCache* c)
+{
+    for (int i = 0; i < POOL_CLASSES; i++) {
+	PoolClass& tc = c->cls[i];
+	m_cls[i].hits += tc.hits;
+	m_cls[i].misses += tc.misses;
+	m_cls[i].live += tc.live;
+	tc.hits = tc.misses = tc.live = 0;
+    }
+    c->ops = 0;
+}
+
+// Move half a cache worth of free blocks from the shared pool to a thread
+void DataPool::refill(PoolCache* c, unsigned int cls)
+{
+    PoolClass& tc = c->cls[cls];
+    Lock mylock(this);
+    fold(c);
+    PoolClass& pc = m_cls[cls];
+    while (pc.free && (tc.count < POOL_CACHE / 2)) {
+	PoolBlock* b = pc.free;
+	pc.free = b->next;
+	pc.count--;
+	b->next = tc.free;
+	tc.free = b;
+	tc.count++;
+    }
+}
+
+// Move half of the free blocks of a thread to the shared pool
+void DataPool::spill(PoolCache* c, unsigned int cls)
+{
+    PoolClass& tc = c->cls[cls];
+    Lock mylock(this);
+    fold(c);
+    PoolClass& pc = m_cls[cls];
+    while (tc.free && (tc.count > POOL_CACHE / 2)) {
+	PoolBlock* b = tc.free;
+	tc.free = b->next;
+	tc.count--;
+	if (s_poolOn && (pc.count < POOL_SHARED)) {
+	    b->next = pc.free;
+	    pc.free = b;
+	    pc.count++;
+	}
+	else
+	    ::free(b);
+    }
+}
+
+void* DataPool::get(unsigned int cls)
+{
+    PoolCache* c = cache();
+    if (c) {
+	PoolClass& tc = c->cls[cls];
+	tc.live++;
+	if (!tc.free)
+	    refill(c,cls);
+	else if (++c->ops >= POOL_FOLD) {
+	    lock();
+	    fold(c);
+	    unlock();
+	}
+	PoolBlock* b = tc.free;
+	if (b) {
+	    tc.free = b->next;
+	    tc.count--;
+	    tc.hits++;
+	    return b;
+	}
+	tc.misses++;
+	return ::malloc(s_poolSizes[cls]);
+    }
+    lock();
+    PoolClass& pc = m_cls[cls];
+    pc.live++;
+    PoolBlock* b = pc.free;
+    if (b) {
+	pc.free = b->next;
+	pc.count--;
+	pc.hits++;
+    }
+    else
+	pc.misses++;
+    unlock();
+    return b ? b : ::malloc(s_poolSizes[cls]);
+}
+
+void DataPool::put(unsigned int cls, void* data)
+{
+    PoolBlock* b = static_cast<PoolBlock*>(data);
+    PoolCache* c = cache();
+    if (c) {
+	PoolClass& tc = c->cls[cls];
+	tc.live--;
+	b->next = tc.free;
+	tc.free = b;
+	if (++tc.count > POOL_CACHE)
+	    spill(c,cls);
+	else if (++c->ops >= POOL_FOLD) {
+	    lock();
+	    fold(c);
+	    unlock();
+	}
+	return;
+    }
+    lock();
+    PoolClass& pc = m_cls[cls];
+    pc.live--;
+    if (pc.count < POOL_SHARED) {
+	b->next = pc.free;
+	pc.free = b;
+	pc.count++;
+	b = 0;
+    }
+    unlock();
+    if (b)
+	::free(b);
+}
+
+// Return the blocks cached by an exiting thread to the shared pool
+void DataPool::threadExit(void* arg)
+{
+    PoolCache* c = static_cast<PoolCache*>(arg);
+    if (!c)
+	return;
+#ifdef POOL_THREAD_CACHE
+    s_cache = 0;
+    s_cacheDone = true;
+#endif
+    s_pool.lock();
+    s_pool.fold(c);
+    for (int i = 0; i < POOL_CLASSES; i++) {
+	PoolClass& tc = c->cls[i];
+	PoolClass& pc = s_pool.m_cls[i];
+	while (PoolBlock* b = tc.free) {
+	    tc.free = b->next;
+	    if (s_poolOn && (pc.count < POOL_SHARED)) {
+		b->next = pc.free;
+		pc.free = b;
+		pc.count++;
+	    }
+	    else
+		::free(b);
+	}
+    }
+    s_pool.unlock();
+    ::free(c);
+}
+
+void DataPool::status(String& str, bool details)
+{
+    Lock mylock(this);
+    int64_t hits = 0;
+    int64_t misses = 0;
+    int64_t live = 0;
+    unsigned int free = 0;
+    for (int i = 0; i < POOL_CLASSES; i++) {
+	hits += m_cls[i].hits;
+	misses += m_cls[i].misses;
+	live += m_cls[i].live;
+	free += m_cls[i].count;
+    }
+    int64_t total = hits + misses;
+    str << "hits=" << hits << ",misses=" << misses;
+    str << ",hitrate=" << (unsigned int)(total ? (hits * 100 / total) : 0);
+    str << ",live=" << live << ",free=" << free;
+    if (!details)
+	return;
+    for (int i = 0; i < POOL_CLASSES; i++) {
+	const PoolClass& pc = m_cls[i];
+	str << (i ? "," : ";") << s_poolSizes[i] << "=" << pc.hits << "|" << pc.misses <<
+	    "|" << pc.live << "|" << pc.count;
+    }
+}
+
+// Allocate memory for a data block, update length to the allocated size
+static void* blockAlloc(unsigned int& len)
+{
+    int cls = s_poolOn ? DataPool::sizeClass(len) : -1;
+    if (cls < 0)
+	return ::malloc(len);
+    len = s_poolSizes[cls];
+    return s_pool.get(cls);
+}
+
+// Release the memory of a data block, pool sized blocks are kept for reuse
+static void blockFree(void* data, unsigned int allocated)
+{
+    int cls = s_poolOn ? DataPool::sizeClass(allocated) : -1;
+    if ((cls >= 0) && (s_poolSizes[cls] == allocated))
+	s_pool.put(cls,data);
+    else
+	::free(data);
+}
+
 static const DataBlock s_empty;
 
 const DataBlock& DataBlock::empty()
@@ -82,6 +427,11 @@ const DataBlock& DataBlock::empty()
     return s_empty;
 }
 
+void DataBlock::poolStatus(String& str, bool details)
+{
+    s_pool.status(str,details);
+}
+
 DataBlock::DataBlock(unsigned int overAlloc)
     : m_data(0), m_length(0), m_allocated(0), m_overAlloc(overAlloc)
 {
@@ -126,21 +476,31 @@ void DataBlock::clear(bool deleteData)
 	void *data = m_data;
 	m_data = 0;
 	if (deleteData)
-	    ::free(data);
+	    blockFree(data,m_allocated);
     }
 }
 
 DataBlock& DataBlock::assign(void* value, unsigned int len, bool copyData, unsigned int allocated)
 {
     if ((value != m_data) || (len != m_length)) {
+	// reuse the current buffer if it is large enough but not much larger
+	if (copyData && len && m_data && (len <= m_allocated) && (m_allocated <= 2 * allocLen(len))) {
+	    if (value)
+		::memmove(m_data,value,len);
+	    else
+		::memset(m_data,0,len);
+	    m_length = len;
+	    return *this;
+	}
 	void *odata = m_data;
+	unsigned int oalloc = m_allocated;
 	m_length = 0;
 	m_allocated = 0;
 	m_data = 0;
 	if (len) {
 	    if (copyData) {
 		allocated = allocLen(len);
-		void *data = ::malloc(allocated);
+		void *data = blockAlloc(allocated);
 		if (data) {
 		    if (value)
 			::memcpy(data,value,len);
@@ -162,7 +522,7 @@ DataBlock& DataBlock::assign(void* value, unsigned int len, bool copyData, unsig
 	    }
 	}
 	if (odata && (odata != m_data))
-	    ::free(odata);
+	    blockFree(odata,oalloc);
     }
     return *this;
 }
@@ -209,7 +569,7 @@ void DataBlock::append(const DataBlock& value)
 		return;
 	    }
 	    unsigned int aLen = allocLen(len);
-	    void *data = ::malloc(aLen);
+	    void *data = blockAlloc(aLen);
 	    if (data) {
 		::memcpy(data,m_data,m_length);
 		::memcpy(m_length+(char*)data,value.data(),value.length());
@@ -234,7 +594,7 @@ void DataBlock::append(const String& value)
 		return;
 	    }
 	    unsigned int aLen = allocLen(len);
-	    void *data = ::malloc(aLen);
+	    void *data = blockAlloc(aLen);
 	    if (data) {
 		::memcpy(data,m_data,m_length);
 		::memcpy(m_length+(char*)data,value.safe(),value.length());
@@ -254,11 +614,12 @@ void DataBlock::insert(const DataBlock& value)
     if (m_length) {
 	if (vl) {
 	    unsigned int len = m_length+vl;
-	    void *data = ::malloc(len);
+	    unsigned int aLen = allocLen(len);
+	    void *data = blockAlloc(aLen);
 	    if (data) {
 		::memcpy(data,value.data(),vl);
 		::memcpy(vl+(char*)data,m_data,m_length);
-		assign(data,len,false);
+		assign(data,len,false,aLen);
 	    }
 	    else
 		Debug("DataBlock",DebugFail,"malloc(%d) returned NULL!",len);
@@ -278,82 +639,359 @@ unsigned int DataBlock::allocLen(unsigned int len) const
 	return len + over;
 }
 
-bool DataBlock::convert(const DataBlock& src, const String& sFormat,
-    const String& dFormat, unsigned maxlen)
+// Table driven sample converters, work on any platform
+
+static inline void byteTable(void* dest, const void* src, unsigned int samples,
+    const unsigned char* c)
 {
-    if (sFormat == dFormat) {
-	operator=(src);
-	return true;
+    const unsigned char* s = (const unsigned char*)src;
+    unsigned char* d = (unsigned char*)dest;
+    while (samples--)
+	*d++ = c[*s++];
+}
+
+static inline void decodeTable(void* dest, const void* src, unsigned int samples,
+    const unsigned short* c)
+{
+    const unsigned char* s = (const unsigned char*)src;
+    unsigned short* d = (unsigned short*)dest;
+    while (samples--)
+	*d++ = c[*s++];
+}
+
+static inline void encodeTable(void* dest, const void* src, unsigned int samples,
+    const unsigned char* c)
+{
+    const unsigned short* s = (const unsigned short*)src;
+    unsigned char* d = (unsigned char*)dest;
+    while (samples--)
+	*d++ = c[*s++];
+}
+
+static void convSlinAlaw(void* dest, const void* src, unsigned int samples)
+{
+    encodeTable(dest,src,samples,s2a);
+}
+
+static void convSlinMulaw(void* dest, const void* src, unsigned int samples)
+{
+    encodeTable(dest,src,samples,s2u);
+}
+
+static void convAlawMulaw(void* dest, const void* src, unsigned int samples)
+{
+    byteTable(dest,src,samples,a2u);
+}
+
+static void convMulawAlaw(void* dest, const void* src, unsigned int samples)
+{
+    byteTable(dest,src,samples,u2a);
+}
+
+static void convAlawSlin(void* dest, const void* src, unsigned int samples)
+{
+    decodeTable(dest,src,samples,a2s);
+}
+
+static void convMulawSlin(void* dest, const void* src, unsigned int samples)
+{
+    decodeTable(dest,src,samples,u2s);
+}
+
+#ifdef G711_SIMD
+
+// Compute 2 raised to a power from 0 to 7 in each 16 bit lane
+SIMD_SSE2 static inline __m128i pow2Sse2(__m128i e)
+{
+    const __m128i one = _mm_set1_epi16(1);
+    __m128i p = _mm_add_epi16(one,_mm_and_si128(e,one));
+    __m128i b = _mm_and_si128(_mm_srli_epi16(e,1),one);
+    p = _mm_mullo_epi16(p,_mm_add_epi16(one,_mm_mullo_epi16(b,_mm_set1_epi16(3))));
+    b = _mm_and_si128(_mm_srli_epi16(e,2),one);
+    return _mm_mullo_epi16(p,_mm_add_epi16(one,_mm_mullo_epi16(b,_mm_set1_epi16(15))));
+}
+
+// Decode 8 mu-law codes held in 16 bit lanes, same results as u2s table
+SIMD_SSE2 static inline __m128i mulawSse2(__m128i u)
+{
+    u = _mm_xor_si128(u,_mm_set1_epi16(0xff));
+    __m128i e = _mm_and_si128(_mm_srli_epi16(u,4),_mm_set1_epi16(7));
+    __m128i v = _mm_add_epi16(_mm_slli_epi16(_mm_and_si128(u,_mm_set1_epi16(0x0f)),3),
+	_mm_set1_epi16(0x84));
+    v = _mm_sub_epi16(_mm_mullo_epi16(v,pow2Sse2(e)),_mm_set1_epi16(0x84));
+    __m128i neg = _mm_cmpeq_epi16(_mm_and_si128(u,_mm_set1_epi16(0x80)),_mm_set1_epi16(0x80));
+    return _mm_sub_epi16(_mm_xor_si128(v,neg),neg);
+}
+
+// Decode 8 A-law codes held in 16 bit lanes, same results as a2s table
+SIMD_SSE2 static inline __m128i alawSse2(__m128i a)
+{
+    a = _mm_xor_si128(a,_mm_set1_epi16(0x55));
+    __m128i e = _mm_and_si128(_mm_srli_epi16(a,4),_mm_set1_epi16(7));
+    // segments above 0 have an implicit leading bit and are shifted by e-1
+    __m128i seg = _mm_cmpgt_epi16(e,_mm_setzero_si128());
+    __m128i v = _mm_add_epi16(_mm_slli_epi16(_mm_and_si128(a,_mm_set1_epi16(0x0f)),4),
+	_mm_set1_epi16(8));
+    v = _mm_add_epi16(v,_mm_and_si128(seg,_mm_set1_epi16(0x100)));
+    e = _mm_add_epi16(e,seg);
+    v = _mm_mullo_epi16(v,pow2Sse2(e));
+    __m128i neg = _mm_cmpeq_epi16(_mm_and_si128(a,_mm_set1_epi16(0x80)),_mm_setzero_si128());
+    return _mm_sub_epi16(_mm_xor_si128(v,neg),neg);
+}
+
+SIMD_SSE2 static void convMulawSlinSse2(void* dest, const void* src, unsigned int samples)
+{
+    const unsigned char* s = (const unsigned char*)src;
+    unsigned char* d = (unsigned char*)dest;
+    const __m128i zero = _mm_setzero_si128();
+    for (; samples >= 16; samples -= 16, s += 16, d += 32) {
+	__m128i in = _mm_loadu_si128((const __m128i*)s);
+	_mm_storeu_si128((__m128i*)d,mulawSse2(_mm_unpacklo_epi8(in,zero)));
+	_mm_storeu_si128((__m128i*)(d + 16),mulawSse2(_mm_unpackhi_epi8(in,zero)));
+    }
+    decodeTable(d,s,samples,u2s);
+}
+
+SIMD_SSE2 static void convAlawSlinSse2(void* dest, const void* src, unsigned int samples)
+{
+    const unsigned char* s = (const unsigned char*)src;
+    unsigned char* d = (unsigned char*)dest;
+    const __m128i zero = _mm_setzero_si128();
+    for (; samples >= 16; samples -= 16, s += 16, d += 32) {
+	__m128i in = _mm_loadu_si128((const __m128i*)s);
+	_mm_storeu_si128((__m128i*)d,alawSse2(_mm_unpacklo_epi8(in,zero)));
+	_mm_storeu_si128((__m128i*)(d + 16),alawSse2(_mm_unpackhi_epi8(in,zero)));
+    }
+    decodeTable(d,s,samples,a2s);
+}
+
+// Compute 2 raised to a power from 0 to 7 in each 16 bit lane
+SIMD_AVX2 static inline __m256i pow2Avx2(__m256i e)
+{
+    const __m256i one = _mm256_set1_epi16(1);
+    __m256i p = _mm256_add_epi16(one,_mm256_and_si256(e,one));
+    __m256i b = _mm256_and_si256(_mm256_srli_epi16(e,1),one);
+    p = _mm256_mullo_epi16(p,_mm256_add_epi16(one,_mm256_mullo_epi16(b,_mm256_set1_epi16(3))));
+    b = _mm256_and_si256(_mm256_srli_epi16(e,2),one);
+    return _mm256_mullo_epi16(p,_mm256_add_epi16(one,_mm256_mullo_epi16(b,_mm256_set1_epi16(15))));
+}
+
+SIMD_AVX2 static void convMulawSlinAvx2(void* dest, const void* src, unsigned int samples)
+{
+    const unsigned char* s = (const unsigned char*)src;
+    unsigned char* d = (unsigned char*)dest;
+    for (; samples >= 16; samples -= 16, s += 16, d += 32) {
+	__m256i u = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)s));
+	u = _mm256_xor_si256(u,_mm256_set1_epi16(0xff));
+	__m256i e = _mm256_and_si256(_mm256_srli_epi16(u,4),_mm256_set1_epi16(7));
+	__m256i v = _mm256_add_epi16(_mm256_slli_epi16(_mm256_and_si256(u,
+	    _mm256_set1_epi16(0x0f)),3),_mm256_set1_epi16(0x84));
+	v = _mm256_sub_epi16(_mm256_mullo_epi16(v,pow2Avx2(e)),_mm256_set1_epi16(0x84));
+	__m256i neg = _mm256_cmpeq_epi16(_mm256_and_si256(u,_mm256_set1_epi16(0x80)),
+	    _mm256_set1_epi16(0x80));
+	_mm256_storeu_si256((__m256i*)d,_mm256_sub_epi16(_mm256_xor_si256(v,neg),neg));
     }
-    unsigned sl = 0, dl = 0;
-    void *ctable = 0;
+    decodeTable(d,s,samples,u2s);
+}
+
+SIMD_AVX2 static void convAlawSlinAvx2(void* dest, const void* src, unsigned int samples)
+{
+    const unsigned char* s = (const unsigned char*)src;
+    unsigned char* d = (unsigned char*)dest;
+    for (; samples >= 16; samples -= 16, s += 16, d += 32) {
+	__m256i a = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)s));
+	a = _mm256_xor_si256(a,_mm256_set1_epi16(0x55));
+	__m256i e = _mm256_and_si256(_mm256_srli_epi16(a,4),_mm256_set1_epi16(7));
+	__m256i seg = _mm256_cmpgt_epi16(e,_mm256_setzero_si256());
+	__m256i v = _mm256_add_epi16(_mm256_slli_epi16(_mm256_and_si256(a,
+	    _mm256_set1_epi16(0x0f)),4),_mm256_set1_epi16(8));
+	v = _mm256_add_epi16(v,_mm256_and_si256(seg,_mm256_set1_epi16(0x100)));
+	e = _mm256_add_epi16(e,seg);
+	v = _mm256_mullo_epi16(v,pow2Avx2(e));
+	__m256i neg = _mm256_cmpeq_epi16(_mm256_and_si256(a,_mm256_set1_epi16(0x80)),
+	    _mm256_setzero_si256());
+	_mm256_storeu_si256((__m256i*)d,_mm256_sub_epi16(_mm256_xor_si256(v,neg),neg));
+    }
+    decodeTable(d,s,samples,a2s);
+}
+
+// Pack the low bytes of 16 32 bit lanes to 16 consecutive bytes
+SIMD_AVX2 static inline __m128i packBytesAvx2(__m256i lo, __m256i hi)
+{
+    __m256i w = _mm256_permute4x64_epi64(_mm256_packus_epi32(lo,hi),0xd8);
+    return _mm_packus_epi16(_mm256_castsi256_si128(w),_mm256_extracti128_si256(w,1));
+}
+
+// Encode 16 bit samples by gathering from a padded 64k byte table
+SIMD_AVX2 static inline void encodeAvx2(void* dest, const void* src, unsigned int samples,
+    const unsigned char* c)
+{
+    const unsigned char* s = (const unsigned char*)src;
+    unsigned char* d = (unsigned char*)dest;
+    const __m256i mask = _mm256_set1_epi32(0xff);
+    for (; samples >= 16; samples -= 16, s += 32, d += 16) {
+	__m256i i0 = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)s));
+	__m256i i1 = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)(s + 16)));
+	__m256i g0 = _mm256_and_si256(_mm256_i32gather_epi32((const int*)c,i0,1),mask);
+	__m256i g1 = _mm256_and_si256(_mm256_i32gather_epi32((const int*)c,i1,1),mask);
+	_mm_storeu_si128((__m128i*)d,packBytesAvx2(g0,g1));
+    }
+    encodeTable(d,s,samples,c);
+}
+
+// Translate bytes by gathering from a widened 256 entry table
+SIMD_AVX2 static inline void byteAvx2(void* dest, const void* src, unsigned int samples,
+    const int* c32, const unsigned char* c)
+{
+    const unsigned char* s = (const unsigned char*)src;
+    unsigned char* d = (unsigned char*)dest;
+    for (; samples >= 16; samples -= 16, s += 16, d += 16) {
+	__m128i in = _mm_loadu_si128((const __m128i*)s);
+	__m256i g0 = _mm256_i32gather_epi32(c32,_mm256_cvtepu8_epi32(in),4);
+	__m256i g1 = _mm256_i32gather_epi32(c32,_mm256_cvtepu8_epi32(_mm_srli_si128(in,8)),4);
+	_mm_storeu_si128((__m128i*)d,packBytesAvx2(g0,g1));
+    }
+    byteTable(d,s,samples,c);
+}
+
+SIMD_AVX2 static void convSlinAlawAvx2(void* dest, const void* src, unsigned int samples)
+{
+    encodeAvx2(dest,src,samples,s2a);
+}
+
+SIMD_AVX2 static void convSlinMulawAvx2(void* dest, const void* src, unsigned int samples)
+{
+    encodeAvx2(dest,src,samples,s2u);
+}
+
+SIMD_AVX2 static void convAlawMulawAvx2(void* dest, const void* src, unsigned int samples)
+{
+    byteAvx2(dest,src,samples,a2u32,a2u);
+}
+
+SIMD_AVX2 static void convMulawAlawAvx2(void* dest, const void* src, unsigned int samples)
+{
+    byteAvx2(dest,src,samples,u2a32,u2a);
+}
+
+#endif // G711_SIMD
+
+// Instruction sets usable for conversions, detected once
+static int s_simdLevel = -1;
+
+static int simdLevel()
+{
+    if (s_simdLevel >= 0)
+	return s_simdLevel;
+    int level = 0;
+#ifdef G711_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+	level = 2;
+    else if (__builtin_cpu_supports("sse2"))
+	level = 1;
+#endif
+    s_simdLevel = level;
+    return level;
+}
+
+DataBlock::Converter DataBlock::converter(const String& sFormat, const String& dFormat,
+    unsigned int& sSize, unsigned int& dSize, bool simd)
+{
+    int level = simd ? simdLevel() : 0;
+    Converter func = 0;
     if (sFormat == YSTRING("slin")) {
-	sl = 2;
-	dl = 1;
+	sSize = 2;
+	dSize = 1;
 	if (dFormat == YSTRING("alaw"))
-	    ctable = s2a;
+	    func = convSlinAlaw;
 	else if (dFormat == YSTRING("mulaw"))
-	    ctable = s2u;
+	    func = convSlinMulaw;
+#ifdef G711_SIMD
+	if (func && (level >= 2))
+	    func = (func == convSlinAlaw) ? convSlinAlawAvx2 : convSlinMulawAvx2;
+#endif
     }
     else if (sFormat == YSTRING("alaw")) {
-	sl = 1;
+	sSize = 1;
 	if (dFormat == YSTRING("mulaw")) {
-	    dl = 1;
-	    ctable = a2u;
+	    dSize = 1;
+	    func = convAlawMulaw;
+#ifdef G711_SIMD
+	    if (level >= 2)
+		func = convAlawMulawAvx2;
+#endif
 	}
 	else if (dFormat == YSTRING("slin")) {
-	    dl = 2;
-	    ctable = a2s;
+	    dSize = 2;
+	    func = convAlawSlin;
+#ifdef G711_SIMD
+	    if (level >= 2)
+		func = convAlawSlinAvx2;
+	    else if (level >= 1)
+		func = convAlawSlinSse2;
+#endif
 	}
     }
     else if (sFormat == YSTRING("mulaw")) {
-	sl = 1;
+	sSize = 1;
 	if (dFormat == YSTRING("alaw")) {
-	    dl = 1;
-	    ctable = u2a;
+	    dSize = 1;
+	    func = convMulawAlaw;
+#ifdef G711_SIMD
+	    if (level >= 2)
+		func = convMulawAlawAvx2;
+#endif
 	}
 	else if (dFormat == YSTRING("slin")) {
-	    dl = 2;
-	    ctable = u2s;
+	    dSize = 2;
+	    func = convMulawSlin;
+#ifdef G711_SIMD
+	    if (level >= 2)
+		func = convMulawSlinAvx2;
+	    else if (level >= 1)
+		func = convMulawSlinSse2;
+#endif
 	}
     }
-    if (!ctable) {
+    if (!func)
+	sSize = dSize = 0;
+    return func;
+}
+
+bool DataBlock::convert(const DataBlock& src, Converter func, unsigned int sSize,
+    unsigned int dSize, unsigned maxlen)
+{
+    if (!(func && sSize && dSize)) {
 	clear();
 	return false;
     }
     unsigned len = src.length();
     if (maxlen && (maxlen < len))
 	len = maxlen;
-    len /= sl;
+    len /= sSize;
     if (!len) {
 	clear();
 	return true;
     }
-    resize(len * dl);
-    if ((sl == 1) && (dl == 1)) {
-	unsigned char *s = (unsigned char *) src.data();
-	unsigned char *d = (unsigned char *) data();
-	unsigned char *c = (unsigned char *) ctable;
-	while (len--)
-	    *d++ = c[*s++];
-    }
-    else if ((sl == 1) && (dl == 2)) {
-	unsigned char *s = (unsigned char *) src.data();
-	unsigned short *d = (unsigned short *) data();
-	unsigned short *c = (unsigned short *) ctable;
-	while (len--)
-	    *d++ = c[*s++];
-    }
-    else if ((sl == 2) && (dl == 1)) {
-	unsigned short *s = (unsigned short *) src.data();
-	unsigned char *d = (unsigned char *) data();
-	unsigned char *c = (unsigned char *) ctable;
-	while (len--)
-	    *d++ = c[*s++];
-    }
+    resize(len * dSize);
+    func(data(),src.data(),len);
     return true;
 }
 
+bool DataBlock::convert(const DataBlock& src, const String& sFormat,
+    const String& dFormat, unsigned maxlen)
+{
+    if (sFormat == dFormat) {
+	operator=(src);
+	return true;
+    }
+    unsigned int sSize = 0;
+    unsigned int dSize = 0;
+    Converter func = converter(sFormat,dFormat,sSize,dSize);
+    return convert(src,func,sSize,dSize,maxlen);
+}
+
 // Decode a single nibble, return -1 on error
 inline signed char hexDecode(char c)
 {
@@ -136,12 +136,260 @@ private:
     RefPointer<ThreadedSource> m_source;
 };
 
+// Length of a media clock tick in microseconds
+#define CLOCK_TICK 10000
+// Ticks run back to back to catch up before the missed ones are dropped
+#define CLOCK_CATCHUP 5
+// Maximum number of media clock threads
+#define CLOCK_THREADS 16
+// Intervals up to this many ticks are balanced over the tick phases
+#define CLOCK_PHASES 10
+// Number of buckets in the lateness and duration histograms
+#define CLOCK_BUCKETS 7
+
+// Upper limits of the histogram buckets in microseconds, the last one is open
+static const unsigned int s_clockLimits[CLOCK_BUCKETS - 1] = {
+    250, 500, 1000, 2000, 5000, CLOCK_TICK
+};
+
+class MediaClockEntry : public GenObject
+{
+    friend class MediaClock;
+public:
+    inline MediaClockEntry(ThreadedSource* source, unsigned int ticks, unsigned int phase)
+	: m_source(source), m_ticks(ticks), m_phase(phase)
+	{ }
+private:
+    RefPointer<ThreadedSource> m_source;
+    unsigned int m_ticks;
+    unsigned int m_phase;
+};
+
+// A thread calling a batch of sources at each tick of the media clock
+class MediaClock : public Thread
+{
+public:
+    MediaClock(unsigned int index);
+    ~MediaClock();
+    inline unsigned int count() const
+	{ return m_count; }
+    void attach(ThreadedSource* source, unsigned int ticks);
+    void status(u_int64_t* late, u_int64_t* busy, u_int64_t& ticks,
+	u_int64_t& overruns, u_int64_t& skipped) const;
+    static MediaClock* get();
+protected:
+    virtual void run();
+    virtual void cleanup();
+private:
+    void tick(u_int64_t index, u_int64_t when);
+    void detach(ObjList* item);
+    void detachAll();
+    static void count(u_int64_t* hist, u_int64_t usec);
+    unsigned int m_index;
+    Mutex m_mutex;
+    Semaphore m_wake;
+    ObjList m_sources;
+    ObjList m_pending;
+    unsigned int m_count;
+    unsigned int m_phases[CLOCK_PHASES];
+    u_int64_t m_late[CLOCK_BUCKETS];
+    u_int64_t m_busy[CLOCK_BUCKETS];
+    u_int64_t m_ticks;
+    u_int64_t m_overruns;
+    u_int64_t m_skipped;
+};
+
+static Mutex s_clockMutex(false,"MediaClock");
+static MediaClock* s_clocks[CLOCK_THREADS];
+static int s_clockThreads = -1;
+
+MediaClock::MediaClock(unsigned int index)
+    : Thread("Media Clock",Thread::High),
+      m_index(index), m_mutex(false,"MediaClockSources"), m_wake(1,"MediaClockWake",0),
+      m_count(0), m_ticks(0), m_overruns(0), m_skipped(0)
+{
+    ::memset(m_phases,0,sizeof(m_phases));
+    ::memset(m_late,0,sizeof(m_late));
+    ::memset(m_busy,0,sizeof(m_busy));
+}
+
+MediaClock::~MediaClock()
+{
+    Lock mylock(s_clockMutex);
+    if (s_clocks[m_index] == this)
+	s_clocks[m_index] = 0;
+}
+
+// Get the least loaded clock thread, start a new one if possible
+MediaClock* MediaClock::get()
+{
+    if (s_clockThreads < 0)
+	s_clockThreads = Engine::config().getIntValue("general","mediaclocks",2,0,CLOCK_THREADS);
+    MediaClock* clock = 0;
+    for (int i = 0; i < s_clockThreads; i++) {
+	MediaClock* c = s_clocks[i];
+	if (!c) {
+	    c = new MediaClock(i);
+	    if (!c->startup()) {
+		delete c;
+		continue;
+	    }
+	    s_clocks[i] = c;
+	}
+	if (!clock || (c->count() < clock->count()))
+	    clock = c;
+    }
+    return clock;
+}
+
+// Queue a source to the thread, it starts receiving ticks at the next one
+void MediaClock::attach(ThreadedSource* source, unsigned int ticks)
+{
+    Lock mylock(m_mutex);
+    // spread sources with longer intervals evenly over the ticks
+    unsigned int phase = 0;
+    if (ticks <= CLOCK_PHASES) {
+	for (unsigned int i = 1; i < ticks; i++)
+	    if (m_phases[i] < m_phases[phase])
+		phase = i;
+	m_phases[phase]++;
+    }
+    else
+	phase = m_count % ticks;
+    MediaClockEntry* entry = new MediaClockEntry(source,ticks,phase);
+    source->m_clock = entry;
+    m_pending.append(entry);
+    if (!m_count++)
+	m_wake.unlock();
+}
+
+void MediaClock::count(u_int64_t* hist, u_int64_t usec)
+{
+    int i = 0;
+    while ((i < CLOCK_BUCKETS - 1) && (usec >= s_clockLimits[i]))
+	i++;
+    hist[i]++;
+}
+
+void MediaClock::status(u_int64_t* late, u_int64_t* busy, u_int64_t& ticks,
+    u_int64_t& overruns, u_int64_t& skipped) const
+{
+    for (int i = 0; i < CLOCK_BUCKETS; i++) {
+	late[i] += m_late[i];
+	busy[i] += m_busy[i];
+    }
+    ticks += m_ticks;
+    overruns += m_overruns;
+    skipped += m_skipped;
+}
+
+void MediaClock::run()
+{
+    u_int64_t index = 0;
+    while (!(Engine::exiting() || check(false))) {
+	if (m_sources.skipNull() || m_pending.skipNull()) {
+	    u_int64_t now = Time::now();
+	    if (!index)
+		index = now / CLOCK_TICK + 1;
+	    u_int64_t when = index * CLOCK_TICK;
+	    if (now < when) {
+		Thread::usleep((unsigned long)(when - now));
+		now = Time::now();
+	    }
+	    if (now >= when + CLOCK_CATCHUP * CLOCK_TICK) {
+		// too far behind, drop the ticks we missed
+		u_int64_t missed = (now - when) / CLOCK_TICK;
+		m_skipped += missed;
+		index += missed;
+		when = index * CLOCK_TICK;
+	    }
+	    count(m_late,(now > when) ? now - when : 0);
+	    tick(index++,when);
+	    u_int64_t busy = Time::now() - now;
+	    count(m_busy,busy);
+	    if (busy > CLOCK_TICK)
+		m_overruns++;
+	    m_ticks++;
+	    continue;
+	}
+	// nothing to do, wait for a source and resynchronize when one arrives
+	index = 0;
+	m_wake.lock(500000);
+    }
+    detachAll();
+}
+
+void MediaClock::cleanup()
+{
+    detachAll();
+}
+
+// Call all the sources due in a tick
+void MediaClock::tick(u_int64_t index, u_int64_t when)
+{
+    if (m_pending.skipNull()) {
+	m_mutex.lock();
+	while (GenObject* obj = m_pending.remove(false))
+	    m_sources.append(obj);
+	m_mutex.unlock();
+    }
+    ObjList* l = m_sources.skipNull();
+    while (l) {
+	MediaClockEntry* e = static_cast<MediaClockEntry*>(l->get());
+	if ((index % e->m_ticks) != e->m_phase) {
+	    l = l->skipNext();
+	    continue;
+	}
+	ThreadedSource* s = e->m_source;
+	s->lock();
+	bool attached = (s->m_clock == e);
+	s->unlock();
+	if (attached && s->clockTick(when)) {
+	    l = l->skipNext();
+	    continue;
+	}
+	detach(l);
+	l = l->skipNull();
+    }
+}
+
+// Remove a source from this thread and let it clean up like a worker thread would
+void MediaClock::detach(ObjList* item)
+{
+    MediaClockEntry* e = static_cast<MediaClockEntry*>(item->get());
+    RefPointer<ThreadedSource> source = e->m_source;
+    e->m_source = 0;
+    source->lock();
+    if (source->m_clock == e)
+	source->m_clock = 0;
+    source->unlock();
+    m_mutex.lock();
+    if ((e->m_ticks <= CLOCK_PHASES) && m_phases[e->m_phase])
+	m_phases[e->m_phase]--;
+    m_count--;
+    item->remove();
+    m_mutex.unlock();
+    source->cleanup();
+}
+
+void MediaClock::detachAll()
+{
+    m_mutex.lock();
+    while (GenObject* obj = m_pending.remove(false))
+	m_sources.append(obj);
+    m_mutex.unlock();
+    while (ObjList* l = m_sources.skipNull())
+	detach(l);
+}
+
+
 // slin/alaw/mulaw converter
 class SimpleTranslator : public DataTranslator
 {
 public:
     SimpleTranslator(const DataFormat& sFormat, const DataFormat& dFormat)
-	: DataTranslator(sFormat,dFormat), m_valid(false) {
+	: DataTranslator(sFormat,dFormat), m_valid(false),
+	  m_func(0), m_sSize(0), m_dSize(0) {
 	    if (!getTransSource())
 		return;
 	    int nchan = m_format.numChannels();
@@ -155,13 +403,15 @@ public:
 		m_sFmt >> "*";
 		m_dFmt >> "*";
 	    }
+	    // resolve the conversion once instead of on each data block
+	    m_func = DataBlock::converter(m_sFmt,m_dFmt,m_sSize,m_dSize);
 	}
     virtual unsigned long Consume(const DataBlock& data, unsigned long tStamp, unsigned long flags)
 	{
 	    if (!ref())
 		return 0;
 	    unsigned long len = 0;
-	    if (m_valid && getTransSource() && m_buffer.convert(data,m_sFmt,m_dFmt)) {
+	    if (m_valid && getTransSource() && m_buffer.convert(data,m_func,m_sSize,m_dSize)) {
 		if (tStamp == invalidStamp()) {
 		    unsigned int delta = data.length();
 		    if (delta > m_buffer.length())
@@ -178,6 +428,9 @@ private:
     bool m_valid;
     String m_sFmt;
     String m_dFmt;
+    DataBlock::Converter m_func;
+    unsigned int m_sSize;
+    unsigned int m_dSize;
     DataBlock m_buffer;
 };
 
@@ -187,6 +440,7 @@ class ResampTranslator : public DataTranslator
 private:
     int m_sRate, m_dRate;
     short m_last;
+    DataBlock m_buffer;
 public:
     ResampTranslator(const DataFormat& sFormat, const DataFormat& dFormat)
 	: DataTranslator(sFormat,dFormat),
@@ -203,13 +457,12 @@ public:
 	    if (src) {
 		long delta = tStamp - m_timestamp;
 		short* s = (short*) data.data();
-		DataBlock oblock;
 		if (m_dRate > m_sRate) {
 		    int mul = m_dRate / m_sRate;
 		    // linear interpolation between existing samples
 		    delta *= mul;
-		    oblock.assign(0,2*n*mul);
-		    short* d = (short*) oblock.data();
+		    m_buffer.resize(2*n*mul);
+		    short* d = (short*) m_buffer.data();
 		    while (n--) {
 			short v = *s++;
 			for (int i = 1; i <= mul; i++)
@@ -222,8 +475,8 @@ public:
 		    // average an integer number of samples
 		    delta /= div;
 		    n /= div;
-		    oblock.assign(0,2*n);
-		    short* d = (short*) oblock.data();
+		    m_buffer.resize(2*n);
+		    short* d = (short*) m_buffer.data();
 		    while (n--) {
 			int v = 0;
 			for (int i = 0; i < div; i++)
@@ -239,7 +492,7 @@ public:
 		}
 		if (src->timeStamp() != invalidStamp())
 		    delta += src->timeStamp();
-		len = src->Forward(oblock, delta, flags);
+		len = src->Forward(m_buffer, delta, flags);
 	    }
 	    deref();
 	    return len;
@@ -251,6 +504,7 @@ class StereoTranslator : public DataTranslator
 {
 private:
     int m_sChans, m_dChans;
+    DataBlock m_buffer;
 public:
     StereoTranslator(const DataFormat& sFormat, const DataFormat& dFormat)
 	: DataTranslator(sFormat,dFormat),
@@ -265,10 +519,9 @@ public:
 	    n /= 2;
 	    if (getTransSource()) {
 		short* s = (short*) data.data();
-		DataBlock oblock;
 		if ((m_sChans == 1) && (m_dChans == 2)) {
-		    oblock.assign(0,n*4);
-		    short* d = (short*) oblock.data();
+		    m_buffer.resize(n*4);
+		    short* d = (short*) m_buffer.data();
 		    // duplicate the sample for each channel
 		    while (n--) {
 			short v = *d++ = *s++;
@@ -277,8 +530,8 @@ public:
 		}
 		else if ((m_sChans == 2) && (m_dChans == 1)) {
 		    n /= 2;
-		    oblock.assign(0,2*n);
-		    short* d = (short*) oblock.data();
+		    m_buffer.resize(2*n);
+		    short* d = (short*) m_buffer.data();
 		    // average the channels
 		    while (n--) {
 			int v = *s++;
@@ -292,7 +545,9 @@ public:
 			*d++ = v;
 		    }
 		}
-		len = getTransSource()->Forward(oblock, tStamp, flags);
+		else
+		    m_buffer.clear();
+		len = getTransSource()->Forward(m_buffer, tStamp, flags);
 	    }
 	    deref();
 	    return len;
@@ -1082,9 +1337,66 @@ bool ThreadedSource::start(const char* name, Thread::Priority prio)
     return m_thread->running();
 }
 
+bool ThreadedSource::startClock(unsigned int interval)
+{
+    if ((interval < CLOCK_TICK / 1000) || (interval % (CLOCK_TICK / 1000)) || Engine::exiting())
+	return false;
+    Lock mylock(this);
+    if (m_clock)
+	return true;
+    if (m_thread)
+	return false;
+    Lock lck(s_clockMutex);
+    MediaClock* clock = MediaClock::get();
+    if (!clock)
+	return false;
+    clock->attach(this,interval / (CLOCK_TICK / 1000));
+    return true;
+}
+
+bool ThreadedSource::clockTick(u_int64_t when)
+{
+    return false;
+}
+
+void ThreadedSource::clockStatus(String& str, bool details)
+{
+    u_int64_t late[CLOCK_BUCKETS];
+    u_int64_t busy[CLOCK_BUCKETS];
+    ::memset(late,0,sizeof(late));
+    ::memset(busy,0,sizeof(busy));
+    u_int64_t ticks = 0;
+    u_int64_t overruns = 0;
+    u_int64_t skipped = 0;
+    unsigned int threads = 0;
+    unsigned int sources = 0;
+    Lock mylock(s_clockMutex);
+    for (int i = 0; i < CLOCK_THREADS; i++) {
+	MediaClock* c = s_clocks[i];
+	if (!c)
+	    continue;
+	threads++;
+	sources += c->count();
+	c->status(late,busy,ticks,overruns,skipped);
+    }
+    mylock.drop();
+    str << "threads=" << threads << ",sources=" << sources << ",ticks=" << ticks;
+    str << ",overruns=" << overruns << ",skipped=" << skipped;
+    if (!details)
+	return;
+    str << ";late=";
+    for (int i = 0; i < CLOCK_BUCKETS; i++)
+	str << (i ? "|" : "") << late[i];
+    str << ",busy=";
+    for (int i = 0; i < CLOCK_BUCKETS; i++)
+	str << (i ? "|" : "") << busy[i];
+}
+
 void ThreadedSource::stop()
 {
     Lock mylock(this);
+    // the clock thread notices and detaches the source at its next tick
+    m_clock = 0;
     ThreadedSourcePrivate* tmp = m_thread;
     m_thread = 0;
     if (!tmp || tmp->running())
@@ -1109,7 +1421,7 @@ Thread* ThreadedSource::thread() const
 bool ThreadedSource::running() const
 {
     Lock mylock(const_cast<ThreadedSource*>(this));
-    return m_thread && m_thread->running();
+    return m_clock || (m_thread && m_thread->running());
 }
 
 bool ThreadedSource::looping(bool runConsumers) const
@@ -1117,6 +1429,8 @@ bool ThreadedSource::looping(bool runConsumers) const
     Lock mylock(const_cast<ThreadedSource*>(this));
     if ((refcount() <= 1) && !(runConsumers && alive() && m_consumers.count()))
 	return false;
+    if (m_clock)
+	return !Engine::exiting();
     return m_thread && !m_thread->check(false) &&
 	m_thread->isCurrent() && !Engine::exiting();
 }
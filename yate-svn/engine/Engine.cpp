@@ -17,7 +17,7 @@
  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
  */
 
-#include "yatengine.h"
+#include "yatephone.h"
 #include "yateversn.h"
 
 #ifdef _WINDOWS
@@ -319,6 +319,10 @@ public:
     virtual bool received(Message &msg);
     static void objects(String& retVal, bool details);
     static int objects(String& str);
+    static void queues(String& retVal, bool details);
+    static void bufpool(String& retVal, bool details);
+    static void mediaclock(String& retVal, bool details);
+    static void mutexes(String& retVal, bool details);
 };
 
 class EngineHelp : public MessageHandler
@@ -451,6 +455,46 @@ void EngineStatusHandler::objects(String& retVal, bool details)
     retVal << "\r\n";
 }
 
+void EngineStatusHandler::queues(String& retVal, bool details)
+{
+    retVal << "name=msgqueues,type=system";
+    if (details)
+	retVal << ",format=Queued|MaxQueued|Dequeued|AvgWait|MaxWait";
+    retVal << ";";
+    Engine::self()->messageQueueStatus(retVal,details);
+    retVal << "\r\n";
+}
+
+void EngineStatusHandler::bufpool(String& retVal, bool details)
+{
+    retVal << "name=bufpool,type=system";
+    if (details)
+	retVal << ",format=Hits|Misses|Live|Free";
+    retVal << ";";
+    DataBlock::poolStatus(retVal,details);
+    retVal << "\r\n";
+}
+
+void EngineStatusHandler::mediaclock(String& retVal, bool details)
+{
+    retVal << "name=mediaclock,type=system";
+    if (details)
+	retVal << ",format=250us|500us|1ms|2ms|5ms|10ms|more";
+    retVal << ";";
+    ThreadedSource::clockStatus(retVal,details);
+    retVal << "\r\n";
+}
+
+void EngineStatusHandler::mutexes(String& retVal, bool details)
+{
+    retVal << "name=mutexes,type=system";
+    if (details)
+	retVal << ",format=Acquired|Contended|WaitTotal|WaitMax|HoldMax";
+    retVal << ";";
+    Mutex::profilingStatus(retVal,details);
+    retVal << "\r\n";
+}
+
 bool EngineStatusHandler::received(Message &msg)
 {
     bool details = msg.getBoolValue("details",true);
@@ -472,6 +516,22 @@ bool EngineStatusHandler::received(Message &msg)
 		objects(msg.retValue(),details);
 	    return true;
 	}
+	if (sel == YSTRING("msgqueues")) {
+	    queues(msg.retValue(),details);
+	    return true;
+	}
+	if (sel == YSTRING("bufpool")) {
+	    bufpool(msg.retValue(),details);
+	    return true;
+	}
+	if (sel == YSTRING("mediaclock")) {
+	    mediaclock(msg.retValue(),details);
+	    return true;
+	}
+	if (sel == YSTRING("mutexes")) {
+	    mutexes(msg.retValue(),details);
+	    return true;
+	}
 	return false;
     }
     msg.retValue() << "name=engine,type=system";
@@ -511,6 +571,13 @@ bool EngineStatusHandler::received(Message &msg)
 	}
     }
     msg.retValue() << "\r\n";
+    if (sel.null()) {
+	queues(msg.retValue(),details);
+	bufpool(msg.retValue(),details);
+	mediaclock(msg.retValue(),details);
+    }
+    if (Mutex::profiling() && sel.null())
+	mutexes(msg.retValue(),details);
     if (getObjCounting() && sel.null())
 	objects(msg.retValue(),details);
     return !sel.null();
@@ -675,6 +742,7 @@ void EngineCommand::doCompletion(Message &msg, const String& partLine, const Str
     else if (partLine == YSTRING("status")) {
 	completeOne(msg.retValue(),"engine",partWord);
 	completeOne(msg.retValue(),"objects",partWord);
+	completeOne(msg.retValue(),"mutexes",partWord);
     }
     else if (partLine == YSTRING("status objects")) {
 	for (ObjList* l = getObjCounters().skipNull();l;l = l->skipNext())
@@ -1442,6 +1510,7 @@ int Engine::engineInit()
     s_maxevents = s_cfg.getIntValue("general","maxevents",s_maxevents);
     s_restarts = s_cfg.getIntValue("general","restarts");
     m_dispatcher.warnTime(1000*(u_int64_t)s_cfg.getIntValue("general","warntime"));
+    m_dispatcher.queueShards(s_cfg.getIntValue("general","queueshards",1,1,64));
     extraPath(clientMode() ? "client" : "server");
     extraPath(s_cfg.getValue("general","extrapath"));
 
@@ -2292,6 +2361,7 @@ static void usage(bool client, FILE* f)
 "     a            Abort if bugs are encountered\n"
 "     m            Attempt to debug mutex deadlocks\n"
 "     d            Enable locking debugging and safety features\n"
+"     M            Profile mutex lock contention\n"
 #ifdef RTLD_GLOBAL
 "     l            Try to keep module symbols local\n"
 #endif
@@ -2525,6 +2595,9 @@ int Engine::main(int argc, const char** argv, const char** env, RunMode mode, En
 				case 'd':
 				    Lockable::enableSafety();
 				    break;
+				case 'M':
+				    Mutex::enableProfiling();
+				    break;
 #ifdef RTLD_GLOBAL
 				case 'l':
 				    s_localsymbol = true;
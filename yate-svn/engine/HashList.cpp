@@ -23,14 +23,21 @@
 
 using namespace TelEngine;
 
+// Upper limit of hash entries for lists that grow automatically
+#define HASH_MAX_SIZE 0x1000000
+// Upper limit of the load factor
+#define HASH_MAX_LOAD 1024
+
 HashList::HashList(unsigned int size)
-    : m_size(size), m_lists(0)
+    : m_size(size), m_base(0), m_split(0), m_alloc(0), m_lists(0),
+    m_maxLoad(0), m_maxSize(0), m_check(0), m_splits(0)
 {
     XDebug(DebugAll,"HashList::HashList(%u) [%p]",size,this);
     if (m_size < 1)
 	m_size = 1;
     if (m_size > 1024)
 	m_size = 1024;
+    m_base = m_alloc = m_size;
     m_lists = new ObjList* [m_size];
     for (unsigned int i = 0; i < m_size; i++)
 	m_lists[i] = 0;
@@ -82,14 +89,14 @@ ObjList* HashList::find(const GenObject* obj, unsigned int hash) const
     XDebug(DebugAll,"HashList::find(%p,%u) [%p]",obj,hash,this);
     if (!obj)
 	return 0;
-    unsigned int i = hash % m_size;
+    unsigned int i = index(hash);
     return m_lists[i] ? m_lists[i]->find(obj) : 0;
 }
 
 ObjList* HashList::find(const String& str) const
 {
     XDebug(DebugAll,"HashList::find(\"%s\") [%p]",str.c_str(),this);
-    unsigned int i = str.hash() % m_size;
+    unsigned int i = index(str.hash());
     return m_lists[i] ? m_lists[i]->find(str) : 0;
 }
 
@@ -98,7 +105,9 @@ ObjList* HashList::append(const GenObject* obj)
     XDebug(DebugAll,"HashList::append(%p) [%p]",obj,this);
     if (!obj)
 	return 0;
-    unsigned int i = obj->toString().hash() % m_size;
+    // Grow before inserting so the returned item stays valid
+    checkLoad();
+    unsigned int i = index(obj->toString().hash());
     if (!m_lists[i])
 	m_lists[i] = new ObjList;
     return m_lists[i]->append(obj);
@@ -126,7 +135,7 @@ bool HashList::resync(GenObject* obj)
     XDebug(DebugAll,"HashList::resync(%p) [%p]",obj,this);
     if (!obj)
 	return false;
-    unsigned int i = obj->toString().hash() % m_size;
+    unsigned int i = index(obj->toString().hash());
     if (m_lists[i] && m_lists[i]->find(obj))
 	return false;
     for (unsigned int n = 0; n < m_size; n++) {
@@ -154,7 +163,7 @@ bool HashList::resync()
 	while (l) {
 	    GenObject* obj = l->get();
 	    if (obj) {
-		unsigned int i = obj->toString().hash() % m_size;
+		unsigned int i = index(obj->toString().hash());
 		if (i != n) {
 		    bool autoDel = l->autoDelete();
 		    m_lists[n]->remove(obj,false);
@@ -171,4 +180,117 @@ bool HashList::resync()
     return moved;
 }
 
+void HashList::setMaxLoad(unsigned int load, unsigned int maxSize)
+{
+    XDebug(DebugAll,"HashList::setMaxLoad(%u,%u) [%p]",load,maxSize,this);
+    if (load > HASH_MAX_LOAD)
+	load = HASH_MAX_LOAD;
+    if (maxSize > HASH_MAX_SIZE)
+	maxSize = HASH_MAX_SIZE;
+    bool spreadChanged = !m_maxLoad != !load;
+    m_maxLoad = load;
+    m_maxSize = maxSize;
+    m_splits = 0;
+    // Count items on next insert
+    m_check = 1;
+    // Hash values are spread only in growing lists
+    if (spreadChanged)
+	resync();
+}
+
+bool HashList::checkLoad(unsigned int added)
+{
+    if (!m_maxLoad || (m_size >= m_maxSize))
+	return false;
+    if (!m_splits) {
+	// Items removed through list items are not seen here so count the
+	//  items only after enough insertions to possibly exceed the load
+	if (m_check > added) {
+	    m_check -= added;
+	    return false;
+	}
+	unsigned int items = count();
+	u_int64_t limit = (u_int64_t)m_size * m_maxLoad;
+	if (items > limit)
+	    m_splits = (unsigned int)((items - limit + m_maxLoad - 1) / m_maxLoad);
+	m_check = (items < limit) ? (unsigned int)(limit - items) : 0;
+	if (m_check <= m_size / 4)
+	    m_check = m_size / 4 + 1;
+	if (!m_splits)
+	    return false;
+	XDebug(DebugAll,"HashList growing from %u by %u for %u items [%p]",
+	    m_size,m_splits,items,this);
+    }
+    // Split just a few entries at once to spread the cost over insertions
+    for (unsigned int n = 0; n < 4 && m_splits; n++) {
+	if (!split()) {
+	    m_splits = 0;
+	    break;
+	}
+	m_splits--;
+    }
+    return true;
+}
+
+// Linear hashing: split the next entry of the current round in two, objects
+//  that don't belong to it anymore are moved to a new entry at the end
+bool HashList::split()
+{
+    if (m_size >= m_maxSize)
+	return false;
+    if (m_size >= m_alloc) {
+	unsigned int alloc = m_alloc * 2;
+	if (alloc > m_maxSize)
+	    alloc = m_maxSize;
+	ObjList** lists = new ObjList* [alloc];
+	for (unsigned int i = 0; i < alloc; i++)
+	    lists[i] = (i < m_size) ? m_lists[i] : 0;
+	delete[] m_lists;
+	m_lists = lists;
+	m_alloc = alloc;
+    }
+    unsigned int from = m_split;
+    unsigned int to = m_size;
+    unsigned int mod = m_base << 1;
+    m_lists[to] = 0;
+    m_size++;
+    if (++m_split >= m_base) {
+	m_base = mod;
+	m_split = 0;
+    }
+    ObjList* l = m_lists[from];
+    ObjList* last = 0;
+    while (l) {
+	GenObject* obj = l->get();
+	if (obj && (spread(obj->toString().hash()) % mod) == to) {
+	    bool autoDel = l->autoDelete();
+	    l->remove(false);
+	    if (!last)
+		last = m_lists[to] = new ObjList;
+	    last = last->append(obj);
+	    last->setDelete(autoDel);
+	    continue;
+	}
+	l = l->next();
+    }
+    return true;
+}
+
+unsigned int HashList::stats(unsigned int& used, unsigned int& longest) const
+{
+    unsigned int c = 0;
+    used = 0;
+    longest = 0;
+    for (unsigned int i = 0; i < m_size; i++) {
+	unsigned int n = m_lists[i] ? m_lists[i]->count() : 0;
+	if (!n)
+	    continue;
+	used++;
+	if (longest < n)
+	    longest = n;
+	c += n;
+    }
+    return c;
+}
+
 /* vi: set ts=8 sw=4 sts=4 noet: */
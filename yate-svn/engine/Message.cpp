@@ -35,9 +35,110 @@ private:
     RefPointer<MessageQueue> m_queue;
 };
 
+namespace TelEngine {
+
+// One shard of the dispatcher waiting queue with its own lock and statistics
+class MessageShard : public Mutex
+{
+public:
+    inline MessageShard()
+	: Mutex(false,"MessageShard"),
+	  m_append(&m_messages), m_count(0), m_maxCount(0),
+	  m_dequeued(0), m_waitTotal(0), m_waitMax(0)
+	{ }
+    inline void push(Message* msg)
+	{
+	    m_append = m_append->append(msg);
+	    if (++m_count > m_maxCount)
+		m_maxCount = m_count;
+	}
+    Message* pop();
+    ObjList m_messages;
+    ObjList* m_append;
+    volatile unsigned int m_count;
+    unsigned int m_maxCount;
+    u_int64_t m_dequeued;
+    u_int64_t m_waitTotal;
+    u_int64_t m_waitMax;
+};
+
+}; // namespace TelEngine
+
+// Pick the shard of a message from its address so the same message always
+//  lands in the same shard and its lock covers the duplicate check
+static inline unsigned int shardIndex(const Message* msg, unsigned int count)
+{
+    // multiplicative hash, low address bits are mostly alignment
+    return (unsigned int)((((unsigned long)msg >> 4) * 2654435761UL) >> 8) % count;
+}
+
+// Retrieve the next index of a rotating counter, lock free if possible
+static inline unsigned int nextIndex(unsigned int& idx)
+{
+#ifdef ATOMIC_OPS
+    return __sync_fetch_and_add(&idx,1);
+#else
+    // an occasional race just skews the shard distribution
+    return idx++;
+#endif
+}
+
+// Handlers installed for a single message name, kept in dispatch order
+class HandlerBucket : public String
+{
+public:
+    inline HandlerBucket(const String& name)
+	: String(name), m_atom(String::atom(name,true))
+	{ }
+    const String* m_atom;
+    ObjList m_handlers;
+};
+
+// Find the handlers of a message name, interned names compare by address
+static HandlerBucket* findBucket(const HashList& index, const Message& msg)
+{
+    const String* atom = msg.atom();
+    ObjList* l = index.getHashList(msg.hash());
+    for (l = l ? l->skipNull() : 0; l; l = l->skipNext()) {
+	HandlerBucket* b = static_cast<HandlerBucket*>(l->get());
+	if ((atom && b->m_atom) ? (atom == b->m_atom) : (msg == *b))
+	    return b;
+    }
+    return 0;
+}
+
+// Check if a handler is dispatched after the given priority and handler
+static inline bool handlerAfter(const MessageHandler* h, unsigned int prio, const MessageHandler* ref)
+{
+    return (h->priority() > prio) || ((h->priority() == prio) && (h > ref));
+}
+
+// Insert a handler in a non-owning list sorted by priority and address
+static void insertHandler(ObjList& list, MessageHandler* handler)
+{
+    ObjList* l = list.skipNull();
+    for (; l; l = l->skipNext()) {
+	if (handlerAfter(static_cast<MessageHandler*>(l->get()),handler->priority(),handler))
+	    break;
+    }
+    (l ? l->insert(handler) : list.append(handler))->setDelete(false);
+}
+
+// Find the first handler in a sorted list dispatched after the given one
+static ObjList* handlerNext(ObjList* list, unsigned int prio, const MessageHandler* ref)
+{
+    ObjList* l = list ? list->skipNull() : 0;
+    for (; l; l = l->skipNext()) {
+	if (handlerAfter(static_cast<MessageHandler*>(l->get()),prio,ref))
+	    break;
+    }
+    return l;
+}
+
 Message::Message(const char* name, const char* retval, bool broadcast)
     : NamedList(name),
-      m_return(retval), m_data(0), m_notify(false), m_broadcast(broadcast)
+      m_return(retval), m_data(0), m_queued(0), m_notify(false), m_broadcast(broadcast),
+      m_atom(0), m_atomSet(false)
 {
     XDebug(DebugAll,"Message::Message(\"%s\",\"%s\",%s) [%p]",
 	name,retval,String::boolText(broadcast),this);
@@ -46,7 +147,8 @@ Message::Message(const char* name, const char* retval, bool broadcast)
 Message::Message(const Message& original)
     : NamedList(original),
       m_return(original.retValue()), m_time(original.msgTime()),
-      m_data(0), m_notify(false), m_broadcast(original.broadcast())
+      m_data(0), m_queued(0), m_notify(false), m_broadcast(original.broadcast()),
+      m_atom(original.m_atom), m_atomSet(original.m_atomSet)
 {
     XDebug(DebugAll,"Message::Message(&%p) [%p]",&original,this);
 }
@@ -54,7 +156,8 @@ Message::Message(const Message& original)
 Message::Message(const Message& original, bool broadcast)
     : NamedList(original),
       m_return(original.retValue()), m_time(original.msgTime()),
-      m_data(0), m_notify(false), m_broadcast(broadcast)
+      m_data(0), m_queued(0), m_notify(false), m_broadcast(broadcast),
+      m_atom(original.m_atom), m_atomSet(original.m_atomSet)
 {
     XDebug(DebugAll,"Message::Message(&%p,%s) [%p]",
 	&original,String::boolText(broadcast),this);
@@ -73,6 +176,21 @@ void* Message::getObject(const String& name) const
     return NamedList::getObject(name);
 }
 
+const String* Message::findAtom() const
+{
+    // concurrent readers intern the same name so they store the same atom
+    m_atom = String::atom(c_str(),true);
+    m_atomSet = true;
+    return m_atom;
+}
+
+void Message::changed()
+{
+    m_atomSet = false;
+    m_atom = 0;
+    NamedList::changed();
+}
+
 void Message::userData(RefObject* data)
 {
     if (data == m_data)
@@ -276,6 +394,13 @@ void MessageHandler::setFilter(NamedString* filter)
     m_filter = filter;
 }
 
+void MessageHandler::setFilter(const char* name, const char* value)
+{
+    // an interned name lets dispatch find the parameter by address
+    const String* atom = String::atom(name,true);
+    setFilter(atom ? new NamedString(atom,value) : new NamedString(name,value));
+}
+
 void MessageHandler::clearFilter()
 {
     if (m_filter) {
@@ -297,8 +422,11 @@ bool MessageRelay::receivedInternal(Message& msg)
 
 MessageDispatcher::MessageDispatcher(const char* trackParam)
     : Mutex(false,"MessageDispatcher"),
+      m_handlerIndex(64),
+      m_shards(new MessageShard[1]), m_shardCount(1),
+      m_deqIndex(0),
       m_hookMutex(false,"PostHooks"),
-      m_msgAppend(&m_messages), m_hookAppend(&m_hooks),
+      m_hookAppend(&m_hooks),
       m_trackParam(trackParam), m_changes(0), m_warnTime(0),
       m_hookCount(0), m_hookHole(false)
 {
@@ -311,6 +439,7 @@ MessageDispatcher::~MessageDispatcher()
     lock();
     clear();
     unlock();
+    delete[] m_shards;
 }
 
 bool MessageDispatcher::install(MessageHandler* handler)
@@ -345,6 +474,16 @@ bool MessageDispatcher::install(MessageHandler* handler)
 	XDebug(DebugAll,"Appending handler [%p] on place #%d",handler,pos);
 	m_handlers.append(handler);
     }
+    if (handler->null())
+	insertHandler(m_nullHandlers,handler);
+    else {
+	HandlerBucket* b = static_cast<HandlerBucket*>(m_handlerIndex[*handler]);
+	if (!b) {
+	    b = new HandlerBucket(*handler);
+	    m_handlerIndex.append(b);
+	}
+	insertHandler(b->m_handlers,handler);
+    }
     handler->m_dispatcher = this;
     if (handler->null())
 	Debug(DebugInfo,"Registered broadcast message handler %p",handler);
@@ -358,6 +497,17 @@ bool MessageDispatcher::uninstall(MessageHandler* handler)
     handler = static_cast<MessageHandler *>(m_handlers.remove(handler,false));
     if (handler) {
 	m_changes++;
+	if (handler->null())
+	    m_nullHandlers.remove(handler,false);
+	else {
+	    ObjList* l = m_handlerIndex.find(*handler);
+	    HandlerBucket* b = l ? static_cast<HandlerBucket*>(l->get()) : 0;
+	    if (b) {
+		b->m_handlers.remove(handler,false);
+		if (!b->m_handlers.skipNull())
+		    l->remove();
+	    }
+	}
 	if (handler->m_unsafe > 0) {
 	    DDebug(DebugNote,"Waiting for unsafe MessageHandler %p '%s'",
 		handler,handler->c_str());
@@ -387,74 +537,74 @@ bool MessageDispatcher::dispatch(Message& msg)
     bool retv = false;
     bool counting = getObjCounting();
     NamedCounter* saved = Thread::getCurrentObjCounter(counting);
-    ObjList *l = &m_handlers;
     Lock mylock(this);
-    for (; l; l=l->next()) {
-	MessageHandler *h = static_cast<MessageHandler*>(l->get());
-	if (h && (h->null() || *h == msg)) {
-	    if (h->filter() && (*(h->filter()) != msg.getValue(h->filter()->name())))
-		continue;
-	    if (counting)
-		Thread::setCurrentObjCounter(h->objectsCounter());
-
-	    unsigned int c = m_changes;
-	    unsigned int p = h->priority();
-	    if (trackParam() && h->trackName()) {
-		NamedString* tracked = msg.getParam(trackParam());
-		if (tracked)
-		    tracked->append(h->trackName(),",");
-		else
-		    msg.addParam(trackParam(),h->trackName());
-	    }
-	    // mark handler as unsafe to destroy / uninstall
-	    h->m_unsafe++;
-	    mylock.drop();
-
-	    u_int64_t tm = m_warnTime ? Time::now() : 0;
-
-	    retv = h->receivedInternal(msg) || retv;
-
-	    if (tm) {
-		tm = Time::now() - tm;
-		if (tm > m_warnTime) {
-		    mylock.acquire(this);
-		    const char* name = (c == m_changes) ? h->trackName().c_str() : 0;
-		    Debug(DebugInfo,"Message '%s' [%p] passed through %p%s%s%s in " FMT64U " usec",
-			msg.c_str(),&msg,h,
-			(name ? " '" : ""),(name ? name : ""),(name ? "'" : ""),tm);
-		}
+    // handlers registered for this name and catch-all handlers are both
+    //  sorted by priority so walk them merged in dispatch order
+    HandlerBucket* b = findBucket(m_handlerIndex,msg);
+    ObjList* ln = b ? b->m_handlers.skipNull() : 0;
+    ObjList* lb = m_nullHandlers.skipNull();
+    while (ln || lb) {
+	MessageHandler* h = 0;
+	if (ln && lb) {
+	    MessageHandler* hb = static_cast<MessageHandler*>(lb->get());
+	    if (handlerAfter(static_cast<MessageHandler*>(ln->get()),hb->priority(),hb)) {
+		h = hb;
+		lb = lb->skipNext();
 	    }
-
-	    if (retv && !msg.broadcast())
-		break;
-	    mylock.acquire(this);
-	    if (c == m_changes)
-		continue;
-	    // the handler list has changed - find again
-	    NDebug(DebugAll,"Rescanning handler list for '%s' [%p] at priority %u",
-		msg.c_str(),&msg,p);
-	    ObjList* l2 = &m_handlers;
-	    for (l = l2; l; l=l->next()) {
-		MessageHandler *mh = static_cast<MessageHandler*>(l->get());
-		if (!mh)
-		    continue;
-		if (mh == h)
-		    // exact match - silently continue where we left
-		    break;
-
-		// gone past last handler priority - exit with last handler
-		if ((mh->priority() > p) || ((mh->priority() == p) && (mh > h))) {
-		    Debug(DebugAll,"Handler list for '%s' [%p] changed, skipping from %p (%u) to %p (%u)",
-			msg.c_str(),&msg,h,p,mh,mh->priority());
-		    // l will advance in the outer for loop so use previous
-		    l = l2;
-		    break;
-		}
-		l2 = l;
+	}
+	else if (lb) {
+	    h = static_cast<MessageHandler*>(lb->get());
+	    lb = lb->skipNext();
+	}
+	if (!h) {
+	    h = static_cast<MessageHandler*>(ln->get());
+	    ln = ln->skipNext();
+	}
+	if (h->filter() && (*(h->filter()) != msg.getValue(h->filter()->name())))
+	    continue;
+	if (counting)
+	    Thread::setCurrentObjCounter(h->objectsCounter());
+
+	unsigned int c = m_changes;
+	unsigned int p = h->priority();
+	if (trackParam() && h->trackName()) {
+	    NamedString* tracked = msg.getParam(trackParam());
+	    if (tracked)
+		tracked->append(h->trackName(),",");
+	    else
+		msg.addParam(trackParam(),h->trackName());
+	}
+	// mark handler as unsafe to destroy / uninstall
+	h->m_unsafe++;
+	mylock.drop();
+
+	u_int64_t tm = m_warnTime ? Time::now() : 0;
+
+	retv = h->receivedInternal(msg) || retv;
+
+	if (tm) {
+	    tm = Time::now() - tm;
+	    if (tm > m_warnTime) {
+		mylock.acquire(this);
+		const char* name = (c == m_changes) ? h->trackName().c_str() : 0;
+		Debug(DebugInfo,"Message '%s' [%p] passed through %p%s%s%s in " FMT64U " usec",
+		    msg.c_str(),&msg,h,
+		    (name ? " '" : ""),(name ? name : ""),(name ? "'" : ""),tm);
 	    }
-	    if (!l)
-		break;
 	}
+
+	if (retv && !msg.broadcast())
+	    break;
+	mylock.acquire(this);
+	// a handler may have renamed the message - follow the handlers of the new name
+	if ((c == m_changes) && (b ? (msg == *b) : !findBucket(m_handlerIndex,msg)))
+	    continue;
+	// the handler lists or the message name have changed - find again where we left
+	NDebug(DebugAll,"Rescanning handler list for '%s' [%p] at priority %u",
+	    msg.c_str(),&msg,p);
+	b = findBucket(m_handlerIndex,msg);
+	ln = handlerNext(b ? &b->m_handlers : 0,p,h);
+	lb = handlerNext(&m_nullHandlers,p,h);
     }
     mylock.drop();
     if (counting)
@@ -479,6 +629,7 @@ bool MessageDispatcher::dispatch(Message& msg)
 	}
     }
 
+    ObjList* l = 0;
     m_hookMutex.lock();
     if (m_hookHole && !m_hookCount) {
 	// compact the list, remove the holes
@@ -513,22 +664,53 @@ bool MessageDispatcher::dispatch(Message& msg)
     return retv;
 }
 
+Message* MessageShard::pop()
+{
+    if (m_messages.next() == m_append)
+	m_append = &m_messages;
+    Message* msg = static_cast<Message*>(m_messages.remove(false));
+    if (!msg)
+	return 0;
+    m_count--;
+    m_dequeued++;
+    u_int64_t wait = Time::now();
+    wait = (wait > msg->m_queued) ? (wait - msg->m_queued) : 0;
+    msg->m_queued = 0;
+    m_waitTotal += wait;
+    if (m_waitMax < wait)
+	m_waitMax = wait;
+    return msg;
+}
+
 bool MessageDispatcher::enqueue(Message* msg)
 {
-    Lock lock(this);
-    if (!msg || m_messages.find(msg))
+    if (!msg)
 	return false;
-    m_msgAppend = m_msgAppend->append(msg);
+    MessageShard& shard = m_shards[shardIndex(msg,m_shardCount)];
+    Lock lock(shard);
+    // the queued time doubles as the O(1) duplicate check
+    if (msg->m_queued)
+	return false;
+    msg->m_queued = Time::now();
+    shard.push(msg);
     return true;
 }
 
 bool MessageDispatcher::dequeueOne()
 {
-    lock();
-    if (m_messages.next() == m_msgAppend)
-	m_msgAppend = &m_messages;
-    Message* msg = static_cast<Message *>(m_messages.remove(false));
-    unlock();
+    Message* msg = 0;
+    unsigned int idx = nextIndex(m_deqIndex);
+    for (unsigned int i = 0; i < m_shardCount; i++) {
+	MessageShard& shard = m_shards[(idx + i) % m_shardCount];
+	// peek without locking, empty shards are skipped at no cost
+	if (!shard.m_count)
+	    continue;
+	shard.lock();
+	msg = shard.pop();
+	shard.unlock();
+	if (msg)
+	    break;
+    }
     if (!msg)
 	return false;
     dispatch(*msg);
@@ -544,8 +726,53 @@ void MessageDispatcher::dequeue()
 
 unsigned int MessageDispatcher::messageCount()
 {
+    unsigned int count = 0;
+    for (unsigned int i = 0; i < m_shardCount; i++)
+	count += m_shards[i].m_count;
+    return count;
+}
+
+bool MessageDispatcher::queueShards(unsigned int count)
+{
+    if (count < 1)
+	count = 1;
+    if (count > 64)
+	count = 64;
     Lock lock(this);
-    return m_messages.count();
+    if (count == m_shardCount)
+	return true;
+    // enqueue and dequeue access the shards without locking the dispatcher
+    //  so they can be replaced only while the queue was never used
+    if (m_deqIndex || messageCount()) {
+	Debug(DebugMild,"Message queue already in use, keeping %u shards",m_shardCount);
+	return false;
+    }
+    MessageShard* old = m_shards;
+    m_shards = new MessageShard[count];
+    m_shardCount = count;
+    delete[] old;
+    Debug(DebugInfo,"Message queue split in %u shards",count);
+    return true;
+}
+
+void MessageDispatcher::queueStatus(String& str, bool details)
+{
+    unsigned int count = 0;
+    String det;
+    for (unsigned int i = 0; i < m_shardCount; i++) {
+	MessageShard& shard = m_shards[i];
+	Lock lock(shard);
+	count += shard.m_count;
+	if (!details)
+	    continue;
+	det.append(String(i),",") << "=" << shard.m_count << "|" << shard.m_maxCount
+	    << "|" << shard.m_dequeued
+	    << "|" << (shard.m_dequeued ? (shard.m_waitTotal / shard.m_dequeued) : 0)
+	    << "|" << shard.m_waitMax;
+    }
+    str << "shards=" << m_shardCount << ",messages=" << count;
+    if (det)
+	str << ";" << det;
 }
 
 unsigned int MessageDispatcher::handlerCount()
@@ -29,6 +29,8 @@ typedef HANDLE HSEMAPHORE;
 #include <pthread.h>
 #include <semaphore.h>
 #include <time.h>
+#include <stdlib.h>
+#include <string.h>
 
 #ifdef MUTEX_HACK
 extern "C" {
@@ -55,6 +57,15 @@ typedef sem_t HSEMAPHORE;
 
 namespace TelEngine {
 
+// Contention counters of one mutex name as seen by one thread
+struct ProfCounters {
+    u_int64_t acquired;
+    u_int64_t contended;
+    u_int64_t waitTotal;
+    u_int64_t waitMax;
+    u_int64_t holdMax;
+};
+
 class MutexPrivate {
 public:
     MutexPrivate(bool recursive, const char* name);
@@ -83,6 +94,8 @@ private:
     bool m_recursive;
     const char* m_name;
     const char* m_owner;
+    unsigned int m_profId;
+    u_int64_t m_lockTime;
 };
 
 class SemaphorePrivate {
@@ -140,6 +153,111 @@ bool GlobalMutex::s_init = true;
 // No debug messages are allowed in mutexes since the debug output itself
 // is serialized using a mutex!
 
+// Lock contention profiler, each thread owns a table of counters indexed
+//  by the identifier of the mutex name so updates need no locking
+#define PROF_CHUNK 64
+#define PROF_CHUNKS 64
+#define PROF_NAMES (PROF_CHUNK * PROF_CHUNKS)
+#define PROF_BUCKETS 251
+
+static volatile bool s_profiling = false;
+static volatile unsigned int s_profGen = 1;
+
+#ifndef _WINDOWS
+
+// Counters of one thread, reused by a new thread after the owner ends
+struct MutexProfile {
+    MutexProfile* next;
+    volatile unsigned int gen;
+    bool free;
+    ProfCounters* volatile chunks[PROF_CHUNKS];
+};
+
+// Registered mutex name
+struct ProfName {
+    char* name;
+    unsigned int id;
+    ProfName* next;
+};
+
+static MutexProfile* s_profiles = 0;
+static ProfName* s_profHash[PROF_BUCKETS];
+// Identifier 0 is never assigned, names past the limit are counted as 1
+static const char* s_profNames[PROF_NAMES] = { 0, "(other)" };
+static unsigned int s_profCount = 2;
+static pthread_key_t s_profKey;
+static bool s_profKeyInit = false;
+
+// Called on thread termination, the counters are kept for the statistics
+static void profileThreadEnd(void* data)
+{
+    GlobalMutex::lock();
+    static_cast<MutexProfile*>(data)->free = true;
+    GlobalMutex::unlock();
+}
+
+// Get the identifier of a mutex name, register the name if new
+static unsigned int profileId(const char* name)
+{
+    if (TelEngine::null(name))
+	name = "(unnamed)";
+    unsigned int h = String::hash(name) % PROF_BUCKETS;
+    unsigned int id = 1;
+    GlobalMutex::lock();
+    ProfName* n = s_profHash[h];
+    while (n && ::strcmp(n->name,name))
+	n = n->next;
+    if (n)
+	id = n->id;
+    else if (s_profCount < PROF_NAMES) {
+	n = new ProfName;
+	n->name = ::strdup(name);
+	n->id = id = s_profCount;
+	n->next = s_profHash[h];
+	s_profHash[h] = n;
+	s_profNames[s_profCount++] = n->name;
+    }
+    GlobalMutex::unlock();
+    return id;
+}
+
+// Get the counters of the current thread for a mutex name
+static ProfCounters* profCounters(unsigned int id)
+{
+    MutexProfile* p = static_cast<MutexProfile*>(::pthread_getspecific(s_profKey));
+    if (!p) {
+	GlobalMutex::lock();
+	for (p = s_profiles; p && !p->free; p = p->next)
+	    ;
+	if (p)
+	    p->free = false;
+	else {
+	    p = static_cast<MutexProfile*>(::calloc(1,sizeof(MutexProfile)));
+	    p->gen = s_profGen;
+	    p->next = s_profiles;
+	    s_profiles = p;
+	}
+	GlobalMutex::unlock();
+	::pthread_setspecific(s_profKey,p);
+    }
+    if (p->gen != s_profGen) {
+	// statistics were reset, clear our own counters
+	for (unsigned int i = 0; i < PROF_CHUNKS; i++) {
+	    if (p->chunks[i])
+		::memset(p->chunks[i],0,PROF_CHUNK * sizeof(ProfCounters));
+	}
+	p->gen = s_profGen;
+    }
+    ProfCounters* c = p->chunks[id / PROF_CHUNK];
+    if (!c) {
+	c = static_cast<ProfCounters*>(::calloc(PROF_CHUNK,sizeof(ProfCounters)));
+	p->chunks[id / PROF_CHUNK] = c;
+    }
+    return c + (id % PROF_CHUNK);
+}
+
+#endif // _WINDOWS
+
 void GlobalMutex::init()
 {
     if (s_init) {
@@ -187,7 +305,7 @@ void GlobalMutex::unlock()
 
 MutexPrivate::MutexPrivate(bool recursive, const char* name)
     : m_refcount(1), m_locked(0), m_waiting(0), m_recursive(recursive),
-      m_name(name), m_owner(0)
+      m_name(name), m_owner(0), m_profId(0), m_lockTime(0)
 {
     GlobalMutex::lock();
     s_count++;
@@ -257,6 +375,20 @@ bool MutexPrivate::lock(long maxwait)
 	m_waiting++;
 	GlobalMutex::unlock();
     }
+    ProfCounters* prof = 0;
+    bool fast = false;
+    u_int64_t now = 0;
+#ifndef _WINDOWS
+    if (s_profiling && !s_unsafe) {
+	if (!m_profId)
+	    m_profId = profileId(m_name);
+	prof = profCounters(m_profId);
+	// uncontended if we get it right away
+	fast = !::pthread_mutex_trylock(&m_mutex);
+	if (!fast)
+	    now = Time::now();
+    }
+#endif
 #ifdef _WINDOWS
     DWORD ms = 0;
     if (maxwait < 0)
@@ -265,7 +397,7 @@ bool MutexPrivate::lock(long maxwait)
 	ms = (DWORD)(maxwait / 1000);
     rval = s_unsafe || (::WaitForSingleObject(m_mutex,ms) == WAIT_OBJECT_0);
 #else
-    if (s_unsafe)
+    if (s_unsafe || fast)
 	rval = true;
     else if (maxwait < 0)
 	rval = !::pthread_mutex_lock(&m_mutex);
@@ -297,6 +429,20 @@ bool MutexPrivate::lock(long maxwait)
 #endif // HAVE_TIMEDLOCK
     }
 #endif // _WINDOWS
+    if (prof) {
+	if (fast)
+	    now = Time::now();
+	else {
+	    u_int64_t wait = Time::now() - now;
+	    now += wait;
+	    prof->contended++;
+	    prof->waitTotal += wait;
+	    if (prof->waitMax < wait)
+		prof->waitMax = wait;
+	}
+	if (rval)
+	    prof->acquired++;
+    }
     if (safety) {
 	GlobalMutex::lock();
 	m_waiting--;
@@ -306,7 +452,8 @@ bool MutexPrivate::lock(long maxwait)
     if (rval) {
 	if (safety)
 	    s_locks++;
-	m_locked++;
+	if (!m_locked++)
+	    m_lockTime = now;
 	if (thr) {
 	    thr->m_locks++;
 	    m_owner = thr->name();
@@ -339,6 +486,15 @@ bool MutexPrivate::unlock()
 		Debug(DebugFail,"MutexPrivate '%s' unlocked by '%s' but owned by '%s' [%p]",
 		    m_name,tname,m_owner,this);
 	    m_owner = 0;
+#ifndef _WINDOWS
+	    if (m_lockTime) {
+		u_int64_t hold = Time::now() - m_lockTime;
+		m_lockTime = 0;
+		ProfCounters* prof = s_profiling ? profCounters(m_profId) : 0;
+		if (prof && (prof->holdMax < hold))
+		    prof->holdMax = hold;
+	    }
+#endif
 	}
 	if (safety) {
 	    int locks = --s_locks;
@@ -619,6 +775,110 @@ int Mutex::locks()
     return s_safety ? MutexPrivate::s_locks : -1;
 }
 
+void Mutex::enableProfiling(bool enable)
+{
+#ifndef _WINDOWS
+    GlobalMutex::lock();
+    if (enable && !s_profKeyInit)
+	s_profKeyInit = !::pthread_key_create(&s_profKey,profileThreadEnd);
+    s_profiling = enable && s_profKeyInit;
+    GlobalMutex::unlock();
+#endif
+}
+
+bool Mutex::profiling()
+{
+    return s_profiling;
+}
+
+void Mutex::resetProfiling()
+{
+    GlobalMutex::lock();
+    s_profGen++;
+    GlobalMutex::unlock();
+}
+
+// Check if a name has more contention than another
+static inline bool moreContended(const ProfCounters& c1, const ProfCounters& c2)
+{
+    if (c1.contended != c2.contended)
+	return c1.contended > c2.contended;
+    return c1.waitTotal > c2.waitTotal;
+}
+
+void Mutex::profilingStatus(String& str, bool details, unsigned int count)
+{
+    str << "profiling=" << String::boolText(s_profiling);
+#ifndef _WINDOWS
+    // sum up the counters of all threads
+    GlobalMutex::lock();
+    unsigned int names = s_profCount;
+    unsigned int gen = s_profGen;
+    ProfCounters* sum = new ProfCounters[names];
+    ::memset(sum,0,names * sizeof(ProfCounters));
+    for (const MutexProfile* p = s_profiles; p; p = p->next) {
+	if (p->gen != gen)
+	    continue;
+	for (unsigned int i = 0; i < PROF_CHUNKS; i++) {
+	    const ProfCounters* c = p->chunks[i];
+	    if (!c)
+		continue;
+	    for (unsigned int j = 0; j < PROF_CHUNK; j++) {
+		unsigned int id = i * PROF_CHUNK + j;
+		if (id >= names)
+		    break;
+		ProfCounters& s = sum[id];
+		s.acquired += c[j].acquired;
+		s.contended += c[j].contended;
+		s.waitTotal += c[j].waitTotal;
+		if (s.waitMax < c[j].waitMax)
+		    s.waitMax = c[j].waitMax;
+		if (s.holdMax < c[j].holdMax)
+		    s.holdMax = c[j].holdMax;
+	    }
+	}
+    }
+    GlobalMutex::unlock();
+    u_int64_t acquired = 0;
+    u_int64_t contended = 0;
+    u_int64_t wait = 0;
+    unsigned int used = 0;
+    // keep the most contended names sorted
+    unsigned int* top = new unsigned int[count + 1];
+    unsigned int n = 0;
+    for (unsigned int id = 1; id < names; id++) {
+	const ProfCounters& s = sum[id];
+	if (!s.acquired && !s.contended)
+	    continue;
+	used++;
+	acquired += s.acquired;
+	contended += s.contended;
+	wait += s.waitTotal;
+	unsigned int i = n;
+	while (i && moreContended(s,sum[top[i - 1]])) {
+	    top[i] = top[i - 1];
+	    i--;
+	}
+	if (i < count) {
+	    top[i] = id;
+	    if (n < count)
+		n++;
+	}
+    }
+    str << ",names=" << used << ",acquired=" << acquired;
+    str << ",contended=" << contended << ",waittotal=" << wait;
+    if (details) {
+	for (unsigned int i = 0; i < n; i++) {
+	    const ProfCounters& s = sum[top[i]];
+	    str << (i ? "," : ";") << s_profNames[top[i]] << "=" << s.acquired <<
+		"|" << s.contended << "|" << s.waitTotal << "|" << s.waitMax << "|" << s.holdMax;
+	}
+    }
+    delete[] top;
+    delete[] sum;
+#endif
+}
+
 bool Mutex::efficientTimedLock()
 {
 #if defined(_WINDOWS) || defined(HAVE_TIMEDLOCK)
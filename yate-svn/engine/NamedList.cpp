@@ -19,8 +19,250 @@
 
 #include "yateclass.h"
 
+#include <stdlib.h>
+#include <string.h>
+
 using namespace TelEngine;
 
+// Walking more than this many parameters in a lookup builds the name index
+#define INDEX_THRESHOLD 16
+
+// Named strings are preceded by a header pointing to their arena, if any
+#define ARENA_HEADER sizeof(void*)
+#define ARENA_ALIGN(s) (((s) + 7) & ~(size_t)7)
+// Arena block size limits
+#define ARENA_MIN 256
+#define ARENA_MAX 1048576
+// Initial count of an arena, must exceed the number of possible allocations
+#define ARENA_BIAS 0x40000000
+
+namespace TelEngine {
+
+// Bump allocator for the parameters of a list.
+// Allocations are done only by the owner list so they are just counted,
+//  the owner settles the count when it releases the arena. Only releases
+//  of parameters need to be atomic as they may happen in any thread
+class ParamArena
+{
+public:
+    static ParamArena* create(unsigned int size);
+    inline unsigned int avail() const
+	{ return m_size - m_used; }
+    inline void* alloc(size_t size)
+	{
+	    size = ARENA_ALIGN(size);
+	    if (size > avail())
+		return 0;
+	    void* ptr = reinterpret_cast<char*>(this + 1) + m_used;
+	    m_used += size;
+	    m_allocs++;
+	    return ptr;
+	}
+    // Owner list stops using the arena
+    inline void release()
+	{ drop(ARENA_BIAS - m_allocs); }
+    // A parameter allocated in the arena is deleted
+    inline void dropParam()
+	{ drop(1); }
+private:
+    void drop(int count);
+    volatile int m_count;
+    unsigned int m_size;
+    unsigned int m_used;
+    int m_allocs;
+};
+
+// Open addressing hash of parameter names, holds the first parameter
+//  of each name in list order so duplicate names resolve as a list scan would
+class NamedListIndex
+{
+public:
+    NamedListIndex(const ObjList& list);
+    inline ~NamedListIndex()
+	{ delete[] m_slots; }
+    NamedString* find(const String& name) const;
+    void add(NamedString* param);
+    bool remove(const NamedString* param);
+    bool replace(const NamedString* oldParam, NamedString* newParam);
+    // Hint to the last list item, avoids walking the list on append
+    ObjList* m_tail;
+private:
+    void insert(NamedString* param);
+    void grow();
+    NamedString** m_slots;
+    unsigned int m_mask;
+    unsigned int m_used;
+};
+
+}; // namespace TelEngine
+
+#ifndef ATOMIC_OPS
+static Mutex s_arenaMutex(false,"ParamArena");
+static Mutex s_indexMutex(false,"NamedListIndex");
+#endif
+
+// Memory is allocated right after the arena object
+ParamArena* ParamArena::create(unsigned int size)
+{
+    ParamArena* arena = static_cast<ParamArena*>(::malloc(sizeof(ParamArena) + size));
+    if (!arena)
+	return 0;
+    arena->m_count = ARENA_BIAS;
+    arena->m_size = size;
+    arena->m_used = 0;
+    arena->m_allocs = 0;
+    return arena;
+}
+
+void ParamArena::drop(int count)
+{
+#ifdef ATOMIC_OPS
+    if (__sync_sub_and_fetch(&m_count,count))
+	return;
+#else
+    s_arenaMutex.lock();
+    int left = (m_count -= count);
+    s_arenaMutex.unlock();
+    if (left)
+	return;
+#endif
+    ::free(this);
+}
+
+NamedListIndex::NamedListIndex(const ObjList& list)
+    : m_tail(0), m_slots(0), m_mask(0), m_used(0)
+{
+    unsigned int size = 64;
+    unsigned int n = list.count();
+    while (size < 2 * n)
+	size <<= 1;
+    m_mask = size - 1;
+    m_slots = new NamedString*[size];
+    ::memset(m_slots,0,size * sizeof(NamedString*));
+    const ObjList* l = &list;
+    for (; l; l = l->next()) {
+	if (l->get())
+	    add(static_cast<NamedString*>(l->get()));
+	m_tail = const_cast<ObjList*>(l);
+    }
+}
+
+NamedString* NamedListIndex::find(const String& name) const
+{
+    unsigned int h = name.hash();
+    for (unsigned int i = h & m_mask; m_slots[i]; i = (i + 1) & m_mask) {
+	NamedString* s = m_slots[i];
+	// interned names match by address
+	if ((s->atom() == &name) || (s->name().hash() == h && s->name() == name))
+	    return s;
+    }
+    return 0;
+}
+
+void NamedListIndex::add(NamedString* param)
+{
+    if (find(param->name()))
+	return;
+    if (2 * (m_used + 1) > m_mask + 1)
+	grow();
+    insert(param);
+}
+
+// Remove the slot holding a parameter, shifts back the rest of the cluster
+bool NamedListIndex::remove(const NamedString* param)
+{
+    unsigned int i = param->name().hash() & m_mask;
+    while (m_slots[i] != param) {
+	if (!m_slots[i])
+	    return false;
+	i = (i + 1) & m_mask;
+    }
+    unsigned int j = i;
+    for (;;) {
+	j = (j + 1) & m_mask;
+	if (!m_slots[j])
+	    break;
+	unsigned int k = m_slots[j]->name().hash() & m_mask;
+	// move the entry back unless its home slot lies cyclically in (i,j]
+	if ((i <= j) ? ((i < k) && (k <= j)) : ((i < k) || (k <= j)))
+	    continue;
+	m_slots[i] = m_slots[j];
+	i = j;
+    }
+    m_slots[i] = 0;
+    m_used--;
+    return true;
+}
+
+bool NamedListIndex::replace(const NamedString* oldParam, NamedString* newParam)
+{
+    unsigned int i = oldParam->name().hash() & m_mask;
+    for (; m_slots[i]; i = (i + 1) & m_mask) {
+	if (m_slots[i] == oldParam) {
+	    m_slots[i] = newParam;
+	    return true;
+	}
+    }
+    return false;
+}
+
+void NamedListIndex::insert(NamedString* param)
+{
+    unsigned int i = param->name().hash() & m_mask;
+    while (m_slots[i])
+	i = (i + 1) & m_mask;
+    m_slots[i] = param;
+    m_used++;
+}
+
+void NamedListIndex::grow()
+{
+    NamedString** old = m_slots;
+    unsigned int size = m_mask + 1;
+    m_mask = 2 * size - 1;
+    m_used = 0;
+    m_slots = new NamedString*[2 * size];
+    ::memset(m_slots,0,2 * size * sizeof(NamedString*));
+    for (unsigned int i = 0; i < size; i++)
+	if (old[i])
+	    insert(old[i]);
+    delete[] old;
+}
+
+void* NamedString::operator new(size_t size)
+{
+    char* ptr = static_cast<char*>(::operator new(size + ARENA_HEADER));
+    *reinterpret_cast<ParamArena**>(ptr) = 0;
+    return ptr + ARENA_HEADER;
+}
+
+void* NamedString::operator new(size_t size, ParamArena* arena)
+{
+    char* ptr = arena ? static_cast<char*>(arena->alloc(size + ARENA_HEADER)) : 0;
+    if (!ptr)
+	return operator new(size);
+    *reinterpret_cast<ParamArena**>(ptr) = arena;
+    return ptr + ARENA_HEADER;
+}
+
+void NamedString::operator delete(void* ptr)
+{
+    if (!ptr)
+	return;
+    char* p = static_cast<char*>(ptr) - ARENA_HEADER;
+    ParamArena* arena = *reinterpret_cast<ParamArena**>(p);
+    if (arena)
+	arena->dropParam();
+    else
+	::operator delete(p);
+}
+
+void NamedString::operator delete(void* ptr, ParamArena* arena)
+{
+    operator delete(ptr);
+}
+
+
 static const NamedList s_empty("");
 
 const NamedList& NamedList::empty()
@@ -29,26 +271,37 @@ const NamedList& NamedList::empty()
 }
 
 NamedList::NamedList(const char* name)
-    : String(name)
+    : String(name),
+      m_index(0), m_arena(0), m_arenaSize(0)
 {
 }
 
 NamedList::NamedList(const NamedList& original)
-    : String(original)
+    : String(original),
+      m_index(0), m_arena(0), m_arenaSize(original.m_arenaSize)
 {
     ObjList* dest = &m_params;
     for (const ObjList* l = original.m_params.skipNull(); l; l = l->skipNext()) {
 	const NamedString* p = static_cast<const NamedString*>(l->get());
-	dest = dest->append(new NamedString(p->name(),*p));
+	dest = dest->append(makeParam(p->name(),*p,p->atom()));
     }
 }
 
 NamedList::NamedList(const char* name, const NamedList& original, const String& prefix)
-    : String(name)
+    : String(name),
+      m_index(0), m_arena(0), m_arenaSize(0)
 {
     copySubParams(original,prefix);
 }
 
+NamedList::~NamedList()
+{
+    dropIndex();
+    // parameters still allocated in the arena keep it alive
+    if (m_arena)
+	m_arena->release();
+}
+
 NamedList& NamedList::operator=(const NamedList& value)
 {
     String::operator=(value);
@@ -63,12 +316,60 @@ void* NamedList::getObject(const String& name) const
     return String::getObject(name);
 }
 
+void NamedList::clearIndex()
+{
+    delete m_index;
+    m_index = 0;
+}
+
+void NamedList::setArena(unsigned int size)
+{
+    if (size && size < ARENA_MIN)
+	size = ARENA_MIN;
+    else if (size > ARENA_MAX)
+	size = ARENA_MAX;
+    if ((size != m_arenaSize) && m_arena) {
+	m_arena->release();
+	m_arena = 0;
+    }
+    m_arenaSize = size;
+}
+
+// Build a new parameter, shares the atom name if one is provided or already
+//  exists, allocates it in the arena if the list uses one
+// Only arena lists (short lived messages) create new atoms, other lists may
+//  hold arbitrary names that would fill the immortal atom table
+NamedString* NamedList::makeParam(const char* name, const char* value, const String* atom)
+{
+    if (!atom)
+	atom = m_arenaSize ? String::atom(name,true) : String::atomLookup(name);
+    if (m_arenaSize && (!m_arena || m_arena->avail() < ARENA_ALIGN(sizeof(NamedString) + ARENA_HEADER))) {
+	if (m_arena)
+	    m_arena->release();
+	m_arena = ParamArena::create(m_arenaSize);
+    }
+    if (atom)
+	return new(m_arena) NamedString(atom,value);
+    return new(m_arena) NamedString(name,value);
+}
+
+// Append a parameter at the end of the list, keeps the index in sync
+static inline void appendParam(ObjList& list, NamedListIndex* index, NamedString* param)
+{
+    if (!index) {
+	list.append(param);
+	return;
+    }
+    index->m_tail = (index->m_tail ? index->m_tail : &list)->append(param);
+    index->add(param);
+}
+
 NamedList& NamedList::addParam(NamedString* param)
 {
     XDebug(DebugInfo,"NamedList::addParam(%p) [\"%s\",\"%s\"]",
         param,(param ? param->name().c_str() : ""),TelEngine::c_safe(param));
     if (param)
-	m_params.append(param);
+	appendParam(m_params,m_index,param);
     return *this;
 }
 
@@ -76,13 +377,55 @@ NamedList& NamedList::addParam(const char* name, const char* value, bool emptyOK
 {
     XDebug(DebugInfo,"NamedList::addParam(\"%s\",\"%s\",%s)",name,value,String::boolText(emptyOK));
     if (emptyOK || !TelEngine::null(value))
-	m_params.append(new NamedString(name, value));
+	appendParam(m_params,m_index,makeParam(name,value));
+    return *this;
+}
+
+NamedList& NamedList::setParam(NamedString* param)
+{
+    if (!param)
+	return *this;
+    if (!m_index) {
+	m_params.setUnique(param);
+	return *this;
+    }
+    NamedString* s = m_index->find(param->name());
+    if (!s) {
+	appendParam(m_params,m_index,param);
+	return *this;
+    }
+    if (s == param)
+	return *this;
+    ObjList* o = m_params.find(s);
+    if (o) {
+	m_index->replace(s,param);
+	o->set(param);
+    }
+    else {
+	// index got out of sync with the list, drop it
+	clearIndex();
+	m_params.setUnique(param);
+    }
     return *this;
 }
 
 NamedList& NamedList::setParam(const String& name, const char* value)
 {
     XDebug(DebugInfo,"NamedList::setParam(\"%s\",\"%s\")",name.c_str(),value);
+    return putParam(name,value,0);
+}
+
+// Set a parameter, a new one gets the name atom if provided
+NamedList& NamedList::putParam(const String& name, const char* value, const String* atom)
+{
+    if (m_index) {
+	NamedString* s = m_index->find(name);
+	if (s)
+	    *s = value;
+	else
+	    appendParam(m_params,m_index,makeParam(name,value,atom));
+	return *this;
+    }
     ObjList *p = m_params.skipNull();
     while (p) {
         NamedString *s = static_cast<NamedString*>(p->get());
@@ -97,9 +440,9 @@ NamedList& NamedList::setParam(const String& name, const char* value)
 	    break;
     }
     if (p)
-	p->append(new NamedString(name,value));
+	p->append(makeParam(name,value,atom));
     else
-	m_params.append(new NamedString(name,value));
+	m_params.append(makeParam(name,value,atom));
     return *this;
 }
 
@@ -110,11 +453,19 @@ NamedList& NamedList::clearParam(const String& name, char childSep)
     String tmp;
     if (childSep)
 	tmp << name << childSep;
+    else if (m_index && !m_index->find(name))
+	return *this;
     ObjList *p = &m_params;
     while (p) {
         NamedString *s = static_cast<NamedString *>(p->get());
-        if (s && ((s->name() == name) || s->name().startsWith(tmp)))
+        if (s && ((s->name() == name) || s->name().startsWith(tmp))) {
+	    if (m_index) {
+		// all parameters with this name go away so no successor is needed
+		m_index->remove(s);
+		m_index->m_tail = 0;
+	    }
             p->remove();
+	}
 	else
 	    p = p->next();
     }
@@ -127,8 +478,22 @@ NamedList& NamedList::clearParam(NamedString* param, bool delParam)
     if (!param)
 	return *this;
     ObjList* o = m_params.find(param);
-    if (o)
+    if (o) {
+	if (m_index) {
+	    m_index->m_tail = 0;
+	    if (m_index->remove(param)) {
+		// a later parameter with the same name becomes the indexed one
+		for (ObjList* l = o->skipNext(); l; l = l->skipNext()) {
+		    NamedString* s = static_cast<NamedString*>(l->get());
+		    if (s->name() == param->name()) {
+			m_index->add(s);
+			break;
+		    }
+		}
+	    }
+	}
 	o->remove(delParam);
+    }
     XDebug(DebugInfo,"NamedList::clearParam(%p) found=%p",param,o);
     return *this;
 }
@@ -140,7 +505,7 @@ NamedList& NamedList::copyParam(const NamedList& original, const String& name, c
     if (!childSep) {
 	// faster and simpler - used in most cases
 	const NamedString* s = original.getParam(name);
-	return s ? setParam(name,*s) : clearParam(name);
+	return s ? putParam(name,*s,s->atom()) : clearParam(name);
     }
     clearParam(name,childSep);
     String tmp;
@@ -148,8 +513,14 @@ NamedList& NamedList::copyParam(const NamedList& original, const String& name, c
     ObjList* dest = &m_params;
     for (const ObjList* l = original.m_params.skipNull(); l; l = l->skipNext()) {
 	const NamedString* s = static_cast<const NamedString*>(l->get());
-        if ((s->name() == name) || s->name().startsWith(tmp))
-	    dest = dest->append(new NamedString(s->name(),*s));
+        if ((s->name() == name) || s->name().startsWith(tmp)) {
+	    NamedString* ns = makeParam(s->name(),*s,s->atom());
+	    dest = dest->append(ns);
+	    if (m_index) {
+		m_index->add(ns);
+		m_index->m_tail = dest;
+	    }
+	}
     }
     return *this;
 }
@@ -159,7 +530,7 @@ NamedList& NamedList::copyParams(const NamedList& original)
     XDebug(DebugInfo,"NamedList::copyParams(%p) [%p]",&original,this);
     for (const ObjList* l = original.m_params.skipNull(); l; l = l->skipNext()) {
 	const NamedString* p = static_cast<const NamedString*>(l->get());
-	setParam(p->name(),*p);
+	putParam(p->name(),*p,p->atom());
     }
     return *this;
 }
@@ -207,12 +578,18 @@ NamedList& NamedList::copySubParams(const NamedList& original, const String& pre
 		const char* name = s->name().c_str() + offs;
 		if (!*name)
 		    continue;
-		if (!replace)
-		    dest = dest->append(new NamedString(name,*s));
+		if (!replace) {
+		    NamedString* ns = makeParam(name,*s,(offs ? 0 : s->atom()));
+		    dest = dest->append(ns);
+		    if (m_index) {
+			m_index->add(ns);
+			m_index->m_tail = dest;
+		    }
+		}
 		else if (offs)
 		    setParam(name,*s);
 		else
-		    setParam(s->name(),*s);
+		    putParam(s->name(),*s,s->atom());
 	    }
 	}
     }
@@ -272,13 +649,36 @@ int NamedList::getIndex(const String& name) const
 NamedString* NamedList::getParam(const String& name) const
 {
     XDebug(DebugInfo,"NamedList::getParam(\"%s\")",name.c_str());
+    NamedListIndex* idx = m_index;
+    if (idx)
+	return idx->find(name);
+    NamedString* found = 0;
+    unsigned int n = 0;
     const ObjList *p = m_params.skipNull();
     for (; p; p=p->skipNext()) {
         NamedString *s = static_cast<NamedString *>(p->get());
-        if (s->name() == name)
-            return s;
+        if ((s->atom() == &name) || (s->name() == name)) {
+	    found = s;
+	    break;
+	}
+	n++;
     }
-    return 0;
+    if (n > INDEX_THRESHOLD) {
+	// concurrent readers of a const list may race to build, first one wins
+	idx = new NamedListIndex(m_params);
+#ifdef ATOMIC_OPS
+	if (!__sync_bool_compare_and_swap(&m_index,(NamedListIndex*)0,idx))
+	    delete idx;
+#else
+	s_indexMutex.lock();
+	if (m_index)
+	    delete idx;
+	else
+	    m_index = idx;
+	s_indexMutex.unlock();
+#endif
+    }
+    return found;
 }
 
 NamedString* NamedList::getParam(unsigned int index) const
@@ -56,6 +56,9 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <utime.h>
+#ifdef __linux__
+#include <netinet/udp.h>
+#endif
 #endif
 
 #ifndef SHUT_RD
@@ -71,6 +74,7 @@
 #endif
 
 #define MAX_SOCKLEN 1024
+#define MAX_MULTIMSG 16
 #define MAX_RESWAIT 5000000
 
 using namespace TelEngine;
@@ -1895,6 +1899,83 @@ int Socket::sendTo(const void* buffer, int length, const struct sockaddr* addr,
     return res;
 }
 
+int Socket::sendToMulti(const void* buffer, const int* lengths, int count, const SocketAddr& addr,
+    int flags, bool* segment)
+{
+    if (!(buffer && lengths && (count > 0)))
+	return 0;
+    if (count > MAX_MULTIMSG)
+	count = MAX_MULTIMSG;
+    const char* buf = (const char*)buffer;
+#ifdef MSG_WAITFORONE
+#ifdef UDP_SEGMENT
+    if (segment && *segment && (count > 1)) {
+	// kernel splits in segments of the first length, only the last may be shorter
+	int total = 0;
+	for (int i = 0; i < count; i++) {
+	    if ((lengths[i] > lengths[0]) || ((lengths[i] < lengths[0]) && (i < count - 1))) {
+		total = -1;
+		break;
+	    }
+	    total += lengths[i];
+	}
+	if (total > 0) {
+	    struct iovec iov;
+	    iov.iov_base = (void*)buf;
+	    iov.iov_len = total;
+	    char ctl[CMSG_SPACE(sizeof(u_int16_t))];
+	    ::memset(ctl,0,sizeof(ctl));
+	    struct msghdr hdr;
+	    ::memset(&hdr,0,sizeof(hdr));
+	    hdr.msg_name = addr.address();
+	    hdr.msg_namelen = addr.length();
+	    hdr.msg_iov = &iov;
+	    hdr.msg_iovlen = 1;
+	    hdr.msg_control = ctl;
+	    hdr.msg_controllen = sizeof(ctl);
+	    struct cmsghdr* cm = CMSG_FIRSTHDR(&hdr);
+	    cm->cmsg_level = SOL_UDP;
+	    cm->cmsg_type = UDP_SEGMENT;
+	    cm->cmsg_len = CMSG_LEN(sizeof(u_int16_t));
+	    *(u_int16_t*)CMSG_DATA(cm) = lengths[0];
+	    int res = ::sendmsg(m_handle,&hdr,flags);
+	    if (checkError(res,true))
+		return count;
+	    // not a UDP socket or no offload support - don't try again
+	    if ((m_error != EINVAL) && (m_error != ENOPROTOOPT) && (m_error != EIO)
+		&& (m_error != EOPNOTSUPP))
+		return res;
+	    *segment = false;
+	}
+    }
+#endif
+    struct mmsghdr msgs[MAX_MULTIMSG];
+    struct iovec iovs[MAX_MULTIMSG];
+    ::memset(msgs,0,count * sizeof(struct mmsghdr));
+    for (int i = 0; i < count; i++) {
+	iovs[i].iov_base = (void*)buf;
+	iovs[i].iov_len = lengths[i];
+	buf += lengths[i];
+	msgs[i].msg_hdr.msg_iov = &iovs[i];
+	msgs[i].msg_hdr.msg_iovlen = 1;
+	msgs[i].msg_hdr.msg_name = addr.address();
+	msgs[i].msg_hdr.msg_namelen = addr.length();
+    }
+    int res = ::sendmmsg(m_handle,msgs,count,flags);
+    checkError(res,true);
+    return res;
+#else
+    int n = 0;
+    for (; n < count; n++) {
+	int res = sendTo(buf,lengths[n],addr,flags);
+	if (res == socketError())
+	    return n ? n : res;
+	buf += lengths[n];
+    }
+    return n;
+#endif
+}
+
 int Socket::send(const void* buffer, int length, int flags)
 {
     if (!buffer)
@@ -1941,6 +2022,51 @@ int Socket::recvFrom(void* buffer, int length, SocketAddr& addr, int flags)
     return res;
 }
 
+int Socket::recvFromMulti(void* buffer, int size, int count, int* lengths, SocketAddr* addrs, int flags)
+{
+    if (!(buffer && lengths && addrs && (size > 0) && (count > 0)))
+	return 0;
+    if (count > MAX_MULTIMSG)
+	count = MAX_MULTIMSG;
+    char* buf = (char*)buffer;
+#ifdef MSG_WAITFORONE
+    struct mmsghdr msgs[MAX_MULTIMSG];
+    struct iovec iovs[MAX_MULTIMSG];
+    struct sockaddr_storage srcs[MAX_MULTIMSG];
+    ::memset(msgs,0,count * sizeof(struct mmsghdr));
+    for (int i = 0; i < count; i++) {
+	iovs[i].iov_base = buf + i * size;
+	iovs[i].iov_len = size;
+	msgs[i].msg_hdr.msg_iov = &iovs[i];
+	msgs[i].msg_hdr.msg_iovlen = 1;
+	msgs[i].msg_hdr.msg_name = &srcs[i];
+	msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_storage);
+    }
+    int res = ::recvmmsg(m_handle,msgs,count,flags,0);
+    if (!checkError(res,true))
+	return res;
+    for (int i = 0; i < res; i++) {
+	int len = msgs[i].msg_len;
+	const struct sockaddr* addr = (const struct sockaddr*)&srcs[i];
+	socklen_t adrlen = msgs[i].msg_hdr.msg_namelen;
+	if (applyFilters(buf + i * size,len,flags,addr,adrlen))
+	    len = 0;
+	lengths[i] = len;
+	addrs[i].assign(addr,adrlen);
+    }
+    return res;
+#else
+    int n = 0;
+    for (; n < count; n++) {
+	int res = recvFrom(buf + n * size,size,addrs[n],flags);
+	if (res == socketError())
+	    return n ? n : res;
+	lengths[n] = res;
+    }
+    return n;
+#endif
+}
+
 int Socket::recv(void* buffer, int length, int flags)
 {
     if (!buffer)
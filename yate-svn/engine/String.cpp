@@ -293,10 +293,54 @@ void StringMatchPrivate::fixup()
 }
 
 
+// Atoms are kept in a fixed hash table of immortal entries so they can be
+//  looked up without locking, new entries are published at bucket heads
+#define ATOM_BUCKETS 1024
+// Limits for atoms created on demand from arbitrary names
+#define ATOM_MAX_COUNT 16384
+#define ATOM_MAX_LENGTH 128
+
+namespace { // anonymous
+
+class AtomEntry
+{
+public:
+    inline AtomEntry(const char* val, AtomEntry* next)
+	: m_atom(val), m_next(next)
+	{ m_atom.hash(); }
+    String m_atom;
+    AtomEntry* m_next;
+};
+
+}; // anonymous namespace
+
 static const String s_empty;
-static ObjList s_atoms;
+static AtomEntry* volatile s_atoms[ATOM_BUCKETS];
+static unsigned int s_atomCount = 0;
 static Mutex s_mutex(false,"Atom");
 
+static const String* atomFind(const char* val, unsigned int hash)
+{
+    for (AtomEntry* e = s_atoms[hash % ATOM_BUCKETS]; e; e = e->m_next) {
+	if ((e->m_atom.hash() == hash) && (e->m_atom == val))
+	    return &e->m_atom;
+    }
+    return 0;
+}
+
+// Called with s_mutex held
+static const String* atomInsert(const char* val, unsigned int hash)
+{
+    AtomEntry* e = new AtomEntry(val,s_atoms[hash % ATOM_BUCKETS]);
+#ifdef ATOMIC_OPS
+    // the entry must be complete before readers can see it
+    __sync_synchronize();
+#endif
+    s_atoms[hash % ATOM_BUCKETS] = e;
+    s_atomCount++;
+    return &e->m_atom;
+}
+
 const String& String::empty()
 {
     return s_empty;
@@ -1702,11 +1746,10 @@ const String* String::atom(const String*& str, const char* val)
 	    if (TelEngine::null(val))
 		str = &s_empty;
 	    else {
-		str = static_cast<const String*>(s_atoms[val]);
-		if (!str) {
-		    str = new String(val);
-		    s_atoms.insert(str);
-		}
+		unsigned int h = hash(val);
+		str = atomFind(val,h);
+		if (!str)
+		    str = atomInsert(val,h);
 	    }
 	}
 	s_mutex.unlock();
@@ -1714,6 +1757,41 @@ const String* String::atom(const String*& str, const char* val)
     return str;
 }
 
+const String* String::atom(const char* val, bool limit)
+{
+    if (TelEngine::null(val))
+	return &s_empty;
+    // long values are never created with limit so there is nothing to find
+    if (limit && (::strlen(val) > ATOM_MAX_LENGTH))
+	return 0;
+    unsigned int h = hash(val);
+    const String* str = 0;
+#ifdef ATOMIC_OPS
+    str = atomFind(val,h);
+    if (str)
+	return str;
+    // a full table can only be searched, don't lock just to fail
+    if (limit && (s_atomCount >= ATOM_MAX_COUNT))
+	return 0;
+#endif
+    Lock lck(s_mutex);
+    str = atomFind(val,h);
+    if (str || (limit && (s_atomCount >= ATOM_MAX_COUNT)))
+	return str;
+    return atomInsert(val,h);
+}
+
+const String* String::atomLookup(const char* val)
+{
+    if (TelEngine::null(val))
+	return &s_empty;
+#ifdef ATOMIC_OPS
+    return atomFind(val,hash(val));
+#else
+    return 0;
+#endif
+}
+
 
 Regexp::Regexp()
     : m_regexp(0), m_flags(0)
@@ -1816,14 +1894,31 @@ bool Regexp::isCaseInsensitive() const
 
 
 NamedString::NamedString(const char* name, const char* value)
-    : String(value), m_name(name)
+    : String(value), m_name(name), m_atom(0)
 {
     XDebug(DebugAll,"NamedString::NamedString(\"%s\",\"%s\") [%p]",name,value,this);
 }
 
+NamedString::NamedString(const String* name, const char* value)
+    : String(value), m_atom(name)
+{
+    XDebug(DebugAll,"NamedString::NamedString(%p,\"%s\") [%p]",name,value,this);
+}
+
+void NamedString::rename(const char* name)
+{
+#ifdef DEBUG
+    // atoms are shared by all lists, one written in place no longer finds itself
+    if (m_atom && (String::atomLookup(m_atom->c_str()) != m_atom))
+	Debug(DebugFail,"NamedString atom name '%s' was modified [%p]",m_atom->c_str(),this);
+#endif
+    m_name = name;
+    m_atom = 0;
+}
+
 const String& NamedString::toString() const
 {
-    return m_name;
+    return name();
 }
 
 void* NamedString::getObject(const String& name) const
@@ -636,7 +636,7 @@ RTPTransport* UDPSession::createTransport()
     return trans;
 }
 
-bool UDPSession::initGroup(int msec, Thread::Priority prio)
+bool UDPSession::initGroup(int msec, Thread::Priority prio, bool events, bool txBatch)
 {
     if (m_group)
 	return true;
@@ -644,7 +644,7 @@ bool UDPSession::initGroup(int msec, Thread::Priority prio)
     if (m_transport)
 	group(m_transport->group());
     if (!m_group)
-	group(new RTPGroup(msec,prio));
+	group(new RTPGroup(msec,prio,events,txBatch));
     if (!m_group)
 	return false;
     if (m_transport)
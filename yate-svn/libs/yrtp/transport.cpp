@@ -20,12 +20,33 @@
 
 #include <yatertp.h>
 
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <string.h>
+#define RTP_EVENTS
+#endif
+
 #define BUF_SIZE 1500
+// Maximum number of packets read from a socket in one call
+#define RX_BATCH 8
+// Maximum number of socket events handled in one wait
+#define MAX_EVENTS 32
+// Maximum number of packets queued for sending in one batch
+#define TX_BATCH 16
 
 using namespace TelEngine;
 
 static unsigned long s_sleep = 5;
 
+// Socket of a processor watched by an event driven group
+struct PollEntry
+{
+    RTPProcessor* proc;
+    Socket* sock;
+};
+
 // Set IPv6 sin6_scope_id for remote addresses from local address
 // recvFrom() will set the sin6_scope_id of the remote socket address
 // This will avoid socket address comparison mismatch (same address, different scope id)
@@ -42,11 +63,17 @@ static inline void setScopeId(const SocketAddr& local, SocketAddr& sa1,
 }
 
 
-RTPGroup::RTPGroup(int msec, Priority prio)
+RTPGroup::RTPGroup(int msec, Priority prio, bool events, bool txBatch)
     : Mutex(true,"RTPGroup"),
-      Thread("RTP Group",prio), m_listChanged(false)
+      Thread("RTP Group",prio), m_listChanged(false), m_pollChanged(true),
+      m_events(events && eventsSupported()),
+      m_pollHandle(-1), m_timerHandle(-1),
+      m_txBatch(txBatch), m_txMutex(false,"RTPGroupTx"), m_txFirst(0),
+      m_txBatches(0), m_txPackets(0), m_txDropped(0), m_txMaxBatch(0),
+      m_txFlushes(0), m_txLatency(0), m_txMaxLatency(0)
 {
-    DDebug(DebugInfo,"RTPGroup::RTPGroup() [%p]",this);
+    DDebug(DebugInfo,"RTPGroup::RTPGroup(%d,%d,%s,%s) [%p]",
+	msec,prio,String::boolText(m_events),String::boolText(txBatch),this);
     if (msec < 1)
 	msec = 1;
     if (msec > 50)
@@ -57,6 +84,7 @@ RTPGroup::RTPGroup(int msec, Priority prio)
 RTPGroup::~RTPGroup()
 {
     DDebug(DebugInfo,"RTPGroup::~RTPGroup() [%p]",this);
+    closePoll();
 }
 
 void RTPGroup::cleanup()
@@ -75,12 +103,19 @@ void RTPGroup::cleanup()
 	l = l->next();
     }
     m_processors.clear();
+    closePoll();
     unlock();
 }
 
 void RTPGroup::run()
 {
     DDebug(DebugInfo,"RTPGroup::run() [%p]",this);
+    if (m_events) {
+	runEvents();
+	if (m_events)
+	    return;
+	Debug(DebugMild,"RTPGroup falling back to sleep and poll [%p]",this);
+    }
     bool ok = true;
     while (ok) {
 	unsigned long msec = m_sleep;
@@ -102,17 +137,180 @@ void RTPGroup::run()
 		    break;
 	    }
 	}
+	txFlush();
 	unlock();
 	Thread::msleep(msec,true);
     }
     DDebug(DebugInfo,"RTPGroup::run() ran out of processors [%p]",this);
 }
 
+// Event driven loop: wait for sockets to become readable and for a periodic
+//  timer, only readable sockets are read and only on timer all processors
+//  get their timerTick() to do the periodic work
+void RTPGroup::runEvents()
+{
+#ifdef RTP_EVENTS
+    bool ok = true;
+    unsigned long msec = m_sleep;
+    if (msec < s_sleep)
+	msec = s_sleep;
+    lock();
+    if (m_timerHandle < 0)
+	m_timerHandle = ::timerfd_create(CLOCK_MONOTONIC,TFD_NONBLOCK|TFD_CLOEXEC);
+    if (m_timerHandle >= 0) {
+	struct itimerspec its;
+	its.it_interval.tv_sec = msec / 1000;
+	its.it_interval.tv_nsec = (msec % 1000) * 1000000;
+	its.it_value = its.it_interval;
+	if (::timerfd_settime(m_timerHandle,0,&its,0)) {
+	    ::close(m_timerHandle);
+	    m_timerHandle = -1;
+	}
+    }
+    if (m_timerHandle < 0) {
+	Debug(DebugWarn,"RTPGroup could not create periodic timer: %d [%p]",errno,this);
+	m_events = false;
+	unlock();
+	return;
+    }
+    m_pollChanged = true;
+    unlock();
+    struct epoll_event events[MAX_EVENTS];
+    while (ok) {
+	lock();
+	if (m_pollChanged && !buildPoll()) {
+	    m_events = false;
+	    closePoll();
+	    unlock();
+	    return;
+	}
+	int epfd = m_pollHandle;
+	unlock();
+	int n = ::epoll_wait(epfd,events,MAX_EVENTS,2 * msec);
+	Thread::check();
+	if (n < 0) {
+	    if (errno == EINTR)
+		continue;
+	    Debug(DebugWarn,"RTPGroup wait failed: %d [%p]",errno,this);
+	    lock();
+	    m_events = false;
+	    closePoll();
+	    unlock();
+	    return;
+	}
+	lock();
+	Time t;
+	// if the processors changed since the poll set was built the events
+	//  may refer to gone processors so just tick all of them
+	bool tick = m_pollChanged || !n;
+	m_listChanged = false;
+	const PollEntry* entries = static_cast<const PollEntry*>(m_pollList.data());
+	unsigned int count = m_pollList.length() / sizeof(PollEntry);
+	for (int i = 0; !tick && (i < n); i++) {
+	    unsigned int idx = (unsigned int)events[i].data.u32;
+	    if (idx >= count) {
+		u_int64_t exp = 0;
+		tick = ::read(m_timerHandle,&exp,sizeof(exp)) > 0;
+		continue;
+	    }
+	    entries[idx].proc->socketReady(entries[idx].sock,t);
+	    if (m_listChanged)
+		break;
+	}
+	if (tick) {
+	    ObjList* l = &m_processors;
+	    m_listChanged = false;
+	    for (ok = false; l; l = l->next()) {
+		RTPProcessor* p = static_cast<RTPProcessor*>(l->get());
+		if (p) {
+		    ok = true;
+		    p->timerTick(t);
+		    if (m_listChanged)
+			break;
+		}
+	    }
+	}
+	else
+	    ok = (0 != m_processors.skipNull());
+	txFlush();
+	unlock();
+    }
+    DDebug(DebugInfo,"RTPGroup::runEvents() ran out of processors [%p]",this);
+#else
+    m_events = false;
+#endif
+}
+
+// Rebuild the set of watched sockets, must be called with the group locked
+bool RTPGroup::buildPoll()
+{
+#ifdef RTP_EVENTS
+    m_pollChanged = false;
+    if (m_pollHandle >= 0)
+	::close(m_pollHandle);
+    m_pollHandle = ::epoll_create1(EPOLL_CLOEXEC);
+    if (m_pollHandle < 0) {
+	Debug(DebugWarn,"RTPGroup could not create event poll: %d [%p]",errno,this);
+	return false;
+    }
+    m_pollList.clear();
+    for (ObjList* l = m_processors.skipNull(); l; l = l->skipNext()) {
+	RTPProcessor* p = static_cast<RTPProcessor*>(l->get());
+	Socket* socks[4];
+	unsigned int cnt = p->pollSockets(socks,4);
+	for (unsigned int i = 0; i < cnt; i++) {
+	    if (!(socks[i] && socks[i]->valid()))
+		continue;
+	    PollEntry entry;
+	    entry.proc = p;
+	    entry.sock = socks[i];
+	    struct epoll_event ev;
+	    ::memset(&ev,0,sizeof(ev));
+	    ev.events = EPOLLIN;
+	    ev.data.u32 = m_pollList.length() / sizeof(PollEntry);
+	    if (::epoll_ctl(m_pollHandle,EPOLL_CTL_ADD,socks[i]->handle(),&ev))
+		Debug(DebugMild,"RTPGroup could not watch socket %d: %d [%p]",
+		    socks[i]->handle(),errno,this);
+	    else
+		m_pollList.append(&entry,sizeof(entry));
+	}
+    }
+    // the periodic timer gets an index past the end of the socket list
+    struct epoll_event ev;
+    ::memset(&ev,0,sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.u32 = 0xffffffff;
+    if (::epoll_ctl(m_pollHandle,EPOLL_CTL_ADD,m_timerHandle,&ev)) {
+	Debug(DebugWarn,"RTPGroup could not watch periodic timer: %d [%p]",errno,this);
+	return false;
+    }
+    XDebug(DebugAll,"RTPGroup watching %u sockets [%p]",
+	m_pollList.length() / (unsigned int)sizeof(PollEntry),this);
+    return true;
+#else
+    return false;
+#endif
+}
+
+void RTPGroup::closePoll()
+{
+#ifdef RTP_EVENTS
+    if (m_pollHandle >= 0)
+	::close(m_pollHandle);
+    if (m_timerHandle >= 0)
+	::close(m_timerHandle);
+#endif
+    m_pollHandle = -1;
+    m_timerHandle = -1;
+    m_pollList.clear();
+}
+
 void RTPGroup::join(RTPProcessor* proc)
 {
     DDebug(DebugAll,"RTPGroup::join(%p) [%p]",proc,this);
     lock();
     m_listChanged = true;
+    m_pollChanged = true;
     m_processors.append(proc)->setDelete(false);
     startup();
     unlock();
@@ -123,10 +321,88 @@ void RTPGroup::part(RTPProcessor* proc)
     DDebug(DebugAll,"RTPGroup::part(%p) [%p]",proc,this);
     lock();
     m_listChanged = true;
+    m_pollChanged = true;
     m_processors.remove(proc,false);
+    m_txMutex.lock();
+    // a transport that flushed by itself may be listed more than once
+    bool pending = false;
+    while (m_txPending.remove(proc,false))
+	pending = true;
+    m_txMutex.unlock();
+    // send what it queued, a transport registers with its group only
+    //  when queueing its first packet so leftovers would be stranded
+    if (pending) {
+	unsigned int batches = 0;
+	unsigned int maxBatch = 0;
+	unsigned int dropped = 0;
+	static_cast<RTPTransport*>(proc)->txFlush(batches,maxBatch,dropped);
+    }
     unlock();
 }
 
+void RTPGroup::socketsChanged()
+{
+    lock();
+    m_pollChanged = true;
+    unlock();
+}
+
+bool RTPGroup::eventsSupported()
+{
+#ifdef RTP_EVENTS
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool RTPGroup::txQueued(RTPTransport* trans)
+{
+    Lock lock(m_txMutex);
+    // the transport may be just leaving the group
+    if (!trans || (trans->group() != this))
+	return false;
+    m_txPending.append(trans)->setDelete(false);
+    if (!m_txFirst)
+	m_txFirst = Time::now();
+    return true;
+}
+
+// Send packets queued by transports, must be called with the group locked
+//  so pending transports cannot leave the group while being flushed
+void RTPGroup::txFlush()
+{
+    m_txMutex.lock();
+    if (!m_txFirst) {
+	m_txMutex.unlock();
+	return;
+    }
+    u_int64_t wait = Time::now() - m_txFirst;
+    m_txFirst = 0;
+    ObjList pending;
+    for (ObjList* l = m_txPending.skipNull(); l; l = l->skipNext())
+	pending.append(l->get())->setDelete(false);
+    m_txPending.clear();
+    m_txMutex.unlock();
+    unsigned int packets = 0;
+    unsigned int batches = 0;
+    unsigned int maxBatch = 0;
+    unsigned int dropped = 0;
+    for (ObjList* l = pending.skipNull(); l; l = l->skipNext())
+	packets += static_cast<RTPTransport*>(l->get())->txFlush(batches,maxBatch,dropped);
+    if (!batches)
+	return;
+    m_txFlushes++;
+    m_txBatches += batches;
+    m_txPackets += packets;
+    m_txDropped += dropped;
+    if (m_txMaxBatch < maxBatch)
+	m_txMaxBatch = maxBatch;
+    m_txLatency += wait;
+    if (m_txMaxLatency < wait)
+	m_txMaxLatency = wait;
+}
+
 void RTPGroup::setMinSleep(int msec)
 {
     if (msec < 1)
@@ -154,8 +430,11 @@ void RTPProcessor::group(RTPGroup* newgrp)
     DDebug(DebugAll,"RTPProcessor::group(%p) old=%p [%p]",newgrp,m_group,this);
     if (newgrp == m_group)
 	return;
-    if (m_group)
-	m_group->part(this);
+    // clear the group first so it is not used from other threads while parting
+    RTPGroup* old = m_group;
+    m_group = 0;
+    if (old)
+	old->part(this);
     m_group = newgrp;
     if (m_group)
 	m_group->join(this);
@@ -173,11 +452,21 @@ void RTPProcessor::getStats(String& stats) const
 {
 }
 
+unsigned int RTPProcessor::pollSockets(Socket** socks, unsigned int count)
+{
+    return 0;
+}
+
+void RTPProcessor::socketReady(Socket* sock, const Time& when)
+{
+}
+
 
 RTPTransport::RTPTransport(RTPTransport::Type type)
     : RTPProcessor(),
       m_type(type), m_processor(0), m_monitor(0), m_autoRemote(false),
-      m_warnSendErrorRtp(true), m_warnSendErrorRtcp(true)
+      m_warnSendErrorRtp(true), m_warnSendErrorRtcp(true),
+      m_txMutex(true,"RTPTransportTx"), m_txUsed(0), m_txCount(0), m_txSegment(true)
 {
     DDebug(DebugAll,"RTPTransport::RTPTransport(%d) [%p]",type,this);
 }
@@ -204,67 +493,115 @@ void RTPTransport::destruct()
 void RTPTransport::timerTick(const Time& when)
 {
     XDebug(DebugAll,"RTPTransport::timerTick() group=%p [%p]",group(),this);
+    // event driven groups read the sockets only when they become readable
+    bool poll = !(group() && group()->eventDriven());
     if (m_rtpSock.valid()) {
-	char buf[BUF_SIZE];
-	int len;
-	while ((len = m_rtpSock.recvFrom(buf,sizeof(buf),m_rxAddrRTP)) > 0) {
-	    XDebug(DebugAll,"RTP/UDPTL from '%s:%d' length %d [%p]",
-		m_rxAddrRTP.host().c_str(),m_rxAddrRTP.port(),len,this);
-	    switch (m_type) {
-		case RTP:
-		    if (len < 12)
-			continue;
-		    if (((unsigned char)buf[0] & 0xc0) != 0x80)
-			continue;
-		    break;
-		case UDPTL:
-		    if (len < 6)
-			continue;
-		    break;
-		default:
-		    break;
-	    }
-	    if (!m_remoteAddr.valid())
-		continue;
-	    // looks like it's RTP or UDPTL, at least by length and version
-	    bool preferred = false;
-	    if ((m_autoRemote || (preferred = (m_rxAddrRTP == m_remotePref))) && (m_rxAddrRTP != m_remoteAddr)) {
-		Debug(DebugInfo,"Auto changing RTP address from %s:%d to%s %s:%d",
-		    m_remoteAddr.host().c_str(),m_remoteAddr.port(),
-		    (preferred ? " preferred" : ""),
-		    m_rxAddrRTP.host().c_str(),m_rxAddrRTP.port());
-		// if we received from the preferred address don't auto change any more
-		if (preferred)
-		    m_remotePref.clear();
-		remoteAddr(m_rxAddrRTP);
-	    }
-	    m_autoRemote = false;
-	    if (m_rxAddrRTP == m_remoteAddr) {
-		if (m_processor)
-		    m_processor->rtpData(buf,len);
-		if (m_monitor)
-		    m_monitor->rtpData(buf,len);
-	    }
-	    else if (m_processor)
-		m_processor->incWrongSrc();
-	}
+	if (poll)
+	    readRTP();
 	m_rtpSock.timerTick(when);
     }
     if (m_rtcpSock.valid()) {
-	char buf[BUF_SIZE];
-	int len;
-	while (((len = m_rtcpSock.recvFrom(buf,sizeof(buf),m_rxAddrRTCP)) >= 8) && (m_rxAddrRTCP == m_remoteRTCP)) {
-	    XDebug(DebugAll,"RTCP from '%s:%d' length %d [%p]",
-		m_rxAddrRTCP.host().c_str(),m_rxAddrRTCP.port(),len,this);
-	    if (m_processor)
-		m_processor->rtcpData(buf,len);
-	    if (m_monitor)
-		m_monitor->rtcpData(buf,len);
-	}
+	if (poll)
+	    readRTCP();
 	m_rtcpSock.timerTick(when);
     }
 }
 
+unsigned int RTPTransport::pollSockets(Socket** socks, unsigned int count)
+{
+    unsigned int n = 0;
+    if ((n < count) && m_rtpSock.valid())
+	socks[n++] = &m_rtpSock;
+    if ((n < count) && m_rtcpSock.valid())
+	socks[n++] = &m_rtcpSock;
+    return n;
+}
+
+void RTPTransport::socketReady(Socket* sock, const Time& when)
+{
+    if (sock == &m_rtpSock)
+	readRTP();
+    else if (sock == &m_rtcpSock)
+	readRTCP();
+}
+
+// Read all available RTP or UDPTL packets in batches
+void RTPTransport::readRTP()
+{
+    char buf[RX_BATCH * BUF_SIZE];
+    int lengths[RX_BATCH];
+    SocketAddr addrs[RX_BATCH];
+    int n;
+    do {
+	n = m_rtpSock.recvFromMulti(buf,BUF_SIZE,RX_BATCH,lengths,addrs);
+	for (int i = 0; i < n; i++) {
+	    if (lengths[i] <= 0)
+		continue;
+	    m_rxAddrRTP = addrs[i];
+	    recvRTP(buf + i * BUF_SIZE,lengths[i]);
+	}
+    } while ((n == RX_BATCH) && m_rtpSock.valid());
+}
+
+// Process one packet received on the RTP socket
+void RTPTransport::recvRTP(char* buf, int len)
+{
+    XDebug(DebugAll,"RTP/UDPTL from '%s:%d' length %d [%p]",
+	m_rxAddrRTP.host().c_str(),m_rxAddrRTP.port(),len,this);
+    switch (m_type) {
+	case RTP:
+	    if (len < 12)
+		return;
+	    if (((unsigned char)buf[0] & 0xc0) != 0x80)
+		return;
+	    break;
+	case UDPTL:
+	    if (len < 6)
+		return;
+	    break;
+	default:
+	    break;
+    }
+    if (!m_remoteAddr.valid())
+	return;
+    // looks like it's RTP or UDPTL, at least by length and version
+    bool preferred = false;
+    if ((m_autoRemote || (preferred = (m_rxAddrRTP == m_remotePref))) && (m_rxAddrRTP != m_remoteAddr)) {
+	Debug(DebugInfo,"Auto changing RTP address from %s:%d to%s %s:%d",
+	    m_remoteAddr.host().c_str(),m_remoteAddr.port(),
+	    (preferred ? " preferred" : ""),
+	    m_rxAddrRTP.host().c_str(),m_rxAddrRTP.port());
+	// if we received from the preferred address don't auto change any more
+	if (preferred)
+	    m_remotePref.clear();
+	remoteAddr(m_rxAddrRTP);
+    }
+    m_autoRemote = false;
+    if (m_rxAddrRTP == m_remoteAddr) {
+	if (m_processor)
+	    m_processor->rtpData(buf,len);
+	if (m_monitor)
+	    m_monitor->rtpData(buf,len);
+    }
+    else if (m_processor)
+	m_processor->incWrongSrc();
+}
+
+// Read available RTCP packets
+void RTPTransport::readRTCP()
+{
+    char buf[BUF_SIZE];
+    int len;
+    while (((len = m_rtcpSock.recvFrom(buf,sizeof(buf),m_rxAddrRTCP)) >= 8) && (m_rxAddrRTCP == m_remoteRTCP)) {
+	XDebug(DebugAll,"RTCP from '%s:%d' length %d [%p]",
+	    m_rxAddrRTCP.host().c_str(),m_rxAddrRTCP.port(),len,this);
+	if (m_processor)
+	    m_processor->rtcpData(buf,len);
+	if (m_monitor)
+	    m_monitor->rtcpData(buf,len);
+    }
+}
+
 // Send data to remote party
 // Put a debug message on failure
 // Return true if all bytes were sent
@@ -320,7 +657,82 @@ void RTPTransport::rtpData(const void* data, int len)
 	default:
 	    break;
     }
-    sendData(m_rtpSock,m_remoteAddr,data,len,"RTP",m_warnSendErrorRtp);
+    if (!txQueue(data,len))
+	sendData(m_rtpSock,m_remoteAddr,data,len,"RTP",m_warnSendErrorRtp);
+}
+
+// Queue a RTP packet to be sent later by the group
+// Return false if the packet must be sent right away
+bool RTPTransport::txQueue(const void* data, int len)
+{
+    RTPGroup* g = group();
+    if (!(g && g->txBatch()) || (len > BUF_SIZE))
+	return false;
+    Lock lock(m_txMutex);
+    unsigned int batches = 0;
+    unsigned int maxBatch = 0;
+    unsigned int dropped = 0;
+    // the group fell behind, send what we have to keep packets in order
+    if ((m_txCount >= TX_BATCH) || (m_txUsed + len > m_txData.length())) {
+	txFlush(batches,maxBatch,dropped);
+	// reserve a full batch of this size once, the buffer is kept between flushes
+	if ((unsigned int)len * TX_BATCH > m_txData.length())
+	    m_txData.assign(0,len * TX_BATCH);
+    }
+    ::memcpy((char*)m_txData.data() + m_txUsed,data,len);
+    m_txUsed += len;
+    m_txLengths[m_txCount++] = len;
+    if ((m_txCount == 1) && !g->txQueued(this))
+	txFlush(batches,maxBatch,dropped);
+    return true;
+}
+
+// Send all queued RTP packets in as few system calls as possible
+// Return the number of packets sent, increment batches for each send operation,
+//  update the largest batch and add packets that failed to dropped
+unsigned int RTPTransport::txFlush(unsigned int& batches, unsigned int& maxBatch,
+    unsigned int& dropped)
+{
+    Lock lock(m_txMutex);
+    unsigned int packets = m_txCount;
+    if (!packets)
+	return 0;
+    if (m_rtpSock.valid() && m_remoteAddr.valid()) {
+	const char* buf = (const char*)m_txData.data();
+	const int* lengths = m_txLengths;
+	int left = m_txCount;
+	while (left > 0) {
+	    int wr = m_rtpSock.sendToMulti(buf,lengths,left,m_remoteAddr,0,&m_txSegment);
+	    batches++;
+	    if (wr <= 0) {
+		if (m_warnSendErrorRtp && !m_rtpSock.canRetry()) {
+		    m_warnSendErrorRtp = false;
+		    String s;
+		    int e = m_rtpSock.error();
+		    Thread::errorString(s,e);
+		    Debug(DebugNote,"RTP batch send failed (remote=%s): %d %s",
+			m_remoteAddr.addr().c_str(),e,s.c_str());
+		}
+		// skip the packet that failed and keep sending the rest
+		wr = 1;
+		dropped++;
+		packets--;
+	    }
+	    else if (maxBatch < (unsigned int)wr)
+		maxBatch = wr;
+	    for (int i = 0; i < wr; i++)
+		buf += lengths[i];
+	    lengths += wr;
+	    left -= wr;
+	}
+    }
+    else {
+	dropped += packets;
+	packets = 0;
+    }
+    m_txUsed = 0;
+    m_txCount = 0;
+    return packets;
 }
 
 void RTPTransport::rtcpData(const void* data, int len)
@@ -365,6 +777,8 @@ bool RTPTransport::localAddr(SocketAddr& addr, bool rtcp)
 	    m_rtpSock.getSockName(addr);
 	    m_localAddr = addr;
 	    setScopeId(m_localAddr,m_remoteAddr,m_remotePref);
+	    if (group())
+		group()->socketsChanged();
 	    return true;
 	}
 	if (!p) {
@@ -378,6 +792,8 @@ bool RTPTransport::localAddr(SocketAddr& addr, bool rtcp)
 		    m_rtpSock.setBlocking(false);
 		    m_localAddr = addr;
 		    setScopeId(m_localAddr,m_remoteAddr,m_remoteRTCP,&m_remotePref);
+		    if (group())
+			group()->socketsChanged();
 		    return true;
 		}
 		DDebug(DebugMild,"RTP Socket failed with code %d",m_rtpSock.error());
@@ -392,6 +808,8 @@ bool RTPTransport::localAddr(SocketAddr& addr, bool rtcp)
 	    addr.port(p);
 	    m_localAddr = addr;
 	    setScopeId(m_localAddr,m_remoteAddr,m_remoteRTCP,&m_remotePref);
+	    if (group())
+		group()->socketsChanged();
 	    return true;
 	}
 #ifdef DEBUG
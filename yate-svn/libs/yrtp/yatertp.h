@@ -128,6 +128,21 @@ protected:
      */
     virtual void timerTick(const Time& when) = 0;
 
+    /**
+     * Retrieve the sockets an event driven group must watch for this processor
+     * @param socks Array to fill with pointers to readable sockets
+     * @param count Number of entries available in the array
+     * @return Number of sockets filled in the array
+     */
+    virtual unsigned int pollSockets(Socket** socks, unsigned int count);
+
+    /**
+     * Method called by an event driven group when a watched socket is readable
+     * @param sock Pointer to the socket that has data available
+     * @param when Time to use as base in all computing
+     */
+    virtual void socketReady(Socket* sock, const Time& when);
+
     unsigned int m_wrongSrc;
 
 private:
@@ -148,8 +163,12 @@ public:
      * Constructor
      * @param msec Minimum time to sleep in loop in milliseconds
      * @param prio Thread priority to run this group
+     * @param events True to wait for socket events instead of sleeping and
+     *  polling, the periodic timer work is still done every msec milliseconds
+     * @param txBatch True to queue outgoing RTP packets and send them in
+     *  batches once per loop instead of one system call per packet
      */
-    RTPGroup(int msec = 0, Priority prio = Normal);
+    RTPGroup(int msec = 0, Priority prio = Normal, bool events = false, bool txBatch = false);
 
     /**
      * Group destructor, removes itself from all remaining processors
@@ -184,10 +203,111 @@ public:
      */
     void part(RTPProcessor* proc);
 
+    /**
+     * Notify the group that the sockets of a processor were changed
+     */
+    void socketsChanged();
+
+    /**
+     * Check if the group is waiting for socket events
+     * @return True if the group runs an event driven loop
+     */
+    inline bool eventDriven() const
+	{ return m_events; }
+
+    /**
+     * Check if the platform supports event driven RTP groups
+     * @return True if event driven groups can be created
+     */
+    static bool eventsSupported();
+
+    /**
+     * Check if outgoing RTP packets are sent in batches
+     * @return True if transports of this group queue outgoing packets
+     */
+    inline bool txBatch() const
+	{ return m_txBatch; }
+
+    /**
+     * Notify the group that a transport has packets queued for sending
+     * @param trans Pointer to the transport holding the queued packets
+     * @return True if the transport will be flushed, false if it left the group
+     */
+    bool txQueued(RTPTransport* trans);
+
+    /**
+     * Retrieve the number of batches sent by transports of this group
+     * @return Number of batched send operations
+     */
+    inline u_int64_t txBatches() const
+	{ return m_txBatches; }
+
+    /**
+     * Retrieve the number of packets sent in batches by this group
+     * @return Number of packets sent in batches
+     */
+    inline u_int64_t txPackets() const
+	{ return m_txPackets; }
+
+    /**
+     * Retrieve the number of queued packets this group failed to send
+     * @return Number of packets dropped on send errors
+     */
+    inline u_int64_t txDropped() const
+	{ return m_txDropped; }
+
+    /**
+     * Retrieve the largest number of packets sent in one batch
+     * @return Maximum batch size
+     */
+    inline unsigned int txMaxBatch() const
+	{ return m_txMaxBatch; }
+
+    /**
+     * Retrieve the number of times queued packets were flushed
+     * @return Number of flushes
+     */
+    inline u_int64_t txFlushes() const
+	{ return m_txFlushes; }
+
+    /**
+     * Retrieve the total time packets waited in queue before being flushed
+     * @return Sum of flush latencies in microseconds
+     */
+    inline u_int64_t txLatency() const
+	{ return m_txLatency; }
+
+    /**
+     * Retrieve the longest time packets waited in queue before being flushed
+     * @return Maximum flush latency in microseconds
+     */
+    inline u_int64_t txMaxLatency() const
+	{ return m_txMaxLatency; }
+
 private:
+    void runEvents();
+    bool buildPoll();
+    void closePoll();
+    void txFlush();
     ObjList m_processors;
     bool m_listChanged;
+    bool m_pollChanged;
+    bool m_events;
     unsigned long m_sleep;
+    int m_pollHandle;
+    int m_timerHandle;
+    DataBlock m_pollList;
+    bool m_txBatch;
+    Mutex m_txMutex;
+    ObjList m_txPending;
+    u_int64_t m_txFirst;
+    u_int64_t m_txBatches;
+    u_int64_t m_txPackets;
+    u_int64_t m_txDropped;
+    unsigned int m_txMaxBatch;
+    u_int64_t m_txFlushes;
+    u_int64_t m_txLatency;
+    u_int64_t m_txMaxLatency;
 };
 
 /**
@@ -196,6 +316,7 @@ private:
  */
 class YRTP_API RTPTransport : public RTPProcessor
 {
+    friend class RTPGroup;
 public:
     /**
      * Activation status of the transport
@@ -315,6 +436,21 @@ protected:
      */
     virtual void timerTick(const Time& when);
 
+    /**
+     * Retrieve the RTP and RTCP sockets to be watched by an event driven group
+     * @param socks Array to fill with pointers to readable sockets
+     * @param count Number of entries available in the array
+     * @return Number of sockets filled in the array
+     */
+    virtual unsigned int pollSockets(Socket** socks, unsigned int count);
+
+    /**
+     * Read available data from a socket reported readable by the group
+     * @param sock Pointer to the socket that has data available
+     * @param when Time to use as base in all computing
+     */
+    virtual void socketReady(Socket* sock, const Time& when);
+
     /**
      * This method is called to send a RTP packet
      * @param data Pointer to raw RTP data
@@ -330,6 +466,11 @@ protected:
     virtual void rtcpData(const void* data, int len);
 
 private:
+    void readRTP();
+    void readRTCP();
+    void recvRTP(char* buf, int len);
+    bool txQueue(const void* data, int len);
+    unsigned int txFlush(unsigned int& batches, unsigned int& maxBatch, unsigned int& dropped);
     Type m_type;
     RTPProcessor* m_processor;
     RTPProcessor* m_monitor;
@@ -344,6 +485,12 @@ private:
     bool m_autoRemote;
     bool m_warnSendErrorRtp;
     bool m_warnSendErrorRtcp;
+    Mutex m_txMutex;
+    DataBlock m_txData;
+    unsigned int m_txUsed;
+    int m_txLengths[16];
+    int m_txCount;
+    bool m_txSegment;
 };
 
 /**
@@ -913,9 +1060,12 @@ public:
      * Initialize the RTP session, attach a group if none is present
      * @param msec Minimum time to sleep in group loop in milliseconds
      * @param prio Thread priority to run the new group
+     * @param events True to create an event driven group if supported
+     * @param txBatch True to create a group that sends RTP packets in batches
      * @return True if initialized, false on some failure
      */
-    bool initGroup(int msec = 0, Thread::Priority prio = Thread::Normal);
+    bool initGroup(int msec = 0, Thread::Priority prio = Thread::Normal, bool events = false,
+	bool txBatch = false);
 
     /**
      * Set the remote network address of the RTP transport of this session
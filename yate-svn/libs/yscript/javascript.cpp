@@ -45,7 +45,7 @@ public:
     virtual bool runFunction(ObjList& stack, const ExpOperation& oper, GenObject* context);
     virtual bool runField(ObjList& stack, const ExpOperation& oper, GenObject* context);
     virtual bool runAssign(ObjList& stack, const ExpOperation& oper, GenObject* context);
-    GenObject* resolve(ObjList& stack, String& name, GenObject* context);
+    GenObject* resolve(ObjList& stack, String& name, GenObject* context, const ObjList* path = 0);
     bool runStringFunction(GenObject* obj, const String& name, ObjList& stack, const ExpOperation& oper, GenObject* context);
     bool runStringField(GenObject* obj, const String& name, ObjList& stack, const ExpOperation& oper, GenObject* context);
 private:
@@ -101,6 +101,55 @@ struct JsEntry
     unsigned int index;
 };
 
+// Compiled form of a linked operation, shared by all runners of the code
+struct JsInstr
+{
+    const ExpOperation* oper;
+    int opcode;
+    unsigned int target;
+};
+
+// Dotted field or function name split once when linking, shared by all
+//  operations of the code using the same name
+class JsPath : public RefObject
+{
+public:
+    inline JsPath(const String& name)
+	: m_name(name), m_parts(name.split('.',true))
+	{ }
+    virtual ~JsPath()
+	{ TelEngine::destruct(m_parts); }
+    virtual const String& toString() const
+	{ return m_name; }
+    inline const ObjList* parts() const
+	{ return m_parts; }
+private:
+    String m_name;
+    ObjList* m_parts;
+};
+
+// Field or function operation of linked code carrying its split name
+// Clones keep the split name unless renamed so fields pushed on the stack
+//  are resolved without splitting their name again
+class JsLinkedName : public ExpOperation
+{
+    YCLASS(JsLinkedName,ExpOperation)
+public:
+    inline JsLinkedName(const ExpOperation& oper, JsPath* path)
+	: ExpOperation(oper,oper.name()), m_path(path)
+	{ lineNumber(oper.lineNumber()); }
+    virtual ExpOperation* clone(const char* name) const
+	{
+	    if (name != this->name().c_str())
+		return ExpOperation::clone(name);
+	    return new JsLinkedName(*this,m_path);
+	}
+    inline const ObjList* path() const
+	{ return m_path->parts(); }
+private:
+    RefPointer<JsPath> m_path;
+};
+
 class JsCode : public ScriptCode, public ExpEvaluator
 {
     friend class TelEngine::JsFunction;
@@ -155,7 +204,7 @@ public:
     };
     inline JsCode()
 	: ExpEvaluator(C),
-	  m_pragmas(""), m_label(0), m_depth(0), m_entries(0), m_traceable(false)
+	  m_pragmas(""), m_label(0), m_depth(0), m_entries(0), m_instr(0), m_traceable(false)
 	{ debugName("JsCode"); }
     ~JsCode();
     virtual void* getObject(const String& name) const
@@ -246,6 +295,7 @@ private:
     long int m_label;
     int m_depth;
     JsEntry* m_entries;
+    JsInstr* m_instr;
     bool m_traceable;
 };
 
@@ -550,6 +600,10 @@ GenObject* JsContext::resolveTop(ObjList& stack, const String& name, GenObject*
 {
     XDebug(DebugAll,"JsContext::resolveTop '%s'",name.c_str());
     for (ObjList* l = stack.skipNull(); l; l = l->skipNext()) {
+	// only call contexts are scopes, skip quickly all other values
+	const String& scope = l->get()->toString();
+	if (scope.length() != 2 || scope != YSTRING("()"))
+	    continue;
 	JsObject* jso = YOBJECT(JsObject,l->get());
 	if (jso && jso->toString() == YSTRING("()") && jso->hasField(stack,name,context))
 	    return jso;
@@ -557,17 +611,18 @@ GenObject* JsContext::resolveTop(ObjList& stack, const String& name, GenObject*
     return this;
 }
 
-GenObject* JsContext::resolve(ObjList& stack, String& name, GenObject* context)
+GenObject* JsContext::resolve(ObjList& stack, String& name, GenObject* context, const ObjList* path)
 {
     GenObject* obj = 0;
-    if (name.find('.') < 0)
+    if (!path && name.find('.') < 0)
 	obj = resolveTop(stack,name,context);
     else {
-	ObjList* list = name.split('.',true);
+	// linked code provides the name already split
+	ObjList* list = path ? 0 : name.split('.',true);
 	name.clear();
-	for (ObjList* l = list->skipNull(); l; ) {
+	for (const ObjList* l = (path ? path : list)->skipNull(); l; ) {
 	    const String* s = static_cast<const String*>(l->get());
-	    ObjList* l2 = l->skipNext();
+	    const ObjList* l2 = l->skipNext();
 	    if (TelEngine::null(s)) {
 		// consecutive dots - not good
 		obj = 0;
@@ -610,7 +665,8 @@ bool JsContext::runFunction(ObjList& stack, const ExpOperation& oper, GenObject*
 {
     XDebug(DebugAll,"JsContext::runFunction '%s' [%p]",oper.name().c_str(),this);
     String name = oper.name();
-    GenObject* o = resolve(stack,name,context);
+    const JsLinkedName* linked = YOBJECT(JsLinkedName,&oper);
+    GenObject* o = resolve(stack,name,context,linked ? linked->path() : 0);
     if (o && o != this) {
 	ExpExtender* ext = YOBJECT(ExpExtender,o);
 	if (ext) {
@@ -653,8 +709,16 @@ bool JsContext::runFunction(ObjList& stack, const ExpOperation& oper, GenObject*
 bool JsContext::runField(ObjList& stack, const ExpOperation& oper, GenObject* context)
 {
     XDebug(DebugAll,"JsContext::runField '%s' [%p]",oper.name().c_str(),this);
+    const JsLinkedName* linked = YOBJECT(JsLinkedName,&oper);
+    if (!linked && (oper.name().find('.') < 0)) {
+	// a plain identifier is held by a scope object or by the context,
+	//  both only use the name so the operation needs no renamed copy
+	GenObject* o = resolveTop(stack,oper.name(),context);
+	ExpExtender* ext = (o && o != this) ? YOBJECT(ExpExtender,o) : 0;
+	return ext ? ext->runField(stack,oper,context) : JsObject::runField(stack,oper,context);
+    }
     String name = oper.name();
-    GenObject* o = resolve(stack,name,context);
+    GenObject* o = resolve(stack,name,context,linked ? linked->path() : 0);
     if (o && o != this) {
 	ExpExtender* ext = YOBJECT(ExpExtender,o);
 	if (ext) {
@@ -917,6 +981,7 @@ bool JsContext::runAssign(ObjList& stack, const ExpOperation& oper, GenObject* c
 JsCode::~JsCode()
 {
     delete[] m_entries;
+    delete[] m_instr;
 }
 
 // Initialize standard globals in the execution context
@@ -955,41 +1020,83 @@ bool JsCode::link()
     m_linked.assign(m_opcodes);
     delete[] m_entries;
     m_entries = 0;
+    delete[] m_instr;
+    m_instr = 0;
     unsigned int n = m_linked.count();
     if (!n)
 	return false;
+    // map label numbers to code indexes in one pass, labels are allocated
+    //  from a counter so they are dense and a plain table is enough
     unsigned int entries = 0;
+    long int maxLbl = -1;
     for (unsigned int i = 0; i < n; i++) {
 	const ExpOperation* l = static_cast<const ExpOperation*>(m_linked[i]);
 	if (!l || l->opcode() != OpcLabel)
 	    continue;
 	long int lbl = (long int)l->number();
-	if (lbl >= 0 && l->barrier())
+	if (lbl < 0)
+	    continue;
+	if (l->barrier())
 	    entries++;
-	for (unsigned int j = 0; j < n; j++) {
-	    const ExpOperation* jmp = static_cast<const ExpOperation*>(m_linked[j]);
-	    if (!jmp || jmp->number() != lbl)
+	if (maxLbl < lbl)
+	    maxLbl = lbl;
+    }
+    long int* labels = 0;
+    if (maxLbl >= 0) {
+	labels = new long int[maxLbl + 1];
+	for (long int k = 0; k <= maxLbl; k++)
+	    labels[k] = -1;
+	for (unsigned int i = 0; i < n; i++) {
+	    const ExpOperation* l = static_cast<const ExpOperation*>(m_linked[i]);
+	    if (l && l->opcode() == OpcLabel && l->number() >= 0)
+		labels[(long int)l->number()] = i;
+	}
+    }
+    // turn every jump to a known label into a relative jump
+    for (unsigned int j = 0; labels && j < n; j++) {
+	const ExpOperation* jmp = static_cast<const ExpOperation*>(m_linked[j]);
+	if (!jmp)
+	    continue;
+	Opcode op = OpcNone;
+	switch ((int)jmp->opcode()) {
+	    case OpcJump:
+		op = (Opcode)OpcJRel;
+		break;
+	    case OpcJumpTrue:
+		op = (Opcode)OpcJRelTrue;
+		break;
+	    case OpcJumpFalse:
+		op = (Opcode)OpcJRelFalse;
+		break;
+	    default:
 		continue;
-	    Opcode op = OpcNone;
-	    switch ((int)jmp->opcode()) {
-		case OpcJump:
-		    op = (Opcode)OpcJRel;
-		    break;
-		case OpcJumpTrue:
-		    op = (Opcode)OpcJRelTrue;
-		    break;
-		case OpcJumpFalse:
-		    op = (Opcode)OpcJRelFalse;
-		    break;
-		default:
-		    continue;
-	    }
-	    long int offs = (long int)i - j;
-	    ExpOperation* newJump = new ExpOperation(op,0,offs,jmp->barrier());
-	    newJump->lineNumber(jmp->lineNumber());
-	    m_linked.set(newJump,j);
 	}
+	long int lbl = (long int)jmp->number();
+	if (lbl < 0 || lbl > maxLbl || labels[lbl] < 0)
+	    continue;
+	long int offs = labels[lbl] - (long int)j;
+	ExpOperation* newJump = new ExpOperation(op,0,offs,jmp->barrier());
+	newJump->lineNumber(jmp->lineNumber());
+	m_linked.set(newJump,j);
+    }
+    delete[] labels;
+    // split dotted field and function names once, operations using the
+    //  same name share the parts
+    ObjList paths;
+    for (unsigned int i = 0; i < m_linked.length(); i++) {
+	const ExpOperation* o = static_cast<const ExpOperation*>(m_linked[i]);
+	if (!o || (o->opcode() != OpcField && o->opcode() != OpcFunc) || (o->name().find('.') < 0))
+	    continue;
+	if (YOBJECT(ExpFunction,o) || YOBJECT(ExpWrapper,o))
+	    continue;
+	JsPath* path = static_cast<JsPath*>(paths[o->name()]);
+	if (!path) {
+	    path = new JsPath(o->name());
+	    paths.append(path);
+	}
+	m_linked.set(new JsLinkedName(*o,path),i);
     }
+    paths.clear();
     if (entries) {
 	m_entries = new JsEntry[entries+1];
 	unsigned int e = 0;
@@ -1003,6 +1110,34 @@ bool JsCode::link()
 	m_entries[entries].number = -1;
 	m_entries[entries].index = 0;
     }
+    // build the compact form with relative jumps resolved to absolute indexes
+    n = m_linked.length();
+    m_instr = new JsInstr[n];
+    for (unsigned int i = 0; i < n; i++) {
+	const ExpOperation* o = static_cast<const ExpOperation*>(m_linked[i]);
+	JsInstr& in = m_instr[i];
+	in.oper = o;
+	in.opcode = o ? (int)o->opcode() : (int)OpcNone;
+	in.target = 0;
+	switch (in.opcode) {
+	    case OpcJRel:
+	    case OpcJRelTrue:
+	    case OpcJRelFalse:
+		{
+		    // the index is already advanced past the jump when it's executed
+		    long int t = (long int)i + 1 + (long int)o->number();
+		    if (t >= 0 && t <= (long int)n)
+			in.target = t;
+		    else
+			in.opcode = OpcNone;
+		}
+		break;
+	    case OpcLabel:
+		break;
+	    default:
+		in.opcode = OpcNone;
+	}
+    }
     return true;
 }
 
@@ -1649,8 +1784,11 @@ bool JsCode::parseFor(ParsePoint& expr, GenObject* nested)
     int64_t cont = 0;
     int64_t jump = ++m_label;
     int64_t body = ++m_label;
+    // for-in loops keep the iterator on stack between iterations
+    bool iterator = true;
     // parse initializer
     if (skipComments(expr) == ';') {
+	iterator = false;
 	int64_t check = body;
 	if (skipComments(++expr) != ';') {
 	    check = ++m_label;
@@ -1688,6 +1826,11 @@ bool JsCode::parseFor(ParsePoint& expr, GenObject* nested)
 	return gotError("Expecting ')'",expr);
     ParseLoop parseStack(this,nested,OpcFor,cont,jump);
     addOpcode(OpcLabel,body);
+    if (!iterator) {
+	// drop what the previous iteration left on stack
+	addOpcode((Opcode)OpcFlush);
+	addOpcode((Opcode)OpcBegin);
+    }
     if (!getOneInstruction(++expr,parseStack))
 	return false;
     addOpcode((Opcode)OpcJump,cont);
@@ -1709,6 +1852,9 @@ bool JsCode::parseWhile(ParsePoint& expr, GenObject* nested)
 	return gotError("Expecting ')'",expr);
     int64_t jump = ++m_label;
     addOpcode((Opcode)OpcJumpFalse,jump);
+    // drop what the previous iteration left on stack
+    addOpcode((Opcode)OpcFlush);
+    addOpcode((Opcode)OpcBegin);
     ParseLoop parseStack(this,nested,OpcWhile,cont,jump);
     if (!getOneInstruction(++expr,parseStack))
 	return false;
@@ -2070,7 +2216,7 @@ JsObject* JsCode::parseObject(ParsePoint& expr, bool constOnly, Mutex* mtx)
 	}
 	if (op->opcode() == OpcField)
 	    op->assign(op->name());
-	const_cast<String&>(op->name()) = name;
+	op->rename(name);
 	jso->params().setParam(op);
     }
     return jso;
@@ -2647,10 +2793,34 @@ bool JsCode::evalVector(ObjList& stack, GenObject* context) const
     XDebug(this,DebugInfo,"JsCode::evalVector(%p,%p)",&stack,context);
     JsRunner* runner = static_cast<JsRunner*>(context);
     unsigned int& index = runner->m_index;
-    while (index < m_linked.length()) {
-	const ExpOperation* o = static_cast<const ExpOperation*>(m_linked[index++]);
-	if (o && !runOperation(stack,*o,context))
-	    return false;
+    unsigned int n = m_linked.length();
+    while (index < n) {
+	const JsInstr& in = m_instr[index++];
+	if (!in.oper)
+	    continue;
+	// labels and resolved jumps are handled here unless tracing
+	switch (runner->m_tracing ? (int)OpcNone : in.opcode) {
+	    case OpcLabel:
+		continue;
+	    case OpcJRel:
+		index = in.target;
+		continue;
+	    case OpcJRelTrue:
+	    case OpcJRelFalse:
+		{
+		    ExpOperation* op = popValue(stack,context);
+		    if (!op)
+			return gotError("Stack underflow",in.oper->lineNumber());
+		    bool val = op->valBoolean();
+		    TelEngine::destruct(op);
+		    if (val == (in.opcode == OpcJRelTrue))
+			index = in.target;
+		}
+		break;
+	    default:
+		if (!runOperation(stack,*in.oper,context))
+		    return false;
+	}
 	if (runner->m_paused)
 	    break;
     }
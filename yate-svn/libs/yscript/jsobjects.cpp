@@ -575,7 +575,7 @@ void JsArray::push(ExpOperation* item)
     unsigned int pos = m_length;
     while (params().getParam(String(pos)))
 	pos++;
-    const_cast<String&>(item->name()) = pos;
+    item->rename(String(pos));
     params().addParam(item);
     setLength(pos + 1);
 }
@@ -631,7 +631,7 @@ JsObject* JsArray::runConstructor(ObjList& stack, const ExpOperation& oper, GenO
 	    TelEngine::destruct(op);
 	    break;
 	}
-	const_cast<String&>(op->name()) = i - 1;
+	op->rename(String(i - 1));
 	obj->params().paramList()->insert(op);
     }
     obj->setLength(len);
@@ -655,7 +655,7 @@ bool JsArray::runNative(ObjList& stack, const ExpOperation& oper, GenObject* con
 	if (!extractArgs(this,stack,oper,context,args))
 	    return false;
 	while (ExpOperation* op = static_cast<ExpOperation*>(args.remove(false))) {
-	    const_cast<String&>(op->name()) = (unsigned int)m_length++;
+	    op->rename(String((unsigned int)m_length++));
 	    params().addParam(op);
 	}
 	ExpEvaluator::pushOne(stack,new ExpOperation((int64_t)length()));
@@ -713,13 +713,13 @@ bool JsArray::runNative(ObjList& stack, const ExpOperation& oper, GenObject* con
 		    NamedString* ns = ja->params().getParam(String(i));
 		    ExpOperation* arg = YOBJECT(ExpOperation,ns);
 		    arg = arg ? arg->clone() : new ExpOperation(*ns,0,true);
-		    const_cast<String&>(arg->name()) = (unsigned int)array->m_length++;
+		    arg->rename(String((unsigned int)array->m_length++));
 		    array->params().addParam(arg);
 		}
 		TelEngine::destruct(op);
 	    }
 	    else {
-		const_cast<String&>(op->name()) = (unsigned int)array->m_length++;
+		op->rename(String((unsigned int)array->m_length++));
 		array->params().addParam(op);
 	    }
 	}
@@ -750,15 +750,17 @@ bool JsArray::runNative(ObjList& stack, const ExpOperation& oper, GenObject* con
 	    return false;
 	int i1 = 0;
 	int i2 = length() - 1;
+	// parameters are renamed in place so work on the raw list
+	ObjList* list = params().paramList();
 	for (; i1 < i2; i1++, i2--) {
 	    String s1(i1);
 	    String s2(i2);
-	    NamedString* n1 = params().getParam(s1);
-	    NamedString* n2 = params().getParam(s2);
+	    NamedString* n1 = static_cast<NamedString*>((*list)[s1]);
+	    NamedString* n2 = static_cast<NamedString*>((*list)[s2]);
 	    if (n1)
-		const_cast<String&>(n1->name()) = s2;
+		n1->rename(s2);
 	    if (n2)
-		const_cast<String&>(n2->name()) = s1;
+		n2->rename(s1);
 	}
 	ref();
 	ExpEvaluator::pushOne(stack,new ExpWrapper(this));
@@ -794,7 +796,7 @@ bool JsArray::runNative(ObjList& stack, const ExpOperation& oper, GenObject* con
 		    setLength(i);
 		    break;
 		}
-		const_cast<String&>(ns->name()) = i;
+		ns->rename(String(i));
 	    }
 	}
 	else
@@ -819,14 +821,14 @@ bool JsArray::runNative(ObjList& stack, const ExpOperation& oper, GenObject* con
 		if (ns) {
 		    String index(i);
 		    params().clearParam(index);
-		    const_cast<String&>(ns->name()) = index;
+		    ns->rename(index);
 		}
 	    }
 	    for (int32_t i = shift - 1; i >= 0; i--) {
 		ExpOperation* op = popValue(stack,context);
 		if (!op)
 		    continue;
-	        const_cast<String&>(op->name()) = i;
+	        op->rename(String(i));
 		params().paramList()->insert(op);
 	    }
 	    setLength(length() + shift);
@@ -970,7 +972,7 @@ bool JsArray::runNativeSlice(ObjList& stack, const ExpOperation& oper, GenObject
 	}
 	ExpOperation* arg = YOBJECT(ExpOperation,ns);
 	arg = arg ? arg->clone() : new ExpOperation(*ns,0,true);
-	const_cast<String&>(arg->name()) = (unsigned int)array->m_length++;
+	arg->rename(String((unsigned int)array->m_length++));
 	array->params().addParam(arg);
     }
     ExpEvaluator::pushOne(stack,new ExpWrapper(array));
@@ -1024,7 +1026,7 @@ bool JsArray::runNativeSplice(ObjList& stack, const ExpOperation& oper, GenObjec
 	    op = new ExpOperation(*ns,0,true);
 	    TelEngine::destruct(ns);
 	}
-	const_cast<String&>(op->name()) = (unsigned int)removed->m_length++;
+	op->rename(String((unsigned int)removed->m_length++));
 	removed->params().addParam(op);
     }
 
@@ -1035,21 +1037,21 @@ bool JsArray::runNativeSplice(ObjList& stack, const ExpOperation& oper, GenObjec
 	for (int32_t i = m_length - 1; i >= begin + delCount; i--) {
 	    NamedString* ns = static_cast<NamedString*>((*params().paramList())[String(i)]);
 	    if (ns)
-		const_cast<String&>(ns->name()) = i + shiftIdx;
+		ns->rename(String(i + shiftIdx));
 	}
     }
     else if (shiftIdx < 0) {
 	for (int32_t i = begin + delCount; i < m_length; i++) {
 	    NamedString* ns = static_cast<NamedString*>((*params().paramList())[String(i)]);
 	    if (ns)
-		const_cast<String&>(ns->name()) = i + shiftIdx;
+		ns->rename(String(i + shiftIdx));
 	}
     }
     setLength(length() + shiftIdx);
     // insert the new elements
     for (int i = 0; i < argc; i++) {
 	ExpOperation* arg = static_cast<ExpOperation*>(args.remove(false));
-	const_cast<String&>(arg->name()) = (unsigned int)(begin + i);
+	arg->rename(String((unsigned int)(begin + i)));
 	params().addParam(arg);
     }
     ExpEvaluator::pushOne(stack,new ExpWrapper(removed));
@@ -1130,7 +1132,7 @@ bool JsArray::runNativeSort(ObjList& stack, const ExpOperation& oper, GenObject*
 	last = params().paramList()->last();
 	for (ObjList* o = sorted.skipNull();o; o = o->skipNull()) {
 	    ExpOperation* slice = static_cast<ExpOperation*>(o->remove(false));
-	    const_cast<String&>(slice->name()) = i++;
+	    slice->rename(String(i++));
 	    last = last->append(slice);
 	}
     }
@@ -34,6 +34,9 @@ using namespace TelEngine;
 // Maximum number of mandatory parameters including two terminators
 #define MAX_MANDATORY_PARAMS 16
 
+// Calls with circuit codes below this value are indexed by code
+#define MAX_CIC_CALLS 65536
+
 // Timer limits and default values
 #define ISUP_T7_MINVAL  20000
 #define ISUP_T7_DEFVAL  20000
@@ -1961,6 +1964,169 @@ static const MsgParams* getIsupParams(SS7PointCode::Type type, SS7MsgISUP::Type
     return 0;
 }
 
+// Parameter found in the raw area of an indexed message
+struct IsupRawParam {
+    unsigned char type;                  // Parameter type
+    bool optional;                       // Parameter is in the optional part
+    bool decoded;                        // Parameter was decoded to message list
+    unsigned int offs;                   // Offset of parameter value in raw area
+    unsigned int len;                    // Length of parameter value
+};
+
+// Retrieve the array of parameters of a raw area index
+static inline IsupRawParam* rawParams(const DataBlock& index, unsigned int& count)
+{
+    count = index.length() / sizeof(IsupRawParam);
+    return static_cast<IsupRawParam*>(index.data());
+}
+
+// Add a parameter to a raw area index
+static void addRawParam(DataBlock& index, unsigned char type, bool optional,
+    unsigned int offs, unsigned int len)
+{
+    IsupRawParam p;
+    p.type = type;
+    p.optional = optional;
+    p.decoded = false;
+    p.offs = offs;
+    p.len = len;
+    index.append(&p,sizeof(p));
+}
+
+// Find the first indexed parameter of a given type still in raw form
+static const IsupRawParam* findRawParam(const DataBlock& index, unsigned char type,
+    bool optional)
+{
+    unsigned int n = 0;
+    const IsupRawParam* p = rawParams(index,n);
+    for (; n--; p++) {
+	if (p->type == type && p->optional == optional && !p->decoded)
+	    return p;
+    }
+    return 0;
+}
+
+// Retrieve the state of an indexed parameter type in the mandatory or optional part
+// Return negative if not indexed, 0 if still in raw form, positive if decoded
+static int rawParamState(const DataBlock& index, unsigned char type, bool optional)
+{
+    unsigned int n = 0;
+    const IsupRawParam* p = rawParams(index,n);
+    for (; n--; p++) {
+	if (p->type == type && p->optional == optional)
+	    return p->decoded ? 1 : 0;
+    }
+    return -1;
+}
+
+// Check if a parameter type is still in raw form in the mandatory or optional part
+// Such parameters are copied as received and must not be encoded from the list
+static inline bool isRawParam(const DataBlock& index, unsigned char type)
+{
+    return !rawParamState(index,type,false) || !rawParamState(index,type,true);
+}
+
+// Check if any indexed parameter was decoded
+static bool hasDecodedParam(const DataBlock& index)
+{
+    unsigned int n = 0;
+    const IsupRawParam* p = rawParams(index,n);
+    for (; n--; p++) {
+	if (p->decoded)
+	    return true;
+    }
+    return false;
+}
+
+// Retrieve the name of an indexed parameter type
+static const String& rawParamName(unsigned char type, String& buf)
+{
+    const IsupParam* param = getParamDesc((SS7MsgISUP::Parameters)type);
+    if (param)
+	buf = param->name;
+    else {
+	buf = "Param_";
+	buf << type;
+    }
+    return buf;
+}
+
+// Retrieve the ISUP parameter type from a list parameter name without prefix
+// Return negative if the name is not an ISUP parameter
+static int rawParamType(const String& name)
+{
+    String tmp(name);
+    int sep = tmp.find('.');
+    if (sep > 0)
+	tmp = tmp.substr(0,sep);
+    const IsupParam* param = getParamDesc(tmp);
+    if (param)
+	return param->type;
+    if (!tmp.startSkip("Param_",false))
+	return -1;
+    int val = tmp.toInteger(-1);
+    return (val >= 0 && val <= 255) ? val : -1;
+}
+
+// Check if a list parameter name belongs to a given ISUP parameter
+static inline bool isParamName(const String& str, const String& name)
+{
+    return str.startsWith(name) &&
+	((str.length() == name.length()) || (str.at(name.length()) == '.'));
+}
+
+// Count the list entries of an ISUP parameter, check if they are found unchanged in other list
+static bool sameParam(const NamedList& list, const NamedList& other, const String& name)
+{
+    unsigned int n = 0;
+    for (const ObjList* o = list.paramList()->skipNull(); o; o = o->skipNext()) {
+	const NamedString* ns = static_cast<const NamedString*>(o->get());
+	if (!isParamName(ns->name(),name))
+	    continue;
+	const String* val = other.getParam(ns->name());
+	if (!val || (*val != *ns))
+	    return false;
+	n++;
+    }
+    for (const ObjList* o = other.paramList()->skipNull(); o; o = o->skipNext()) {
+	if (isParamName(static_cast<const NamedString*>(o->get())->name(),name) && !n--)
+	    return false;
+    }
+    return 0 == n;
+}
+
+// Retrieve the parameters whose compatibility information asks for special handling
+static void setParamCompat(NamedList& msg, const String& prefix)
+{
+    String release,cnf,npRelease;
+    String pCompat(prefix + "ParameterCompatInformation.");
+    unsigned int n = msg.length();
+    for (unsigned int i = 0; i < n; i++) {
+	NamedString* ns = msg.getParam(i);
+	if (!(ns && ns->name().startsWith(pCompat) && !ns->name().endsWith(".more")))
+	    continue;
+	ObjList* l = ns->split(',',false);
+	for (ObjList* ol = l->skipNull(); ol; ol = ol->skipNext()) {
+	    String* s = static_cast<String*>(ol->get());
+	    if (*s == YSTRING("release")) {
+		SignallingUtils::appendFlag(release,ns->name().substr(pCompat.length()));
+		break;
+	    }
+	    if (*s == YSTRING("cnf"))
+		SignallingUtils::appendFlag(cnf,ns->name().substr(pCompat.length()));
+	    if (*s == YSTRING("nopass-release"))
+		SignallingUtils::appendFlag(npRelease,ns->name().substr(pCompat.length()));
+	}
+	TelEngine::destruct(l);
+    }
+    if (release)
+	msg.setParam(prefix + "parameters-unhandled-release",release);
+    if (cnf)
+	msg.setParam(prefix + "parameters-unhandled-cnf",cnf);
+    if (npRelease)
+	msg.setParam(prefix + "parameters-nopass-release",npRelease);
+}
+
 // Hexify a list of isup parameter values/names
 static void hexifyIsupParams(String& s, const String& list)
 {
@@ -2231,6 +2397,7 @@ SS7ISUPCall::SS7ISUPCall(SS7ISUP* controller, SignallingCircuit* cic,
     m_state(Null),
     m_testCall(testCall),
     m_circuit(cic),
+    m_cicIndex((unsigned int)-1),
     m_cicRange(range),
     m_terminate(false),
     m_gracefully(true),
@@ -2289,6 +2456,7 @@ SS7ISUPCall::~SS7ISUPCall()
 	id(),m_reason.safe(),TelEngine::c_safe(timeout),this);
     TelEngine::destruct(m_relMsg);
     if (controller()) {
+	isup()->indexCall(this,true);
 	if (!timeout)
 	    controller()->releaseCircuit(m_circuit);
 	else
@@ -2711,6 +2879,8 @@ bool SS7ISUPCall::replaceCircuit(SignallingCircuit* circuit, SS7MsgISUP* msg)
     if (controller())
 	controller()->releaseCircuit(m_circuit);
     m_circuit = circuit;
+    if (controller())
+	isup()->indexCall(this);
     Debug(isup(),DebugNote,"Call(%u). Circuit replaced by %u [%p]",oldId,id(),this);
     m_circuitChanged = true;
     return transmitIAM();
@@ -3716,6 +3886,7 @@ SignallingCall* SS7ISUP::call(SignallingMessage* msg, String& reason)
 	call = new SS7ISUPCall(this,cic,*m_defPoint,dest,true,sls,range);
 	call->ref();
 	m_calls.append(call);
+	indexCall(call);
 	SignallingEvent* event = new SignallingEvent(SignallingEvent::NewCall,msg,call);
 	// (re)start RSC timer if not currently reseting
 	if (!m_rscCic && m_rscTimer.interval())
@@ -3810,6 +3981,9 @@ void SS7ISUP::cleanup(const char* reason)
     unlock();
     setCallsTerminate(terminate,true,reason);
     clearCalls();
+    lock();
+    m_cicCalls.clear();
+    unlock();
 }
 
 // Remove all links with other layers. Disposes the memory
@@ -3817,6 +3991,7 @@ void SS7ISUP::destroyed()
 {
     lock();
     clearCalls();
+    m_cicCalls.clear();
     unlock();
     SignallingCallControl::attach(0);
     SS7Layer4::destroyed();
@@ -4239,7 +4414,8 @@ void SS7ISUP::notify(SS7Layer3* link, int sls)
 }
 
 SS7MSU* SS7ISUP::buildMSU(SS7MsgISUP::Type type, unsigned char sio,
-    const SS7Label& label, unsigned int cic, const NamedList* params) const
+    const SS7Label& label, unsigned int cic, const NamedList* params,
+    const SS7MsgISUP* raw) const
 {
     // Special treatment for charge message
     // Check if it is in raw format
@@ -4326,7 +4502,10 @@ SS7MSU* SS7ISUP::buildMSU(SS7MsgISUP::Type type, unsigned char sio,
 	    Debug(this,DebugFail,"Stage 2: Invalid (variable) description of fixed ISUP parameter %s [%p]",param->name,this);
 	    continue;
 	}
-	if (!encodeParam(this,*msu,param,params,exclude,prefix,d))
+	const IsupRawParam* rp = raw ? findRawParam(raw->m_rawIndex,ptype,false) : 0;
+	if (rp && (rp->len == param->size))
+	    ::memcpy(d,raw->m_raw.data(rp->offs,rp->len),rp->len);
+	else if (!encodeParam(this,*msu,param,params,exclude,prefix,d))
 	    Debug(this,DebugGoOn,"Could not encode fixed ISUP parameter %s [%p]",param->name,this);
 	d += param->size;
     }
@@ -4343,7 +4522,16 @@ SS7MSU* SS7ISUP::buildMSU(SS7MsgISUP::Type type, unsigned char sio,
 	}
 	// remember the offset this parameter will actually get stored
 	len = msu->length();
-	unsigned char size = encodeParam(this,*msu,param,params,exclude,prefix);
+	unsigned char size = 0;
+	const IsupRawParam* rp = raw ? findRawParam(raw->m_rawIndex,ptype,false) : 0;
+	if (rp) {
+	    // copy the parameter as received
+	    size = rp->len;
+	    msu->append(&size,1);
+	    msu->append(raw->m_raw.data(rp->offs,rp->len),rp->len);
+	}
+	else
+	    size = encodeParam(this,*msu,param,params,exclude,prefix);
 	d = msu->getData(0,len+1);
 	if (!(size && d)) {
 	    Debug(this,DebugGoOn,"Could not encode variable ISUP parameter %s [%p]",param->name,this);
@@ -4379,11 +4567,14 @@ SS7MSU* SS7ISUP::buildMSU(SS7MsgISUP::Type type, unsigned char sio,
 	    }
 	    const IsupParam* param = getParamDesc(tmp);
 	    unsigned char size = 0;
-	    if (param)
-		size = encodeParam(this,*msu,param,ns,params,prefix);
+	    if (param) {
+		// parameters still in raw form are copied later
+		if (!(raw && isRawParam(raw->m_rawIndex,param->type)))
+		    size = encodeParam(this,*msu,param,ns,params,prefix);
+	    }
 	    else if (tmp.startSkip("Param_",false)) {
 		int val = tmp.toInteger(-1);
-		if (val >= 0 && val <= 255) {
+		if (val >= 0 && val <= 255 && !(raw && isRawParam(raw->m_rawIndex,val))) {
 		    IsupParam p;
 		    p.name = tmp;
 		    p.type = (SS7MsgISUP::Parameters)val;
@@ -4400,6 +4591,23 @@ SS7MSU* SS7ISUP::buildMSU(SS7MsgISUP::Type type, unsigned char sio,
 		len = 0;
 	    }
 	}
+	// append the optional parameters still in raw form
+	unsigned int count = 0;
+	const IsupRawParam* rp = raw ? rawParams(raw->m_rawIndex,count) : 0;
+	for (; count--; rp++) {
+	    if (rp->decoded || !rp->optional)
+		continue;
+	    unsigned char hdr[2];
+	    hdr[0] = rp->type;
+	    hdr[1] = rp->len;
+	    msu->append(hdr,2);
+	    msu->append(raw->m_raw.data(rp->offs,rp->len),rp->len);
+	    if (len) {
+		d = msu->getData(0,len+1);
+		d[ptr] = len - ptr;
+		len = 0;
+	    }
+	}
 	if (!len) {
 	    // we stored some optional parameters so we need to put the terminator
 	    DataBlock tmp(0,1);
@@ -4422,6 +4630,12 @@ SS7MSU* SS7ISUP::encodeRawMessage(SS7MsgISUP::Type type, unsigned char sio,
 		raw.length());
 	return 0;
     }
+    return encodeRawMessage(type,sio,label,cic,raw);
+}
+
+SS7MSU* SS7ISUP::encodeRawMessage(SS7MsgISUP::Type type, unsigned char sio,
+    const SS7Label& label, unsigned int cic, const DataBlock& raw) const
+{
     SS7MSU* msu = new SS7MSU(sio,label,0,m_cicLen + 1);
     unsigned char* d = msu->getData(label.length()+1,m_cicLen + 1);
     unsigned int i = m_cicLen;
@@ -4441,6 +4655,30 @@ bool SS7ISUP::decodeMessage(NamedList& msg,
     SS7MsgISUP::Type msgType, SS7PointCode::Type pcType,
     const unsigned char* paramPtr, unsigned int paramLen)
 {
+    return parseMessage(msg,msgType,pcType,paramPtr,paramLen,0);
+}
+
+// Index a buffer, keep the parameters in raw form
+bool SS7ISUP::indexMessage(SS7MsgISUP& msg, SS7PointCode::Type pcType,
+    const unsigned char* paramPtr, unsigned int paramLen)
+{
+    msg.m_raw.assign((void*)paramPtr,paramLen);
+    msg.m_rawIndex.clear();
+    msg.m_indexed = true;
+    if (parseMessage(msg.params(),msg.type(),pcType,paramPtr,paramLen,&msg))
+	return true;
+    msg.m_indexed = false;
+    msg.m_raw.clear();
+    msg.m_rawIndex.clear();
+    return false;
+}
+
+// Parse a buffer, decode the parameters to a list or index them in message
+bool SS7ISUP::parseMessage(NamedList& msg,
+    SS7MsgISUP::Type msgType, SS7PointCode::Type pcType,
+    const unsigned char* paramPtr, unsigned int paramLen, SS7MsgISUP* index)
+{
+    const unsigned char* rawPtr = paramPtr;
     String msgTypeName((int)msgType);
     const char* msgName = SS7MsgISUP::lookup(msgType,msgTypeName);
 #ifdef XDEBUG
@@ -4524,7 +4762,9 @@ bool SS7ISUP::decodeMessage(NamedList& msg,
 	    Debug(this,DebugWarn,"Truncated ISUP message! [%p]",this);
 	    return false;
 	}
-	if (!decodeParam(this,msg,param,paramPtr,param->size,prefix)) {
+	if (index)
+	    addRawParam(index->m_rawIndex,ptype,false,paramPtr - rawPtr,param->size);
+	else if (!decodeParam(this,msg,param,paramPtr,param->size,prefix)) {
 	    Debug(this,DebugWarn,"Could not decode fixed ISUP parameter %s [%p]",param->name,this);
 	    decodeRaw(this,msg,param,paramPtr,param->size,prefix);
 	    SignallingUtils::appendFlag(unsupported,param->name);
@@ -4556,7 +4796,9 @@ bool SS7ISUP::decodeMessage(NamedList& msg,
 		size,offs,paramLen,param->name,this);
 	    return false;
 	}
-	if (!decodeParam(this,msg,param,paramPtr+offs+1,size,prefix)) {
+	if (index)
+	    addRawParam(index->m_rawIndex,ptype,false,paramPtr + offs + 1 - rawPtr,size);
+	else if (!decodeParam(this,msg,param,paramPtr+offs+1,size,prefix)) {
 	    Debug(this,DebugWarn,"Could not decode variable ISUP parameter %s (size=%u) [%p]",
 		param->name,size,this);
 	    decodeRaw(this,msg,param,paramPtr+offs+1,size,prefix);
@@ -4600,7 +4842,9 @@ bool SS7ISUP::decodeMessage(NamedList& msg,
 		    return false;
 		}
 		const IsupParam* param = getParamDesc(ptype);
-		if (!param) {
+		if (index)
+		    addRawParam(index->m_rawIndex,ptype,true,paramPtr - rawPtr,size);
+		else if (!param) {
 		    Debug(this,DebugMild,"Unknown optional ISUP parameter 0x%02x (size=%u) [%p]",ptype,size,this);
 		    decodeRawParam(this,msg,ptype,paramPtr,size,prefix);
 		    SignallingUtils::appendFlag(unsupported,String((unsigned int)ptype));
@@ -4619,39 +4863,134 @@ bool SS7ISUP::decodeMessage(NamedList& msg,
     }
     if (unsupported)
 	msg.addParam(prefix + "parameters-unsupported",unsupported);
-    String release,cnf,npRelease;
-    String pCompat(prefix + "ParameterCompatInformation.");
-    unsigned int n = msg.length();
-    for (unsigned int i = 0; i < n; i++) {
-	NamedString* ns = msg.getParam(i);
-	if (!(ns && ns->name().startsWith(pCompat) && !ns->name().endsWith(".more")))
-	    continue;
-	ObjList* l = ns->split(',',false);
-	for (ObjList* ol = l->skipNull(); ol; ol = ol->skipNext()) {
-	    String* s = static_cast<String*>(ol->get());
-	    if (*s == YSTRING("release")) {
-		SignallingUtils::appendFlag(release,ns->name().substr(pCompat.length()));
-		break;
-	    }
-	    if (*s == YSTRING("cnf"))
-		SignallingUtils::appendFlag(cnf,ns->name().substr(pCompat.length()));
-	    if (*s == YSTRING("nopass-release"))
-		SignallingUtils::appendFlag(npRelease,ns->name().substr(pCompat.length()));
-	}
-	TelEngine::destruct(l);
-    }
-    if (release)
-	msg.setParam(prefix + "parameters-unhandled-release",release);
-    if (cnf)
-	msg.setParam(prefix + "parameters-unhandled-cnf",cnf);
-    if (npRelease)
-	msg.setParam(prefix + "parameters-nopass-release",npRelease);
+    if (!index)
+	setParamCompat(msg,prefix);
     if (paramLen && mustWarn)
 	Debug(this,DebugWarn,"Got %u garbage octets after message type 0x%02x [%p]",
 	    paramLen,msgType,this);
     return true;
 }
 
+// Decode indexed parameters of a message to its list of parameters
+bool SS7ISUP::decodeIndexed(SS7MsgISUP& msg, const String& name)
+{
+    NamedList& list = msg.params();
+    String prefix = list.getValue(YSTRING("message-prefix"));
+    if (!msg.m_indexed)
+	return !name || list.getParam(prefix + name);
+    int type = -1;
+    if (name) {
+	type = rawParamType(name);
+	if (type < 0)
+	    return false;
+    }
+    String unsupported;
+    bool found = false;
+    bool compat = false;
+    unsigned int n = 0;
+    IsupRawParam* p = rawParams(msg.m_rawIndex,n);
+    for (; n--; p++) {
+	if (type >= 0 && type != p->type)
+	    continue;
+	found = true;
+	if (p->decoded)
+	    continue;
+	p->decoded = true;
+	const unsigned char* buf = msg.m_raw.data(p->offs,p->len);
+	const IsupParam* param = getParamDesc((SS7MsgISUP::Parameters)p->type);
+	if (!param) {
+	    Debug(this,DebugMild,"Unknown optional ISUP parameter 0x%02x (size=%u) [%p]",
+		p->type,p->len,this);
+	    decodeRawParam(this,list,p->type,buf,p->len,prefix);
+	    SignallingUtils::appendFlag(unsupported,String((unsigned int)p->type));
+	}
+	else if (!decodeParam(this,list,param,buf,p->len,prefix)) {
+	    Debug(this,DebugWarn,"Could not decode ISUP parameter %s (size=%u) [%p]",
+		param->name,p->len,this);
+	    decodeRaw(this,list,param,buf,p->len,prefix);
+	    SignallingUtils::appendFlag(unsupported,param->name);
+	}
+	else if (p->type == SS7MsgISUP::ParameterCompatInformation)
+	    compat = true;
+    }
+    if (unsupported) {
+	NamedString* ns = list.getParam(prefix + "parameters-unsupported");
+	if (ns)
+	    SignallingUtils::appendFlag(*ns,unsupported);
+	else
+	    list.addParam(prefix + "parameters-unsupported",unsupported);
+    }
+    if (compat)
+	setParamCompat(list,prefix);
+    return found || !name;
+}
+
+// Set back to raw form the decoded parameters of a message found unchanged in a list
+unsigned int SS7ISUP::matchIndexed(SS7MsgISUP& msg, const NamedList& params)
+{
+    if (!msg.m_indexed)
+	return params.length() + 1;
+    NamedList& list = msg.params();
+    String prefix = list.getValue(YSTRING("message-prefix"));
+    unsigned int changed = 0;
+    // decode raw parameters set in list, count the ones not found in message
+    for (const ObjList* o = params.paramList()->skipNull(); o; o = o->skipNext()) {
+	const NamedString* ns = static_cast<const NamedString*>(o->get());
+	if (prefix && !ns->name().startsWith(prefix))
+	    continue;
+	String tmp = ns->name().substr(prefix.length());
+	int type = rawParamType(tmp);
+	if (type < 0)
+	    continue;
+	int state = rawParamState(msg.m_rawIndex,type,false);
+	if (state < 0)
+	    state = rawParamState(msg.m_rawIndex,type,true);
+	if (state < 0)
+	    changed++;
+	else if (!state)
+	    decodeIndexed(msg,tmp);
+    }
+    String tmp;
+    unsigned int n = 0;
+    IsupRawParam* p = rawParams(msg.m_rawIndex,n);
+    for (unsigned int i = 0; i < n; i++) {
+	if (!p[i].decoded)
+	    continue;
+	// all instances of a parameter are handled together
+	unsigned int j = 0;
+	while (j < i && p[j].type != p[i].type)
+	    j++;
+	if (j < i)
+	    continue;
+	String name = prefix + rawParamName(p[i].type,tmp);
+	if (!sameParam(list,params,name)) {
+	    changed++;
+	    continue;
+	}
+	for (j = i; j < n; j++) {
+	    if (p[j].type == p[i].type)
+		p[j].decoded = false;
+	}
+	list.clearParam(name,'.');
+    }
+    return changed;
+}
+
+// Create a MSU from an indexed message, copy parameters still in raw form
+SS7MSU* SS7ISUP::createMSU(const SS7MsgISUP& msg, unsigned char ssf,
+    const SS7Label& label, const NamedList* params) const
+{
+    unsigned char sio = sif() | (ssf & 0xf0);
+    if (!params)
+	params = &msg.params();
+    if (!msg.m_indexed)
+	return buildMSU(msg.type(),sio,label,msg.cic(),params);
+    // nothing decoded or changed: copy the parameter area as received
+    if (params == &msg.params() && !hasDecodedParam(msg.m_rawIndex))
+	return encodeRawMessage(msg.type(),sio,label,msg.cic(),msg.m_raw);
+    return buildMSU(msg.type(),sio,label,msg.cic(),params,&msg);
+}
+
 // Encode an ISUP list of parameters to a buffer
 bool SS7ISUP::encodeMessage(DataBlock& buf, SS7MsgISUP::Type msgType, SS7PointCode::Type pcType,
     const NamedList& params, unsigned int* cic)
@@ -4768,6 +5107,8 @@ bool SS7ISUP::processMSU(SS7MsgISUP::Type type, unsigned int cic,
 	tmp.hexify(&type,1);
 	msg->params().assign("Message_" + tmp);
     }
+    // calls read most parameters of the few messages they get and keep them
+    //  in call state so indexing them and decoding later would not pay
     if (!decodeMessage(msg->params(),type,label.type(),paramPtr,paramLen)) {
 	TelEngine::destruct(msg);
 	return false;
@@ -5068,6 +5409,7 @@ void SS7ISUP::processCallMsg(SS7MsgISUP* msg, const SS7Label& label, int sls)
 	    call = new SS7ISUPCall(this,circuit,label.dpc(),label.opc(),false,label.sls(),
 		0,msg->type() == SS7MsgISUP::CCR);
 	    m_calls.append(call);
+	    indexCall(call);
 	    break;
 	}
 	// Congestion: send REL
@@ -5581,6 +5923,13 @@ bool SS7ISUP::blockCircuit(unsigned int cic, bool block, bool remote, bool hwFai
 
 SS7ISUPCall* SS7ISUP::findCall(unsigned int cic)
 {
+    if (cic < MAX_CIC_CALLS) {
+	if (cic >= m_cicCalls.length() / sizeof(SS7ISUPCall*))
+	    return 0;
+	SS7ISUPCall* call = ((SS7ISUPCall**)m_cicCalls.data())[cic];
+	// The call may have released or replaced its circuit since indexed
+	return (call && call->id() == cic) ? call : 0;
+    }
     for (ObjList* o = m_calls.skipNull(); o; o = o->skipNext()) {
 	SS7ISUPCall* call = static_cast<SS7ISUPCall*>(o->get());
 	if (call->id() == cic)
@@ -5589,6 +5938,32 @@ SS7ISUPCall* SS7ISUP::findCall(unsigned int cic)
     return 0;
 }
 
+// Index a call by its circuit code, drop the entry of its previous code
+void SS7ISUP::indexCall(SS7ISUPCall* call, bool remove)
+{
+    if (!call)
+	return;
+    Lock mylock(this);
+    SS7ISUPCall** calls = (SS7ISUPCall**)m_cicCalls.data();
+    unsigned int n = m_cicCalls.length() / sizeof(SS7ISUPCall*);
+    if (call->m_cicIndex < n && calls[call->m_cicIndex] == call)
+	calls[call->m_cicIndex] = 0;
+    call->m_cicIndex = (unsigned int)-1;
+    if (remove || !call->m_circuit)
+	return;
+    unsigned int cic = call->id();
+    if (cic >= MAX_CIC_CALLS)
+	return;
+    if (cic >= n) {
+	// Grow in steps of 256 circuits
+	DataBlock tmp(0,(((cic + 256) & ~255) - n) * sizeof(SS7ISUPCall*));
+	m_cicCalls.append(tmp);
+	calls = (SS7ISUPCall**)m_cicCalls.data();
+    }
+    calls[cic] = call;
+    call->m_cicIndex = cic;
+}
+
 // Utility used in sendLocalLock()
 // Check if a circuit has lock change flag set and can be locked (not busy)
 static inline bool canLock(SignallingCircuit* cic, bool hw)
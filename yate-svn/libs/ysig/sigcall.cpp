@@ -27,6 +27,46 @@
 
 using namespace TelEngine;
 
+// Circuit codes below this value are kept in direct indexed maps
+#define MAX_CIC_MAP 65536
+
+// Grow a zero filled block to hold at least len bytes
+static inline void growMap(DataBlock& data, unsigned int len)
+{
+    if (data.length() >= len)
+	return;
+    // Grow in 1k steps to avoid reallocating on each circuit insert
+    len = (len + 1023) & ~1023;
+    DataBlock tmp(0,len - data.length());
+    data.append(tmp);
+}
+
+// Set or reset the bit of a circuit code in a code map
+static inline void setMapBit(DataBlock& map, unsigned int code, bool on)
+{
+    if (code >= MAX_CIC_MAP)
+	return;
+    unsigned int idx = code >> 5;
+    if (on)
+	growMap(map,(idx + 1) * sizeof(u_int32_t));
+    else if (idx >= map.length() / sizeof(u_int32_t))
+	return;
+    u_int32_t* w = (u_int32_t*)map.data() + idx;
+    if (on)
+	*w |= ((u_int32_t)1 << (code & 31));
+    else
+	*w &= ~((u_int32_t)1 << (code & 31));
+}
+
+// Check if the bit of a circuit code is set in a code map
+static inline bool getMapBit(const DataBlock& map, unsigned int code)
+{
+    unsigned int idx = code >> 5;
+    if (idx >= map.length() / sizeof(u_int32_t))
+	return false;
+    return 0 != (((const u_int32_t*)map.data())[idx] & ((u_int32_t)1 << (code & 31)));
+}
+
 const TokenDict SignallingCircuit::s_lockNames[] = {
     {"localhw",            LockLocalHWFail},
     {"localmaint",         LockLocalMaint},
@@ -520,6 +560,16 @@ SignallingCircuit::~SignallingCircuit()
     XDebug(m_group,DebugAll,"SignallingCircuit::~SignallingCircuit [%p]",this);
 }
 
+// Set the status. Keep the group's idle circuits map up to date
+bool SignallingCircuit::status(Status newStat, bool sync)
+{
+    m_status = newStat;
+    SignallingCircuitGroup* group = m_group;
+    if (group)
+	group->setIdle(m_code,Idle == newStat);
+    return true;
+}
+
 // Set circuit data from a list of parameters
 bool SignallingCircuit::setParams(const NamedList& params)
 {
@@ -675,6 +725,8 @@ void SignallingCircuitRange::add(unsigned int* codes, unsigned int len)
 	return;
     m_range.append(codes,len*sizeof(unsigned int));
     m_count += len;
+    for (unsigned int i = 0; i < len; i++)
+	setMapBit(m_map,codes[i],true);
     updateLast();
 }
 
@@ -686,8 +738,10 @@ void SignallingCircuitRange::add(unsigned int first, unsigned int last)
     unsigned int count = last - first + 1;
     DataBlock data(0,count*sizeof(unsigned int));
     unsigned int* codes = (unsigned int*)data.data();
-    for (unsigned int i = 0; i < count; i++)
+    for (unsigned int i = 0; i < count; i++) {
 	codes[i] = first+i;
+	setMapBit(m_map,codes[i],true);
+    }
     m_range.append(data);
     m_count += count;
     updateLast();
@@ -697,9 +751,17 @@ void SignallingCircuitRange::add(unsigned int first, unsigned int last)
 void SignallingCircuitRange::remove(unsigned int code)
 {
     unsigned int* d = (unsigned int*)range();
+    bool zero = false;
     for (unsigned int i = 0; i < count(); i++)
-	if (d[i] == code)
+	if (d[i] == code) {
 	    d[i] = 0;
+	    zero = true;
+	}
+    if (!zero)
+	return;
+    // Removed entries are zeroed so the array now contains code 0
+    setMapBit(m_map,code,false);
+    setMapBit(m_map,0,true);
     updateLast();
 }
 
@@ -709,6 +771,8 @@ bool SignallingCircuitRange::find(unsigned int code)
 {
     if (!range())
 	return false;
+    if (code < MAX_CIC_MAP)
+	return getMapBit(m_map,code);
     for (unsigned int i = 0; i < count(); i++)
 	if (range()[i] == code)
 	    return true;
@@ -740,6 +804,7 @@ const TokenDict SignallingCircuitGroup::s_strategy[] = {
 SignallingCircuitGroup::SignallingCircuitGroup(unsigned int base, int strategy, const char* name)
     : SignallingComponent(name),
       Mutex(true,"SignallingCircuitGroup"),
+      m_idleMutex(false,"SignallingCircuitGroup::idle"),
       m_range(String::empty(),name,strategy),
       m_base(base)
 {
@@ -766,6 +831,11 @@ SignallingCircuit* SignallingCircuitGroup::find(unsigned int cic, bool local)
     Lock mylock(this);
     if (cic >= m_range.m_last)
 	return 0;
+    if (cic < MAX_CIC_MAP) {
+	if (cic >= m_index.length() / sizeof(SignallingCircuit*))
+	    return 0;
+	return ((SignallingCircuit**)m_index.data())[cic];
+    }
     ObjList* l = m_circuits.skipNull();
     for (; l; l = l->skipNext()) {
 	SignallingCircuit* c = static_cast<SignallingCircuit*>(l->get());
@@ -804,6 +874,14 @@ bool SignallingCircuitGroup::insert(SignallingCircuit* circuit)
     circuit->m_group = this;
     m_circuits.append(circuit);
     m_range.add(circuit->code());
+    unsigned int code = circuit->code();
+    if (code < MAX_CIC_MAP) {
+	growMap(m_index,(code + 1) * sizeof(SignallingCircuit*));
+	((SignallingCircuit**)m_index.data())[code] = circuit;
+    }
+    // Never reset the idle flag here: we may race with a status change
+    if (circuit->available())
+	setIdle(code,true);
     return true;
 }
 
@@ -817,6 +895,10 @@ void SignallingCircuitGroup::remove(SignallingCircuit* circuit)
 	return;
     circuit->m_group = 0;
     m_range.remove(circuit->code());
+    unsigned int code = circuit->code();
+    if (code < m_index.length() / sizeof(SignallingCircuit*))
+	((SignallingCircuit**)m_index.data())[code] = 0;
+    setIdle(code,false);
     // TODO: remove from all ranges
 }
 
@@ -975,6 +1057,62 @@ unsigned int SignallingCircuitGroup::advance(unsigned int n, int strategy,
     return n;
 }
 
+// Set or reset the idle flag of a circuit given by its local code
+void SignallingCircuitGroup::setIdle(unsigned int code, bool idle)
+{
+    Lock mylock(m_idleMutex);
+    setMapBit(m_idle,code,idle);
+}
+
+// Find the lowest (up) or highest (down) idle circuit code within range
+//  and the [first,last) interval matching the even/odd strategy
+// Circuit and range maps are checked one 32 bit word at a time
+int SignallingCircuitGroup::findIdle(SignallingCircuitRange& range, int strategy,
+	unsigned int first, unsigned int last, bool up)
+{
+    u_int32_t parity = 0xffffffff;
+    if (strategy & OnlyEven)
+	parity &= 0x55555555;
+    if (strategy & OnlyOdd)
+	parity &= 0xaaaaaaaa;
+    Lock mylock(m_idleMutex);
+    unsigned int words = m_idle.length();
+    if (words > range.m_map.length())
+	words = range.m_map.length();
+    words /= sizeof(u_int32_t);
+    if (last > (words << 5))
+	last = words << 5;
+    const u_int32_t* idle = (const u_int32_t*)m_idle.data();
+    const u_int32_t* map = (const u_int32_t*)range.m_map.data();
+    while (first < last) {
+	unsigned int idx = (up ? first : (last - 1)) >> 5;
+	u_int32_t w = idle[idx] & map[idx] & parity;
+	if (up)
+	    w &= (0xffffffff << (first & 31));
+	else if (((last - 1) & 31) != 31)
+	    w &= ((u_int32_t)2 << ((last - 1) & 31)) - 1;
+	if (w) {
+	    unsigned int bit = 0;
+	    if (up) {
+		while (!(w & ((u_int32_t)1 << bit)))
+		    bit++;
+	    }
+	    else {
+		bit = 31;
+		while (!(w & ((u_int32_t)1 << bit)))
+		    bit--;
+	    }
+	    unsigned int code = (idx << 5) + bit;
+	    return (code >= first && code < last) ? (int)code : -1;
+	}
+	if (up)
+	    first = (idx + 1) << 5;
+	else
+	    last = idx << 5;
+    }
+    return -1;
+}
+
 // Reserve a circuit
 SignallingCircuit* SignallingCircuitGroup::reserve(int checkLock, int strategy,
 	SignallingCircuitRange* range)
@@ -1015,29 +1153,69 @@ SignallingCircuit* SignallingCircuitGroup::reserve(int checkLock, int strategy,
     }
     // then go to the proper even/odd start circuit
     adjustParity(n,strategy,up);
-    // remember where the scan started
-    unsigned int start = n;
-    // try at most how many channels we have, halve that if we only scan even or odd
-    unsigned int i = range->m_last;
-    if (strategy & (OnlyOdd|OnlyEven))
-	i = (i + 1) / 2;
-    while (i--) {
-	// Check if the circuit is within range
-	if (range->find(n)) {
-	    SignallingCircuit* circuit = find(n,true);
-	    if (circuit && !circuit->locked(checkLock) && circuit->reserve()) {
-		if (circuit->ref()) {
-		    range->m_used = n;
-		    return circuit;
+    if (range->m_last <= MAX_CIC_MAP) {
+	// Scan idle circuits from start towards one end of range, then wrap around
+	// Random strategy scans up from its random start
+	for (int pass = 0; pass < 2; pass++) {
+	    unsigned int first = 0;
+	    unsigned int last = range->m_last;
+	    if (up) {
+		if (pass)
+		    last = n;
+		else
+		    first = n;
+	    }
+	    else {
+		if (pass)
+		    first = n + 1;
+		else
+		    last = n + 1;
+	    }
+	    for (;;) {
+		int code = findIdle(*range,strategy,first,last,up);
+		if (code < 0)
+		    break;
+		SignallingCircuit* circuit = find(code,true);
+		if (circuit && !circuit->locked(checkLock) && circuit->reserve()) {
+		    if (circuit->ref()) {
+			range->m_used = code;
+			return circuit;
+		    }
+		    release(circuit);
+		    return 0;
 		}
-		release(circuit);
-		return 0;
+		if (up)
+		    first = code + 1;
+		else
+		    last = code;
 	    }
 	}
-	n = advance(n,strategy,*range);
-	// if wrapped around bail out, don't scan again
-	if (n == start)
-	    break;
+    }
+    else {
+	// remember where the scan started
+	unsigned int start = n;
+	// try at most how many channels we have, halve that if we only scan even or odd
+	unsigned int i = range->m_last;
+	if (strategy & (OnlyOdd|OnlyEven))
+	    i = (i + 1) / 2;
+	while (i--) {
+	    // Check if the circuit is within range
+	    if (range->find(n)) {
+		SignallingCircuit* circuit = find(n,true);
+		if (circuit && !circuit->locked(checkLock) && circuit->reserve()) {
+		    if (circuit->ref()) {
+			range->m_used = n;
+			return circuit;
+		    }
+		    release(circuit);
+		    return 0;
+		}
+	    }
+	    n = advance(n,strategy,*range);
+	    // if wrapped around bail out, don't scan again
+	    if (n == start)
+		break;
+	}
     }
     mylock.drop();
     if (strategy & Fallback) {
@@ -1111,6 +1289,10 @@ void SignallingCircuitGroup::clearAll()
 	c->m_group = 0;
     }
     m_circuits.clear();
+    m_index.clear();
+    m_idleMutex.lock();
+    m_idle.clear();
+    m_idleMutex.unlock();
     m_ranges.clear();
 }
 
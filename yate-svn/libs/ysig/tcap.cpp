@@ -25,6 +25,22 @@
 
 using namespace TelEngine;
 
+// Number of hash lists of the transactions table
+#define TCAP_HASH_SIZE 1024
+// Number of lock shards of the transactions table
+#define TCAP_SHARDS 16
+// Number of slots and slot resolution in milliseconds of the timer wheel
+#define TCAP_WHEEL_SLOTS 512
+#define TCAP_WHEEL_RES 20
+// Interval in milliseconds used to compute the timeout rate
+#define TCAP_RATE_INTERVAL 60000
+
+// Retrieve the lock shard of a transaction ID
+static inline unsigned int shardIndex(const HashList& list, const String& id)
+{
+    return list.index(id.hash()) % TCAP_SHARDS;
+}
+
 #ifdef DEBUG
 static void dumpData(int debugLevel, SS7TCAP* tcap, String message, void* obj, NamedList& params,
 		    DataBlock data = DataBlock::empty())
@@ -264,12 +280,24 @@ SS7TCAP::SS7TCAP(const NamedList& params)
       m_defaultRemotePC(0),
       m_remoteTypePC(SS7PointCode::Other),
       m_trTimeout(300),
-      m_transactionsMtx(true,"TCAPTransactions"),
+      m_transactionsMtx(TCAP_SHARDS,true,"TCAPTransactions"),
+      m_transactions(TCAP_HASH_SIZE),
+      m_wheelMtx(false,"TCAPTimerWheel"),
+      m_wheel(0), m_wheelSlot(0),
       m_tcapType(UnknownTCAP),
-      m_idsPool(0)
+      m_idsPool(0),
+      m_rateTime(0)
 {
     Debug(this,DebugAll,"SS7TCAP::SS7TCAP() [%p] created",this);
-    m_recvMsgs = m_sentMsgs = m_discardMsgs = m_normalMsgs = m_abnormalMsgs = 0;
+    m_recvMsgs = m_sentMsgs = m_discardMsgs = m_normalMsgs = m_abnormalMsgs = m_timeouts = 0;
+    m_wheel = new SS7TCAPTransaction*[TCAP_WHEEL_SLOTS];
+    for (unsigned int i = 0; i < TCAP_WHEEL_SLOTS; i++)
+	m_wheel[i] = 0;
+    m_shardCount = new unsigned int[TCAP_SHARDS];
+    m_shardTimeouts = new unsigned int[TCAP_SHARDS];
+    m_shardRate = new unsigned int[TCAP_SHARDS];
+    for (unsigned int i = 0; i < TCAP_SHARDS; i++)
+	m_shardCount[i] = m_shardTimeouts[i] = m_shardRate[i] = 0;
     m_ssnStatus = SCCPManagement::UserOutOfService;
 }
 
@@ -291,7 +319,10 @@ SS7TCAP::~SS7TCAP()
     }
     m_transactions.clear();
     m_inQueue.clear();
-
+    delete[] m_wheel;
+    delete[] m_shardCount;
+    delete[] m_shardTimeouts;
+    delete[] m_shardRate;
 }
 
 bool SS7TCAP::initialize(const NamedList* config)
@@ -587,6 +618,18 @@ void SS7TCAP::status(NamedList& status)
     status.setParam("totalDiscarded",String(m_discardMsgs));
     status.setParam("totalNormal",String(m_normalMsgs));
     status.setParam("totalAbnormal",String(m_abnormalMsgs));
+    status.setParam("totalTimeouts",String(m_timeouts));
+    unsigned int total = 0;
+    String count, rate;
+    for (unsigned int i = 0; i < TCAP_SHARDS; i++) {
+	total += m_shardCount[i];
+	count.append(String(m_shardCount[i]),"|");
+	rate.append(String(m_shardRate[i]),"|");
+    }
+    status.setParam("transactions",String(total));
+    // occupancy and timeouts per minute of each lock shard
+    status.setParam("shardTransactions",count);
+    status.setParam("shardTimeoutRate",rate);
 }
 
 void SS7TCAP::userStatus(NamedList& status)
@@ -597,7 +640,7 @@ void SS7TCAP::userStatus(NamedList& status)
 SS7TCAPTransaction* SS7TCAP::getTransaction(const String& tid)
 {
     SS7TCAPTransaction* tr = 0;
-    Lock lock(m_transactionsMtx);
+    Lock lock(m_transactionsMtx.mutex(shardIndex(m_transactions,tid)));
     ObjList* o = m_transactions.find(tid);
     if (o)
 	tr = static_cast<SS7TCAPTransaction*>(o->get());
@@ -606,10 +649,72 @@ SS7TCAPTransaction* SS7TCAP::getTransaction(const String& tid)
     return 0;
 }
 
+void SS7TCAP::addTransaction(SS7TCAPTransaction* tr)
+{
+    if (!tr)
+	return;
+    unsigned int shard = shardIndex(m_transactions,tr->toString());
+    Lock lock(m_transactionsMtx.mutex(shard));
+    m_transactions.append(tr);
+    m_shardCount[shard]++;
+    lock.drop();
+    scheduleTransaction(tr);
+}
+
 void SS7TCAP::removeTransaction(SS7TCAPTransaction* tr)
 {
-    Lock lock(m_transactionsMtx);
-    m_transactions.remove(tr);
+    if (!tr)
+	return;
+    unsigned int shard = shardIndex(m_transactions,tr->toString());
+    Lock lock(m_transactionsMtx.mutex(shard));
+    ObjList* o = m_transactions.find(tr,tr->toString().hash());
+    if (!o)
+	return;
+    m_wheelMtx.lock();
+    unscheduleTransaction(tr);
+    m_wheelMtx.unlock();
+    m_shardCount[shard]--;
+    o->remove();
+}
+
+void SS7TCAP::scheduleTransaction(SS7TCAPTransaction* tr, u_int64_t when)
+{
+    if (!tr)
+	return;
+    // only transactions held by the table may be kept in the wheel
+    Lock lock(m_transactionsMtx.mutex(shardIndex(m_transactions,tr->toString())));
+    if (!m_transactions.find(tr,tr->toString().hash()))
+	return;
+    Lock wLock(m_wheelMtx);
+    u_int64_t slot = (when ? when : Time::msecNow()) / TCAP_WHEEL_RES;
+    if (slot < m_wheelSlot)
+	slot = m_wheelSlot;
+    if (tr->m_checkSlot) {
+	if (tr->m_checkSlot <= slot)
+	    return;
+	unscheduleTransaction(tr);
+    }
+    SS7TCAPTransaction*& head = m_wheel[slot % TCAP_WHEEL_SLOTS];
+    tr->m_checkSlot = slot;
+    tr->m_checkPrev = 0;
+    tr->m_checkNext = head;
+    if (head)
+	head->m_checkPrev = tr;
+    head = tr;
+}
+
+void SS7TCAP::unscheduleTransaction(SS7TCAPTransaction* tr)
+{
+    if (!tr->m_checkSlot)
+	return;
+    if (tr->m_checkPrev)
+	tr->m_checkPrev->m_checkNext = tr->m_checkNext;
+    else
+	m_wheel[tr->m_checkSlot % TCAP_WHEEL_SLOTS] = tr->m_checkNext;
+    if (tr->m_checkNext)
+	tr->m_checkNext->m_checkPrev = tr->m_checkPrev;
+    tr->m_checkPrev = tr->m_checkNext = 0;
+    tr->m_checkSlot = 0;
 }
 
 void SS7TCAP::timerTick(const Time& when)
@@ -624,17 +729,42 @@ void SS7TCAP::timerTick(const Time& when)
 	msg = dequeue();
     }
 
-    // update/handle rest of transactions
-    Lock lock(m_transactionsMtx);
-    ListIterator iter(m_transactions);
-    for (;;) {
-	SS7TCAPTransaction* tr = static_cast<SS7TCAPTransaction*>(iter.get());
-	// End of iteration?
-	if (!tr)
-	    break;
-	if (!tr->ref())
-	    continue;
-	lock.drop();
+    u_int64_t now = when.msec();
+    if (now >= m_rateTime) {
+	if (m_rateTime) {
+	    for (unsigned int i = 0; i < TCAP_SHARDS; i++) {
+		m_shardRate[i] = m_shardTimeouts[i];
+		m_shardTimeouts[i] = 0;
+	    }
+	}
+	m_rateTime = now + TCAP_RATE_INTERVAL;
+    }
+
+    // collect the transactions scheduled up to now
+    ObjList due;
+    ObjList* last = &due;
+    u_int64_t slot = now / TCAP_WHEEL_RES;
+    m_wheelMtx.lock();
+    if (!m_wheelSlot || (m_wheelSlot + TCAP_WHEEL_SLOTS <= slot))
+	m_wheelSlot = (slot >= TCAP_WHEEL_SLOTS) ? slot - TCAP_WHEEL_SLOTS + 1 : 0;
+    for (; m_wheelSlot <= slot; m_wheelSlot++) {
+	SS7TCAPTransaction* tr = m_wheel[m_wheelSlot % TCAP_WHEEL_SLOTS];
+	while (tr) {
+	    SS7TCAPTransaction* next = tr->m_checkNext;
+	    // skip the ones scheduled in a later turn of the wheel
+	    if (tr->m_checkSlot <= slot) {
+		unscheduleTransaction(tr);
+		if (tr->ref())
+		    last = last->append(tr);
+	    }
+	    tr = next;
+	}
+    }
+    m_wheelMtx.unlock();
+
+    // update/handle the collected transactions
+    for (ObjList* o = due.skipNull(); o; o = o->skipNext()) {
+	SS7TCAPTransaction* tr = static_cast<SS7TCAPTransaction*>(o->get());
 	NamedList params("");
 	DataBlock data;
 	if (tr->transactionState() != SS7TCAPTransaction::Idle)
@@ -643,6 +773,8 @@ void SS7TCAP::timerTick(const Time& when)
 	    tr->setState(SS7TCAPTransaction::Idle);
 	if (tr->timedOut()) {
 	    DDebug(this,DebugInfo,"SS7TCAP::timerTick() - transaction with id=%s(%p) timed out [%p]",tr->toString().c_str(),tr,this);
+	    m_timeouts++;
+	    m_shardTimeouts[shardIndex(m_transactions,tr->toString())]++;
 	    tr->updateToEnd();
 	    buildSCCPData(params,tr);
 	    if (!tr->basicEnd())
@@ -653,9 +785,11 @@ void SS7TCAP::timerTick(const Time& when)
 
 	if (tr->transactionState() == SS7TCAPTransaction::Idle)
 	    removeTransaction(tr);
-	TelEngine::destruct(tr);
-	if (!lock.acquire(m_transactionsMtx))
-	    break;
+	else {
+	    u_int64_t next = tr->nextTimeout();
+	    if (next)
+		scheduleTransaction(tr,next + 1);
+	}
     }
 }
 
@@ -700,9 +834,7 @@ HandledMSU SS7TCAP::processSCCPData(SS7TCAPMessage* msg)
 		allocTransactionID(newID);
 		tr = buildTransaction(type,newID,msgParams,false);
 		tr->ref();
-		m_transactionsMtx.lock();
-		m_transactions.append(tr);
-		m_transactionsMtx.unlock();
+		addTransaction(tr);
 		msgParams.setParam(s_tcapLocalTID,newID);
 	    }
 	    break;
@@ -726,6 +858,7 @@ HandledMSU SS7TCAP::processSCCPData(SS7TCAPMessage* msg)
 	    transactError = tr->update((SS7TCAP::TCAPUserTransActions)type,msgParams,false);
 	    if (transactError.error() != SS7TCAPError::NoError) {
 		result = handleError(transactError,msgParams,msgData,tr);
+		scheduleTransaction(tr);
 		TelEngine::destruct(tr);
 		return result;
 	    }
@@ -738,6 +871,7 @@ HandledMSU SS7TCAP::processSCCPData(SS7TCAPMessage* msg)
 	transactError = tr->handleData(msgParams,msgData);
 	if (transactError.error() != SS7TCAPError::NoError) {
 	    result = handleError(transactError,msgParams,msgData,tr);
+	    scheduleTransaction(tr);
 	    TelEngine::destruct(tr);
 	    return result;
 	}
@@ -765,6 +899,7 @@ HandledMSU SS7TCAP::processSCCPData(SS7TCAPMessage* msg)
 	}
 	else
 	    tr->setState(SS7TCAPTransaction::Idle);
+	scheduleTransaction(tr);
 	TelEngine::destruct(tr);
     }
     result = HandledMSU::Accepted;
@@ -822,9 +957,7 @@ SS7TCAPError SS7TCAP::userRequest(NamedList& params)
 		if (!TelEngine::null(user))
 		    tr->setUserName(user);
 		tr->ref();
-		m_transactionsMtx.lock();
-		m_transactions.append(tr);
-		m_transactionsMtx.unlock();
+		addTransaction(tr);
 		break;
 	    case SS7TCAP::TC_Continue:
 	    case SS7TCAP::TC_ConversationWithPerm:
@@ -842,6 +975,7 @@ SS7TCAPError SS7TCAP::userRequest(NamedList& params)
 		    }
 		    error = tr->update((SS7TCAP::TCAPUserTransActions)type,params);
 		    if (error.error() != SS7TCAPError::NoError) {
+			scheduleTransaction(tr);
 			TelEngine::destruct(tr);
 			return error;
 		    }
@@ -868,11 +1002,13 @@ SS7TCAPError SS7TCAP::userRequest(NamedList& params)
     if (tr) {
 	error = tr->handleDialogPortion(params,true);
 	if (error.error() != SS7TCAPError::NoError) {
+	    scheduleTransaction(tr);
 	    TelEngine::destruct(tr);
 	    return error;
 	}
 	error = tr->handleComponents(params,true);
 	if (error.error() != SS7TCAPError::NoError) {
+	    scheduleTransaction(tr);
 	    TelEngine::destruct(tr);
 	    return error;
 	}
@@ -883,6 +1019,7 @@ SS7TCAPError SS7TCAP::userRequest(NamedList& params)
 	}
 	else if (tr->transmitState() == SS7TCAPTransaction::NoTransmit)
 	    removeTransaction(tr);
+	scheduleTransaction(tr);
 	TelEngine::destruct(tr);
     }
     return error;
@@ -1220,7 +1357,8 @@ SS7TCAPTransaction::SS7TCAPTransaction(SS7TCAP* tcap, SS7TCAP::TCAPUserTransActi
 	const String& transactID, NamedList& params, u_int64_t timeout, bool initLocal)
     : Mutex(true,"TcapTransaction"),
       m_tcap(tcap), m_tcapType(SS7TCAP::UnknownTCAP), m_userName(""), m_localID(transactID), m_type(type),
-      m_localSCCPAddr(""), m_remoteSCCPAddr(""), m_basicEnd(true), m_endNow(false), m_timeout(timeout)
+      m_localSCCPAddr(""), m_remoteSCCPAddr(""), m_basicEnd(true), m_endNow(false), m_timeout(timeout),
+      m_checkSlot(0), m_checkPrev(0), m_checkNext(0)
 {
 
     DDebug(m_tcap,DebugAll,"SS7TCAPTransaction(tcap = '%s' [%p], transactID = %s) created [%p]",
@@ -1517,6 +1655,18 @@ void SS7TCAPTransaction::checkComponents()
     }
 }
 
+u_int64_t SS7TCAPTransaction::nextTimeout()
+{
+    Lock l(this);
+    u_int64_t next = m_timeout.fireTime();
+    for (ObjList* o = m_components.skipNull(); o; o = o->skipNext()) {
+	u_int64_t t = static_cast<SS7TCAPComponent*>(o->get())->fireTime();
+	if (t && (!next || t < next))
+	    next = t;
+    }
+    return next;
+}
+
 void SS7TCAPTransaction::setTransmitState(TransactionTransmit state)
 {
     Lock l(this);
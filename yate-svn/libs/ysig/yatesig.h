@@ -1691,8 +1691,7 @@ public:
      * @param sync Synchronous status change requested
      * @return True if status change has been initiated
      */
-    virtual bool status(Status newStat, bool sync = false)
-	{ m_status = newStat; return true; }
+    virtual bool status(Status newStat, bool sync = false);
 
     /**
      * Get the type of this circuit
@@ -2027,7 +2026,7 @@ public:
      * @return Pointer to the circuit codes array or 0
      */
     inline void clear()
-	{ m_range.clear(); m_count = 0; }
+	{ m_range.clear(); m_map.clear(); m_count = 0; }
 
     /**
      * Indexing operator
@@ -2102,6 +2101,7 @@ protected:
     void updateLast();                   // Update last circuit code
 
     DataBlock m_range;                   // Array containing the circuit codes
+    DataBlock m_map;                     // Bit map of the circuit codes in the array
     unsigned int m_count;                // The number of elements in the array
     unsigned int m_last;                 // Last (the greater) not used circuit code within this range
     int m_strategy;                      // Keep the strategy used to allocate circuits from this range
@@ -2353,9 +2353,15 @@ protected:
 
 private:
     unsigned int advance(unsigned int n, int strategy, SignallingCircuitRange& range);
+    int findIdle(SignallingCircuitRange& range, int strategy,
+	unsigned int first, unsigned int last, bool up);
+    void setIdle(unsigned int code, bool idle);
     void clearAll();
 
     ObjList m_circuits;                  // The circuits belonging to this group
+    DataBlock m_index;                   // Circuits indexed by their local code
+    DataBlock m_idle;                    // Bit map of idle circuits
+    Mutex m_idleMutex;                   // Protects the idle circuits map
     ObjList m_spans;                     // The spans belonging to this group
     ObjList m_ranges;                    // Additional circuit ranges
     SignallingCircuitRange m_range;      // Range containing all circuits belonging to this group
@@ -8173,6 +8179,7 @@ class YSIG_API SS7MsgISUP : public SignallingMessage
 {
     YCLASS(SS7MsgISUP,SignallingMessage)
     friend class SS7ISUPCall;
+    friend class SS7ISUP;
 public:
     /**
      * ISUP Message type as defined by Q.762 Table 2 and Q.763 Table 4
@@ -8385,7 +8392,8 @@ public:
      * @param cic Source/destination Circuit Identification Code
      */
     inline SS7MsgISUP(Type type, unsigned int cic)
-	: SignallingMessage(lookup(type,"Unknown")), m_type(type), m_cic(cic)
+	: SignallingMessage(lookup(type,"Unknown")), m_type(type), m_cic(cic),
+	  m_indexed(false)
 	{ }
 
     /**
@@ -8408,6 +8416,14 @@ public:
     inline unsigned int cic() const
 	{ return m_cic; }
 
+    /**
+     * Check if this message keeps the raw parameter area it was received with.
+     * Parameters of an indexed message are decoded only when requested
+     * @return True if the message parameters were indexed, not decoded
+     */
+    inline bool indexed() const
+	{ return m_indexed; }
+
     /**
      * Fill a string with this message's parameters for debug purposes
      * @param dest The destination string
@@ -8446,6 +8462,9 @@ public:
 private:
     Type m_type;                         // Message type
     unsigned int m_cic;                  // Source/destination Circuit Identification Code
+    bool m_indexed;                      // Parameters are kept in raw form
+    DataBlock m_raw;                     // Raw parameter area of an indexed message
+    DataBlock m_rawIndex;                // Index of the parameters in the raw area
 };
 
 /**
@@ -8788,6 +8807,7 @@ private:
     State m_state;                       // Call state
     bool m_testCall;                     // Test only call
     SignallingCircuit* m_circuit;        // Circuit reserved for this call
+    unsigned int m_cicIndex;             // Circuit code this call is indexed by in controller
     String m_cicRange;                   // The range used to re(alloc) a circuit
     SS7Label m_label;                    // The routing label for this call
     bool m_terminate;                    // Termination flag
@@ -9003,6 +9023,49 @@ public:
     bool decodeMessage(NamedList& msg, SS7MsgISUP::Type msgType, SS7PointCode::Type pcType,
 	const unsigned char* paramPtr, unsigned int paramLen);
 
+    /**
+     * Index an ISUP message buffer without decoding the parameters.
+     * The raw parameter area is kept in the message, parameters are decoded to
+     *  the message list only when requested by decodeIndexed()
+     * @param msg Destination message
+     * @param pcType The point code type (message version)
+     * @param paramPtr Pointer to the Parameter area (just after the message type)
+     * @param paramLen Length of the Parameter area
+     * @return True if the mesage was successfully parsed
+     */
+    bool indexMessage(SS7MsgISUP& msg, SS7PointCode::Type pcType,
+	const unsigned char* paramPtr, unsigned int paramLen);
+
+    /**
+     * Decode parameters of an indexed message to the message list
+     * @param msg The message to decode
+     * @param name Name of the parameter to decode, empty to decode all parameters
+     * @return True if the parameter was found, always true when decoding all
+     */
+    bool decodeIndexed(SS7MsgISUP& msg, const String& name = String::empty());
+
+    /**
+     * Match the decoded parameters of an indexed message against a list of parameters.
+     * Parameters found unchanged are set back to raw form and removed from message list
+     * @param msg The indexed message
+     * @param params List of parameters to match
+     * @return The number of parameters changed or added in the list,
+     *  non zero if the message was not indexed
+     */
+    unsigned int matchIndexed(SS7MsgISUP& msg, const NamedList& params);
+
+    /**
+     * Create a new MSU from an indexed message.
+     * Parameters still in raw form are copied as received
+     * @param msg The message to encode
+     * @param ssf Subservice Field
+     * @param label Routing label for the new MSU
+     * @param params Optional parameter list to use instead of message parameters
+     * @return Pointer to the new MSU or NULL if an error occured
+     */
+    SS7MSU* createMSU(const SS7MsgISUP& msg, unsigned char ssf,
+	const SS7Label& label, const NamedList* params = 0) const;
+
     /**
      * Encode an ISUP list of parameters to a buffer.
      * The input list may contain a 'message-prefix' parameter to override this controller's prefix
@@ -9060,10 +9123,12 @@ protected:
      * @param label Routing label for the new MSU
      * @param cic Circuit Identification Code
      * @param params Parameter list
+     * @param raw Optional indexed message whose raw parameters are copied unchanged
      * @return Pointer to the new MSU or NULL if an error occured
      */
     SS7MSU* buildMSU(SS7MsgISUP::Type type, unsigned char sio,
-	const SS7Label& label, unsigned int cic, const NamedList* params) const;
+	const SS7Label& label, unsigned int cic, const NamedList* params,
+	const SS7MsgISUP* raw = 0) const;
 
     /**
      * Process a MSU received from a Layer 3 component
@@ -9148,6 +9213,9 @@ private:
     // Find a call by its circuit identification code
     // This method is not thread safe
     SS7ISUPCall* findCall(unsigned int cic);
+    // (Re)index a call by its current circuit code or remove it from index
+    // This method is thread safe
+    void indexCall(SS7ISUPCall* call, bool remove = false);
     // Find a call by its circuit identification code
     // This method is thread safe
     inline void findCall(unsigned int cic, RefPointer<SS7ISUPCall>& call) {
@@ -9157,6 +9225,11 @@ private:
     // Encode a raw message
     SS7MSU* encodeRawMessage(SS7MsgISUP::Type type, unsigned char sio,
 	const SS7Label& label, unsigned int cic, const String& param) const;
+    SS7MSU* encodeRawMessage(SS7MsgISUP::Type type, unsigned char sio,
+	const SS7Label& label, unsigned int cic, const DataBlock& raw) const;
+    // Parse a message parameter area, decode or index the parameters
+    bool parseMessage(NamedList& msg, SS7MsgISUP::Type msgType, SS7PointCode::Type pcType,
+	const unsigned char* paramPtr, unsigned int paramLen, SS7MsgISUP* index);
     // Send blocking/unblocking messages.
     // Restart the re-check timer if there is any (un)lockable, not sent cic
     // Return false if no request was sent
@@ -9233,6 +9306,7 @@ private:
     u_int64_t m_t27Interval;             // Q.764 T27 Reset after Cont. Check failure
     u_int64_t m_t34Interval;             // Q.764 T34 Segmentation receive timout
     SignallingMessageTimerList m_pending;// Pending messages (RSC ...)
+    DataBlock m_cicCalls;                // Calls indexed by circuit code
     // Remote User Part test
     SignallingTimer m_uptTimer;          // Timer for UPT
     bool m_userPartAvail;                // Flag indicating the remote User Part availability
@@ -10999,12 +11073,26 @@ public:
      */
     SS7TCAPTransaction* getTransaction(const String& tid);
 
+    /**
+     * Add a transaction to the table of current transactions
+     * @param tr The transaction to add, the table takes its reference
+     */
+    void addTransaction(SS7TCAPTransaction* tr);
+
     /**
      * Remove transaction
      * @param tr The transaction to remove
      */
     void removeTransaction(SS7TCAPTransaction* tr);
 
+    /**
+     * Schedule a current transaction to be checked by timerTick().
+     * Must be called after changing a transaction outside of timer ticks
+     * @param tr The transaction to check
+     * @param when Time in milliseconds of the check, 0 to check on next timer tick
+     */
+    void scheduleTransaction(SS7TCAPTransaction* tr, u_int64_t when = 0);
+
     /**
      * Method called periodically to do processing and timeout checks
      * @param when Time to use as computing base for events and timeouts
@@ -11142,6 +11230,8 @@ protected:
     virtual SS7TCAPError decodeTransactionPart(NamedList& params, DataBlock& data) = 0;
     virtual void encodeTransactionPart(NamedList& params, DataBlock& data) = 0;
     bool sendSCCPNotify(NamedList& params);
+    // Unlink a transaction from its timer wheel slot, wheel must be locked
+    void unscheduleTransaction(SS7TCAPTransaction* tr);
     // list of TCAP users attached to this TCAP instance
     ObjList m_users;
     Mutex m_usersMtx;
@@ -11157,9 +11247,13 @@ protected:
     SS7PointCode::Type m_remoteTypePC;
     u_int64_t m_trTimeout;
 
-    // list of current TCAP transactions
-    Mutex m_transactionsMtx;
-    ObjList m_transactions;
+    // current TCAP transactions hashed by local ID, hash lists locked by shard
+    MutexPool m_transactionsMtx;
+    HashList m_transactions;
+    // timer wheel of transactions scheduled for checking
+    Mutex m_wheelMtx;
+    SS7TCAPTransaction** m_wheel;
+    u_int64_t m_wheelSlot;
     // type of TCAP
     TCAPType m_tcapType;
 
@@ -11172,6 +11266,13 @@ protected:
     unsigned int m_discardMsgs;
     unsigned int m_normalMsgs;
     unsigned int m_abnormalMsgs;
+    unsigned int m_timeouts;
+
+    // per shard counters of transactions, timeouts in current and last rate interval
+    unsigned int* m_shardCount;
+    unsigned int* m_shardTimeouts;
+    unsigned int* m_shardRate;
+    u_int64_t m_rateTime;
 
     // Subsystem Status
     SCCPManagement::LocalBroadcast m_ssnStatus;
@@ -11514,6 +11615,12 @@ public:
     inline bool timedOut()
 	{ return m_timeout.timeout(); }
 
+    /**
+     * Retrieve the earliest time the transaction or one of its components will time out
+     * @return Time in milliseconds of the first timeout, 0 if no timer is running
+     */
+    u_int64_t nextTimeout();
+
     /**
      * Find a component with given id
      * @param id Id of component to find
@@ -11582,6 +11689,12 @@ protected:
     bool m_basicEnd; // basic or prearranged end (specified by user when sending a Response)
     bool m_endNow; // delete immediately after sending
     SignallingTimer m_timeout;
+
+private:
+    friend class SS7TCAP;
+    u_int64_t m_checkSlot; // TCAP timer wheel slot the transaction is scheduled in, 0 if none
+    SS7TCAPTransaction* m_checkPrev; // Previous transaction in the same wheel slot
+    SS7TCAPTransaction* m_checkNext; // Next transaction in the same wheel slot
 };
 
 /**
@@ -11691,6 +11804,13 @@ public:
     inline bool timedOut()
 	{ return m_opTimer.timeout(); }
 
+    /**
+     * Retrieve the time when the component will time out
+     * @return Time in milliseconds of the timeout, 0 if the timer is not running
+     */
+    inline u_int64_t fireTime() const
+	{ return m_opTimer.fireTime(); }
+
     /**
      * Set component state
      * @param state The state to be set
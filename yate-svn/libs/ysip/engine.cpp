@@ -110,6 +110,221 @@ static TokenDict sip_responses[] = {
 
 TokenDict* TelEngine::SIPResponses = sip_responses;
 
+// Timer wheel resolution is 2^13 usec (about 8 msec)
+#define WHEEL_TICK_BITS 13
+// First level has 256 slots (about 2 sec), upper levels 64 slots each
+#define WHEEL_L0_BITS 8
+#define WHEEL_LN_BITS 6
+#define WHEEL_L0 (1 << WHEEL_L0_BITS)
+#define WHEEL_LN (1 << WHEEL_LN_BITS)
+// Three levels cover about 2.4 hours, longer timers are parked at the end
+#define WHEEL_SPAN (WHEEL_L0 * WHEEL_LN * WHEEL_LN)
+#define WHEEL_SLOTS (WHEEL_L0 + 2 * WHEEL_LN)
+
+// Buckets of the branch and Call-ID lookup hashes
+#define INDEX_SIZE 1021
+
+namespace TelEngine {
+
+// Scheduling and lookup structures of the transactions in a SIPEngine
+// Transactions with work to do sit in the ready queue, those waiting for a
+//  timer in a hierarchical timer wheel and idle ones in neither
+class SIPTransIndex
+{
+public:
+    SIPTransIndex();
+    void attach(SIPTransaction* trans, bool first);
+    void detach(SIPTransaction* trans);
+    void changeBranch(SIPTransaction* trans, const String& branch);
+    void ready(SIPTransaction* trans);
+    inline void unqueue(SIPTransaction* trans)
+	{ unlink(trans); }
+    inline bool queued(const SIPTransaction* trans) const
+	{ return trans->m_queue != 0; }
+    void idle(SIPTransaction* trans);
+    void expire(u_int64_t time);
+    void find(ObjList& list, const String& branch, const String& callid, bool ack) const;
+    inline SIPTransaction* first() const
+	{ return m_first; }
+    inline static bool attached(const SIPTransaction* trans)
+	{ return trans->m_order != 0; }
+private:
+    void link(SIPTransaction* trans, SIPTransaction** queue);
+    void unlink(SIPTransaction* trans);
+    void cascade(unsigned int slot);
+    SIPTransaction* m_first;
+    SIPTransaction* m_last;
+    SIPTransaction* m_wheel[WHEEL_SLOTS];
+    u_int64_t m_tick;
+    int64_t m_orderFirst;
+    int64_t m_orderLast;
+    ObjList m_branches[INDEX_SIZE];
+    ObjList m_callids[INDEX_SIZE];
+};
+
+}; // namespace TelEngine
+
+SIPTransIndex::SIPTransIndex()
+    : m_first(0), m_last(0),
+      m_tick(Time::now() >> WHEEL_TICK_BITS),
+      m_orderFirst(0), m_orderLast(0)
+{
+    for (unsigned int i = 0; i < WHEEL_SLOTS; i++)
+	m_wheel[i] = 0;
+}
+
+// Start tracking a transaction that was put in the engine list
+void SIPTransIndex::attach(SIPTransaction* trans, bool first)
+{
+    if (attached(trans))
+	return;
+    trans->m_order = first ? --m_orderFirst : ++m_orderLast;
+    if (trans->m_branch)
+	m_branches[trans->m_branch.hash() % INDEX_SIZE].append(trans)->setDelete(false);
+    m_callids[trans->m_callid.hash() % INDEX_SIZE].append(trans)->setDelete(false);
+    ready(trans);
+}
+
+// Stop tracking a transaction removed from the engine list
+void SIPTransIndex::detach(SIPTransaction* trans)
+{
+    if (!attached(trans))
+	return;
+    unlink(trans);
+    if (trans->m_branch)
+	m_branches[trans->m_branch.hash() % INDEX_SIZE].remove(trans,false);
+    m_callids[trans->m_callid.hash() % INDEX_SIZE].remove(trans,false);
+    trans->m_order = 0;
+}
+
+void SIPTransIndex::changeBranch(SIPTransaction* trans, const String& branch)
+{
+    if (attached(trans) && trans->m_branch)
+	m_branches[trans->m_branch.hash() % INDEX_SIZE].remove(trans,false);
+    trans->m_branch = branch;
+    if (attached(trans) && trans->m_branch)
+	m_branches[trans->m_branch.hash() % INDEX_SIZE].append(trans)->setDelete(false);
+}
+
+void SIPTransIndex::link(SIPTransaction* trans, SIPTransaction** queue)
+{
+    trans->m_queue = queue;
+    trans->m_queuePrev = 0;
+    trans->m_queueNext = *queue;
+    if (*queue)
+	(*queue)->m_queuePrev = trans;
+    *queue = trans;
+}
+
+void SIPTransIndex::unlink(SIPTransaction* trans)
+{
+    if (!trans->m_queue)
+	return;
+    if (trans->m_queuePrev)
+	trans->m_queuePrev->m_queueNext = trans->m_queueNext;
+    else
+	*trans->m_queue = trans->m_queueNext;
+    if (trans->m_queueNext)
+	trans->m_queueNext->m_queuePrev = trans->m_queuePrev;
+    if (m_last == trans)
+	m_last = trans->m_queuePrev;
+    trans->m_queue = 0;
+    trans->m_queuePrev = 0;
+    trans->m_queueNext = 0;
+}
+
+// Put a transaction at the end of the ready queue
+void SIPTransIndex::ready(SIPTransaction* trans)
+{
+    if (trans->m_queue == &m_first)
+	return;
+    unlink(trans);
+    trans->m_queue = &m_first;
+    trans->m_queuePrev = m_last;
+    if (m_last)
+	m_last->m_queueNext = trans;
+    else
+	m_first = trans;
+    m_last = trans;
+}
+
+// Transaction has nothing to do now, wait for its timer if it has one
+void SIPTransIndex::idle(SIPTransaction* trans)
+{
+    unlink(trans);
+    if (!trans->m_timeout)
+	return;
+    u_int64_t due = (trans->m_timeout + (1 << WHEEL_TICK_BITS) - 1) >> WHEEL_TICK_BITS;
+    if (due <= m_tick) {
+	ready(trans);
+	return;
+    }
+    u_int64_t delta = due - m_tick;
+    unsigned int slot;
+    if (delta < WHEEL_L0)
+	slot = due & (WHEEL_L0 - 1);
+    else if (delta < WHEEL_L0 * WHEEL_LN)
+	slot = WHEEL_L0 + ((due >> WHEEL_L0_BITS) & (WHEEL_LN - 1));
+    else {
+	if (delta >= WHEEL_SPAN)
+	    due = m_tick + WHEEL_SPAN - 1;
+	slot = WHEEL_L0 + WHEEL_LN + ((due >> (WHEEL_L0_BITS + WHEEL_LN_BITS)) & (WHEEL_LN - 1));
+    }
+    link(trans,&m_wheel[slot]);
+}
+
+// Move the content of an upper level slot to the lower levels
+void SIPTransIndex::cascade(unsigned int slot)
+{
+    while (SIPTransaction* t = m_wheel[slot])
+	idle(t);
+}
+
+// Advance the timer wheel, move transactions with expired timers to the ready queue
+void SIPTransIndex::expire(u_int64_t time)
+{
+    u_int64_t target = time >> WHEEL_TICK_BITS;
+    while (m_tick < target) {
+	u_int64_t tick = ++m_tick;
+	if (!(tick & (WHEEL_L0 - 1))) {
+	    unsigned int idx = (tick >> WHEEL_L0_BITS) & (WHEEL_LN - 1);
+	    if (!idx)
+		cascade(WHEEL_L0 + WHEEL_LN +
+		    ((tick >> (WHEEL_L0_BITS + WHEEL_LN_BITS)) & (WHEEL_LN - 1)));
+	    cascade(WHEEL_L0 + idx);
+	}
+	SIPTransaction** slot = &m_wheel[tick & (WHEEL_L0 - 1)];
+	while (*slot)
+	    ready(*slot);
+    }
+}
+
+// Collect the transactions that may match a message, in engine list order
+void SIPTransIndex::find(ObjList& list, const String& branch, const String& callid, bool ack) const
+{
+    for (int pass = 0; pass < 2; pass++) {
+	const ObjList* l = 0;
+	if (!pass) {
+	    if (branch)
+		l = m_branches[branch.hash() % INDEX_SIZE].skipNull();
+	}
+	else if (ack || !branch)
+	    l = m_callids[callid.hash() % INDEX_SIZE].skipNull();
+	for (; l; l = l->skipNext()) {
+	    SIPTransaction* t = static_cast<SIPTransaction*>(l->get());
+	    if (pass ? (t->m_callid != callid) : (t->m_branch != branch))
+		continue;
+	    ObjList* o = list.skipNull();
+	    while (o && (static_cast<SIPTransaction*>(o->get())->m_order < t->m_order))
+		o = o->skipNext();
+	    if (!o)
+		list.append(t)->setDelete(false);
+	    else if (o->get() != t)
+		o->insert(t)->setDelete(false);
+	}
+    }
+}
+
 SIPParty::SIPParty(Mutex* mutex)
     : m_mutex(mutex), m_reliable(false), m_localPort(0), m_partyPort(0)
 {
@@ -174,7 +389,8 @@ SIPEngine::SIPEngine(const char* userAgent)
       m_flags(0), m_lazyTrying(false),
       m_userAgent(userAgent), m_nc(0), m_nonce_time(0),
       m_nonce_mutex(false,"SIPEngine::nonce"),
-      m_autoChangeParty(false)
+      m_autoChangeParty(false),
+      m_index(new SIPTransIndex)
 {
     debugName("sipengine");
     DDebug(this,DebugInfo,"SIPEngine::SIPEngine() [%p]",this);
@@ -191,6 +407,61 @@ SIPEngine::SIPEngine(const char* userAgent)
 SIPEngine::~SIPEngine()
 {
     DDebug(this,DebugInfo,"SIPEngine::~SIPEngine() [%p]",this);
+    clearTransactions();
+    lock();
+    SIPTransIndex* idx = m_index;
+    m_index = 0;
+    unlock();
+    delete idx;
+}
+
+void SIPEngine::remove(SIPTransaction* transaction)
+{
+    Lock lock(this);
+    m_transList.remove(transaction,false);
+    if (m_index)
+	m_index->detach(transaction);
+}
+
+void SIPEngine::append(SIPTransaction* transaction)
+{
+    Lock lock(this);
+    m_transList.append(transaction);
+    if (m_index)
+	m_index->attach(transaction,false);
+}
+
+void SIPEngine::insert(SIPTransaction* transaction)
+{
+    Lock lock(this);
+    m_transList.insert(transaction);
+    if (m_index)
+	m_index->attach(transaction,true);
+}
+
+void SIPEngine::clearTransactions()
+{
+    Lock lock(this);
+    if (m_index) {
+	for (ObjList* l = m_transList.skipNull(); l; l = l->skipNext())
+	    m_index->detach(static_cast<SIPTransaction*>(l->get()));
+    }
+    m_transList.clear();
+}
+
+// Notification from a transaction that it may have an event to deliver
+void SIPEngine::wakeup(SIPTransaction* transaction)
+{
+    Lock lock(this);
+    if (m_index && SIPTransIndex::attached(transaction))
+	m_index->ready(transaction);
+}
+
+void SIPEngine::changeBranch(SIPTransaction* transaction, const String& branch)
+{
+    Lock lock(this);
+    if (m_index)
+	m_index->changeBranch(transaction,branch);
 }
 
 SIPTransaction* SIPEngine::addMessage(SIPParty* ep, const char* buf, int len)
@@ -229,11 +500,11 @@ SIPTransaction* SIPEngine::addMessage(SIPMessage* message)
 	branch = *br;
     Lock lock(this);
     SIPTransaction* forked = 0;
-    ObjList* l = &m_transList;
-    for (; l; l = l->next()) {
+    // only transactions with the same branch or Call-ID can match
+    ObjList found;
+    m_index->find(found,branch,message->getHeaderValue("Call-ID"),message->isACK());
+    for (ObjList* l = found.skipNull(); l; l = l->skipNext()) {
 	SIPTransaction* t = static_cast<SIPTransaction*>(l->get());
-	if (!t)
-	    continue;
 	switch (t->processMessage(message,branch)) {
 	    case SIPTransaction::Matched:
 		return t;
@@ -280,32 +551,30 @@ bool SIPEngine::process()
 SIPEvent* SIPEngine::getEvent()
 {
     Lock lock(this);
-    ObjList* l = m_transList.skipNull();
-    if (!l)
+    if (!m_index)
 	return 0;
     u_int64_t time = Time::now();
-    for (; l; l = l->skipNext()) {
-	SIPTransaction* t = static_cast<SIPTransaction*>(l->get());
-	SIPEvent* e = t->getEvent(true,time);
-	if (e) {
-	    DDebug(this,DebugInfo,"Got pending event %p (state %s) from transaction %p [%p]",
-		e,SIPTransaction::stateName(e->getState()),t,this);
-	    if (t->getState() == SIPTransaction::Invalid)
-		m_transList.remove(t);
-	    return e;
-	}
-    }
-    time = Time::now();
-    for (l = m_transList.skipNull(); l; l = l->skipNext()) {
-	SIPTransaction* t = static_cast<SIPTransaction*>(l->get());
+    m_index->expire(time);
+    while (SIPTransaction* t = m_index->first()) {
+	// take it out of the queue, a wakeup while polling puts it back
+	m_index->unqueue(t);
 	SIPEvent* e = t->getEvent(false,time);
 	if (e) {
 	    DDebug(this,DebugInfo,"Got event %p (state %s) from transaction %p [%p]",
 		e,SIPTransaction::stateName(e->getState()),t,this);
-	    if (t->getState() == SIPTransaction::Invalid)
-		m_transList.remove(t);
+	    if (t->getState() == SIPTransaction::Invalid) {
+		m_index->detach(t);
+		if (m_transList.remove(t,false))
+		    t->deref();
+	    }
+	    else {
+		// there may be more events, poll it again after the others
+		m_index->ready(t);
+	    }
 	    return e;
 	}
+	if (!m_index->queued(t))
+	    m_index->idle(t);
     }
     return 0;
 }
@@ -517,14 +786,8 @@ int SIPEngine::authUser(const SIPMessage* message, String& user, bool proxy, Gen
     long bestAge = -1;
     String bestNonce;
     const char* hdr = proxy ? "Proxy-Authorization" : "Authorization";
-    const ObjList* l = &message->header;
-    for (; l; l = l->next()) {
-	const GenObject* o = l->get();
-	if (!o)
-	    continue;
-	const MimeHeaderLine* t = static_cast<const MimeHeaderLine*>(o->getObject(YATOM("MimeHeaderLine")));
-	if (!t || (t->name() |= hdr))
-	    continue;
+    const MimeHeaderLine* t = 0;
+    for (unsigned int i = 0; (t = message->getHeaderAt(hdr,i)); i++) {
 	// remember this line for foreign authentication
 	if (!authLine)
 	    authLine = t;
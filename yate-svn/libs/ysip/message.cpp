@@ -23,12 +23,355 @@
 
 #include <string.h>
 #include <stdlib.h>
+#include <ctype.h>
 
 
+// Number of well known headers that have a fixed slot in the index
+#define HEADER_KNOWN 11
+
+namespace TelEngine {
+
+// Offsets of the header lines of a parsed message in a private copy of its
+//  header block. Lines are decoded into MimeHeaderLine objects on first use,
+//  the first line of each well known header is found from a fixed slot
+class SIPHeaderIndex
+{
+public:
+    SIPHeaderIndex();
+    ~SIPHeaderIndex();
+    bool parse(const char*& buf, int& len);
+    int find(const char* name, int from = 0) const;
+    MimeHeaderLine* line(int index);
+    MimeHeaderLine* take(int index);
+    void moveContent(MimeBody* body, const MimeHeaderLine* cType);
+    inline unsigned int count() const
+	{ return m_count; }
+private:
+    struct Entry {
+	unsigned int nameOffs;           // Header name, trimmed
+	unsigned int nameLen;
+	unsigned int valOffs;            // Trimmed value or entire folded line
+	unsigned int valLen;
+	const char* name;                // Full name of a compact form
+	int known;                       // Well known header slot, -1 if other
+	bool folded;                     // Line is folded, decode it as a whole
+	bool gone;                       // Line was moved out of the index
+	MimeHeaderLine* line;            // Decoded line
+    };
+    Entry* add();
+    const char* name(const Entry& e, unsigned int& len) const;
+    Entry* m_entries;
+    unsigned int m_count;
+    unsigned int m_alloc;
+    DataBlock m_data;
+    int m_first[HEADER_KNOWN];
+};
+
+}; // namespace TelEngine
+
 using namespace TelEngine;
 
 static Regexp s_angled("<\\([^>]\\+\\)>");
 
+// Headers most transactions look at, they get a fixed slot in the index
+static const char* s_knownHeaders[HEADER_KNOWN] = {
+    "Via",
+    "From",
+    "To",
+    "Call-ID",
+    "CSeq",
+    "Contact",
+    "Content-Length",
+    "Content-Type",
+    "Max-Forwards",
+    "Route",
+    "Record-Route",
+};
+
+// Protects the lazy decoding of lines of messages shared between threads
+static MutexPool s_indexMutex(17,false,"SIPHeaderIndex");
+
+static inline bool isBlank(char c)
+{
+    return (c == ' ') || (c == '\t');
+}
+
+// Find the fixed slot of a header name, -1 if it has none
+static int knownHeader(const char* name, unsigned int len)
+{
+    for (int i = 0; i < HEADER_KNOWN; i++) {
+	const char* k = s_knownHeaders[i];
+	if (!(::strncasecmp(k,name,len) || k[len]))
+	    return i;
+    }
+    return -1;
+}
+
+static inline Mutex* indexMutex(const SIPMessage* msg)
+{
+    return s_indexMutex.mutex((void*)msg);
+}
+
+
+SIPHeaderIndex::SIPHeaderIndex()
+    : m_entries(0), m_count(0), m_alloc(0)
+{
+    for (int i = 0; i < HEADER_KNOWN; i++)
+	m_first[i] = -1;
+}
+
+SIPHeaderIndex::~SIPHeaderIndex()
+{
+    for (unsigned int i = 0; i < m_count; i++)
+	TelEngine::destruct(m_entries[i].line);
+    ::free(m_entries);
+}
+
+SIPHeaderIndex::Entry* SIPHeaderIndex::add()
+{
+    if (m_count >= m_alloc) {
+	unsigned int alloc = m_alloc ? 2 * m_alloc : 32;
+	Entry* e = (Entry*)::realloc(m_entries,alloc * sizeof(Entry));
+	if (!e)
+	    return 0;
+	m_entries = e;
+	m_alloc = alloc;
+    }
+    Entry* e = m_entries + m_count++;
+    e->nameOffs = e->nameLen = e->valOffs = e->valLen = 0;
+    e->name = 0;
+    e->known = -1;
+    e->folded = false;
+    e->gone = false;
+    e->line = 0;
+    return e;
+}
+
+// Index the header lines, consume the buffer up to the empty line after them
+// Lines are delimited and unfolded the same way MimeBody::getUnfoldedLine() does
+bool SIPHeaderIndex::parse(const char*& buf, int& len)
+{
+    int i = 0;
+    while (i < len) {
+	int start = i;
+	int eol = -1;
+	int col = -1;
+	int chars = 0;
+	bool folded = false;
+	bool colFolded = false;
+	while (i < len) {
+	    char c = buf[i];
+	    if ((c == '\r') || (c == '\n')) {
+		eol = i++;
+		// CR is optional but skip over it if exists
+		if ((c == '\r') && (i < len) && (buf[i] == '\n'))
+		    i++;
+		if (!(chars && (i < len) && isBlank(buf[i])))
+		    break;
+		folded = true;
+		while ((i < len) && isBlank(buf[i]))
+		    i++;
+		continue;
+	    }
+	    if (!c) {
+		// Should not happen - ignore anything after a NUL
+		eol = i;
+		i = len;
+		break;
+	    }
+	    if ((c == ':') && (col < 0)) {
+		// An initial colon makes the line invalid
+		if (!chars)
+		    return false;
+		col = i;
+		colFolded = folded;
+	    }
+	    chars++;
+	    i++;
+	}
+	if (eol < 0)
+	    eol = i;
+	// Empty line ends the headers
+	if (!chars)
+	    break;
+	if (col < 0)
+	    return false;
+	Entry* e = add();
+	if (!e)
+	    return false;
+	e->folded = folded;
+	if (folded) {
+	    e->valOffs = start;
+	    e->valLen = eol - start;
+	}
+	else {
+	    int s = col + 1;
+	    while ((s < eol) && isBlank(buf[s]))
+		s++;
+	    int n = eol;
+	    while ((n > s) && isBlank(buf[n - 1]))
+		n--;
+	    e->valOffs = s;
+	    e->valLen = n - s;
+	}
+	if (colFolded)
+	    // Name is split across lines, take it after decoding
+	    continue;
+	int s = start;
+	while ((s < col) && isBlank(buf[s]))
+	    s++;
+	int n = col;
+	while ((n > s) && isBlank(buf[n - 1]))
+	    n--;
+	if (n <= s)
+	    return false;
+	e->nameOffs = s;
+	e->nameLen = n - s;
+	if (e->nameLen == 1) {
+	    char tmp[2] = { buf[s], 0 };
+	    const char* full = uncompactForm(tmp);
+	    if (full != tmp)
+		e->name = full;
+	}
+    }
+    m_data.assign((void*)buf,i);
+    buf += i;
+    len -= i;
+    for (int j = m_count - 1; j >= 0; j--) {
+	Entry& e = m_entries[j];
+	if (e.folded && !e.nameLen) {
+	    MimeHeaderLine* hl = line(j);
+	    if (!hl || hl->name().null())
+		return false;
+	}
+	unsigned int l = 0;
+	const char* n = name(e,l);
+	e.known = knownHeader(n,l);
+	if (e.known >= 0)
+	    m_first[e.known] = j;
+    }
+    return true;
+}
+
+// Retrieve the name of an entry, it may not be NUL terminated
+const char* SIPHeaderIndex::name(const Entry& e, unsigned int& len) const
+{
+    if (e.line) {
+	len = e.line->name().length();
+	return e.line->name();
+    }
+    if (e.name) {
+	len = ::strlen(e.name);
+	return e.name;
+    }
+    len = e.nameLen;
+    return (const char*)m_data.data() + e.nameOffs;
+}
+
+// Find the first line with a name, starting at some index
+int SIPHeaderIndex::find(const char* name, int from) const
+{
+    unsigned int len = ::strlen(name);
+    int known = knownHeader(name,len);
+    if (known >= 0) {
+	if (m_first[known] < 0)
+	    return -1;
+	if (from < m_first[known])
+	    from = m_first[known];
+	for (; (unsigned int)from < m_count; from++) {
+	    const Entry& e = m_entries[from];
+	    if (e.known == known && !e.gone)
+		return from;
+	}
+	return -1;
+    }
+    for (; (unsigned int)from < m_count; from++) {
+	const Entry& e = m_entries[from];
+	if (e.known >= 0 || e.gone)
+	    continue;
+	unsigned int l = 0;
+	const char* n = this->name(e,l);
+	if ((l == len) && !::strncasecmp(n,name,len))
+	    return from;
+    }
+    return -1;
+}
+
+// Get the decoded line at an index, decode it if not done already
+MimeHeaderLine* SIPHeaderIndex::line(int index)
+{
+    if ((index < 0) || ((unsigned int)index >= m_count))
+	return 0;
+    Entry& e = m_entries[index];
+    if (e.line || e.gone)
+	return e.line;
+    const char* buf = (const char*)m_data.data();
+    String name;
+    String value;
+    if (e.folded) {
+	const char* b = buf + e.valOffs;
+	int l = e.valLen;
+	String* line = MimeBody::getUnfoldedLine(b,l);
+	int col = line->find(':');
+	name = line->substr(0,col);
+	value = line->substr(col + 1);
+	line->destruct();
+	name.trimBlanks();
+	value.trimBlanks();
+    }
+    else {
+	name.assign(buf + e.nameOffs,e.nameLen);
+	value.assign(buf + e.valOffs,e.valLen);
+    }
+    XDebug(DebugAll,"SIPHeaderIndex::line header='%s' value='%s'",name.c_str(),value.c_str());
+    const char* n = e.name ? e.name : uncompactForm(name);
+    if ((name &= "WWW-Authenticate") ||
+	(name &= "Proxy-Authenticate") ||
+	(name &= "Authorization") ||
+	(name &= "Proxy-Authorization"))
+	e.line = new MimeAuthLine(n,value);
+    else
+	e.line = new MimeHeaderLine(n,value);
+    return e.line;
+}
+
+// Take a line out of the index, decode it first if needed
+MimeHeaderLine* SIPHeaderIndex::take(int index)
+{
+    MimeHeaderLine* hl = line(index);
+    if (hl) {
+	m_entries[index].line = 0;
+	m_entries[index].gone = true;
+    }
+    return hl;
+}
+
+// Move lines holding Content- values to a newly built body
+// Only looks at the raw value of lines not decoded yet
+void SIPHeaderIndex::moveContent(MimeBody* body, const MimeHeaderLine* cType)
+{
+    const char* buf = (const char*)m_data.data();
+    for (unsigned int i = 0; i < m_count; i++) {
+	Entry& e = m_entries[i];
+	if (e.gone)
+	    continue;
+	if (!(e.line || e.folded)) {
+	    if ((e.valLen < 8) || ::strncasecmp(buf + e.valOffs,"Content-",8))
+		continue;
+	}
+	MimeHeaderLine* hl = line(i);
+	if (!hl || !hl->startsWith("Content-",false,true) || (*hl &= "Content-Length"))
+	    continue;
+	take(i);
+	// Delete Content-Type and move all other lines to body
+	if (hl == cType)
+	    TelEngine::destruct(hl);
+	else
+	    body->appendHdr(hl);
+    }
+}
+
+
 SIPMessage::SIPMessage(const SIPMessage& original)
     : RefObject(),
       version(original.version), method(original.method), uri(original.uri),
@@ -36,7 +379,7 @@ SIPMessage::SIPMessage(const SIPMessage& original)
       body(0), m_ep(0),
       m_valid(original.isValid()), m_answer(original.isAnswer()),
       m_outgoing(original.isOutgoing()), m_ack(original.isACK()),
-      m_cseq(-1), m_flags(original.getFlags())
+      m_cseq(-1), m_flags(original.getFlags()), m_index(0)
 {
     DDebug(DebugAll,"SIPMessage::SIPMessage(&%p) [%p]",
 	&original,this);
@@ -45,7 +388,7 @@ SIPMessage::SIPMessage(const SIPMessage& original)
     setParty(original.getParty());
     setSequence(original.getSequence());
     bool via1 = true;
-    const ObjList* l = &original.header;
+    const ObjList* l = &original.allHeaders();
     for (; l; l = l->next()) {
 	const MimeHeaderLine* hl = static_cast<MimeHeaderLine*>(l->get());
 	if (!hl)
@@ -66,7 +409,8 @@ SIPMessage::SIPMessage(const SIPMessage& original)
 SIPMessage::SIPMessage(const char* _method, const char* _uri, const char* _version)
     : version(_version), method(_method), uri(_uri), code(0),
       body(0), m_ep(0), m_valid(true),
-      m_answer(false), m_outgoing(true), m_ack(false), m_cseq(-1), m_flags(-1)
+      m_answer(false), m_outgoing(true), m_ack(false), m_cseq(-1), m_flags(-1),
+      m_index(0)
 {
     DDebug(DebugAll,"SIPMessage::SIPMessage('%s','%s','%s') [%p]",
 	_method,_uri,_version,this);
@@ -74,7 +418,8 @@ SIPMessage::SIPMessage(const char* _method, const char* _uri, const char* _versi
 
 SIPMessage::SIPMessage(SIPParty* ep, const char* buf, int len, unsigned int* bodyLen)
     : code(0), body(0), m_ep(ep), m_valid(false),
-      m_answer(false), m_outgoing(false), m_ack(false), m_cseq(-1), m_flags(-1)
+      m_answer(false), m_outgoing(false), m_ack(false), m_cseq(-1), m_flags(-1),
+      m_index(0)
 {
     DDebug(DebugInfo,"SIPMessage::SIPMessage(%p,%d) [%p]\r\n------\r\n%s------",
 	buf,len,this,buf);
@@ -92,7 +437,8 @@ SIPMessage::SIPMessage(SIPParty* ep, const char* buf, int len, unsigned int* bod
 SIPMessage::SIPMessage(const SIPMessage* message, int _code, const char* _reason)
     : code(_code), body(0),
       m_ep(0), m_valid(false),
-      m_answer(true), m_outgoing(true), m_ack(false), m_cseq(-1), m_flags(-1)
+      m_answer(true), m_outgoing(true), m_ack(false), m_cseq(-1), m_flags(-1),
+      m_index(0)
 {
     DDebug(DebugAll,"SIPMessage::SIPMessage(%p,%d,'%s') [%p]",
 	message,_code,_reason,this);
@@ -121,7 +467,8 @@ SIPMessage::SIPMessage(const SIPMessage* message, int _code, const char* _reason
 SIPMessage::SIPMessage(const SIPMessage* original, const SIPMessage* answer)
     : method("ACK"), code(0),
       body(0), m_ep(0), m_valid(false),
-      m_answer(false), m_outgoing(true), m_ack(true), m_cseq(-1), m_flags(-1)
+      m_answer(false), m_outgoing(true), m_ack(true), m_cseq(-1), m_flags(-1),
+      m_index(0)
 {
     DDebug(DebugAll,"SIPMessage::SIPMessage(%p,%p) [%p]",original,answer,this);
     if (!(original && original->isValid()))
@@ -184,6 +531,7 @@ SIPMessage::~SIPMessage()
     m_valid = false;
     setParty();
     setBody();
+    delete m_index;
 }
 
 void SIPMessage::complete(SIPEngine* engine, const char* user, const char* domain, const char* dlgTag, int flags)
@@ -358,7 +706,7 @@ bool SIPMessage::copyHeader(const SIPMessage* message, const char* name, const c
 {
     const MimeHeaderLine* hl = message ? message->getHeader(name) : 0;
     if (hl) {
-	header.append(hl->clone(newName));
+	addHeader(hl->clone(newName));
 	return true;
     }
     return false;
@@ -369,50 +717,76 @@ int SIPMessage::copyAllHeaders(const SIPMessage* message, const char* name, cons
     if (!(message && name && *name))
 	return 0;
     int c = 0;
-    const ObjList* l = &message->header;
-    for (; l; l = l->next()) {
-	const MimeHeaderLine* hl = static_cast<const MimeHeaderLine*>(l->get());
-	if (hl && (hl->name() &= name)) {
-	    ++c;
-	    header.append(hl->clone(newName));
-	}
+    const MimeHeaderLine* hl = 0;
+    while ((hl = message->getHeaderAt(name,c))) {
+	++c;
+	addHeader(hl->clone(newName));
     }
     return c;
 }
 
+// Match a SIP version at the start of a string, return its length or 0
+static unsigned int sipVersion(const char* s)
+{
+    if (::strncasecmp(s,"SIP/",4) || !isdigit(s[4]) || (s[5] != '.') || !isdigit(s[6]))
+	return 0;
+    unsigned int len = 7;
+    while (isdigit(s[len]))
+	len++;
+    return len;
+}
+
+static inline const char* skipSpaces(const char* s)
+{
+    while (*s && isspace(*s))
+	s++;
+    return s;
+}
+
 bool SIPMessage::parseFirst(String& line)
 {
     XDebug(DebugAll,"SIPMessage::parse firstline= '%s'",line.c_str());
     if (line.null())
 	return false;
-    static Regexp r("^\\([Ss][Ii][Pp]/[0-9]\\.[0-9]\\+\\)[[:space:]]\\+\\([0-9][0-9][0-9]\\)[[:space:]]\\+\\(.*\\)$");
-    if (line.matches(r)) {
+    const char* s = line.c_str();
+    unsigned int len = sipVersion(s);
+    if (len) {
 	// Answer: <version> <code> <reason-phrase>
+	const char* c = skipSpaces(s + len);
+	if ((c == s + len) || !(isdigit(c[0]) && isdigit(c[1]) && isdigit(c[2]) && isspace(c[3]))) {
+	    Debug(DebugAll,"Invalid SIP line '%s'",line.c_str());
+	    return false;
+	}
 	m_answer = true;
-	version = line.matchString(1).toUpper();
-	code = line.matchString(2).toInteger();
-	reason = line.matchString(3);
+	version.assign(s,len).toUpper();
+	code = (c[0] - '0') * 100 + (c[1] - '0') * 10 + (c[2] - '0');
+	reason = skipSpaces(c + 3);
 	DDebug(DebugAll,"got answer version='%s' code=%d reason='%s'",
 	    version.c_str(),code,reason.c_str());
+	return true;
     }
-    else {
-	static Regexp r2("^\\([[:alpha:]]\\+\\)[[:space:]]\\+\\([^[:space:]]\\+\\)[[:space:]]\\+\\([Ss][Ii][Pp]/[0-9]\\.[0-9]\\+\\)$");
-	if (line.matches(r2)) {
-	    // Request: <method> <uri> <version>
-	    m_answer = false;
-	    method = line.matchString(1).toUpper();
-	    uri = line.matchString(2);
-	    version = line.matchString(3).toUpper();
-	    DDebug(DebugAll,"got request method='%s' uri='%s' version='%s'",
-		method.c_str(),uri.c_str(),version.c_str());
-	    if (method == YSTRING("ACK"))
-		m_ack = true;
-	}
-	else {
-	    Debug(DebugAll,"Invalid SIP line '%s'",line.c_str());
-	    return false;
-	}
+    // Request: <method> <uri> <version>
+    const char* m = s;
+    while (isalpha(*m))
+	m++;
+    const char* u = skipSpaces(m);
+    const char* e = u;
+    while (*e && !isspace(*e))
+	e++;
+    const char* v = skipSpaces(e);
+    len = sipVersion(v);
+    if ((m == s) || (u == m) || (e == u) || (v == e) || !len || v[len]) {
+	Debug(DebugAll,"Invalid SIP line '%s'",line.c_str());
+	return false;
     }
+    m_answer = false;
+    method.assign(s,m - s).toUpper();
+    uri.assign(u,e - u);
+    version.assign(v,len).toUpper();
+    DDebug(DebugAll,"got request method='%s' uri='%s' version='%s'",
+	method.c_str(),uri.c_str(),version.c_str());
+    if (method == YSTRING("ACK"))
+	m_ack = true;
     return true;
 }
 
@@ -434,51 +808,30 @@ bool SIPMessage::parse(const char* buf, int len, unsigned int* bodyLen)
 	return false;
     }
     line->destruct();
+    // Only index the header lines, they are decoded when first accessed
+    SIPHeaderIndex* index = new SIPHeaderIndex;
+    if (!index->parse(buf,len)) {
+	delete index;
+	return false;
+    }
+    if (index->count())
+	m_index = index;
+    else
+	delete index;
     int clen = -1;
-    while (len > 0) {
-	line = MimeBody::getUnfoldedLine(buf,len);
-	if (line->null()) {
-	    // Found end of headers
-	    line->destruct();
-	    break;
-	}
-	int col = line->find(':');
-	if (col <= 0) {
-	    line->destruct();
-	    return false;
-	}
-	String name = line->substr(0,col);
-	name.trimBlanks();
-	if (name.null()) {
-	    line->destruct();
-	    return false;
-	}
-	name = uncompactForm(name);
-	*line >> ":";
-	line->trimBlanks();
-	XDebug(DebugAll,"SIPMessage::parse header='%s' value='%s'",name.c_str(),line->c_str());
-
-	if ((name &= "WWW-Authenticate") ||
-	    (name &= "Proxy-Authenticate") ||
-	    (name &= "Authorization") ||
-	    (name &= "Proxy-Authorization"))
-	    header.append(new MimeAuthLine(name,*line));
-	else
-	    header.append(new MimeHeaderLine(name,*line));
-
-	if ((clen < 0) && (name &= "Content-Length"))
-	    clen = line->toInteger(-1,10);
-	else if ((m_cseq < 0) && (name &= "CSeq")) {
-	    int sep = line->find(' ');
-	    if (sep > 0) {
-		m_cseq = line->substr(0,sep).toInteger(-1,10);
-		if (m_answer) {
-		    method = line->substr(sep + 1);
-		    method.trimBlanks().toUpper();
-		}
+    const MimeHeaderLine* hl = getHeader("Content-Length");
+    if (hl)
+	clen = hl->toInteger(-1,10);
+    hl = getHeader("CSeq");
+    if (hl) {
+	int sep = hl->find(' ');
+	if (sep > 0) {
+	    m_cseq = hl->substr(0,sep).toInteger(-1,10);
+	    if (m_answer) {
+		method = hl->substr(sep + 1);
+		method.trimBlanks().toUpper();
 	    }
 	}
-	line->destruct();
     }
     if (!bodyLen) {
 	if (clen >= 0) {
@@ -493,8 +846,8 @@ bool SIPMessage::parse(const char* buf, int len, unsigned int* bodyLen)
     }
     else
 	*bodyLen = (clen >= 0) ? clen : 0;
-    DDebug(DebugAll,"SIPMessage::parse %d header lines, body %p",
-	header.count(),body);
+    DDebug(DebugAll,"SIPMessage::parse %u header lines, body %p",
+	(m_index ? m_index->count() : header.count()),body);
     return true;
 }
 
@@ -520,6 +873,11 @@ void SIPMessage::buildBody(const char* buf, int len)
     if (cType)
 	body = MimeBody::build(buf,len,*cType);
     // Move extra Content- header lines to body
+    if (body && m_index) {
+	Lock lck(indexMutex(this));
+	if (m_index)
+	    m_index->moveContent(body,cType);
+    }
     if (body) {
 	ListIterator iter(header);
 	for (GenObject* o = 0; (o = iter.get());) {
@@ -537,10 +895,34 @@ void SIPMessage::buildBody(const char* buf, int len)
 	header.count(),body);
 }
 
+// Move all header lines of a parsed message to the list, keeping their order
+void SIPMessage::decodeHeaders() const
+{
+    Lock lck(indexMutex(this));
+    if (!m_index)
+	return;
+    ObjList& list = const_cast<ObjList&>(header);
+    for (int i = m_index->count() - 1; i >= 0; i--) {
+	MimeHeaderLine* hl = m_index->take(i);
+	if (hl)
+	    list.insert(hl);
+    }
+    delete m_index;
+    m_index = 0;
+}
+
 const MimeHeaderLine* SIPMessage::getHeader(const char* name) const
 {
     if (!(name && *name))
 	return 0;
+    if (m_index) {
+	Lock lck(indexMutex(this));
+	if (m_index) {
+	    const MimeHeaderLine* hl = m_index->line(m_index->find(name));
+	    if (hl)
+		return hl;
+	}
+    }
     const ObjList* l = &header;
     for (; l; l = l->next()) {
 	const MimeHeaderLine* t = static_cast<const MimeHeaderLine*>(l->get());
@@ -550,11 +932,40 @@ const MimeHeaderLine* SIPMessage::getHeader(const char* name) const
     return 0;
 }
 
+const MimeHeaderLine* SIPMessage::getHeaderAt(const char* name, unsigned int index) const
+{
+    if (!(name && *name))
+	return 0;
+    // walk the index and list under the same lock so lines can't be moved between
+    Lock lck(m_index ? indexMutex(this) : 0);
+    if (m_index) {
+	for (int i = m_index->find(name); i >= 0; i = m_index->find(name,i + 1)) {
+	    if (!index--)
+		return m_index->line(i);
+	}
+    }
+    const ObjList* l = &header;
+    for (; l; l = l->next()) {
+	const MimeHeaderLine* t = static_cast<const MimeHeaderLine*>(l->get());
+	if (t && (t->name() &= name) && !index--)
+	    return t;
+    }
+    return 0;
+}
+
 const MimeHeaderLine* SIPMessage::getLastHeader(const char* name) const
 {
     if (!(name && *name))
 	return 0;
     const MimeHeaderLine* res = 0;
+    // lines still in the index come before any in the list
+    Lock lck(m_index ? indexMutex(this) : 0);
+    if (m_index) {
+	int last = -1;
+	for (int i = m_index->find(name); i >= 0; i = m_index->find(name,i + 1))
+	    last = i;
+	res = m_index->line(last);
+    }
     const ObjList* l = &header;
     for (; l; l = l->next()) {
 	const MimeHeaderLine* t = static_cast<const MimeHeaderLine*>(l->get());
@@ -568,6 +979,8 @@ void SIPMessage::clearHeaders(const char* name)
 {
     if (!(name && *name))
 	return;
+    if (m_index)
+	decodeHeaders();
     ObjList* l = &header;
     while (l) {
 	const MimeHeaderLine* t = static_cast<const MimeHeaderLine*>(l->get());
@@ -583,6 +996,11 @@ int SIPMessage::countHeaders(const char* name) const
     if (!(name && *name))
 	return 0;
     int res = 0;
+    Lock lck(m_index ? indexMutex(this) : 0);
+    if (m_index) {
+	for (int i = m_index->find(name); i >= 0; i = m_index->find(name,i + 1))
+	    ++res;
+    }
     const ObjList* l = &header;
     for (; l; l = l->next()) {
 	const MimeHeaderLine* t = static_cast<const MimeHeaderLine*>(l->get());
@@ -618,7 +1036,7 @@ const String& SIPMessage::getHeaders() const
 	else
 	    m_string << method << " " << uri << " " << version << "\r\n";
 
-	const ObjList* l = &header;
+	const ObjList* l = &allHeaders();
 	for (; l; l = l->next()) {
 	    MimeHeaderLine* t = static_cast<MimeHeaderLine*>(l->get());
 	    if (t) {
@@ -679,9 +1097,9 @@ MimeAuthLine* SIPMessage::buildAuth(const String& username, const String& passwo
     const String& meth, const String& uri, bool proxy, SIPEngine* engine) const
 {
     const char* hdr = proxy ? "Proxy-Authenticate" : "WWW-Authenticate";
-    const ObjList* l = &header;
-    for (; l; l = l->next()) {
-	const MimeAuthLine* t = YOBJECT(MimeAuthLine,l->get());
+    const MimeHeaderLine* hl = 0;
+    for (unsigned int i = 0; (hl = getHeaderAt(hdr,i)); i++) {
+	const MimeAuthLine* t = YOBJECT(MimeAuthLine,hl);
 	if (t && (t->name() &= hdr) && (*t &= "Digest")) {
 	    String nonce(t->getParam("nonce"));
 	    MimeHeaderLine::delQuotes(nonce);
@@ -746,41 +1164,38 @@ MimeAuthLine* SIPMessage::buildAuth(const SIPMessage& original, SIPEngine* engin
 ObjList* SIPMessage::getRoutes() const
 {
     ObjList* list = 0;
-    const ObjList* l = &header;
-    for (; l; l = l->next()) {
-	const MimeHeaderLine* h = YOBJECT(MimeHeaderLine,l->get());
-	if (h && (h->name() &= "Record-Route")) {
-	    int p = 0;
-	    while (p >= 0) {
-		MimeHeaderLine* line = 0;
-		int s = MimeHeaderLine::findSep(*h,',',p);
-		String tmp;
-		if (s < 0) {
-		    if (p)
-			tmp = h->substr(p);
-		    else
-			line = new MimeHeaderLine(*h,"Route");
-		    p = -1;
-		}
-		else {
-		    if (s > p)
-			tmp = h->substr(p,s-p);
-		    p = s + 1;
-		}
-		tmp.trimBlanks();
-		if (tmp)
-		    line = new MimeHeaderLine("Route",tmp);
-		if (!line)
-		    continue;
-		if (!list)
-		    list = new ObjList;
-		if (isAnswer())
-		    // route set learned from an answer, reverse order
-		    list->insert(line);
+    const MimeHeaderLine* h = 0;
+    for (unsigned int i = 0; (h = getHeaderAt("Record-Route",i)); i++) {
+	int p = 0;
+	while (p >= 0) {
+	    MimeHeaderLine* line = 0;
+	    int s = MimeHeaderLine::findSep(*h,',',p);
+	    String tmp;
+	    if (s < 0) {
+		if (p)
+		    tmp = h->substr(p);
 		else
-		    // route set learned from a request, preserve order
-		    list->append(line);
+		    line = new MimeHeaderLine(*h,"Route");
+		p = -1;
 	    }
+	    else {
+		if (s > p)
+		    tmp = h->substr(p,s-p);
+		p = s + 1;
+	    }
+	    tmp.trimBlanks();
+	    if (tmp)
+		line = new MimeHeaderLine("Route",tmp);
+	    if (!line)
+		continue;
+	    if (!list)
+		list = new ObjList;
+	    if (isAnswer())
+		// route set learned from an answer, reverse order
+		list->insert(line);
+	    else
+		// route set learned from a request, preserve order
+		list->append(line);
 	}
     }
     return list;
@@ -30,7 +30,8 @@ using namespace TelEngine;
 SIPTransaction::SIPTransaction(SIPMessage* message, SIPEngine* engine, bool outgoing)
     : m_outgoing(outgoing), m_invite(false), m_transmit(false), m_state(Invalid),
       m_response(0), m_timeouts(0), m_timeout(0),
-      m_firstMessage(message), m_lastMessage(0), m_pending(0), m_engine(engine), m_private(0)
+      m_firstMessage(message), m_lastMessage(0), m_pending(0), m_engine(engine), m_private(0),
+      m_queuePrev(0), m_queueNext(0), m_queue(0), m_order(0)
 {
     DDebug(getEngine(),DebugAll,"SIPTransaction::SIPTransaction(%p,%p,%d) [%p]",
 	message,engine,outgoing,this);
@@ -77,7 +78,8 @@ SIPTransaction::SIPTransaction(SIPTransaction& original, SIPMessage* answer)
       m_firstMessage(original.m_firstMessage), m_lastMessage(original.m_lastMessage),
       m_pending(0), m_engine(original.m_engine),
       m_branch(original.m_branch), m_callid(original.m_callid), m_tag(original.m_tag),
-      m_private(0)
+      m_private(0),
+      m_queuePrev(0), m_queueNext(0), m_queue(0), m_order(0)
 {
     DDebug(getEngine(),DebugAll,"SIPTransaction::SIPTransaction(&%p,%p) [%p]",
 	&original,answer,this);
@@ -88,10 +90,8 @@ SIPTransaction::SIPTransaction(SIPTransaction& original, SIPMessage* answer)
     msg->complete(m_engine);
     msg->addHeader(auth);
     const NamedString* ns = msg->getParam("Via","branch",true);
-    if (ns)
-	original.m_branch = *ns;
-    else
-	original.m_branch.clear();
+    // the engine looks up transactions by branch so let it do the change
+    m_engine->changeBranch(&original,ns ? *ns : String::empty());
     ns = msg->getParam("To","tag");
     if (ns)
 	original.m_tag = *ns;
@@ -122,7 +122,8 @@ SIPTransaction::SIPTransaction(const SIPTransaction& original, const String& tag
       m_firstMessage(original.m_firstMessage), m_lastMessage(0),
       m_pending(0), m_engine(original.m_engine),
       m_branch(original.m_branch), m_callid(original.m_callid), m_tag(tag),
-      m_private(0)
+      m_private(0),
+      m_queuePrev(0), m_queueNext(0), m_queue(0), m_order(0)
 {
     if (m_firstMessage)
 	m_firstMessage->ref();
@@ -187,6 +188,7 @@ bool SIPTransaction::changeState(int newstate)
     DDebug(getEngine(),DebugAll,"SIPTransaction state changed from %s to %s [%p]",
 	stateName(m_state),stateName(newstate),this);
     m_state = newstate;
+    m_engine->wakeup(this);
     return true;
 }
 
@@ -221,6 +223,12 @@ void SIPTransaction::setLatestMessage(SIPMessage* message)
     }
 }
 
+void SIPTransaction::setTransmit()
+{
+    m_transmit = true;
+    m_engine->wakeup(this);
+}
+
 void SIPTransaction::setPendingEvent(SIPEvent* event, bool replace)
 {
     if (m_pending)
@@ -232,6 +240,8 @@ void SIPTransaction::setPendingEvent(SIPEvent* event, bool replace)
 	    delete event;
     else
 	m_pending = event;
+    if (m_pending)
+	m_engine->wakeup(this);
 }
 
 void SIPTransaction::setTransCount(int count)
@@ -256,6 +266,8 @@ void SIPTransaction::setTimeout(u_int64_t delay, unsigned int count)
 	Debug(getEngine(),DebugAll,"SIPTransaction new %d timeouts initially " FMT64U " usec apart [%p]",
 	    m_timeouts,m_delay,this);
 #endif
+    // get polled so the engine reschedules the timer
+    m_engine->wakeup(this);
 }
 
 SIPEvent* SIPTransaction::getEvent(bool pendingOnly, u_int64_t time)
@@ -52,6 +52,8 @@ extern YSIP_API TokenDict* SIPResponses;
 
 class SIPEngine;
 class SIPEvent;
+class SIPTransIndex;
+class SIPHeaderIndex;
 
 class YSIP_API SIPParty : public RefObject
 {
@@ -320,6 +322,14 @@ public:
      */
     const MimeHeaderLine* getHeader(const char* name) const;
 
+    /**
+     * Find a header line by name and position among the lines with that name
+     * @param name Name of the header to locate
+     * @param index Zero based index of the line among the matching ones
+     * @return A pointer to the matching header line or 0 if not found
+     */
+    const MimeHeaderLine* getHeaderAt(const char* name, unsigned int index) const;
+
     /**
      * Find the last header line that matches a given name name
      * @param name Name of the header to locate
@@ -366,14 +376,14 @@ public:
      * @param value Content of the new header line
      */
     inline void addHeader(const char* name, const char* value = 0)
-	{ header.append(new MimeHeaderLine(name,value)); }
+	{ addHeader(new MimeHeaderLine(name,value)); }
 
     /**
      * Append an already constructed header line
      * @param line Header line to add
      */
     inline void addHeader(MimeHeaderLine* line)
-	{ header.append(line); }
+	{ if (m_index) decodeHeaders(); header.append(line); }
 
     /**
      * Clear all header lines that match a name
@@ -466,6 +476,14 @@ public:
      */
     const String& getHeaders() const;
 
+    /**
+     * Retrieve the list of header lines, decoding all of them first if the
+     *  message was parsed and some are still held undecoded
+     * @return The list holding all header lines of the message
+     */
+    inline const ObjList& allHeaders() const
+	{ if (m_index) decodeHeaders(); return header; }
+
     /**
      * Set a new body for this message
      */
@@ -498,6 +516,8 @@ public:
 
     /**
      * All the headers should be in this list.
+     * Header lines of a parsed message are decoded only when first accessed,
+     *  use allHeaders() before walking this list directly
      */
     ObjList header;
 
@@ -524,6 +544,8 @@ protected:
     String m_authPass;
 private:
     SIPMessage(); // no, thanks
+    void decodeHeaders() const;
+    mutable SIPHeaderIndex* m_index;
 };
 
 /**
@@ -738,6 +760,7 @@ protected:
  */
 class YSIP_API SIPTransaction : public RefObject
 {
+    friend class SIPTransIndex;
 public:
     /**
      * Current state of the transaction
@@ -914,8 +937,7 @@ public:
      * Set the (re)transmission flag that allows the latest outgoing message
      *  to be send over the wire
      */
-    inline void setTransmit()
-	{ m_transmit = true; }
+    void setTransmit();
 
     /**
      * Change transaction status to Cleared
@@ -1133,6 +1155,14 @@ protected:
     String m_callid;
     String m_tag;
     void *m_private;
+
+private:
+    // Engine ready queue or timer slot links, protected by the engine mutex
+    SIPTransaction* m_queuePrev;
+    SIPTransaction* m_queueNext;
+    SIPTransaction** m_queue;
+    // Position in the engine transaction list, zero if not attached
+    int64_t m_order;
 };
 
 /**
@@ -1224,6 +1254,7 @@ protected:
  */
 class YSIP_API SIPEngine : public DebugEnabler, public Mutex
 {
+    friend class SIPTransaction;
 public:
     /**
      * Create the SIP Engine
@@ -1302,9 +1333,10 @@ public:
 
     /**
      * Get a SIPEvent from the queue.
-     * This method mainly looks into the transaction list and get all kind of
-     * events, like an incoming request (INVITE, REGISTRATION), a timer, an
-     * outgoing message.
+     * This method polls the transactions that were signaled as having work
+     * to do or whose timer expired and gets all kind of events, like an
+     * incoming request (INVITE, REGISTRATION), a timer, an outgoing message.
+     * Idle transactions are not visited at all.
      * This method is thread safe
      */
     SIPEvent *getEvent();
@@ -1487,22 +1519,24 @@ public:
      * Remove a transaction from the list without dereferencing it
      * @param transaction Pointer to transaction to remove
      */
-    inline void remove(SIPTransaction* transaction)
-	{ lock(); m_transList.remove(transaction,false); unlock(); }
+    void remove(SIPTransaction* transaction);
 
     /**
      * Append a transaction to the end of the list
      * @param transaction Pointer to transaction to append
      */
-    inline void append(SIPTransaction* transaction)
-	{ lock(); m_transList.append(transaction); unlock(); }
+    void append(SIPTransaction* transaction);
 
     /**
      * Insert a transaction at the start of the list
      * @param transaction Pointer to transaction to insert
      */
-    inline void insert(SIPTransaction* transaction)
-	{ lock(); m_transList.insert(transaction); unlock(); }
+    void insert(SIPTransaction* transaction);
+
+    /**
+     * Remove and release all transactions
+     */
+    void clearTransactions();
 
     /**
      * Get the number of active SIP transactions
@@ -1533,6 +1567,11 @@ protected:
     u_int32_t m_nonce_time;
     Mutex m_nonce_mutex;
     bool m_autoChangeParty;
+
+private:
+    void wakeup(SIPTransaction* transaction);
+    void changeBranch(SIPTransaction* transaction, const String& branch);
+    SIPTransIndex* m_index;
 };
 
 }
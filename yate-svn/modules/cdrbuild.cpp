@@ -362,6 +362,7 @@ void CdrBuilder::emit(const char *operation)
 	operation,c_str(),m_status.c_str());
     char buf[64];
     Message *m = new Message("call.cdr",0,true);
+    m->setArena();
     m->addParam("time",printTime(buf,m_start));
     m->addParam("chan",c_str());
     m->addParam("cdrid",m_cdrId);
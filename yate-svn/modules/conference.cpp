@@ -23,6 +23,11 @@
 
 #include <yatephone.h>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#define MIX_SSE2
+#endif
+
 using namespace TelEngine;
 namespace { // anonymous
 
@@ -35,6 +40,9 @@ namespace { // anonymous
 // maximum size we allow the buffer to grow
 #define MAX_BUFFER 960
 
+// mixing interval of rooms that have a dedicated mixer thread, in usec
+#define MIX_INTERVAL 20000
+
 // minimum notification interval in msec
 #define MIN_INTERVAL 1000
 
@@ -74,6 +82,7 @@ namespace { // anonymous
 class ConfConsumer;
 class ConfSource;
 class ConfChan;
+class ConfMixer;
 
 // The list of conference rooms
 static ObjList s_rooms;
@@ -84,6 +93,12 @@ static Mutex s_srcMutex(false,"Conference");
 // Hold the number of the newest allocated dynamic room
 static int s_roomAlloc = 0;
 
+// Mutex that protects the link between a room and its mixer thread
+static Mutex s_mixMutex(false,"ConfMixer");
+
+// Number of mixer threads still alive, they may outlive their room
+static unsigned int s_mixers = 0;
+
 // The conference room holds a list of connected channels and does the mixing.
 // It does also act as a data source for the sum of all channels
 class ConfRoom : public DataSource
@@ -111,7 +126,9 @@ public:
 	{ return m_expire && m_expire < time; }
     inline bool created()
 	{ return m_created && !(m_created = false); }
-    void mix(ConfConsumer* cons = 0);
+    inline bool threaded() const
+	{ return m_mixer != 0; }
+    void mix(ConfConsumer* cons = 0, unsigned int frame = 0);
     void addChannel(ConfChan* chan, bool player = false);
     void delChannel(ConfChan* chan);
     void addOwner(const String& id);
@@ -129,6 +146,8 @@ private:
     void setLonelyTimeout(const String& value);
     // Set the expire time
     void setExpire();
+    // Start a dedicated mixer thread if the room grew large enough
+    void checkMixer();
     String m_name;
     ObjList m_chans;
     ObjList m_owners;
@@ -148,6 +167,23 @@ private:
     int m_trackInterval;
     u_int64_t m_nextNotify;
     u_int64_t m_nextSpeakers;
+    DataBlock m_mixBuf;
+    int m_mixUsers;
+    ConfMixer* m_mixer;
+    friend class ConfMixer;
+};
+
+// Thread that mixes a large room at fixed intervals instead of mixing from
+//  the thread of whichever channel happened to fill its buffer
+class ConfMixer : public Thread
+{
+    friend class ConfRoom;
+public:
+    ConfMixer(ConfRoom* room);
+    virtual ~ConfMixer();
+    virtual void run();
+private:
+    ConfRoom* m_room;
 };
 
 // A conference channel is just a dumb holder of its data channels
@@ -306,6 +342,109 @@ static unsigned int binLog(unsigned int x)
 }
 
 
+// Add 16 bit samples to the 32 bit mixing accumulator
+static inline void mixAdd(int* acc, const int16_t* src, unsigned int samples)
+{
+    unsigned int i = 0;
+#ifdef MIX_SSE2
+    for (; i + 8 <= samples; i += 8) {
+	__m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+	// sign extend by unpacking into the upper half and shifting back
+	__m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(s,s),16);
+	__m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(s,s),16);
+	__m128i* a = (__m128i*)(acc + i);
+	_mm_storeu_si128(a,_mm_add_epi32(_mm_loadu_si128(a),lo));
+	_mm_storeu_si128(a + 1,_mm_add_epi32(_mm_loadu_si128(a + 1),hi));
+    }
+#endif
+    for (; i < samples; i++)
+	acc[i] += src[i];
+}
+
+// Saturate symmetrically a range of the accumulator, optionally substracting
+//  the samples a channel contributed to the mix
+static inline void mixOut(int16_t* dest, const int* acc, unsigned int samples,
+    const int16_t* own = 0, unsigned int n = 0)
+{
+    if (!own || (n > samples))
+	n = own ? samples : 0;
+    unsigned int i = 0;
+#ifdef MIX_SSE2
+    // packing saturates to -32768, raise it to keep saturation symmetrical
+    const __m128i neg = _mm_set1_epi16(-32767);
+    for (; i + 8 <= n; i += 8) {
+	__m128i s = _mm_loadu_si128((const __m128i*)(own + i));
+	__m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(s,s),16);
+	__m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(s,s),16);
+	lo = _mm_sub_epi32(_mm_loadu_si128((const __m128i*)(acc + i)),lo);
+	hi = _mm_sub_epi32(_mm_loadu_si128((const __m128i*)(acc + i + 4)),hi);
+	_mm_storeu_si128((__m128i*)(dest + i),_mm_max_epi16(_mm_packs_epi32(lo,hi),neg));
+    }
+#endif
+    for (; i < n; i++) {
+	int val = acc[i] - own[i];
+	dest[i] = (val < -32767) ? -32767 : ((val > 32767) ? 32767 : val);
+    }
+#ifdef MIX_SSE2
+    for (; i + 8 <= samples; i += 8) {
+	__m128i lo = _mm_loadu_si128((const __m128i*)(acc + i));
+	__m128i hi = _mm_loadu_si128((const __m128i*)(acc + i + 4));
+	_mm_storeu_si128((__m128i*)(dest + i),_mm_max_epi16(_mm_packs_epi32(lo,hi),neg));
+    }
+#endif
+    for (; i < samples; i++) {
+	int val = acc[i];
+	dest[i] = (val < -32767) ? -32767 : ((val > 32767) ? 32767 : val);
+    }
+}
+
+
+// Called with s_mixMutex locked
+ConfMixer::ConfMixer(ConfRoom* room)
+    : Thread("Conf Mixer",High),
+      m_room(room)
+{
+    DDebug(&__plugin,DebugAll,"ConfMixer::ConfMixer(%p) [%p]",room,this);
+    s_mixers++;
+}
+
+ConfMixer::~ConfMixer()
+{
+    DDebug(&__plugin,DebugAll,"ConfMixer::~ConfMixer() [%p]",this);
+    // the room may outlive us if the thread got cancelled
+    Lock lock(s_mixMutex);
+    if (m_room)
+	m_room->m_mixer = 0;
+    s_mixers--;
+}
+
+// Mix the room once every interval until the room goes away
+void ConfMixer::run()
+{
+    u_int64_t next = Time::now();
+    for (;;) {
+	s_mixMutex.lock();
+	RefPointer<ConfRoom> room = m_room;
+	s_mixMutex.unlock();
+	if (!room)
+	    break;
+	room->mix(0,room->rate() * (MIX_INTERVAL / 1000) / 1000);
+	// we may have been holding the last reference so let it go now
+	room = 0;
+	next += MIX_INTERVAL;
+	u_int64_t now = Time::now();
+	if (now < next)
+	    Thread::usleep((unsigned long)(next - now));
+	else if (now > next + 5 * MIX_INTERVAL) {
+	    DDebug(&__plugin,DebugMild,"Mixer fell behind by " FMT64U " usec [%p]",now - next,this);
+	    next = now;
+	}
+	if (Thread::check(false))
+	    break;
+    }
+}
+
+
 // Get a pointer to a conference by name, optionally creates it with given parameters
 // If a pointer is returned it must be dereferenced by the caller
 // Thread safe
@@ -331,13 +470,15 @@ ConfRoom* ConfRoom::get(const String& name, const NamedList* params)
 ConfRoom::ConfRoom(const String& name, const NamedList& params)
     : m_name(name), m_lonely(false), m_created(true), m_record(0),
       m_rate(8000), m_users(0), m_maxusers(10), m_maxLock(200),
-      m_expire(0), m_lonelyInterval(0), m_nextNotify(0), m_nextSpeakers(0)
+      m_expire(0), m_lonelyInterval(0), m_nextNotify(0), m_nextSpeakers(0),
+      m_mixUsers(0), m_mixer(0)
 {
     DDebug(&__plugin,DebugAll,"ConfRoom::ConfRoom('%s',%p) [%p]",
 	name.c_str(),&params,this);
     m_rate = params.getIntValue("rate",m_rate);
     m_maxusers = params.getIntValue("maxusers",m_maxusers);
     m_maxLock = params.getIntValue("waitlock",m_maxLock);
+    m_mixUsers = params.getIntValue("mixthread",0,0);
     m_notify = params.getValue("notify");
     m_trackSpeakers = params.getIntValue("speakers",0);
     if (m_trackSpeakers < 0)
@@ -381,6 +522,12 @@ void ConfRoom::destroyed()
     // plugin must be locked as the destructor is called when room is dereferenced
     Lock lock(&__plugin);
     s_rooms.remove(this,false);
+    s_mixMutex.lock();
+    // the mixer thread will notice and exit by itself
+    if (m_mixer)
+	m_mixer->m_room = 0;
+    m_mixer = 0;
+    s_mixMutex.unlock();
     if (m_expire)
 	__plugin.setConfToutCount(false);
     m_chans.clear();
@@ -406,6 +553,7 @@ void ConfRoom::addChannel(ConfChan* chan, bool player)
     if (chan->isCounted()) {
 	m_users++;
 	setExpire();
+	checkMixer();
     }
     if (m_notify && !chan->isUtility()) {
 	String tmp(m_users);
@@ -554,6 +702,7 @@ void ConfRoom::msgStatus(Message& msg)
 	msg.retValue() << ",notify=" << m_notify;
     if (m_playerId)
 	msg.retValue() << ",player=" << m_playerId;
+    msg.retValue() << ",mixthread=" << String::boolText(threaded());
     msg.retValue() << "\r\n";
 }
 
@@ -650,7 +799,8 @@ bool ConfRoom::setParams(NamedList& params)
 }
 
 // Mix in buffered data from all channels, only if we have enough in buffer
-void ConfRoom::mix(ConfConsumer* cons)
+// A non zero frame is the number of samples to mix on each mixer thread tick
+void ConfRoom::mix(ConfConsumer* cons, unsigned int frame)
 {
     unsigned int len = MAX_BUFFER;
     unsigned int mlen = 0;
@@ -669,17 +819,31 @@ void ConfRoom::mix(ConfConsumer* cons)
 	}
     }
     XDebug(DebugAll,"ConfRoom::mix() buffer %u - %u [%p]",len,mlen,this);
-    mlen += MIN_BUFFER;
-    // do we have at least minimum amount of data in buffer?
-    if (mlen <= MAX_BUFFER)
-	return;
-    mlen -= MAX_BUFFER;
-    // make sure we mix in enough data to prevent channels from overflowing
-    if (len < mlen)
-	len = mlen;
-    unsigned int chunks = len / DATA_CHUNK;
-    if (!chunks)
-	return;
+    if (frame) {
+	// paced by the mixer thread, wait until anybody has a full frame
+	frame *= sizeof(int16_t);
+	if (mlen < frame)
+	    return;
+	// drain the excess so buffers stay short
+	len = (mlen > MIN_BUFFER) ? mlen - MIN_BUFFER + frame : frame;
+	if (len > mlen)
+	    len = mlen;
+	len /= sizeof(int16_t);
+    }
+    else {
+	mlen += MIN_BUFFER;
+	// do we have at least minimum amount of data in buffer?
+	if (mlen <= MAX_BUFFER)
+	    return;
+	mlen -= MAX_BUFFER;
+	// make sure we mix in enough data to prevent channels from overflowing
+	if (len < mlen)
+	    len = mlen;
+	unsigned int chunks = len / DATA_CHUNK;
+	if (!chunks)
+	    return;
+	len = chunks * DATA_CHUNK / sizeof(int16_t);
+    }
     int speakVol[MAX_SPEAKERS];
     ConfChan* speakChan[MAX_SPEAKERS];
     int spk;
@@ -687,9 +851,9 @@ void ConfRoom::mix(ConfConsumer* cons)
 	speakVol[spk] = 0;
 	speakChan[spk] = 0;
     }
-    len = chunks * DATA_CHUNK / sizeof(int16_t);
-    DataBlock mixbuf(0,len*sizeof(int));
-    int* buf = (int*)mixbuf.data();
+    // the mixing buffer is kept between calls to avoid reallocating it
+    m_mixBuf.assign(0,len*sizeof(int));
+    int* buf = (int*)m_mixBuf.data();
     for (l = m_chans.skipNull(); l; l = l->skipNext()) {
 	ConfChan* ch = static_cast<ConfChan*>(l->get());
 	ConfConsumer* co = static_cast<ConfConsumer*>(ch->getConsumer());
@@ -713,9 +877,7 @@ void ConfRoom::mix(ConfConsumer* cons)
 #endif
 		if (n > len)
 		    n = len;
-		const int16_t* p = (const int16_t*)co->m_buffer.data();
-		for (unsigned int i=0; i < n; i++)
-		    buf[i] += *p++;
+		mixAdd(buf,(const int16_t*)co->m_buffer.data(),n);
 	    }
 	    if (m_trackSpeakers && m_notify && !ch->isUtility() && co->speaking()) {
 		int vol = co->envelope();
@@ -740,13 +902,8 @@ void ConfRoom::mix(ConfConsumer* cons)
 	    co->consumed(buf,len);
     }
     DataBlock data(0,len*sizeof(int16_t));
-    int16_t* p = (int16_t*)data.data();
-    for (unsigned int i=0; i < len; i++) {
-	int val = buf[i];
-	// saturate symmetrically the result of addition
-	*p++ = (val < -32767) ? -32767 : ((val > 32767) ? 32767 : val);
-    }
-    mixbuf.clear();
+    // saturate symmetrically the result of addition
+    mixOut((int16_t*)data.data(),buf,len);
     Message* m = 0;
     while (m_trackSpeakers && m_notify) {
 	u_int64_t now = Time::now();
@@ -829,6 +986,36 @@ void ConfRoom::update(const NamedList& params)
     String* l = params.getParam("lonely");
     if (l)
 	setLonelyTimeout(*l);
+    l = params.getParam("mixthread");
+    if (l) {
+	Lock mylock(this);
+	m_mixUsers = l->toInteger(0,0,0);
+	checkMixer();
+    }
+}
+
+// Start a dedicated mixer thread if the room grew large enough
+// A thread once started is kept for the entire life of the room
+void ConfRoom::checkMixer()
+{
+    if (m_mixer || !m_mixUsers || (m_users < m_mixUsers))
+	return;
+    Lock lock(s_mixMutex);
+    ConfMixer* mixer = new ConfMixer(this);
+    if (!mixer->startup()) {
+	Debug(&__plugin,DebugWarn,"Failed to start mixer thread for room '%s' [%p]",
+	    m_name.c_str(),this);
+	mixer->m_room = 0;
+	// the destructor locks the mutex too
+	lock.drop();
+	delete mixer;
+	// don't try again for this room
+	m_mixUsers = 0;
+	return;
+    }
+    m_mixer = mixer;
+    Debug(&__plugin,DebugInfo,"Room '%s' with %d users is now mixed by thread %p [%p]",
+	m_name.c_str(),m_users,mixer,this);
 }
 
 // Set the expire time from 'lonely' parameter value
@@ -932,8 +1119,9 @@ unsigned long ConfConsumer::Consume(const DataBlock& data, unsigned long tStamp,
     }
     if (m_buffer.length()+data.length() <= MAX_BUFFER)
 	m_buffer += data;
+    bool mix = (m_buffer.length() >= MIN_BUFFER) && !m_room->threaded();
     m_room->unlock();
-    if (m_buffer.length() >= MIN_BUFFER)
+    if (mix)
 	m_room->mix(this);
     return invalidStamp();
 }
@@ -975,18 +1163,14 @@ void ConfConsumer::dataForward(const int* mixed, unsigned int samples)
     if (!src)
 	return;
 
-    int16_t* d = (int16_t*)m_buffer.data();
-    unsigned int n = m_buffer.length() / 2;
     DataBlock data(0,samples*sizeof(int16_t));
-    int16_t* p = (int16_t*)data.data();
-    for (unsigned int i=0; i < samples; i++) {
-	int val = *mixed++;
-	// substract our own data if we contributed - only as much as we have
-	if ((i < n) && shouldMix())
-	    val -= d[i];
-	// saturate symmetrically the result of additions and substraction
-	*p++ = (val < -32767) ? -32767 : ((val > 32767) ? 32767 : val);
-    }
+    // substract our own data if we contributed - only as much as we have
+    //  and saturate symmetrically the result of additions and substraction
+    if (shouldMix())
+	mixOut((int16_t*)data.data(),mixed,samples,
+	    (const int16_t*)m_buffer.data(),m_buffer.length() / 2);
+    else
+	mixOut((int16_t*)data.data(),mixed,samples);
     src->Forward(data);
 }
 
@@ -1428,6 +1612,14 @@ bool ConferenceDriver::unload()
 	return false;
     if (isBusy() || s_rooms.count())
 	return false;
+    // mixer threads exit shortly after their room is gone, wait for them
+    s_mixMutex.lock();
+    unsigned int mixers = s_mixers;
+    s_mixMutex.unlock();
+    if (mixers) {
+	Debug(this,DebugNote,"Refusing to unload with %u mixer threads running",mixers);
+	return false;
+    }
     uninstallRelays();
     Engine::uninstall(m_handler);
     m_handler = 0;
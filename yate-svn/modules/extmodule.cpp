@@ -88,6 +88,8 @@ public:
     ExtModSource(Stream* str, ExtModChan* chan);
     ~ExtModSource();
     virtual void run();
+protected:
+    virtual bool clockTick(u_int64_t when);
 private:
     Stream* m_str;
     unsigned m_brate;
@@ -427,7 +429,11 @@ ExtModSource::ExtModSource(Stream* str, ExtModChan* chan)
     Debug(DebugAll,"ExtModSource::ExtModSource(%p) [%p]",str,this);
     if (m_str) {
 	chan->setRunning(true);
-	start("ExtMod Source");
+	// read without blocking at each tick of the media clock if possible
+	if (!(m_str->setBlocking(false) && startClock(20))) {
+	    m_str->setBlocking(true);
+	    start("ExtMod Source");
+	}
     }
 }
 
@@ -478,6 +484,27 @@ void ExtModSource::run()
     m_chan->setRunning(false);
 }
 
+// Forward whatever data the script provided during the last 20 ms
+bool ExtModSource::clockTick(u_int64_t when)
+{
+    if (looping()) {
+	char data[320];
+	int r = m_str->readData(data,sizeof(data));
+	if (r > 0) {
+	    DataBlock buf(data,r,false);
+	    Forward(buf,m_total/2);
+	    buf.clear(false);
+	    m_total += r;
+	    return true;
+	}
+	if ((r < 0) && m_str->canRetry())
+	    return true;
+    }
+    Debug(DebugAll,"ExtModSource [%p] end of data total=%u",this,m_total);
+    m_chan->setRunning(false);
+    return false;
+}
+
 
 ExtModConsumer::ExtModConsumer(Stream* str)
     : m_str(str), m_total(0)
@@ -2571,7 +2571,7 @@ bool JsConfigFile::runNative(ObjList& stack, const ExpOperation& oper, GenObject
     else if (oper.name() == YSTRING("keys")) {
 	if (extractArgs(stack,oper,context,args) != 1)
 	    return false;
-	NamedList* sect = m_config.getSection(*static_cast<ExpOperation*>(args[0]));
+	const NamedList* sect = m_config.getSection(*static_cast<ExpOperation*>(args[0]));
 	if (sect) {
 	    JsArray* jsa = new JsArray(context,mutex());
 	    int32_t len = 0;
@@ -2726,7 +2726,7 @@ bool JsConfigSection::runNative(ObjList& stack, const ExpOperation& oper, GenObj
     else if (oper.name() == YSTRING("keys")) {
 	if (extractArgs(stack,oper,context,args) != 0)
 	    return false;
-	NamedList* sect = m_owner->config().getSection(toString());
+	const NamedList* sect = m_owner->config().getSection(toString());
 	if (sect) {
 	    JsArray* jsa = new JsArray(context,mutex());
 	    int32_t len = 0;
@@ -2965,7 +2965,7 @@ bool JsXML::runNative(ObjList& stack, const ExpOperation& oper, GenObject* conte
 		m_xml->setAttribute(*name,*val);
 	}
 	else {
-	    JsObject* jso = YOBJECT(JsObject,name);
+	    const JsObject* jso = YOBJECT(JsObject,name);
 	    if (!jso)
 		return false;
 	    const ObjList* o = jso->params().paramList()->skipNull();
@@ -3364,8 +3364,8 @@ void JsJSON::stringify(const NamedString* ns, String& buf, int spaces, int inden
 	return;
     }
     const char* nl = spaces ? "\r\n" : "";
-    JsObject* jso = YOBJECT(JsObject,oper);
-    JsArray* jsa = YOBJECT(JsArray,jso);
+    const JsObject* jso = YOBJECT(JsObject,oper);
+    const JsArray* jsa = YOBJECT(JsArray,jso);
     if (jsa) {
 	if (jsa->length() <= 0) {
 	    buf << "[]";
@@ -3400,7 +3400,7 @@ void JsJSON::stringify(const NamedString* ns, String& buf, int spaces, int inden
 		buf << "{}";
 		return;
 	}
-	ObjList* l = jso->params().paramList()->skipNull();
+	const ObjList* l = jso->params().paramList()->skipNull();
 	String li(' ',indent);
 	String ci(' ',indent + spaces);
 	const char* sep = spaces ? ": " : ":";
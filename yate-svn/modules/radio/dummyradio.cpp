@@ -293,8 +293,9 @@ unsigned int DummyInterface::setParams(NamedList& params, bool shareFate)
     params.dump(tmp,"\r\n");
     Debug(this,DebugAll,"setParams [%p]\r\n-----\r\n%s\r\n-----",this,tmp.c_str());
 #endif
-    for (ObjList* o = params.paramList()->skipNull(); o; o = o->skipNext()) {
-	NamedString* ns = static_cast<NamedString*>(o->get());
+    const NamedList& cmds = params;
+    for (const ObjList* o = cmds.paramList()->skipNull(); o; o = o->skipNext()) {
+	const NamedString* ns = static_cast<const NamedString*>(o->get());
 	if (!ns->name().startsWith("cmd:"))
 	    continue;
 	String cmd = ns->name().substr(4);
@@ -7252,8 +7252,9 @@ unsigned int BrfInterface::setParams(NamedList& params, bool shareFate)
     params.dump(tmp,"\r\n");
     Debug(this,DebugAll,"setParams [%p]%s",this,encloseDashes(tmp,true));
 #endif
-    for (ObjList* o = params.paramList()->skipNull(); o; o = o->skipNext()) {
-	NamedString* ns = static_cast<NamedString*>(o->get());
+    const NamedList& cmds = params;
+    for (const ObjList* o = cmds.paramList()->skipNull(); o; o = o->skipNext()) {
+	const NamedString* ns = static_cast<const NamedString*>(o->get());
 	if (!ns->name().startsWith("cmd:"))
 	    continue;
 	String cmd = ns->name().substr(4);
@@ -7633,7 +7634,7 @@ BrfInterface* BrfModule::createIface(const NamedList& params)
     // Allow using a different interface profile
     // Override general parameters
     const String& profile = params[YSTRING("profile")];
-    NamedList* sect = 0;
+    const NamedList* sect = 0;
     if (profile && profile != YSTRING("general"))
 	sect = s_cfg.getSection(profile);
     if (sect) {
@@ -23,6 +23,7 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
 
 using namespace TelEngine;
 namespace { // anonymous
@@ -31,13 +32,9 @@ namespace { // anonymous
 #define BLOCK_STACK 10
 #define MAX_VAR_LEN 8100
 
-static Configuration s_cfg;
 static const char* s_trackName = 0;
-static bool s_extended;
-static bool s_insensitive;
 static bool s_prerouteall;
 static int s_maxDepth = 5;
-static String s_defRule;
 static Mutex s_mutex(true,"RegexRoute");
 static ObjList s_extra;
 static NamedList s_vars("");
@@ -388,7 +385,8 @@ static void evalFunc(String& str, Message& msg)
 		if (par.null())
 		    par = ",";
 		str.clear();
-		for (const ObjList* l = msg.paramList()->skipNull(); l; l = l->skipNext())
+		const NamedList& params = msg;
+		for (const ObjList* l = params.paramList()->skipNull(); l; l = l->skipNext())
 		    str.append(static_cast<const NamedString*>(l->get())->name(),par);
 	    }
 	    else
@@ -408,7 +406,8 @@ static void evalFunc(String& str, Message& msg)
 		if (par.null())
 		    par = ",";
 		str.clear();
-		for (const ObjList* l = s_vars.paramList()->skipNull(); l; l = l->skipNext()) {
+		const NamedList& vars = s_vars;
+		for (const ObjList* l = vars.paramList()->skipNull(); l; l = l->skipNext()) {
 		    if (str.length() > MAX_VAR_LEN) {
 			Debug("RegexRoute",DebugWarn,"Truncating output of $(variables,list)");
 			str.append("...",par);
@@ -516,91 +515,519 @@ static void setMessage(const String& match, Message& msg, String& line, Message*
 }
 
 // helper function to set the default regexp
-static void setDefault(Regexp& reg)
+static void setDefault(String& reg, const String& defRule)
 {
-    if (s_defRule.null())
+    if (defRule.null())
 	return;
     if (reg.null())
-	reg = s_defRule;
+	reg = defRule;
     else if (reg == "^") {
 	// deal with double '^' at end
-	if (s_defRule.endsWith("^"))
-	    reg.assign(s_defRule,s_defRule.length()-1);
+	if (defRule.endsWith("^"))
+	    reg.assign(defRule,defRule.length()-1);
 	else
-	    reg = s_defRule + reg;
+	    reg = defRule + reg;
     }
 }
 
-// helper function to process one match attempt
-static bool oneMatch(Message& msg, Regexp& reg, String& match, const String& context, unsigned int rule)
+enum BlockState {
+    BlockRun  = 0,
+    BlockSkip = 1,
+    BlockDone = 2
+};
+
+// Longest literal prefix kept in the dispatch table
+#define MAX_PREFIX 32
+
+// One match attempt of a rule, parsed and compiled when loading the config
+class RouteMatch : public GenObject
+{
+public:
+    enum Source {
+	Subject,
+	Param,
+	Function
+    };
+    RouteMatch(const String& text, const String& defRule, bool extended, bool insensitive,
+	const String& context, unsigned int rule);
+    bool matches(Message& msg, const String& str, String& match) const;
+    inline bool valid() const
+	{ return m_valid; }
+    inline const String& prefix() const
+	{ return m_prefix; }
+private:
+    Regexp m_regexp;
+    int m_source;
+    String m_name;
+    String m_default;
+    String m_prefix;
+    bool m_negate;
+    bool m_valid;
+};
+
+// A secondary if/and/or condition following the primary match
+class RouteCond : public GenObject
+{
+public:
+    inline RouteCond(char oper, bool assign)
+	: m_oper(oper), m_assign(assign), m_match(0)
+	{ }
+    inline ~RouteCond()
+	{ TelEngine::destruct(m_match); }
+    char m_oper;
+    bool m_assign;
+    RouteMatch* m_match;
+};
+
+// One line of a context with its matches parsed and compiled
+class RouteRule : public GenObject
+{
+public:
+    enum Action {
+	Set,
+	Echo,
+	Block,
+	Dispatch,
+	Enqueue
+    };
+    RouteRule(const NamedString& line, unsigned int index, const String& defRule,
+	bool extended, bool insensitive, const String& context);
+    ~RouteRule();
+    bool check(Message& msg, const String& str, String& match, const String& context) const;
+    // Literal prefix the match string must have for the rule to be worth trying
+    const String& prefix() const;
+    NamedString m_line;
+    unsigned int m_index;
+    bool m_close;
+    bool m_open;
+    int m_action;
+    String m_value;
+    unsigned int m_skip;
+private:
+    RouteMatch* m_match;
+    ObjList m_conds;
+};
+
+// A compiled context: rules in config order plus a literal prefix dispatch
+//  table so rules that can't match the current string are never tried
+class RouteContext : public String
+{
+    friend class RouteCursor;
+public:
+    RouteContext(const NamedList& sect, const String& defRule, bool extended, bool insensitive);
+    ~RouteContext();
+    inline unsigned int count() const
+	{ return m_count; }
+    inline const RouteRule* rule(unsigned int index) const
+	{ return m_rules[index]; }
+    inline bool jumps() const
+	{ return m_jumps; }
+private:
+    const unsigned int* lookup(const String& prefix, unsigned int& len) const;
+    RouteRule** m_rules;
+    unsigned int m_count;
+    // rules that must always be visited
+    unsigned int* m_always;
+    unsigned int m_alwaysCount;
+    // rules keyed by their literal prefix
+    HashList m_prefixes;
+    u_int64_t m_lengths;
+    bool m_jumps;
+};
+
+// Rules sharing the same literal prefix, in config order
+class RoutePrefix : public String
+{
+public:
+    inline RoutePrefix(const String& prefix)
+	: String(prefix), m_rules(0), m_count(0)
+	{ }
+    inline ~RoutePrefix()
+	{ delete[] m_rules; }
+    unsigned int* m_rules;
+    unsigned int m_count;
+};
+
+// Walks the candidate rules of a context for a match string in config order
+class RouteCursor
+{
+public:
+    inline RouteCursor(const RouteContext& ctx, const String& str)
+	: m_ctx(ctx), m_lists(0)
+	{ reset(str); }
+    void reset(const String& str);
+    unsigned int next(unsigned int index);
+private:
+    const RouteContext& m_ctx;
+    const unsigned int* m_list[MAX_PREFIX + 2];
+    unsigned int m_len[MAX_PREFIX + 2];
+    unsigned int m_pos[MAX_PREFIX + 2];
+    unsigned int m_lists;
+};
+
+// Immutable compiled configuration, replaced as a whole on reload
+class RouteProgram : public RefObject
 {
+public:
+    RouteProgram(const Configuration& cfg, const String& defRule, bool extended, bool insensitive);
+    inline const RouteContext* context(const String& name) const
+	{ return static_cast<const RouteContext*>(m_contexts[name]); }
+    inline unsigned int sections() const
+	{ return m_sections; }
+private:
+    HashList m_contexts;
+    unsigned int m_sections;
+};
+
+static RefPointer<RouteProgram> s_program;
+static Regexp s_blockStart("\\(=[[:space:]]*\\)\\?{$");
+
+RouteMatch::RouteMatch(const String& text, const String& defRule, bool extended, bool insensitive,
+    const String& context, unsigned int rule)
+    : m_source(Subject), m_negate(false), m_valid(false)
+{
+    String reg(text);
     if (reg.startsWith("${")) {
 	// handle special matching by param ${paramname}regexp
+	m_source = Param;
 	int p = reg.find('}');
 	if (p < 3) {
 	    Debug("RegexRoute",DebugWarn,"Invalid parameter match '%s' in rule #%u in context '%s'",
 		reg.c_str(),rule,context.c_str());
-	    return false;
+	    return;
 	}
-	match = reg.substr(2,p-2);
+	m_name = reg.substr(2,p-2);
 	reg = reg.substr(p+1);
-	match.trimBlanks();
+	m_name.trimBlanks();
 	reg.trimBlanks();
-	String def;
-	p = match.find('$');
+	p = m_name.find('$');
 	if (p >= 0) {
 	    // param is in ${<name>$<default>} format
-	    def = match.substr(p+1);
-	    match = match.substr(0,p);
-	    match.trimBlanks();
+	    m_default = m_name.substr(p+1);
+	    m_name = m_name.substr(0,p);
+	    m_name.trimBlanks();
 	}
-	setDefault(reg);
-	if (match.null() || reg.null()) {
+	setDefault(reg,defRule);
+	if (m_name.null() || reg.null()) {
 	    Debug("RegexRoute",DebugWarn,"Missing parameter or rule in rule #%u in context '%s'",
 		rule,context.c_str());
-	    return false;
+	    return;
 	}
-	DDebug("RegexRoute",DebugAll,"Using message parameter '%s' default '%s'",
-	    match.c_str(),def.c_str());
-	match = msg.getValue(match,def);
     }
     else if (reg.startsWith("$(")) {
 	// handle special matching by param $(function)regexp
+	m_source = Function;
 	int p = reg.find(')');
 	if (p < 3) {
 	    Debug("RegexRoute",DebugWarn,"Invalid function match '%s' in rule #%u in context '%s'",
 		reg.c_str(),rule,context.c_str());
-	    return false;
+	    return;
 	}
-	match = reg.substr(0,p+1);
+	m_name = reg.substr(0,p+1);
 	reg = reg.substr(p+1);
 	reg.trimBlanks();
-	setDefault(reg);
+	setDefault(reg,defRule);
 	if (reg.null()) {
 	    Debug("RegexRoute",DebugWarn,"Missing rule in rule #%u in context '%s'",
 		rule,context.c_str());
-	    return false;
+	    return;
 	}
-	DDebug("RegexRoute",DebugAll,"Using function '%s'",match.c_str());
-	msg.replaceParams(match);
-	replaceFuncs(match,msg);
     }
-    match.trimBlanks();
-
-    bool doMatch = true;
     if (reg.endsWith("^")) {
 	// reverse match on final ^ (makes no sense in a regexp)
-	doMatch = false;
+	m_negate = true;
 	reg = reg.substr(0,reg.length()-1);
     }
-    return (match.matches(reg) == doMatch);
+    m_regexp = reg;
+    m_regexp.setFlags(extended,insensitive);
+    m_regexp.compile();
+    m_valid = true;
+    // an anchored regexp starting with literal text rules out all other strings
+    if (m_source != Subject || m_negate || insensitive || !reg.startsWith("^") || (reg.find('|') >= 0))
+	return;
+    const char* r = reg.c_str() + 1;
+    unsigned int n = 0;
+    while (r[n] && (n <= MAX_PREFIX) && (::isalnum((unsigned char)r[n]) || ::strchr("@:/#%_-,;=!~<>&' ",r[n])))
+	n++;
+    // a quantifier makes the last literal character optional
+    if (n && (::strchr("*?+{",r[n]) || ((r[n] == '\\') && r[n+1] && ::strchr("{?+",r[n+1]))))
+	n--;
+    if (n > MAX_PREFIX)
+	n = MAX_PREFIX;
+    m_prefix.assign(r,n);
+}
+
+bool RouteMatch::matches(Message& msg, const String& str, String& match) const
+{
+    switch (m_source) {
+	case Param:
+	    DDebug("RegexRoute",DebugAll,"Using message parameter '%s' default '%s'",
+		m_name.c_str(),m_default.c_str());
+	    match = msg.getValue(m_name,m_default);
+	    break;
+	case Function:
+	    DDebug("RegexRoute",DebugAll,"Using function '%s'",m_name.c_str());
+	    match = m_name;
+	    msg.replaceParams(match);
+	    replaceFuncs(match,msg);
+	    break;
+	default:
+	    match = str;
+    }
+    if (!m_valid)
+	return false;
+    match.trimBlanks();
+    return (match.matches(m_regexp) != m_negate);
 }
 
-enum BlockState {
-    BlockRun  = 0,
-    BlockSkip = 1,
-    BlockDone = 2
-};
+RouteRule::RouteRule(const NamedString& line, unsigned int index, const String& defRule,
+    bool extended, bool insensitive, const String& context)
+    : m_line(line.name(),line), m_index(index), m_close(false), m_open(false), m_action(Set),
+      m_skip(0), m_match(0)
+{
+    String reg(line.name());
+    m_close = reg.startSkip("}");
+    if (m_close && reg.trimBlanks().null())
+	reg = ".*";
+    m_open = s_blockStart.matches(line);
+    m_match = new RouteMatch(reg,defRule,extended,insensitive,context,index+1);
+    // split the value in if/and/or conditions and the action
+    String val(line);
+    ObjList* add = &m_conds;
+    for (;;) {
+	char oper = 0;
+	if (val.startSkip("or"))
+	    oper = 'o';
+	else if (val.startSkip("if"))
+	    oper = 'i';
+	else if (val.startSkip("and"))
+	    oper = 'a';
+	else
+	    break;
+	int p = val.find('=');
+	RouteCond* cond = new RouteCond(oper,p >= 0);
+	add = add->append(cond);
+	if (p < 0) {
+	    val.clear();
+	    break;
+	}
+	reg = val.substr(0,p);
+	reg.trimBlanks();
+	val = val.substr(p+1);
+	val.trimBlanks();
+	if (p >= 1 && reg)
+	    cond->m_match = new RouteMatch(reg,defRule,extended,insensitive,context,index+1);
+    }
+    if (val.startSkip("echo") || val.startSkip("output"))
+	m_action = Echo;
+    else if (val == "{")
+	m_action = Block;
+    else if (val.startSkip("dispatch"))
+	m_action = Dispatch;
+    else if (val.startSkip("enqueue"))
+	m_action = Enqueue;
+    m_value = val;
+}
+
+RouteRule::~RouteRule()
+{
+    TelEngine::destruct(m_match);
+}
+
+const String& RouteRule::prefix() const
+{
+    // block markers must always be processed, failed matches may be rescued by 'or'
+    if (m_close || m_open)
+	return String::empty();
+    const RouteCond* cond = static_cast<const RouteCond*>(m_conds.get());
+    if (cond && cond->m_oper == 'o')
+	return String::empty();
+    return m_match->prefix();
+}
+
+// Run the primary match and the if/and/or conditions following it
+bool RouteRule::check(Message& msg, const String& str, String& match, const String& context) const
+{
+    bool ok = m_match->matches(msg,str,match);
+    const ObjList* l = m_conds.skipNull();
+    for (;;) {
+	const RouteCond* cond = l ? static_cast<const RouteCond*>(l->get()) : 0;
+	if (ok) {
+	    if (!cond)
+		return true;
+	    if (cond->m_oper == 'o') {
+		// matched so skip over all the alternatives
+		for (; l; l = l->skipNext()) {
+		    if (!static_cast<const RouteCond*>(l->get())->m_assign) {
+			Debug("RegexRoute",DebugWarn,"Malformed 'or' rule #%u in context '%s'",
+			    m_index+1,context.c_str());
+			return false;
+		    }
+		}
+		return true;
+	    }
+	}
+	else if (!cond || cond->m_oper != 'o')
+	    return false;
+	if (!cond->m_match) {
+	    Debug("RegexRoute",DebugWarn,"Missing 'if' in rule #%u in context '%s'",
+		m_index+1,context.c_str());
+	    return false;
+	}
+	NDebug("RegexRoute",DebugAll,"Secondary match by rule #%u in context '%s'",
+	    m_index+1,context.c_str());
+	ok = cond->m_match->matches(msg,str,match);
+	l = l->skipNext();
+    }
+}
+
+RouteContext::RouteContext(const NamedList& sect, const String& defRule, bool extended, bool insensitive)
+    : String(sect),
+      m_rules(0), m_count(0), m_always(0), m_alwaysCount(0),
+      m_lengths(0), m_jumps(true)
+{
+    unsigned int len = sect.length();
+    m_rules = new RouteRule*[len + 1];
+    m_always = new unsigned int[len + 1];
+    ObjList prefixes;
+    ObjList* add = &prefixes;
+    for (unsigned int i = 0; i < len; i++) {
+	const NamedString* n = sect.getParam(i);
+	if (!n)
+	    continue;
+	RouteRule* r = new RouteRule(*n,i,defRule,extended,insensitive,*this);
+	unsigned int idx = m_count++;
+	m_rules[idx] = r;
+	const String& prefix = r->prefix();
+	if (prefix) {
+	    RoutePrefix* p = static_cast<RoutePrefix*>(m_prefixes[prefix]);
+	    if (!p) {
+		p = new RoutePrefix(prefix);
+		m_prefixes.append(p);
+		m_lengths |= ((u_int64_t)1) << prefix.length();
+	    }
+	    p->m_count++;
+	}
+	else
+	    m_always[m_alwaysCount++] = idx;
+	add = add->append(new String(prefix));
+    }
+    // fill the prefix tables in config order
+    unsigned int idx = 0;
+    for (ObjList* l = prefixes.skipNull(); l; l = l->skipNext(), idx++) {
+	const String* prefix = static_cast<const String*>(l->get());
+	if (prefix->null())
+	    continue;
+	RoutePrefix* p = static_cast<RoutePrefix*>(m_prefixes[*prefix]);
+	if (!p->m_rules) {
+	    p->m_rules = new unsigned int[p->m_count];
+	    p->m_count = 0;
+	}
+	p->m_rules[p->m_count++] = idx;
+    }
+    // find the line closing each block, unclosed ones run to the end
+    unsigned int* stack = new unsigned int[m_count + 1];
+    unsigned int* closing = new unsigned int[m_count + 1];
+    unsigned int depth = 0;
+    for (unsigned int i = 0; i < m_count; i++) {
+	const RouteRule* r = m_rules[i];
+	closing[i] = m_count;
+	if (r->m_close) {
+	    // a '}' outside any block is ignored, like at run time
+	    if (!depth)
+		continue;
+	    closing[stack[--depth]] = i;
+	}
+	if (r->m_open) {
+	    if (depth >= BLOCK_STACK)
+		m_jumps = false;
+	    stack[depth++] = i;
+	}
+    }
+    // a rule skipped inside a block can jump to where the innermost one ends
+    depth = 0;
+    for (unsigned int i = 0; i < m_count; i++) {
+	RouteRule* r = m_rules[i];
+	if (r->m_close) {
+	    if (!depth)
+		continue;
+	    depth--;
+	}
+	if (r->m_open)
+	    stack[depth++] = i;
+	r->m_skip = depth ? closing[stack[depth - 1]] : m_count;
+    }
+    delete[] closing;
+    delete[] stack;
+    DDebug("RegexRoute",DebugAll,"Compiled context '%s' with %u rules, %u always tried",
+	c_str(),m_count,m_alwaysCount);
+}
+
+RouteContext::~RouteContext()
+{
+    for (unsigned int i = 0; i < m_count; i++)
+	TelEngine::destruct(m_rules[i]);
+    delete[] m_rules;
+    delete[] m_always;
+}
+
+const unsigned int* RouteContext::lookup(const String& prefix, unsigned int& len) const
+{
+    const RoutePrefix* p = static_cast<const RoutePrefix*>(m_prefixes[prefix]);
+    if (!p)
+	return 0;
+    len = p->m_count;
+    return p->m_rules;
+}
+
+// Select the rule lists whose prefix is found at the start of the match string
+void RouteCursor::reset(const String& str)
+{
+    const RouteContext& ctx = m_ctx;
+    m_list[0] = ctx.m_always;
+    m_len[0] = ctx.m_alwaysCount;
+    m_pos[0] = 0;
+    m_lists = 1;
+    if (!ctx.m_lengths)
+	return;
+    String subj(str);
+    subj.trimBlanks();
+    for (unsigned int n = 1; (n <= MAX_PREFIX) && (n <= subj.length()); n++) {
+	if (!(ctx.m_lengths & (((u_int64_t)1) << n)))
+	    continue;
+	unsigned int len = 0;
+	const unsigned int* list = ctx.lookup(subj.substr(0,n),len);
+	if (!list)
+	    continue;
+	m_list[m_lists] = list;
+	m_len[m_lists] = len;
+	m_pos[m_lists] = 0;
+	m_lists++;
+    }
+}
+
+// Get the first candidate rule at or after an index
+unsigned int RouteCursor::next(unsigned int index)
+{
+    unsigned int best = m_ctx.count();
+    for (unsigned int i = 0; i < m_lists; i++) {
+	while ((m_pos[i] < m_len[i]) && (m_list[i][m_pos[i]] < index))
+	    m_pos[i]++;
+	if ((m_pos[i] < m_len[i]) && (m_list[i][m_pos[i]] < best))
+	    best = m_list[i][m_pos[i]];
+    }
+    return best;
+}
+
+RouteProgram::RouteProgram(const Configuration& cfg, const String& defRule, bool extended, bool insensitive)
+    : m_contexts(61), m_sections(cfg.sections())
+{
+    for (unsigned int i = 0; i < m_sections; i++) {
+	const NamedList* sect = cfg.getSection(i);
+	if (sect && !m_contexts.find(*sect))
+	    m_contexts.append(new RouteContext(*sect,defRule,extended,insensitive));
+    }
+}
 
 // process one context, can call itself recursively
 static bool oneContext(Message &msg, String &str, const String &context, String &ret,
@@ -612,36 +1039,31 @@ static bool oneContext(Message &msg, String &str, const String &context, String
 	Debug("RegexRoute",DebugWarn,"Possible loop detected, current context '%s'",context.c_str());
 	return false;
     }
-    NamedList *l = s_cfg.getSection(context);
-    if (l) {
+    const RouteContext* ctx = s_program ? s_program->context(context) : 0;
+    if (ctx) {
 	unsigned int blockDepth = 0;
 	BlockState blockStack[BLOCK_STACK];
-	unsigned int len = l->length();
-	for (unsigned int i = 0; i < len; i++) {
-	    const NamedString* n = l->getParam(i);
-	    if (!n)
-		continue;
+	RouteCursor cursor(*ctx,str);
+	for (unsigned int i = cursor.next(0); i < ctx->count(); i = cursor.next(i + 1)) {
+	    const RouteRule* r = ctx->rule(i);
+	    const NamedString* n = &r->m_line;
 	    BlockState blockThis = (blockDepth > 0) ? blockStack[blockDepth-1] : BlockRun;
 	    BlockState blockLast = BlockSkip;
-	    Regexp reg(n->name(),s_extended,s_insensitive);
-	    if (reg.startSkip("}")) {
+	    if (r->m_close) {
 		if (!blockDepth) {
 		    Debug("RegexRoute",DebugWarn,"Got '}' outside block in line #%u in context '%s'",
-			i+1,context.c_str());
+			r->m_index+1,context.c_str());
 		    continue;
 		}
-		if (reg.trimBlanks().null())
-		    reg = ".*";
 		blockDepth--;
 		blockLast = blockThis;
 		blockThis = (blockDepth > 0) ? blockStack[blockDepth-1] : BlockRun;
 	    }
-	    static Regexp s_blockStart("\\(=[[:space:]]*\\)\\?{$");
-	    if (s_blockStart.matches(*n)) {
+	    if (r->m_open) {
 		// start of a new block
 		if (blockDepth >= BLOCK_STACK) {
 		    Debug("RegexRoute",DebugWarn,"Block stack overflow in line #%u in context '%s'",
-			i+1,context.c_str());
+			r->m_index+1,context.c_str());
 		    return false;
 		}
 		// assume block is done
@@ -655,60 +1077,22 @@ static bool oneContext(Message &msg, String &str, const String &context, String
 		}
 		blockStack[blockDepth++] = blockEnter;
 	    }
-	    XDebug("RegexRoute",DebugAll,"%s:%d(%u:%s) %s=%s",context.c_str(),i+1,
+	    XDebug("RegexRoute",DebugAll,"%s:%d(%u:%s) %s=%s",context.c_str(),r->m_index+1,
 		blockDepth,String::boolText(BlockRun == blockThis),
 		n->name().c_str(),n->c_str());
-	    if (BlockRun != blockThis)
+	    if (BlockRun != blockThis) {
+		// nothing inside the current block can run, go to where it ends
+		if (blockDepth && ctx->jumps())
+		    i = r->m_skip - 1;
 		continue;
+	    }
 
-	    String val(*n);
 	    String match;
-	    bool ok;
-	    do {
-		match = str;
-		ok = oneMatch(msg,reg,match,context,i+1);
-		if (ok) {
-		    if (val.startSkip("or")) {
-			do {
-			    int p = val.find('=');
-			    if (p < 0) {
-				Debug("RegexRoute",DebugWarn,"Malformed 'or' rule #%u in context '%s'",
-				    i+1,context.c_str());
-				ok = false;
-				break;
-			    }
-			    val = val.substr(p+1);
-			    val.trimBlanks();
-			} while (ok && (val.startSkip("or") || val.startSkip("if") || val.startSkip("and")));
-			break;
-		    }
-		    if (!(val.startSkip("if") || val.startSkip("and")))
-			break;
-		}
-		else if (val.startSkip("or"))
-		    ok = true;
-		if (ok) {
-		    int p = val.find('=');
-		    if (p >= 1) {
-			reg = val.substr(0,p);
-			val = val.substr(p+1);
-			reg.trimBlanks();
-			val.trimBlanks();
-			if (!reg.null()) {
-			    NDebug("RegexRoute",DebugAll,"Secondary match rule '%s' by rule #%u in context '%s'",
-				reg.c_str(),i+1,context.c_str());
-			    continue;
-			}
-		    }
-		    Debug("RegexRoute",DebugWarn,"Missing 'if' in rule #%u in context '%s'",
-			i+1,context.c_str());
-		    ok = false;
-		}
-	    } while (ok);
-	    if (!ok)
+	    if (!r->check(msg,str,match,context))
 		continue;
+	    String val(r->m_value);
 
-	    if (val.startSkip("echo") || val.startSkip("output")) {
+	    if (r->m_action == RouteRule::Echo) {
 		// special case: display the line but don't set params
 		val = match.replaceMatches(val);
 		msg.replaceParams(val);
@@ -716,17 +1100,17 @@ static bool oneContext(Message &msg, String &str, const String &context, String
 		Output("%s",val.safe());
 		continue;
 	    }
-	    else if (val == "{") {
+	    else if (r->m_action == RouteRule::Block) {
 		// mark block as being processed now
 		if (blockDepth)
 		    blockStack[blockDepth-1] = BlockRun;
 		else
 		    Debug("RegexRoute",DebugWarn,"Got '{' outside block in line #%u in context '%s'",
-			i+1,context.c_str());
+			r->m_index+1,context.c_str());
 		continue;
 	    }
-	    bool disp = val.startSkip("dispatch");
-	    if (disp || val.startSkip("enqueue")) {
+	    bool disp = (r->m_action == RouteRule::Dispatch);
+	    if (disp || (r->m_action == RouteRule::Enqueue)) {
 		// special case: enqueue or dispatch a new message
 		if (val && (val[0] != ';')) {
 		    Message* m = new Message("");
@@ -738,7 +1122,7 @@ static bool oneContext(Message &msg, String &str, const String &context, String
 			m->userData(msg.userData());
 			NDebug("RegexRoute",DebugAll,"%s new message '%s' by rule #%u '%s' in context '%s'",
 			    (disp ? "Dispatching" : "Enqueueing"),
-			    val.c_str(),i+1,n->name().c_str(),context.c_str());
+			    val.c_str(),r->m_index+1,n->name().c_str(),context.c_str());
 			if (disp) {
 			    s_dispatching++;
 			    Engine::dispatch(m);
@@ -769,35 +1153,38 @@ static bool oneContext(Message &msg, String &str, const String &context, String
 	    else if (val.startSkip("goto") || val.startSkip("jump") ||
 		((val.startSkip("@goto") || val.startSkip("@jump")) && !(warn = false))) {
 		NDebug("RegexRoute",DebugAll,"Jumping to context '%s' by rule #%u '%s'",
-		    val.c_str(),i+1,n->name().c_str());
+		    val.c_str(),r->m_index+1,n->name().c_str());
 		return oneContext(msg,str,val,ret,warn,depth+1);
 	    }
 	    else if (val.startSkip("include") || val.startSkip("call") ||
 		((val.startSkip("@include") || val.startSkip("@call")) && !(warn = false))) {
 		NDebug("RegexRoute",DebugAll,"Including context '%s' by rule #%u '%s'",
-		    val.c_str(),i+1,n->name().c_str());
+		    val.c_str(),r->m_index+1,n->name().c_str());
 		if (oneContext(msg,str,val,ret,warn,depth+1)) {
 		    DDebug("RegexRoute",DebugAll,"Returning true from context '%s'", context.c_str());
 		    return true;
 		}
+		// the included context may have changed the match string
+		cursor.reset(str);
 	    }
 	    else if (val.startSkip("match") || val.startSkip("newmatch")) {
 		if (!val.null()) {
 		    NDebug("RegexRoute",DebugAll,"Setting match string '%s' by rule #%u '%s' in context '%s'",
-			val.c_str(),i+1,n->name().c_str(),context.c_str());
+			val.c_str(),r->m_index+1,n->name().c_str(),context.c_str());
 		    str = val;
+		    cursor.reset(str);
 		}
 	    }
 	    else if (val.startSkip("rename")) {
 		if (!val.null()) {
 		    NDebug("RegexRoute",DebugAll,"Renaming message '%s' to '%s' by rule #%u '%s' in context '%s'",
-			msg.c_str(),val.c_str(),i+1,n->name().c_str(),context.c_str());
+			msg.c_str(),val.c_str(),r->m_index+1,n->name().c_str(),context.c_str());
 		    msg = val;
 		}
 	    }
 	    else {
 		DDebug("RegexRoute",DebugAll,"Returning '%s' for '%s' in context '%s' by rule #%u '%s'",
-		    val.c_str(),str.c_str(),context.c_str(),i+1,n->name().c_str());
+		    val.c_str(),str.c_str(),context.c_str(),r->m_index+1,n->name().c_str());
 		ret = val;
 		return true;
 	    }
@@ -881,7 +1268,7 @@ bool StatusHandler::received(Message &msg)
 	return false;
     Lock lock(s_mutex);
     msg.retValue() << "name=" << __plugin.name()
-	<< ",type=route;sections=" << s_cfg.count()
+	<< ",type=route;sections=" << (s_program ? s_program->sections() : 0)
 	<< ",extra=" << s_extra.count()
 	<< ",variables=" << s_vars.count() << "\r\n";
     return !dest.null();
@@ -929,38 +1316,41 @@ void RegexRoutePlugin::initialize()
     TelEngine::destruct(m_status);
     TelEngine::destruct(m_command);
     s_extra.clear();
+    Configuration cfg(Engine::configFile(name()));
+    cfg.load();
+    // compile the new rules before taking the lock so routing is not stalled
+    RouteProgram* prog = new RouteProgram(cfg,cfg.getValue("priorities","defaultrule",DEFAULT_RULE),
+	cfg.getBoolValue("priorities","extended",false),
+	cfg.getBoolValue("priorities","insensitive",false));
     Lock lock(s_mutex);
-    s_cfg = Engine::configFile(name());
-    s_cfg.load();
+    s_program = prog;
+    TelEngine::destruct(prog);
     if (m_first) {
 	m_first = false;
-	initVars(s_cfg.getSection("$once"));
+	initVars(cfg.getSection("$once"));
     }
-    initVars(s_cfg.getSection("$init"));
-    s_trackName = s_cfg.getBoolValue("priorities","trackparam",true) ?
+    initVars(cfg.getSection("$init"));
+    s_trackName = cfg.getBoolValue("priorities","trackparam",true) ?
 	name().c_str() : (const char*)0;
-    s_extended = s_cfg.getBoolValue("priorities","extended",false);
-    s_insensitive = s_cfg.getBoolValue("priorities","insensitive",false);
-    s_prerouteall = s_cfg.getBoolValue("priorities","prerouteall",false);
-    unsigned priority = s_cfg.getIntValue("priorities","preroute",100);
+    s_prerouteall = cfg.getBoolValue("priorities","prerouteall",false);
+    unsigned priority = cfg.getIntValue("priorities","preroute",100);
     if (priority)
 	Engine::install(m_preroute = new PrerouteHandler(priority));
-    priority = s_cfg.getIntValue("priorities","route",100);
+    priority = cfg.getIntValue("priorities","route",100);
     if (priority)
 	Engine::install(m_route = new RouteHandler(priority));
-    priority = s_cfg.getIntValue("priorities","status",110);
+    priority = cfg.getIntValue("priorities","status",110);
     if (priority) {
 	Engine::install(m_status = new StatusHandler(priority));
 	Engine::install(m_command = new CommandHandler(priority));
     }
-    int depth = s_cfg.getIntValue("priorities","maxdepth",5);
+    int depth = cfg.getIntValue("priorities","maxdepth",5);
     if (depth < 5)
 	depth = 5;
     else if (depth > 100)
 	depth = 100;
     s_maxDepth = depth;
-    s_defRule = s_cfg.getValue("priorities","defaultrule",DEFAULT_RULE);
-    NamedList* l = s_cfg.getSection("extra");
+    NamedList* l = cfg.getSection("extra");
     if (l) {
 	unsigned int len = l->length();
 	for (unsigned int i=0; i<len; i++) {
@@ -974,7 +1364,7 @@ void RegexRoutePlugin::initialize()
 		const char* context = TelEngine::c_str(static_cast<const String*>(o->at(2)));
 		if (TelEngine::null(context))
 		    context = n->name().c_str();
-		if (s_cfg.getSection(context))
+		if (cfg.getSection(context))
 		    Engine::install(new GenericHandler(n->name(),prio,context,match));
 		else
 		    Debug(DebugWarn,"Missing context [%s] for handling %s",context,n->name().c_str());
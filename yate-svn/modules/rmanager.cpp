@@ -70,6 +70,7 @@ static const char* s_level[] =
 {
     "level",
     "objects",
+    "mutexes",
     "on",
     "off",
     "enable",
@@ -119,7 +120,7 @@ static const CommandInfo s_cmdInfo[] =
     { "color", "[on|off]", s_bools, "Show status or turn local colorization on or off" },
 
     // Admin commands
-    { "debug", "[module] [level|objects|on|off]", s_level, "Show or change debugging level globally or per module" },
+    { "debug", "[module] [level|objects|mutexes|on|off]", s_level, "Show or change debugging level globally or per module" },
 #ifdef HAVE_MALLINFO
     { "meminfo", 0, 0, "Displays memory allocation statistics" },
 #endif
@@ -1137,7 +1138,7 @@ bool Connection::autoComplete()
 	completeWord(m.retValue(),YSTRING("all"),partWord);
 	completeWords(m.retValue(),s_bools,partWord);
     }
-    else if (partLine.matches(o1) || partLine.matches(o2)) {
+    else if (partLine.matches(o1) || partLine.matches(o2) || (partLine == "debug mutexes")) {
 	completeWord(m.retValue(),YSTRING("reset"),partWord);
 	completeWords(m.retValue(),s_bools,partWord);
     }
@@ -1472,6 +1473,15 @@ bool Connection::processLine(const char *line, bool saveLine)
 		setObjCounting(dbg);
 	    }
 	}
+	else if (str.startSkip("mutexes")) {
+	    if (str == YSTRING("reset"))
+		Mutex::resetProfiling();
+	    else {
+		bool dbg = Mutex::profiling();
+		str >> dbg;
+		Mutex::enableProfiling(dbg);
+	    }
+	}
 	else if (str.startSkip("threshold")) {
 	    int thr = m_threshold;
 	    str >> thr;
@@ -1512,6 +1522,7 @@ bool Connection::processLine(const char *line, bool saveLine)
 	if (m_machine) {
 	    str = "%%=debug:level=";
 	    str << debugLevel() << ":objects=" << getObjCounting();
+	    str << ":mutexes=" << Mutex::profiling();
 	    str << ":local=" << m_debug;
 	    str << ":threshold=" << m_threshold;
 	    if (counter)
@@ -1520,6 +1531,7 @@ bool Connection::processLine(const char *line, bool saveLine)
 	else {
 	    str = "Debug level: ";
 	    str << debugLevel() << ", objects: " << (getObjCounting() ? "on" : "off");
+	    str << ", mutexes: " << (Mutex::profiling() ? "on" : "off");
 	    str << ", local: " << (m_debug ? "on" : "off");
 	    str << ", threshold: " << m_threshold;
 	    if (counter)
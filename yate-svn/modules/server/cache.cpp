@@ -26,10 +26,13 @@ using namespace TelEngine;
 namespace { // anonymous
 
 class CacheItem;                         // A cache item
+class CacheTrie;                         // A digit trie indexing cache items
 class Cache;                             // A cache hash list
 class CacheThread;                       // Base class for cache threads
 class CacheExpireThread;                 // Cache expire thread
 class CacheLoadThread;                   // Cache load thread
+class CacheLoadRequest;                  // Pending database load of a cache item
+class CacheItemLoadThread;               // Cache items load thread
 class EngineHandler;                     // engine.start/stop handler
 class CacheModule;
 
@@ -37,6 +40,17 @@ class CacheModule;
 #define EXPIRE_CHECK_MAX 300
 // Min value for cache reload interval in seconds
 #define CACHE_RELOAD_MIN 10
+// Max value for the number of items loaded in a single database request
+#define LOADITEM_BATCH_MAX 500
+// Max value for the number of cache item load threads
+#define LOADITEM_THREADS_MAX 16
+// Trie nodes are allocated in pages of 2^TRIE_PAGE_BITS nodes
+#define TRIE_PAGE_BITS 12
+#define TRIE_PAGE_SIZE (1 << TRIE_PAGE_BITS)
+// Node links are 28 bit indexes, upper 4 bits of the sibling link hold the symbol
+#define TRIE_INDEX_MASK 0x0fffffff
+#define TRIE_SYMBOL_SHIFT 28
+#define TRIE_MAX_NODES TRIE_INDEX_MASK
 
 class CacheItem : public NamedList
 {
@@ -61,6 +75,96 @@ protected:
     u_int64_t m_expires;
 };
 
+// Digit trie holding non owning pointers to cache items
+// Ids made of digits, '*', '#' and '+' only are indexed
+// Nodes are 16 bytes (on 64 bit platforms) and are kept in fixed size pages
+// Nodes left without item and children when an item is removed are unlinked
+//  and kept in a free list to be re-used, pages are released on clear only
+class CacheTrie
+{
+public:
+    CacheTrie();
+    inline ~CacheTrie()
+	{ clear(); }
+    // Retrieve the number of nodes in use
+    inline unsigned int nodes() const
+	{ return m_count - m_freeCount; }
+    // Retrieve the memory used by the trie
+    inline u_int64_t memory() const
+	{ return (u_int64_t)m_pages * TRIE_PAGE_SIZE * sizeof(Node) + m_alloc * sizeof(Node*); }
+    // Check if an id can be indexed in the trie
+    static bool indexable(const String& id);
+    // Set the item of an id, build the path if missing
+    // Return false if the id is not indexable or the trie is full
+    bool set(const String& id, CacheItem* item);
+    // Reset the item of an id if it is the given one, release the unused nodes of its path
+    void reset(const String& id, const CacheItem* item);
+    // Find an item matching id or its longest prefix not shorter than minLen
+    // Exact match only is done if minLen is 0
+    // Return false if the id is not indexable
+    bool find(const String& id, unsigned int minLen, CacheItem*& item) const;
+    // Make room for a number of nodes to be added
+    void reserve(unsigned int count);
+    // Release all nodes
+    void clear();
+private:
+    struct Node {
+	u_int32_t child;                 // Index of first child, 0 if none
+	u_int32_t next;                  // Symbol and index of next sibling, 0 if none
+	CacheItem* item;                 // Item stored in this node
+    };
+    inline Node& node(u_int32_t idx) const
+	{ return m_nodes[idx >> TRIE_PAGE_BITS][idx & (TRIE_PAGE_SIZE - 1)]; }
+    static inline int symbol(char c) {
+	    if (c >= '0' && c <= '9')
+		return c - '0';
+	    switch (c) {
+		case '*': return 10;
+		case '#': return 11;
+		case '+': return 12;
+	    }
+	    return -1;
+	}
+    // Find the child of a node with a given symbol, return 0 if not found
+    u_int32_t child(u_int32_t idx, int sym) const;
+    // Allocate a node, return 0 if the trie is full
+    u_int32_t alloc(int sym);
+    // Put a node in the free list
+    void release(u_int32_t idx);
+
+    Node** m_nodes;                      // Node pages
+    unsigned int m_pages;                // Number of allocated pages
+    unsigned int m_alloc;                // Length of page pointers array
+    unsigned int m_count;                // Number of initialized nodes, root included
+    u_int32_t m_free;                    // First free node, linked by child index
+    unsigned int m_freeCount;            // Number of free nodes
+};
+
+// Pending database load of a cache item
+// Members are protected by the cache mutex
+class CacheLoadRequest : public RefObject
+{
+public:
+    inline CacheLoadRequest(const String& id)
+	: m_id(id), m_semaphore(LOADITEM_THREADS_MAX * 1000,"CacheLoadRequest",0),
+	m_waiters(0), m_sent(false), m_done(false)
+	{}
+    virtual const String& toString() const
+	{ return m_id; }
+    // Mark the request done, release waiters
+    inline void done() {
+	    m_done = true;
+	    for (; m_waiters; m_waiters--)
+		m_semaphore.unlock();
+	}
+
+    String m_id;                         // Requested item id
+    Semaphore m_semaphore;               // Waiters are blocked here
+    unsigned int m_waiters;              // Number of threads waiting for load
+    bool m_sent;                         // Request taken by a load thread
+    bool m_done;                         // Request completed
+};
+
 class Cache : public RefObject, public Mutex
 {
 public:
@@ -76,7 +180,7 @@ public:
 	{ return m_loadInterval != 0 || m_reload != 0; }
     // Retrieve the mutex protecting a given list
     inline unsigned int index(const String& str) const
-	{ return str.hash() % m_list.length(); }
+	{ return m_list.index(str.hash()); }
     // Safely retrieve the id matching parameter
     inline void getIdParam(String& param) {
 	    Lock lck(this);
@@ -132,11 +236,32 @@ public:
     unsigned int remove(const String& id, bool regexp = false);
     // Retrieve cache name
     virtual const String& toString() const;
+    // Load pending items from database until none is left
+    // Called from item load thread
+    void loadItems();
     // Dump the cache to output if XDEBUG is defined
     void dump(const char* oper);
     // Retrieve the item length bit mask
     u_int32_t prefixMask() const
 	{ return m_prefixMask; }
+    // Retrieve the number of lookups satisfied from memory
+    inline u_int64_t hits() const
+	{ return m_hits; }
+    // Retrieve the number of lookups not found in memory
+    inline u_int64_t misses() const
+	{ return m_misses; }
+    // Retrieve the memory used by the prefix trie, 0 if not used
+    inline u_int64_t indexMemory() const
+	{ return m_trie ? m_trie->memory() : 0; }
+    // Retrieve the number of prefix trie nodes in use, 0 if not used
+    inline unsigned int indexNodes() const
+	{ return m_trie ? m_trie->nodes() : 0; }
+    // Retrieve the number of lists and the number of items in the longest one
+    inline unsigned int listStats(unsigned int& longest) const {
+	    unsigned int used = 0;
+	    m_list.stats(used,longest);
+	    return m_list.length();
+	}
     // Set chunk limit and offset to a query
     // Return the number of replaced params
     static int setLimits(String& query, unsigned int chunk, unsigned int offset);
@@ -155,9 +280,31 @@ protected:
     CacheItem* findPrefix(const String& id);
     // Adjust cache length to limit
     void adjustToLimit(CacheItem* skipAdded);
+    // Add an item to the prefix trie, if any
+    void indexItem(CacheItem* item);
+    // Remove an item from the prefix trie, if any
+    inline void unindexItem(const CacheItem* item) {
+	    if (m_trie)
+		m_trie->reset(item->toString(),item);
+	}
+    // Build or release the prefix trie
+    void setIndex(bool trie);
+    // Retrieve or queue a database load request for an item. This method is not thread safe
+    // Set start to true if a new load thread must be started
+    CacheLoadRequest* requestLoad(const String& id, bool& start);
+    // Start a load thread for queued items
+    void startLoader();
+    // Take queued load requests. This method is not thread safe
+    unsigned int takeLoadRequests(ObjList& dest);
+    // Complete load requests. This method is not thread safe
+    void completeLoadRequests(ObjList& list);
 
     String m_name;                       // Cache name
     HashList m_list;                     // The list holding the cache
+    unsigned int m_size;                 // Initial number of lists
+    CacheTrie* m_trie;                   // Optional prefix trie indexing the list
+    u_int64_t m_hits;                    // Lookups found in memory
+    u_int64_t m_misses;                  // Lookups not found in memory
     u_int64_t m_cacheTtl;                // Cache item TTL (in us)
     unsigned int m_count;                // Current number of items
     unsigned int m_limit;                // Limit the number of cache items
@@ -179,6 +326,13 @@ protected:
     String m_queryLoadCache;             // Database load all cache query
     String m_queryLoadItem;              // Database load a cache item query
     String m_queryLoadItemCmd;           // Database load item on command query
+    String m_queryLoadItems;             // Database load a batch of cache items query
+    ObjList m_loadRequests;              // Pending item load requests
+    unsigned int m_loaders;              // Number of running item load threads
+    unsigned int m_loadItemThreads;      // Max number of item load threads
+    unsigned int m_loadItemBatch;        // Max number of items loaded in a batch
+    unsigned int m_loadItemInterval;     // Interval (in ms) to collect a batch
+    long m_loadItemWait;                 // Max time (in us) to wait for an item load
     String m_querySave;                  // Database save query
     String m_queryExpire;                // Database expire query
 };
@@ -217,6 +371,18 @@ private:
     ObjList* m_items;
 };
 
+class CacheItemLoadThread : public CacheThread
+{
+public:
+    inline CacheItemLoadThread(Cache* cache, Thread::Priority prio)
+	: CacheThread("CacheItemLoadThread",prio),
+	m_cache(cache)
+	{}
+    virtual void run();
+private:
+    RefPointer<Cache> m_cache;
+};
+
 class CacheModule : public Module
 {
 public:
@@ -285,6 +451,7 @@ static bool s_lnpStoreNpdiBefore = true; // Store LNP when already done
 static bool s_cnamStoreEmpty = false;    // Store empty caller name in CNAM cache
 static unsigned int s_size = 0;          // The number of listst in each cache
 static unsigned int s_limit = 0;         // Default cache limit
+static unsigned int s_maxLoad = 8;       // Average items in a list to grow the cache lists
 static unsigned int s_loadChunk = 0;     // The number of cache items to load in each DB load query
 static unsigned int s_maxChunks = 1000;  // Maximum number of chunks to load in a cache
 static Thread::Priority s_loadPrio = Thread::Normal; // Cache load thread priority
@@ -401,16 +568,236 @@ static void fillList(NamedList& list, String& buf)
 }
 
 
+/*
+ * CacheTrie
+ */
+CacheTrie::CacheTrie()
+    : m_nodes(0), m_pages(0), m_alloc(0), m_count(0), m_free(0), m_freeCount(0)
+{
+}
+
+// Check if an id can be indexed in the trie
+bool CacheTrie::indexable(const String& id)
+{
+    if (!id)
+	return false;
+    for (const char* s = id.c_str(); *s; s++)
+	if (symbol(*s) < 0)
+	    return false;
+    return true;
+}
+
+// Set the item of an id, build the path if missing
+bool CacheTrie::set(const String& id, CacheItem* item)
+{
+    if (!indexable(id))
+	return false;
+    // Allocate the root node
+    if (!m_count)
+	alloc(0);
+    u_int32_t idx = 0;
+    for (const char* s = id.c_str(); *s; s++) {
+	int sym = symbol(*s);
+	// Siblings are kept in ascending symbol order
+	u_int32_t prev = 0;
+	u_int32_t crt = node(idx).child;
+	for (; crt; crt = node(crt).next & TRIE_INDEX_MASK) {
+	    if ((int)(node(crt).next >> TRIE_SYMBOL_SHIFT) >= sym)
+		break;
+	    prev = crt;
+	}
+	if (!crt || (int)(node(crt).next >> TRIE_SYMBOL_SHIFT) != sym) {
+	    u_int32_t n = alloc(sym);
+	    if (!n)
+		return false;
+	    node(n).next |= crt;
+	    if (prev)
+		node(prev).next = (node(prev).next & ~TRIE_INDEX_MASK) | n;
+	    else
+		node(idx).child = n;
+	    crt = n;
+	}
+	idx = crt;
+    }
+    node(idx).item = item;
+    return true;
+}
+
+// Reset the item of an id if it is the given one
+void CacheTrie::reset(const String& id, const CacheItem* item)
+{
+    if (!(m_count && id))
+	return;
+    // Remember the last node on path that must be kept and its child on path:
+    //  nodes below it have a single child and no item
+    u_int32_t keep = 0;
+    u_int32_t cut = 0;
+    u_int32_t idx = 0;
+    for (const char* s = id.c_str(); *s; s++) {
+	int sym = symbol(*s);
+	if (sym < 0)
+	    return;
+	u_int32_t parent = idx;
+	idx = child(parent,sym);
+	if (!idx)
+	    return;
+	Node& p = node(parent);
+	if (!parent || p.item || (node(p.child).next & TRIE_INDEX_MASK)) {
+	    keep = parent;
+	    cut = idx;
+	}
+    }
+    Node& n = node(idx);
+    if (n.item != item)
+	return;
+    n.item = 0;
+    if (n.child)
+	return;
+    // Unlink the unused branch from its parent and release its nodes
+    u_int32_t next = node(cut).next & TRIE_INDEX_MASK;
+    u_int32_t crt = node(keep).child;
+    if (crt == cut)
+	node(keep).child = next;
+    else {
+	while (crt && (node(crt).next & TRIE_INDEX_MASK) != cut)
+	    crt = node(crt).next & TRIE_INDEX_MASK;
+	if (crt)
+	    node(crt).next = (node(crt).next & ~TRIE_INDEX_MASK) | next;
+    }
+    while (cut) {
+	next = node(cut).child;
+	release(cut);
+	cut = next;
+    }
+}
+
+// Find an item matching id or its longest prefix not shorter than minLen
+bool CacheTrie::find(const String& id, unsigned int minLen, CacheItem*& item) const
+{
+    item = 0;
+    unsigned int len = id.length();
+    unsigned int depth = 0;
+    bool walk = (m_count != 0);
+    u_int32_t idx = 0;
+    for (const char* s = id.c_str(); *s; s++) {
+	int sym = symbol(*s);
+	if (sym < 0)
+	    return false;
+	// Keep checking symbols after the path ended: we must not report
+	//  a miss for an id that may be held by the hash list only
+	if (!walk)
+	    continue;
+	idx = child(idx,sym);
+	if (!idx) {
+	    walk = false;
+	    continue;
+	}
+	depth++;
+	CacheItem* it = node(idx).item;
+	if (it && (depth == len || (minLen && depth >= minLen)))
+	    item = it;
+    }
+    return len != 0;
+}
+
+// Make room for a number of nodes to be added
+void CacheTrie::reserve(unsigned int count)
+{
+    count = (count > m_freeCount) ? (count - m_freeCount) : 0;
+    if (count > TRIE_MAX_NODES - m_count)
+	count = TRIE_MAX_NODES - m_count;
+    unsigned int pages = (m_count + count + TRIE_PAGE_SIZE - 1) >> TRIE_PAGE_BITS;
+    if (pages <= m_pages)
+	return;
+    if (pages > m_alloc) {
+	// Grow page pointers array by at least 1/8 to avoid copying it too often
+	unsigned int alloc = m_alloc + m_alloc / 8 + 16;
+	if (alloc < pages)
+	    alloc = pages;
+	Node** nodes = new Node*[alloc];
+	for (unsigned int i = 0; i < m_pages; i++)
+	    nodes[i] = m_nodes[i];
+	delete[] m_nodes;
+	m_nodes = nodes;
+	m_alloc = alloc;
+    }
+    while (m_pages < pages)
+	m_nodes[m_pages++] = new Node[TRIE_PAGE_SIZE];
+}
+
+// Release all nodes
+void CacheTrie::clear()
+{
+    for (unsigned int i = 0; i < m_pages; i++)
+	delete[] m_nodes[i];
+    delete[] m_nodes;
+    m_nodes = 0;
+    m_pages = 0;
+    m_alloc = 0;
+    m_count = 0;
+    m_free = 0;
+    m_freeCount = 0;
+}
+
+// Find the child of a node with a given symbol, return 0 if not found
+u_int32_t CacheTrie::child(u_int32_t idx, int sym) const
+{
+    for (u_int32_t crt = node(idx).child; crt; crt = node(crt).next & TRIE_INDEX_MASK) {
+	int s = (int)(node(crt).next >> TRIE_SYMBOL_SHIFT);
+	if (s == sym)
+	    return crt;
+	if (s > sym)
+	    break;
+    }
+    return 0;
+}
+
+// Allocate a node, return 0 if the trie is full
+u_int32_t CacheTrie::alloc(int sym)
+{
+    u_int32_t idx = m_free;
+    if (idx) {
+	m_free = node(idx).child;
+	m_freeCount--;
+    }
+    else {
+	if (m_count >= TRIE_MAX_NODES)
+	    return 0;
+	if (m_count >= (m_pages << TRIE_PAGE_BITS))
+	    reserve(1);
+	idx = m_count++;
+    }
+    Node& n = node(idx);
+    n.child = 0;
+    n.next = (u_int32_t)sym << TRIE_SYMBOL_SHIFT;
+    n.item = 0;
+    return idx;
+}
+
+// Put a node in the free list
+void CacheTrie::release(u_int32_t idx)
+{
+    Node& n = node(idx);
+    n.child = m_free;
+    n.next = 0;
+    n.item = 0;
+    m_free = idx;
+    m_freeCount++;
+}
+
+
 /*
  * Cache
  */
 Cache::Cache(const String& name, int size, const NamedList& params)
     : Mutex(false,"Cache"),
-    m_name(name), m_list(size), m_cacheTtl(0), m_count(0), m_limit(0),
+    m_name(name), m_list(size), m_size(m_list.length()), m_trie(0), m_hits(0), m_misses(0), m_cacheTtl(0), m_count(0), m_limit(0),
     m_limitOverflow(0), m_loadChunk(0), m_prefixMin(0), m_prefixMask(0),
     m_loadPrio(Thread::Normal),
     m_loading(false), m_loadInterval(0), m_nextLoad(0),
-    m_reload(0), m_reloadItems(0)
+    m_reload(0), m_reloadItems(0),
+    m_loaders(0), m_loadItemThreads(1), m_loadItemBatch(1), m_loadItemInterval(0),
+    m_loadItemWait(0)
 
 {
     Debug(&__plugin,DebugInfo,"Cache(%s) size=%u [%p]",
@@ -493,39 +880,38 @@ void Cache::endLoad(bool triggerReload)
 // Copy params from cache item. Return true if found
 bool Cache::copyParams(const String& id, NamedList& list, const String* cpParams)
 {
-    lock();
+    Lock lck(this);
     CacheItem* item = findPrefix(id);
-    if (!item && m_account && m_queryLoadItem) {
-	// Load from database
-	String query = m_queryLoadItem;
-	NamedList p("");
-	p.addParam("id",id);
-	p.replaceParams(query);
-	Message m("database");
-	m.addParam("account",m_account);
-	m.addParam("query",query);
-	unlock();
-	bool ok = Engine::dispatch(m);
-	lock();
-	const char* error = m.getValue("error");
-	if (ok && !error) {
-	    Array* a = static_cast<Array*>(m.userObject(YATOM("Array")));
-	    int rows = a ? a->getRows() : 0;
-	    if (rows > 0)
-		item = addUnsafe(*a,1,a->getColumns());
-	    else
-		DDebug(&__plugin,DebugAll,"Cache(%s) item '%s' not found in database [%p]",
-		    m_name.c_str(),id.c_str(),this);
-	}
-	else
-	    Debug(&__plugin,DebugNote,"Cache(%s) failed to load item '%s' %s [%p]",
-		m_name.c_str(),id.c_str(),TelEngine::c_safe(error),this);
+    if (item)
+	m_hits++;
+    else
+	m_misses++;
+    if (!item && id && m_account && (m_queryLoadItem || m_queryLoadItems)) {
+	// Load from database, share the request with other threads missing the same id
+	// The message is not suspended, this thread blocks for at most loaditem_wait
+	bool start = false;
+	RefPointer<CacheLoadRequest> req = requestLoad(id,start);
+	long wait = m_loadItemWait;
+	if (wait)
+	    req->m_waiters++;
+	lck.drop();
+	if (start)
+	    startLoader();
+	bool ok = !wait || req->m_semaphore.lock(wait);
+	lck.acquire(this);
+	if (wait && !ok && !req->m_done)
+	    req->m_waiters--;
+	if (req->m_done)
+	    item = findPrefix(id);
+	if (!item)
+	    DDebug(&__plugin,DebugAll,"Cache(%s) item '%s' not loaded from database%s [%p]",
+		m_name.c_str(),id.c_str(),(req->m_done ? "" : " (pending)"),this);
+	req = 0;
     }
     if (item) {
 	list.copyParams(*item,!cpParams ? m_copyParams : *cpParams);
 	dumpItem(*this,*item,"found in cache");
     }
-    unlock();
     return item != 0;
 }
 
@@ -616,7 +1002,7 @@ void Cache::expire(const Time& time)
     for (unsigned int i = 0; i < m_list.length(); i++) {
 	if (exiting())
 	    break;
-	ObjList* list = m_list.getHashList(i);
+	ObjList* list = m_list.getList(i);
 	if (list)
 	    list = list->skipNull();
 	// Stop when found a non timed out item:
@@ -626,6 +1012,7 @@ void Cache::expire(const Time& time)
 	    if (!item->timeout(time))
 		break;
 	    dumpItem(*this,*item,"removing timed out");
+	    unindexItem(item);
 	    list->remove();
 	    m_count--;
 	}
@@ -661,6 +1048,9 @@ unsigned int Cache::addRows(Array& array)
     String** titles = new String*[cols];
     lock();
     ObjList* params = m_copyParams.split(',',false);
+    // Each new item adds at least one trie node
+    if (m_trie)
+	m_trie->reserve(rows - 1);
     unlock();
     int colId = -1;
     for (int i = 0; i < cols; i++) {
@@ -726,6 +1116,8 @@ unsigned int Cache::clear()
 {
     Lock lck(this);
     m_list.clear();
+    if (m_trie)
+	m_trie->clear();
     unsigned int n = m_count;
     m_count = 0;
     m_prefixMask = 0;
@@ -745,6 +1137,7 @@ unsigned int Cache::remove(const String& id, bool regexp)
 	    return 0;
 	CacheItem* item = static_cast<CacheItem*>(gen);
 	dumpItem(*this,*item,"removed");
+	unindexItem(item);
 	m_count--;
 	TelEngine::destruct(item);
 	return 1;
@@ -752,7 +1145,7 @@ unsigned int Cache::remove(const String& id, bool regexp)
     unsigned int removed = 0;
     for (unsigned int i = 0; i < m_list.length(); i++) {
 	Lock lck(this);
-	ObjList* list = m_list.getHashList(i);
+	ObjList* list = m_list.getList(i);
 	if (list)
 	    list = list->skipNull();
 	while (list) {
@@ -762,6 +1155,7 @@ unsigned int Cache::remove(const String& id, bool regexp)
 		continue;
 	    }
 	    dumpItem(*this,*item,"removed");
+	    unindexItem(item);
 	    list->remove();
 	    list = list->skipNull();
 	    removed++;
@@ -782,6 +1176,72 @@ const String& Cache::toString() const
     return m_name;
 }
 
+// Load pending items from database until none is left
+void Cache::loadItems()
+{
+    while (true) {
+	ObjList reqs;
+	if (exiting()) {
+	    // Release waiters
+	    Lock lck(this);
+	    while (takeLoadRequests(reqs))
+		;
+	    completeLoadRequests(reqs);
+	    m_loaders--;
+	    return;
+	}
+	lock();
+	bool batch = m_queryLoadItems && m_loadItemBatch > 1;
+	unsigned int interval = batch ? m_loadItemInterval : 0;
+	unlock();
+	// Let other misses join the batch
+	if (interval)
+	    Thread::msleep(interval);
+	lock();
+	unsigned int n = takeLoadRequests(reqs);
+	if (!n) {
+	    m_loaders--;
+	    unlock();
+	    return;
+	}
+	String account = m_account;
+	String query;
+	NamedList p("");
+	if (n == 1 && m_queryLoadItem) {
+	    query = m_queryLoadItem;
+	    p.addParam("id",reqs.get()->toString());
+	}
+	else {
+	    query = m_queryLoadItems;
+	    String ids;
+	    for (ObjList* o = reqs.skipNull(); o; o = o->skipNext())
+		ids.append("'" + o->get()->toString().sqlEscape() + "'",",");
+	    p.addParam("ids",ids);
+	}
+	unlock();
+	p.replaceParams(query);
+	Message m("database");
+	m.addParam("account",account);
+	m.addParam("query",query);
+	bool ok = Engine::dispatch(m);
+	const char* error = m.getValue("error");
+	unsigned int added = 0;
+	if (ok && !error) {
+	    Array* a = static_cast<Array*>(m.userObject(YATOM("Array")));
+	    if (a)
+		added = addRows(*a);
+	}
+	else
+	    Debug(&__plugin,DebugNote,"Cache(%s) failed to load %u item(s) %s [%p]",
+		m_name.c_str(),n,TelEngine::c_safe(error),this);
+	Debug(&__plugin,DebugAll,"Cache(%s) loaded %u row(s) for %u requested item(s) [%p]",
+	    m_name.c_str(),added,n,this);
+	lock();
+	completeLoadRequests(reqs);
+	unlock();
+    }
+}
+
 // Dump the cache to output if XDEBUG is defined
 void Cache::dump(const char* oper)
 {
@@ -793,7 +1253,7 @@ void Cache::dump(const char* oper)
     unsigned int n = 0;
     int64_t now = (int64_t)Time::now();
     for (unsigned int i = 0; i < m_list.length(); i++) {
-	ObjList* list = m_list.getHashList(i);
+	ObjList* list = m_list.getList(i);
 	if (list)
 	    list = list->skipNull();
 	String rowData;
@@ -831,6 +1291,10 @@ void Cache::destroyed()
 {
     Debug(&__plugin,DebugInfo,"Cache(%s) destroyed [%p]",m_name.c_str(),this);
     clear();
+    setIndex(false);
+    for (ObjList* o = m_loadRequests.skipNull(); o; o = o->skipNext())
+	static_cast<CacheLoadRequest*>(o->get())->done();
+    m_loadRequests.clear();
     TelEngine::destruct(m_reloadItems);
     RefObject::destroyed();
 }
@@ -847,7 +1311,8 @@ void Cache::doUpdate(const NamedList& params, bool first)
 	int ttl = safeValue(params.getIntValue("ttl",s_cacheTtlSec));
 	m_cacheTtl = (u_int64_t)adjustedCacheTtl(ttl) * 1000000;
     }
-    m_limit = adjustedCacheLimit(params.getIntValue("limit",s_limit),m_list.length());
+    m_limit = adjustedCacheLimit(params.getIntValue("limit",s_limit),m_size);
+    m_list.setMaxLoad(params.getIntValue("max_load",s_maxLoad,0,1024));
     if (m_limit)
 	m_limitOverflow = m_limit + (m_limit / 100);
     else
@@ -861,6 +1326,11 @@ void Cache::doUpdate(const NamedList& params, bool first)
     m_queryLoadCache = params.getValue("query_loadcache");
     m_queryLoadItem = params.getValue("query_loaditem");
     m_queryLoadItemCmd = params.getValue("query_loaditem_command",m_queryLoadItem);
+    m_queryLoadItems = params.getValue("query_loaditems");
+    m_loadItemWait = (long)params.getIntValue("loaditem_wait",2000,0,60000) * 1000;
+    m_loadItemBatch = params.getIntValue("loaditem_batch",50,1,LOADITEM_BATCH_MAX);
+    m_loadItemInterval = params.getIntValue("loaditem_batch_interval",5,0,1000);
+    m_loadItemThreads = params.getIntValue("loaditem_threads",4,1,LOADITEM_THREADS_MAX);
     m_querySave = params.getValue("query_save");
     m_queryExpire = params.getValue("query_expire");
     // Minimum sanity check for cache load
@@ -884,6 +1354,7 @@ void Cache::doUpdate(const NamedList& params, bool first)
     m_prefixMin = params.getIntValue("shortest_prefix",0);
     if (m_prefixMin > 32)
 	m_prefixMin = 32;
+    setIndex(params[YSTRING("index")] == YSTRING("trie"));
     String all;
 #ifdef DEBUG
     if (m_account) {
@@ -894,15 +1365,20 @@ void Cache::doUpdate(const NamedList& params, bool first)
 	all << " query_loadcache=" << m_queryLoadCache;
 	all << " query_loaditem=" << m_queryLoadItem;
 	all << " query_loaditem_command=" << m_queryLoadItemCmd;
+	all << " query_loaditems=" << m_queryLoadItems;
+	all << " loaditem_wait=" << (unsigned int)(m_loadItemWait / 1000);
+	all << " loaditem_batch=" << m_loadItemBatch;
+	all << " loaditem_batch_interval=" << m_loadItemInterval;
+	all << " loaditem_threads=" << m_loadItemThreads;
 	all << " query_save=" << m_querySave;
 	all << " query_expire=" << m_queryExpire;
 	all << " shortest_prefix=" << m_prefixMin;
     }
 #endif
     Debug(&__plugin,DebugInfo,
-	"Cache(%s) updated ttl=%u limit=%u reload_interval=%u copyparams='%s'%s [%p]",
+	"Cache(%s) updated ttl=%u limit=%u reload_interval=%u index=%s copyparams='%s'%s [%p]",
 	m_name.c_str(),(unsigned int)(m_cacheTtl / 1000000),m_limit,m_loadInterval,
-	m_copyParams.safe(),all.safe(),this);
+	(m_trie ? "trie" : "hash"),m_copyParams.safe(),all.safe(),this);
 }
 
 // Add an item to the cache. Remove an existing one
@@ -912,7 +1388,7 @@ CacheItem* Cache::addUnsafe(const String& id, const NamedList& params, const Str
     XDebug(&__plugin,DebugAll,"Cache::add(%s,%p,'%s',%u) [%p]",
 	id.c_str(),&params,TelEngine::c_safe(cpParams),dbSave,this);
     unsigned int idx = index(id);
-    ObjList* list = m_list.getHashList(idx);
+    ObjList* list = m_list.getList(idx);
     if (list)
 	list = list->skipNull();
     u_int64_t expires = m_cacheTtl;
@@ -971,6 +1447,10 @@ CacheItem* Cache::addUnsafe(const String& id, const NamedList& params, const Str
 	list->append(item);
     else
 	m_list.append(item);
+    // Items inserted directly in lists are not seen by the hash list
+    if (insert || list)
+	m_list.checkLoad();
+    indexItem(item);
     unsigned int len = id.length();
     if (len > 0 && len <= 32)
 	m_prefixMask |= (1 << (len - 1));
@@ -1025,7 +1505,11 @@ CacheItem* Cache::find(const String& id)
 // Find a cache item or prefix. This method is not thread safe
 CacheItem* Cache::findPrefix(const String& id)
 {
-    CacheItem* it = find(id);
+    CacheItem* it = 0;
+    // The trie holds all ids it can index: its answer is final for them
+    if (m_trie && m_trie->find(id,m_prefixMin,it))
+	return it;
+    it = find(id);
     if (it || !m_prefixMin)
 	return it;
     unsigned int len = id.length();
@@ -1054,7 +1538,7 @@ void Cache::adjustToLimit(CacheItem* skipAdded)
     while (m_count > m_limit) {
 	CacheItem* found = 0;
 	for (unsigned int i = 0; i < m_list.length(); i++) {
-	    ObjList* list = m_list.getHashList(i);
+	    ObjList* list = m_list.getList(i);
 	    if (list)
 		list = list->skipNull();
 	    CacheItem* item = list ? static_cast<CacheItem*>(list->get()) : 0;
@@ -1065,6 +1549,7 @@ void Cache::adjustToLimit(CacheItem* skipAdded)
 	}
 	if (found) {
 	    dumpItem(*this,*found,"removing oldest");
+	    unindexItem(found);
 	    m_list.remove(found);
 	    m_count--;
 	    continue;
@@ -1077,6 +1562,102 @@ void Cache::adjustToLimit(CacheItem* skipAdded)
     }
 }
 
+// Add an item to the prefix trie, if any
+void Cache::indexItem(CacheItem* item)
+{
+    if (!m_trie || m_trie->set(item->toString(),item) || !CacheTrie::indexable(item->toString()))
+	return;
+    Debug(&__plugin,DebugWarn,"Cache(%s) prefix trie is full, using hash lookup [%p]",
+	m_name.c_str(),this);
+    setIndex(false);
+}
+
+// Retrieve or queue a database load request for an item
+CacheLoadRequest* Cache::requestLoad(const String& id, bool& start)
+{
+    CacheLoadRequest* req = static_cast<CacheLoadRequest*>(m_loadRequests[id]);
+    start = false;
+    if (req) {
+	XDebug(&__plugin,DebugAll,"Cache(%s) item '%s' load already requested [%p]",
+	    m_name.c_str(),id.c_str(),this);
+	return req;
+    }
+    req = new CacheLoadRequest(id);
+    m_loadRequests.append(req);
+    if (m_loaders < m_loadItemThreads) {
+	m_loaders++;
+	start = true;
+    }
+    return req;
+}
+
+// Start a load thread for queued items
+void Cache::startLoader()
+{
+    lock();
+    Thread::Priority prio = m_loadPrio;
+    unlock();
+    CacheItemLoadThread* th = new CacheItemLoadThread(this,prio);
+    if (th->startup())
+	return;
+    Debug(&__plugin,DebugWarn,"Cache(%s) failed to start item load thread [%p]",
+	m_name.c_str(),this);
+    delete th;
+    Lock lck(this);
+    m_loaders--;
+}
+
+// Take queued load requests
+unsigned int Cache::takeLoadRequests(ObjList& dest)
+{
+    unsigned int max = m_queryLoadItems ? m_loadItemBatch : 1;
+    unsigned int n = 0;
+    for (ObjList* o = m_loadRequests.skipNull(); o && n < max; o = o->skipNext()) {
+	CacheLoadRequest* req = static_cast<CacheLoadRequest*>(o->get());
+	if (req->m_sent || !req->ref())
+	    continue;
+	req->m_sent = true;
+	dest.append(req);
+	n++;
+    }
+    return n;
+}
+
+// Complete load requests
+void Cache::completeLoadRequests(ObjList& list)
+{
+    for (ObjList* o = list.skipNull(); o; o = o->skipNext()) {
+	CacheLoadRequest* req = static_cast<CacheLoadRequest*>(o->get());
+	req->done();
+	m_loadRequests.remove(req);
+    }
+    list.clear();
+}
+
+// Build or release the prefix trie
+void Cache::setIndex(bool trie)
+{
+    if (trie == (m_trie != 0))
+	return;
+    if (!trie) {
+	delete m_trie;
+	m_trie = 0;
+	return;
+    }
+    m_trie = new CacheTrie;
+    unsigned int n = 0;
+    for (unsigned int i = 0; m_trie && i < m_list.length(); i++) {
+	ObjList* list = m_list.getList(i);
+	for (list = list ? list->skipNull() : 0; m_trie && list; list = list->skipNext()) {
+	    indexItem(static_cast<CacheItem*>(list->get()));
+	    n++;
+	}
+    }
+    if (m_trie)
+	Debug(&__plugin,DebugInfo,"Cache(%s) built prefix trie items=%u nodes=%u memory=" FMT64U " [%p]",
+	    m_name.c_str(),n,m_trie->nodes(),m_trie->memory(),this);
+}
+
 
 /*
  * CacheThread
@@ -1138,6 +1719,20 @@ void CacheLoadThread::run()
 }
 
 
+/*
+ * CacheItemLoadThread
+ */
+void CacheItemLoadThread::run()
+{
+    Debug(&__plugin,DebugAll,"%s start running cache=%s [%p]",
+	currentName(),m_cache->toString().c_str(),this);
+    m_cache->loadItems();
+    Debug(&__plugin,DebugAll,"%s stopped cache=%s [%p]",
+	currentName(),m_cache->toString().c_str(),this);
+    m_cache = 0;
+}
+
+
 /*
  * EngineHandler
  */
@@ -1360,6 +1955,7 @@ void CacheModule::initialize()
     // Globals
     s_size = adjustedCacheSize(cfg.getIntValue("general","size",17));
     s_limit = adjustedCacheLimit(cfg.getIntValue("general","limit",s_limit),s_size);
+    s_maxLoad = cfg.getIntValue("general","max_load",8,0,1024);
     s_loadChunk = adjustedCacheLoadChunk(cfg.getIntValue("general","loadchunk"));
     s_maxChunks = safeValue(cfg.getIntValue("general","maxchunks",1000));
     if (!s_maxChunks)
@@ -1467,7 +2063,7 @@ bool CacheModule::received(Message& msg, int id)
 
 void CacheModule::statusModule(String& buf)
 {
-    static const String s_params = "format=Count";
+    static const String s_params = "format=Count|Hits|Misses|Memory|Lists|Longest|Nodes";
     Module::statusModule(buf);
     buf.append(s_params,",");
 }
@@ -1597,7 +2193,13 @@ void CacheModule::addCacheDetail(String& buf, Cache* cache)
     if (!cache)
 	return;
     Lock lock(cache);
-    buf.append(cache->toString() + "=" + String(cache->count()),";");
+    String tmp;
+    unsigned int longest = 0;
+    unsigned int lists = cache->listStats(longest);
+    tmp << cache->toString() << "=" << cache->count() << "|" << cache->hits() <<
+	"|" << cache->misses() << "|" << cache->indexMemory() << "|" << lists << "|" << longest <<
+	"|" << cache->indexNodes();
+    buf.append(tmp,";");
 }
 
 // Handle messages for LNP
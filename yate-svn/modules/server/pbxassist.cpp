@@ -323,7 +323,7 @@ void PBXList::chanReplaced(const String& initial, const String& final)
 	if (initial == n->name()) {
 	    Debug(this,DebugInfo,"In transfer '%s' replaced '%s' with '%s'",
 		n->c_str(),initial.c_str(),final.c_str());
-	    const_cast<String&>(n->name()) = final;
+	    n->rename(final);
 	}
 	if (initial == *n) {
 	    Debug(this,DebugInfo,"In transfer '%s' replaced '%s' with '%s'",
@@ -33,6 +33,7 @@ static ObjList s_handlers;
 
 static NamedList s_statusaccounts("StatusAccounts");
 static HashList s_fallbacklist;
+static Mutex s_fallbackMutex(false,"Register::fallback");
 
 class AAAHandler : public MessageHandler
 {
@@ -309,8 +310,10 @@ static bool copyParams(Message &msg, Array *a, const String& resultName)
     if (fallback) {
 	Message mlocate("chan.locate");
 	mlocate.addParam("id",msg.getValue("id"));
-	if (static_cast<CallEndpoint*>(Engine::dispatch(mlocate) ? mlocate.userData() : 0))
+	if (static_cast<CallEndpoint*>(Engine::dispatch(mlocate) ? mlocate.userData() : 0)) {
+	    Lock lock(s_fallbackMutex);
 	    s_fallbacklist.append(fallback);
+	}
 	else
 	    fallback->destruct();
     }
@@ -1029,6 +1032,8 @@ void RegistModule::initialize()
     Output("Initializing module Register for database");
     s_expire = s_cfg.getIntValue("general","expires",s_expire);
     s_errOffline = s_cfg.getBoolValue("call.route","offlineauto",true);
+    // Keep fallback lookups short when many calls are in progress
+    s_fallbacklist.setMaxLoad(4);
     Engine::install(new MessageRelay("engine.start",this,Private,150));
     addHandler("call.cdr",AAAHandler::Cdr);
     addHandler("linetracker",AAAHandler::Cdr);
@@ -1057,25 +1062,28 @@ bool FallBackHandler::received(Message &msg)
     {
 	case Answered:
 	{
+	    Lock lock(s_fallbackMutex);
 	    GenObject* route = s_fallbacklist[msg.getValue("targetid")];
-	    s_fallbacklist.remove(route);
+	    s_fallbacklist.remove(route,true,true);
 	    return false;
 	}
 	break;
 	case Hangup:
 	{
+	    Lock lock(s_fallbackMutex);
 	    GenObject* route = s_fallbacklist[msg.getValue("id")];
-	    s_fallbacklist.remove(route);
+	    s_fallbacklist.remove(route,true,true);
 	    return false;
 	}
 	break;
 	case Disconnect:
 	{
 	    String reason=msg.getValue("reason");
+	    Lock lock(s_fallbackMutex);
 	    if (m_stoperror && m_stoperror.matches(reason)) {
 		//stop fallback on this error
 		GenObject* route = s_fallbacklist[msg.getValue("id")];
-		s_fallbacklist.remove(route);
+		s_fallbacklist.remove(route,true,true);
 		return false;
 	    }
 
@@ -1087,7 +1095,7 @@ bool FallBackHandler::received(Message &msg)
 		    Engine::enqueue(r);
 		    return true;
 		}
-		s_fallbacklist.remove(route);
+		s_fallbacklist.remove(route,true,true);
 	    }
 	    return false;
 	}
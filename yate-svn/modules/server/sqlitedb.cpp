@@ -22,17 +22,43 @@
 #include <yatephone.h>
 
 #include <stdio.h>
+#include <string.h>
+#include <ctype.h>
 #include <sqlite3.h>
 
 using namespace TelEngine;
 namespace { // anonymous
 
+// Maximum number of prepared statements kept by a connection
+#define STMT_CACHE_MAX 256
+// Query time histogram: 4 buckets for each power of 2 microseconds, up to about 67s
+#define LATENCY_BUCKETS 100
+
 class SqlConn;
 
 static ObjList s_accounts;
 Mutex s_conmutex(false,"SQLite::acc");
 static unsigned int s_failedConns;
 static bool s_sharedCache = false;
+static unsigned int s_batchTick = 0;
+
+static const TokenDict s_journalModes[] = {
+    { "delete",   1 },
+    { "truncate", 2 },
+    { "persist",  3 },
+    { "memory",   4 },
+    { "wal",      5 },
+    { "off",      6 },
+    { 0, 0 },
+};
+
+static const TokenDict s_syncModes[] = {
+    { "off",    1 },
+    { "normal", 2 },
+    { "full",   3 },
+    { "extra",  4 },
+    { 0, 0 },
+};
 
 // Database account holding the connection(s)
 class SqlAccount : public RefObject, public Mutex
@@ -45,6 +71,8 @@ public:
     // Make a query
     int queryDb(const char* query, Message* dest);
     bool hasConn();
+    // Commit batched writes older than the batch interval
+    void flushBatch(u_int64_t now);
     virtual const String& toString() const
 	{ return m_name; }
     virtual void destroyed();
@@ -57,6 +85,11 @@ public:
 	{ return m_errorQueries; }
     inline unsigned int queryTime()
         { return (unsigned int) m_queryTime; }
+    // Retrieve a query time percentile in microseconds
+    unsigned int latency(unsigned int percent);
+    // Retrieve the write batch interval in milliseconds, 0 if not batching
+    inline unsigned int batchInterval() const
+	{ return m_batchRows ? (unsigned int)(m_batchInterval / 1000) : 0; }
 
 protected:
     inline void incErrorQueriesSafe() {
@@ -74,12 +107,30 @@ private:
     u_int64_t m_timeout;
     SqlConn* m_connPool;
     unsigned int m_connPoolSize;
+    unsigned int m_stmtCacheSize;
+    unsigned int m_batchRows;
+    u_int64_t m_batchInterval;
+    const char* m_journalMode;
+    const char* m_syncMode;
     // stat counters
     Mutex* m_statsMutex;
     unsigned int m_totalQueries;
     unsigned int m_failedQueries;
     unsigned int m_errorQueries;
     u_int64_t m_queryTime;
+    unsigned int m_latency[LATENCY_BUCKETS];
+};
+
+// A prepared statement kept by a connection, the string holds the query text
+class SqlStmt : public String
+{
+public:
+    inline SqlStmt(const String& query, sqlite3_stmt* stmt)
+	: String(query), m_stmt(stmt)
+	{ }
+    ~SqlStmt()
+	{ sqlite3_finalize(m_stmt); }
+    sqlite3_stmt* m_stmt;
 };
 
 // A database connection
@@ -103,11 +154,33 @@ public:
     // Perform the query, fill the message with data, retry in case of errors
     // Return number of rows, -1 for non-retryable errors and -2 for busy / timeout
     int queryDb(const char* query, Message* dest);
+    // Commit the write batch transaction, if any
+    bool commitBatch();
     virtual void destruct();
 private:
+    // Run a statement without results, retry if busy
+    bool exec(const char* sql);
+    // Prepare a statement, retry if busy. Report errors if dest is not NULL
+    // Return 0 on success, -1 for errors and -2 for busy / timeout
+    int prepare(const char* query, sqlite3_stmt*& stmt, const char*& tail, Message* dest);
+    // Execute a prepared statement, collect results, reset the statement when done
+    // Return 0 on success, -1 for non-retryable errors and -2 for busy / timeout
+    int execute(sqlite3_stmt* stmt, const char* query, Message* dest, bool results,
+	int& rows, int& cols);
+    // Run a single statement using the prepared statement cache
+    // Return -3 if the statement can't be cached
+    int queryCached(const char* text, const String& query, const ObjList& values,
+	Message* dest, bool results, int& rows, int& cols);
+    // Prepare and run each statement in a query
+    int querySimple(const char* query, Message* dest, bool results, int& rows, int& cols);
+
     SqlAccount* m_account;
     bool m_busy;
     sqlite3* m_conn;
+    ObjList m_stmts;                     // Prepared statements, most recently used first
+    unsigned int m_stmtCount;            // Number of prepared statements
+    unsigned int m_batch;                // Number of writes in batch transaction
+    u_int64_t m_batchStart;              // Batch transaction start time, 0 if none
 };
 
 class SqlModule : public Module
@@ -137,13 +210,173 @@ public:
     virtual bool received(Message& msg);
 };
 
+// Commits write batches when their interval expires
+class SqlBatchThread : public Thread
+{
+public:
+    inline SqlBatchThread()
+	: Thread("SQLite Batch")
+	{ }
+    virtual void run();
+};
+
+
+// Query classes, by first keyword
+enum QueryKind {
+    QueryOther = 0,
+    QueryRead,
+    QueryWrite,
+};
+
+static inline bool isIdentChar(char c)
+{
+    return isalnum((unsigned char)c) || c == '_' || (c & 0x80);
+}
+
+// Classify a query by its first keyword
+static int queryKind(const char* query)
+{
+    if (!query)
+	return QueryOther;
+    while (*query && (isspace((unsigned char)*query) || *query == ';'))
+	query++;
+    const char* end = query;
+    while (isIdentChar(*end))
+	end++;
+    String word(query,end - query);
+    word.toUpper();
+    if (word == YSTRING("SELECT"))
+	return QueryRead;
+    if (word == YSTRING("INSERT") || word == YSTRING("UPDATE") ||
+	word == YSTRING("DELETE") || word == YSTRING("REPLACE"))
+	return QueryWrite;
+    return QueryOther;
+}
+
+// Build the text of a single SELECT/INSERT/UPDATE/DELETE/REPLACE statement having
+//  string literals replaced by parameters, store literal values in list
+// Return false if the query is not suitable for parameter binding
+static bool normalize(const char* query, String& norm, ObjList& values)
+{
+    if (queryKind(query) == QueryOther)
+	return false;
+    while (isspace((unsigned char)*query))
+	query++;
+    const char* start = query;
+    const char* s = query;
+    bool afterAs = false;
+    while (*s) {
+	char c = *s;
+	if (c == '\'') {
+	    // Leave unchanged blob literals and string aliases
+	    bool keep = afterAs || ((s > query) && (s[-1] == 'x' || s[-1] == 'X') &&
+		((s - 1) == query || !isIdentChar(s[-2])));
+	    String* val = keep ? 0 : new String;
+	    const char* lit = s;
+	    const char* seg = ++s;
+	    while (true) {
+		if (!*s) {
+		    TelEngine::destruct(val);
+		    return false;
+		}
+		if (*s != '\'') {
+		    s++;
+		    continue;
+		}
+		if (val)
+		    val->append(seg,s - seg);
+		if (s[1] != '\'')
+		    break;
+		if (val)
+		    *val << '\'';
+		s += 2;
+		seg = s;
+	    }
+	    s++;
+	    afterAs = false;
+	    if (!val)
+		continue;
+	    norm.append(start,lit - start);
+	    norm << "?";
+	    values.append(val);
+	    start = s;
+	    continue;
+	}
+	if (c == '"' || c == '`' || c == '[') {
+	    const char* end = ::strchr(s + 1,(c == '[') ? ']' : c);
+	    if (!end)
+		return false;
+	    s = end + 1;
+	    afterAs = false;
+	    continue;
+	}
+	if (c == '-' && s[1] == '-') {
+	    const char* end = ::strchr(s,'\n');
+	    s = end ? end : (s + ::strlen(s));
+	    continue;
+	}
+	if (c == '/' && s[1] == '*') {
+	    const char* end = ::strstr(s + 2,"*/");
+	    if (!end)
+		return false;
+	    s = end + 2;
+	    continue;
+	}
+	// Already using parameters
+	if (c == '?' || c == ':' || c == '@' || c == '$')
+	    return false;
+	if (c == ';') {
+	    // Allow trailing separators only
+	    for (const char* p = s; *p; p++)
+		if (*p != ';' && !isspace((unsigned char)*p))
+		    return false;
+	    break;
+	}
+	if (isIdentChar(c)) {
+	    const char* word = s;
+	    while (isIdentChar(*s))
+		s++;
+	    afterAs = ((s - word) == 2) && ((word[0] | 0x20) == 'a') && ((word[1] | 0x20) == 's');
+	    continue;
+	}
+	if (!isspace((unsigned char)c))
+	    afterAs = false;
+	s++;
+    }
+    norm.append(start,s - start);
+    return true;
+}
+
+// Retrieve the histogram bucket of a query time
+static unsigned int latencyBucket(u_int64_t usec)
+{
+    if (usec < 4)
+	return (unsigned int)usec;
+    unsigned int bit = 2;
+    while ((usec >> (bit + 1)) && bit < 63)
+	bit++;
+    unsigned int idx = (bit - 1) * 4 + (unsigned int)((usec >> (bit - 2)) & 3);
+    return (idx < LATENCY_BUCKETS) ? idx : (LATENCY_BUCKETS - 1);
+}
+
+// Retrieve the highest query time of a histogram bucket
+static unsigned int latencyLimit(unsigned int idx)
+{
+    if (idx < 4)
+	return idx;
+    unsigned int bit = idx / 4 + 1;
+    u_int64_t low = (u_int64_t)(4 + idx % 4) << (bit - 2);
+    return (unsigned int)(low + ((u_int64_t)1 << (bit - 2)) - 1);
+}
+
 
 //
 // SqlConn
 //
 SqlConn::SqlConn(SqlAccount* account)
     : m_account(account), m_busy(false),
-    m_conn(0)
+    m_conn(0), m_stmtCount(0),
+    m_batch(0), m_batchStart(0)
 {
 }
 
@@ -166,6 +399,10 @@ bool SqlConn::initDb()
 	dropDb();
 	return false;
     }
+    if (m_account->m_journalMode)
+	exec(String("PRAGMA journal_mode=") + m_account->m_journalMode);
+    if (m_account->m_syncMode)
+	exec(String("PRAGMA synchronous=") + m_account->m_syncMode);
     return true;
 }
 
@@ -174,6 +411,10 @@ void SqlConn::dropDb()
 {
     if (!m_conn)
 	return;
+    commitBatch();
+    // Prepared statements must be finalized before closing
+    m_stmts.clear();
+    m_stmtCount = 0;
     sqlite3* tmp = m_conn;
     m_conn = 0;
     XDebug(&module,DebugAll,"Database '%s' dropped [%p]",c_str(),m_account);
@@ -182,140 +423,289 @@ void SqlConn::dropDb()
 	    c_str(),sqlite3_errmsg(tmp));
 }
 
-// Perform the query, fill the message with data, retry in case of errors
-// Return number of rows, -1 for non-retryable errors and -2 for busy / timeout
-int SqlConn::queryDb(const char* query, Message* dest)
+// Run a statement without results, retry if busy
+bool SqlConn::exec(const char* sql)
 {
-    if (!initDb())
-	// no retry - initDb already tried and failed...
-	return -1;
-    bool results = dest && dest->getBoolValue("results",true);
-    int changed = sqlite3_total_changes(m_conn);
-    int rows = 0;
-    int cols = -1;
-
-    while (query) {
-	while (';' == *query || ' ' == *query || '\t' == *query || '\r' == *query || '\n' == *query)
-	    query++;
-	if (!*query)
-	    break;
-	int retry = retries();
-	sqlite3_stmt* stmt;
-	const char* tail;
-	int i;
-	// Prepare statement, leave whatever unparsed in tail
-	for (i = 0; i >= 0; i++) {
-	    if (i)
-		Thread::idle();
-	    stmt = 0;
-	    tail = 0;
-	    switch (sqlite3_prepare_v2(m_conn,query,-1,&stmt,&tail)) {
-		case SQLITE_OK:
-		    i = -2;
-		    break;
-		case SQLITE_BUSY:
-		case SQLITE_LOCKED:
-		    sqlite3_finalize(stmt);
-		    if (i >= retry)
-			return -2;
+    int retry = retries();
+    for (int i = 0; ; i++) {
+	if (i)
+	    Thread::idle();
+	switch (sqlite3_exec(m_conn,sql,0,0,0)) {
+	    case SQLITE_OK:
+		return true;
+	    case SQLITE_BUSY:
+	    case SQLITE_LOCKED:
+		if (i < retry)
 		    continue;
-		default:
-		    {
-			const char* errStr = sqlite3_errmsg(m_conn);
-			Debug(&module,DebugWarn,"Query '%s' for '%s' prepare error: %s [%p]",
-			    query,c_str(),errStr,m_account);
-			if (dest)
-			    dest->setParam("error",errStr);
-		    }
-		    sqlite3_finalize(stmt);
-		    if (results)
-			dest->userData(0);
-		    return -1;
-	    }
+		// fall through
+	    default:
+		Debug(&module,DebugWarn,"Query '%s' for '%s' failed: %s [%p]",
+		    sql,c_str(),sqlite3_errmsg(m_conn),m_account);
+		return false;
 	}
-	int lr = 0;
-	int lc = 0;
-	Array* a = 0;
-	// Execute statement, collect results if needed
-	for (i = 0; i >= 0; ) {
-	    if (i)
-		Thread::idle();
-	    switch (sqlite3_step(stmt)) {
-		case SQLITE_DONE:
-		    if (lr || !rows) {
-			rows = lr;
-			cols = lc;
-			if (results) {
-			    dest->userData(a);
-			    a = 0;
-			}
-		    }
-		    i = -2;
-		    break;
-		case SQLITE_ROW:
-		    if (!lr++)
-			lc = sqlite3_column_count(stmt);
-		    if (!results)
-			continue;
-		    if (!a) {
-			a = new Array(lc,2);
-			for (int j = 0; j < lc; j++)
-			    a->set(new String(sqlite3_column_name(stmt,j)),j,0);
-		    }
-		    else
-			a->addRow();
-		    for (int j = 0; j < lc; j++) {
-			GenObject* v = 0;
-			switch (sqlite3_column_type(stmt,j)) {
-			    case SQLITE_NULL:
-				break;
-			    case SQLITE_BLOB:
-				{
-				    // Must do this in two steps to guarantee call order
-				    void* data = const_cast<void*>(sqlite3_column_blob(stmt,j));
-				    v = new DataBlock(data,sqlite3_column_bytes(stmt,j));
-				}
-				break;
-			    default:
-				v = new String(reinterpret_cast<const char*>(sqlite3_column_text(stmt,j)));
-			}
-			a->set(v,j,lr);
-		    }
-		    continue;
-		case SQLITE_BUSY:
-		case SQLITE_LOCKED:
-		    if (i++ >= retry) {
-			sqlite3_reset(stmt);
-			sqlite3_finalize(stmt);
-			TelEngine::destruct(a);
-			if (results)
-			    dest->userData(0);
-			return -2;
+    }
+}
+
+// Commit the write batch transaction, if any
+bool SqlConn::commitBatch()
+{
+    if (!m_batchStart)
+	return true;
+    if (!m_conn || sqlite3_get_autocommit(m_conn)) {
+	if (m_batch)
+	    Debug(&module,DebugWarn,"'%s' lost %u batched write(s) [%p]",
+		c_str(),m_batch,m_account);
+	m_batch = 0;
+	m_batchStart = 0;
+	return false;
+    }
+    // Keep the transaction on failure, it will be retried later
+    if (!exec("COMMIT"))
+	return false;
+    XDebug(&module,DebugAll,"'%s' committed %u batched write(s) [%p]",
+	c_str(),m_batch,m_account);
+    m_batch = 0;
+    m_batchStart = 0;
+    return true;
+}
+
+// Prepare a statement, retry if busy
+int SqlConn::prepare(const char* query, sqlite3_stmt*& stmt, const char*& tail, Message* dest)
+{
+    int retry = retries();
+    for (int i = 0; ; i++) {
+	if (i)
+	    Thread::idle();
+	stmt = 0;
+	tail = 0;
+	switch (sqlite3_prepare_v2(m_conn,query,-1,&stmt,&tail)) {
+	    case SQLITE_OK:
+		return 0;
+	    case SQLITE_BUSY:
+	    case SQLITE_LOCKED:
+		sqlite3_finalize(stmt);
+		if (i >= retry)
+		    return -2;
+		continue;
+	    default:
+		if (dest) {
+		    const char* errStr = sqlite3_errmsg(m_conn);
+		    Debug(&module,DebugWarn,"Query '%s' for '%s' prepare error: %s [%p]",
+			query,c_str(),errStr,m_account);
+		    dest->setParam("error",errStr);
+		}
+		sqlite3_finalize(stmt);
+		stmt = 0;
+		return -1;
+	}
+    }
+}
+
+// Execute a prepared statement, collect results, reset the statement when done
+int SqlConn::execute(sqlite3_stmt* stmt, const char* query, Message* dest, bool results,
+    int& rows, int& cols)
+{
+    int retry = retries();
+    int lr = 0;
+    int lc = 0;
+    Array* a = 0;
+    for (int i = 0; ; ) {
+	if (i)
+	    Thread::idle();
+	switch (sqlite3_step(stmt)) {
+	    case SQLITE_DONE:
+		if (lr || !rows) {
+		    rows = lr;
+		    cols = lc;
+		    if (results) {
+			dest->userData(a);
+			a = 0;
 		    }
+		}
+		sqlite3_reset(stmt);
+		TelEngine::destruct(a);
+		return 0;
+	    case SQLITE_ROW:
+		if (!lr++)
+		    lc = sqlite3_column_count(stmt);
+		if (!results)
 		    continue;
-		default:
-		    {
-			const char* errStr = sqlite3_errmsg(m_conn);
-			Debug(&module,DebugWarn,"Query '%s' for '%s' execute error: %s [%p]",
-			    query,c_str(),errStr,m_account);
-			if (dest)
-			    dest->setParam("error",errStr);
+		if (!a) {
+		    a = new Array(lc,2);
+		    for (int j = 0; j < lc; j++)
+			a->set(new String(sqlite3_column_name(stmt,j)),j,0);
+		}
+		else
+		    a->addRow();
+		for (int j = 0; j < lc; j++) {
+		    GenObject* v = 0;
+		    switch (sqlite3_column_type(stmt,j)) {
+			case SQLITE_NULL:
+			    break;
+			case SQLITE_BLOB:
+			    {
+				// Must do this in two steps to guarantee call order
+				void* data = const_cast<void*>(sqlite3_column_blob(stmt,j));
+				v = new DataBlock(data,sqlite3_column_bytes(stmt,j));
+			    }
+			    break;
+			default:
+			    v = new String(reinterpret_cast<const char*>(sqlite3_column_text(stmt,j)));
 		    }
+		    a->set(v,j,lr);
+		}
+		continue;
+	    case SQLITE_BUSY:
+	    case SQLITE_LOCKED:
+		if (i++ >= retry) {
 		    sqlite3_reset(stmt);
-		    sqlite3_finalize(stmt);
 		    TelEngine::destruct(a);
 		    if (results)
 			dest->userData(0);
-		    m_account->incErrorQueriesSafe();
-		    return -1;
-	    }
+		    return -2;
+		}
+		continue;
+	    default:
+		{
+		    const char* errStr = sqlite3_errmsg(m_conn);
+		    Debug(&module,DebugWarn,"Query '%s' for '%s' execute error: %s [%p]",
+			query,c_str(),errStr,m_account);
+		    if (dest)
+			dest->setParam("error",errStr);
+		}
+		sqlite3_reset(stmt);
+		TelEngine::destruct(a);
+		if (results)
+		    dest->userData(0);
+		m_account->incErrorQueriesSafe();
+		return -1;
 	}
+    }
+}
+
+// Run a single statement using the prepared statement cache
+int SqlConn::queryCached(const char* text, const String& query, const ObjList& values,
+    Message* dest, bool results, int& rows, int& cols)
+{
+    SqlStmt* st = 0;
+    ObjList* o = m_stmts.find(query);
+    if (o) {
+	st = static_cast<SqlStmt*>(o->remove(false));
+	m_stmts.insert(st);
+    }
+    else {
+	sqlite3_stmt* stmt = 0;
+	const char* tail = 0;
+	// Let the caller handle (and report) failures using the original query
+	if (prepare(query,stmt,tail,0) < 0)
+	    return -3;
+	bool ok = (sqlite3_bind_parameter_count(stmt) == (int)values.count());
+	while (ok && tail && *tail) {
+	    if (*tail != ';' && !isspace((unsigned char)*tail))
+		ok = false;
+	    tail++;
+	}
+	// Unnamed expressions are named by their text: parameters would change it
+	for (int i = sqlite3_column_count(stmt) - 1; ok && i >= 0; i--)
+	    ok = !::strchr(sqlite3_column_name(stmt,i),'?');
+	if (!ok) {
+	    DDebug(&module,DebugAll,"'%s' not caching query '%s' [%p]",
+		c_str(),query.c_str(),m_account);
+	    sqlite3_finalize(stmt);
+	    return -3;
+	}
+	st = new SqlStmt(query,stmt);
+	m_stmts.insert(st);
+	if (++m_stmtCount > m_account->m_stmtCacheSize) {
+	    GenObject* old = 0;
+	    for (ObjList* l = m_stmts.skipNull(); l; l = l->skipNext())
+		old = l->get();
+	    m_stmts.remove(old);
+	    m_stmtCount--;
+	}
+    }
+    int idx = 1;
+    for (ObjList* l = values.skipNull(); l; l = l->skipNext(), idx++) {
+	const String* val = static_cast<const String*>(l->get());
+	sqlite3_bind_text(st->m_stmt,idx,val->safe(),val->length(),SQLITE_STATIC);
+    }
+    int res = execute(st->m_stmt,text,dest,results,rows,cols);
+    sqlite3_clear_bindings(st->m_stmt);
+    if (res == -1) {
+	m_stmts.remove(st);
+	m_stmtCount--;
+    }
+    return res;
+}
+
+// Prepare and run each statement in a query
+int SqlConn::querySimple(const char* query, Message* dest, bool results, int& rows, int& cols)
+{
+    while (query) {
+	while (';' == *query || ' ' == *query || '\t' == *query || '\r' == *query || '\n' == *query)
+	    query++;
+	if (!*query)
+	    break;
+	sqlite3_stmt* stmt = 0;
+	const char* tail = 0;
+	// Prepare statement, leave whatever unparsed in tail
+	int res = prepare(query,stmt,tail,dest);
+	if (res < 0) {
+	    if (res == -1 && results)
+		dest->userData(0);
+	    return res;
+	}
+	// Execute statement, collect results if needed
+	res = execute(stmt,query,dest,results,rows,cols);
 	// Clean up statement and advance to next one
-	sqlite3_reset(stmt);
 	sqlite3_finalize(stmt);
-	TelEngine::destruct(a);
+	if (res < 0)
+	    return res;
 	query = tail;
     }
+    return 0;
+}
+
+// Perform the query, fill the message with data, retry in case of errors
+// Return number of rows, -1 for non-retryable errors and -2 for busy / timeout
+int SqlConn::queryDb(const char* query, Message* dest)
+{
+    if (!initDb())
+	// no retry - initDb already tried and failed...
+	return -1;
+    bool results = dest && dest->getBoolValue("results",true);
+    int changed = sqlite3_total_changes(m_conn);
+    int rows = 0;
+    int cols = -1;
+
+    String norm;
+    ObjList values;
+    bool single = (m_account->m_stmtCacheSize || m_account->m_batchRows) &&
+	normalize(query,norm,values);
+    // Single write statements are grouped in a transaction, other queries except
+    //  single reads must see the batch committed
+    bool batch = single && m_account->m_batchRows && (queryKind(query) == QueryWrite);
+    if (m_batchStart && !batch && !(single && queryKind(query) == QueryRead))
+	commitBatch();
+    if (batch && !m_batchStart) {
+	if (exec("BEGIN"))
+	    m_batchStart = Time::now();
+	else
+	    batch = false;
+    }
+    int res = -3;
+    if (single && m_account->m_stmtCacheSize)
+	res = queryCached(query,norm,values,dest,results,rows,cols);
+    if (res == -3)
+	res = querySimple(query,dest,results,rows,cols);
+    if (batch) {
+	if (res >= 0)
+	    m_batch++;
+	if (sqlite3_get_autocommit(m_conn) || m_batch >= m_account->m_batchRows)
+	    commitBatch();
+    }
+    if (res < 0)
+	return res;
     changed = sqlite3_total_changes(m_conn) - changed;
     if (dest) {
 	dest->setParam("rows",String(rows));
@@ -340,10 +730,13 @@ SqlAccount::SqlAccount(const NamedList& sect)
     : Mutex(true,"SqlAccount"),
       m_name(sect),
       m_connPool(0), m_connPoolSize(0),
+      m_stmtCacheSize(0), m_batchRows(0), m_batchInterval(0),
+      m_journalMode(0), m_syncMode(0),
       m_statsMutex(&s_conmutex),
       m_totalQueries(0), m_failedQueries(0),
       m_errorQueries(0), m_queryTime(0)
 {
+    ::memset(m_latency,0,sizeof(m_latency));
     m_database = sect.getValue("database",":memory:");
     Engine::runParams().replaceParams(m_database);
     m_initialize = sect.getValue("initialize");
@@ -376,6 +769,11 @@ SqlAccount::SqlAccount(const NamedList& sect)
     if (m_timeout < 100000)
 	m_timeout = 100000;
     m_retry = sect.getIntValue("retry",5,0,100,false);
+    m_stmtCacheSize = sect.getIntValue("stmt_cache",32,0,STMT_CACHE_MAX);
+    m_batchRows = sect.getIntValue("batch_writes",0,0,100000);
+    m_batchInterval = (u_int64_t)1000 * sect.getIntValue("batch_interval",100,1,10000);
+    m_journalMode = lookup(sect.getIntValue("journal_mode",s_journalModes),s_journalModes);
+    m_syncMode = lookup(sect.getIntValue("synchronous",s_syncModes),s_syncModes);
     // Can create just one connection to temporary or non shared cache in-memory databases
     bool shared = s_sharedCache && !m_database.null();
     shared = shared && (m_database.find(":memory:") < 0) && (m_database.find("mode=memory") < 0);
@@ -391,8 +789,8 @@ SqlAccount::SqlAccount(const NamedList& sect)
 	m_connPool[i].m_account = this;
 	m_connPool[i].assign(m_name + "." + String(i + 1));
     }
-    Debug(&module,DebugInfo,"Database account '%s' created poolsize=%u [%p]",
-	m_name.c_str(),m_connPoolSize,this);
+    Debug(&module,DebugInfo,"Database account '%s' created poolsize=%u stmt_cache=%u batch_writes=%u [%p]",
+	m_name.c_str(),m_connPoolSize,m_stmtCacheSize,m_batchRows,this);
 }
 
 // Init the connections for the account, run init query
@@ -439,6 +837,10 @@ int SqlAccount::queryDb(const char* query, Message* dest)
 	return -1;
     Debug(&module,DebugAll,"Performing query \"%s\" for '%s'",
 	query,m_name.c_str());
+    // When batching all but read queries use the first connection which holds the
+    //  write transaction
+    bool read = (queryKind(query) == QueryRead);
+    unsigned int pool = (m_batchRows && !read) ? 1 : m_connPoolSize;
     // Use a while() to break to the end to update statistics
     int res = -1;
     u_int64_t start = Time::now();
@@ -449,10 +851,13 @@ int SqlAccount::queryDb(const char* query, Message* dest)
 		m_name.c_str(),m_timeout);
 	    break;
 	}
+	// Reads must see the writes of an open batch which only its connection can
+	if (read && m_batchRows && m_connPoolSize && m_connPool[0].m_batchStart)
+	    pool = 1;
 	// Find a non busy connection
 	SqlConn* conn = 0;
 	SqlConn* notConnected = 0;
-	for (unsigned int i = 0; i < m_connPoolSize; i++) {
+	for (unsigned int i = 0; i < pool; i++) {
 	    if (m_connPool[i].isBusy())
 		continue;
 	    if (m_connPool[i].testDb()) {
@@ -469,7 +874,7 @@ int SqlAccount::queryDb(const char* query, Message* dest)
 	    // Round up the number of intervals to wait
 	    unsigned int n = (unsigned int)((m_timeout + 999999) / Thread::idleUsec());
 	    for (unsigned int i = 0; i < n; i++) {
-		for (unsigned int j = 0; j < m_connPoolSize; j++) {
+		for (unsigned int j = 0; j < pool; j++) {
 		    if (!m_connPool[j].isBusy() && m_connPool[j].testDb()) {
 			conn = &(m_connPool[j]);
 			break;
@@ -498,6 +903,7 @@ int SqlAccount::queryDb(const char* query, Message* dest)
 	    m_failedQueries++;
 	u_int64_t finish = Time::now() - start;
 	m_queryTime += finish;
+	m_latency[latencyBucket(finish)]++;
     }
     stats.drop();
     module.changed();
@@ -514,6 +920,41 @@ bool SqlAccount::hasConn()
     return false;
 }
 
+// Commit batched writes older than the batch interval
+void SqlAccount::flushBatch(u_int64_t now)
+{
+    if (!m_batchRows)
+	return;
+    Lock mylock(this,(long)Thread::idleUsec());
+    if (!(mylock.locked() && m_connPoolSize))
+	return;
+    SqlConn& conn = m_connPool[0];
+    if (conn.isBusy() || !conn.m_batchStart || (conn.m_batchStart + m_batchInterval > now))
+	return;
+    conn.setBusy(true);
+    mylock.drop();
+    conn.commitBatch();
+    conn.setBusy(false);
+}
+
+// Retrieve a query time percentile in microseconds
+unsigned int SqlAccount::latency(unsigned int percent)
+{
+    u_int64_t total = 0;
+    for (unsigned int i = 0; i < LATENCY_BUCKETS; i++)
+	total += m_latency[i];
+    if (!total)
+	return 0;
+    u_int64_t target = (total * percent + 99) / 100;
+    u_int64_t crt = 0;
+    for (unsigned int i = 0; i < LATENCY_BUCKETS; i++) {
+	crt += m_latency[i];
+	if (crt >= target)
+	    return latencyLimit(i);
+    }
+    return latencyLimit(LATENCY_BUCKETS - 1);
+}
+
 static SqlAccount* findDb(const String& account)
 {
     if (account.null())
@@ -539,6 +980,25 @@ bool SqlHandler::received(Message& msg)
     return true;
 }
 
+void SqlBatchThread::run()
+{
+    while (!Engine::exiting()) {
+	Thread::msleep(s_batchTick,true);
+	// Don't hold the accounts mutex while committing, it also protects statistics
+	ObjList accounts;
+	s_conmutex.lock();
+	for (ObjList* o = s_accounts.skipNull(); o; o = o->skipNext()) {
+	    SqlAccount* acc = static_cast<SqlAccount*>(o->get());
+	    if (acc->batchInterval() && acc->ref())
+		accounts.append(acc);
+	}
+	s_conmutex.unlock();
+	u_int64_t now = Time::now();
+	for (ObjList* o = accounts.skipNull(); o; o = o->skipNext())
+	    static_cast<SqlAccount*>(o->get())->flushBatch(now);
+    }
+}
+
 SqlModule::SqlModule()
     : Module ("sqlitedb","database",true),m_init(false)
 {
@@ -562,7 +1022,7 @@ SqlModule::~SqlModule()
 void SqlModule::statusModule(String& str)
 {
     Module::statusModule(str);
-    str.append("format=Total|Failed|Errors|AvgExecTime",",");
+    str.append("format=Total|Failed|Errors|AvgExecTime|ExecP50us|ExecP90us|ExecP99us",",");
 }
 
 void SqlModule::statusParams(String& str)
@@ -584,6 +1044,7 @@ void SqlModule::statusDetail(String& str)
 	    str << (acc->queryTime() / (acc->total() - acc->failed()) / 1000); //miliseconds
         else
 	    str << "0";
+	str << "|" << acc->latency(50) << "|" << acc->latency(90) << "|" << acc->latency(99);
     }
     s_conmutex.unlock();
 }
@@ -614,13 +1075,20 @@ void SqlModule::initialize()
 	if (acc) {
 	    s_accounts.insert(acc);
 	    m_init = true;
+	    // Check batches at least 4 times in the shortest interval
+	    unsigned int tick = acc->batchInterval() / 4;
+	    if (acc->batchInterval() && (!s_batchTick || tick < s_batchTick))
+		s_batchTick = tick ? tick : 1;
 	}
 	else
 	    s_failedConns++;
 	s_conmutex.unlock();
     }
-    if (m_init)
+    if (m_init) {
 	Engine::install(new SqlHandler(cfg.getIntValue("general","priority",100)));
+	if (s_batchTick)
+	    (new SqlBatchThread)->startup();
+    }
     else
 	sqlite3_shutdown();
 }
@@ -637,6 +1105,8 @@ void SqlModule::genUpdate(Message& msg)
 	msg.setParam(String("errorred.") << index,String(acc->errorred()));
 	msg.setParam(String("hasconn.") << index,String::boolText(acc->hasConn()));
 	msg.setParam(String("querytime.") << index,String(acc->queryTime()));
+	msg.setParam(String("querytime50.") << index,String(acc->latency(50)));
+	msg.setParam(String("querytime99.") << index,String(acc->latency(99)));
 	index++;
     }
     s_conmutex.unlock();
@@ -4164,6 +4164,10 @@ void SigSS7Tcap::status(String& retVal)
     retVal << ",totalDiscarded=" << p.getValue("totalDiscarded","0");
     retVal << ",totalNormal=" << p.getValue("totalNormal","0");
     retVal << ",totalAbnormal=" << p.getValue("totalAbnormal","0");
+    retVal << ",totalTimeouts=" << p.getValue("totalTimeouts","0");
+    retVal << ",transactions=" << p.getValue("transactions","0");
+    retVal << ",shardTransactions=" << p.getValue("shardTransactions");
+    retVal << ",shardTimeoutRate=" << p.getValue("shardTimeoutRate");
 }
 
 /**
@@ -41,8 +41,10 @@ public:
 	  m_used(true), m_symmetric(false), m_what(Iam),
 	  m_cicMin(1), m_cicMax(16383),
 	  m_setOpc(0), m_setDpc(0), m_setSls(-2), m_setCic(0),
-	  m_resend(true)
+	  m_resend(true), m_decode(0)
 	{ }
+    inline ~IsupIntercept()
+	{ TelEngine::destruct(m_decode); }
     virtual bool initialize(const NamedList* config);
     void dispatched(SS7MsgISUP& isup, const Message& msg, const SS7Label& label, int sls, bool accepted);
 protected:
@@ -59,6 +61,8 @@ private:
     unsigned int m_cicMin, m_cicMax;
     int m_setOpc, m_setDpc, m_setSls, m_setCic;
     bool m_resend;
+    // Names of parameters decoded for handlers, all if NULL
+    ObjList* m_decode;
 };
 
 class IsupMessage : public Message
@@ -136,6 +140,14 @@ bool IsupIntercept::initialize(const NamedList* config)
     m_setDpc = config->getIntValue("set:dpc",s_dict_pc,m_setDpc);
     m_setSls = config->getIntValue("set:sls",s_dict_sls,m_setSls);
     m_setCic = config->getIntValue("set:cic",m_setCic);
+    const String& decode = (*config)[YSTRING("decode")];
+    ObjList* list = decode ? decode.split(',',false) : 0;
+    for (ObjList* l = list ? list->skipNull() : 0; l; l = l->skipNext())
+	static_cast<String*>(l->get())->trimBlanks();
+    lock();
+    TelEngine::destruct(m_decode);
+    m_decode = list;
+    unlock();
     Debug(this,DebugAll,"Added %u Point Codes, intercepts %s %s, cic=%u-%u",
 	setPointCode(*config),lookup(m_what,s_dict_what,"???"),
 	(m_symmetric) ? "both ways" : "one way",
@@ -259,7 +271,19 @@ bool IsupIntercept::processMSU(SS7MsgISUP::Type type, unsigned int cic,
 	tmp.hexify(&type,1);
 	msg->params().assign("Message_" + tmp);
     }
-    if (!decodeMessage(msg->params(),type,label.type(),paramPtr,paramLen)) {
+    // keep the raw parameters so unchanged ones are forwarded as received
+    bool ok = indexMessage(*msg,label.type(),paramPtr,paramLen);
+    if (ok) {
+	// decode only the parameters handlers are configured to look at
+	Lock lock(this);
+	if (m_decode) {
+	    for (ObjList* l = m_decode->skipNull(); l; l = l->skipNext())
+		decodeIndexed(*msg,*static_cast<String*>(l->get()));
+	}
+	else
+	    ok = decodeIndexed(*msg);
+    }
+    if (!ok) {
 	TelEngine::destruct(msg);
 	return false;
     }
@@ -286,7 +310,9 @@ bool IsupIntercept::processMSU(SS7MsgISUP::Type type, unsigned int cic,
 
 void IsupIntercept::dispatched(SS7MsgISUP& isup, const Message& msg, const SS7Label& label, int sls, bool accepted)
 {
-    SS7MSU* msu = createMSU(isup.type(),ssf(),label,isup.cic(),&msg);
+    // re-encode only the parameters changed by message handlers
+    SS7MSU* msu = matchIndexed(isup,msg) ?
+	createMSU(isup,ssf(),label,&msg) : createMSU(isup,ssf(),label);
     if (!msu || (transmitMSU(*msu,label,sls) < 0))
 	Debug(this,DebugWarn,"Failed to forward mangled %s (%u) [%p]",
 	    SS7MsgISUP::lookup(isup.type()),isup.cic(),this);
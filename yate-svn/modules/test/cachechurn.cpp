@@ -0,0 +1,142 @@
+/**
+ * cachechurn.cpp
+ * This file is part of the YATE Project http://YATE.null.ro
+ *
+ * LNP cache prefix trie churn test
+ *
+ * Yet Another Telephony Engine - a fully featured software PBX and IVR
+ * Copyright (C) 2004-2014 Null Team
+ *
+ * This software is distributed under multiple licenses;
+ * see the COPYING file in the main directory for licensing
+ * information for this specific distribution.
+ *
+ * This use of this software may be subject to additional restrictions.
+ * See the LEGAL file in the main directory for details.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+#include <yatengine.h>
+
+using namespace TelEngine;
+namespace { // anonymous
+
+// Run the test when the cache module is initialized
+class StartHandler : public MessageHandler
+{
+public:
+    inline StartHandler()
+	: MessageHandler("engine.start",100,"cachechurn")
+	{ }
+    virtual bool received(Message& msg);
+};
+
+class CacheChurn : public Plugin
+{
+public:
+    CacheChurn();
+    virtual void initialize();
+    void runChurn();
+private:
+    bool m_init;
+};
+
+INIT_PLUGIN(CacheChurn);
+
+
+// Retrieve the number of trie nodes of the LNP cache from the module status
+static int trieNodes()
+{
+    Message m("engine.status");
+    m.addParam("module","cache");
+    Engine::dispatch(m);
+    int pos = m.retValue().find("lnp=");
+    if (pos < 0)
+	return -1;
+    String tmp = m.retValue().substr(pos + 4);
+    pos = tmp.find(';');
+    if (pos >= 0)
+	tmp = tmp.substr(0,pos);
+    tmp.trimSpaces();
+    ObjList* list = tmp.split('|');
+    String* nodes = static_cast<String*>((*list)[6]);
+    int n = nodes ? nodes->toInteger(-1) : -1;
+    TelEngine::destruct(list);
+    return n;
+}
+
+bool StartHandler::received(Message& msg)
+{
+    __plugin.runChurn();
+    return false;
+}
+
+
+CacheChurn::CacheChurn()
+    : Plugin("cachechurn","misc"),
+      m_init(false)
+{
+    Output("Loaded module CacheChurn");
+}
+
+// Store numbers in the LNP cache so items are evicted by the cache limit
+//  and check the trie keeps its size
+void CacheChurn::runChurn()
+{
+    const NamedList* s = Engine::config().getSection("cachechurn");
+    const NamedList& sect = s ? *s : NamedList::empty();
+    unsigned int items = sect.getIntValue(YSTRING("items"),1000,1);
+    unsigned int rounds = sect.getIntValue(YSTRING("rounds"),10,2);
+    int first = -1;
+    int last = -1;
+    unsigned int found = 0;
+    for (unsigned int r = 0; r < rounds; r++) {
+	String called;
+	for (unsigned int i = 0; i < items; i++) {
+	    called.clear();
+	    called << (u_int64_t)(1000000000 + Random::random() % 1000000000);
+	    Message m("call.route");
+	    m.addParam("called",called);
+	    m.addParam("querylnp",String::boolText(false));
+	    m.addParam("npdi",String::boolText(true));
+	    m.addParam("cache_lnp_store",String::boolText(true));
+	    m.addParam("routing",called);
+	    Engine::dispatch(m);
+	}
+	// The last stored number must be found in cache
+	Message m("call.route");
+	m.addParam("called",called);
+	m.addParam("querylnp",String::boolText(true));
+	Engine::dispatch(m);
+	if (m[YSTRING("routing")] == called)
+	    found++;
+	last = trieNodes();
+	if (first < 0)
+	    first = last;
+	Output("CacheChurn: round %u stored %u numbers, trie nodes %d",r + 1,items,last);
+    }
+    Message m("engine.command");
+    m.addParam("line","cache flush lnp regexp=.");
+    Engine::dispatch(m);
+    int empty = trieNodes();
+    // A random set of items of the same size uses about as many nodes
+    bool ok = (first > 0) && (last <= first + first / 10) && (empty == 1) && (found == rounds);
+    Output("CacheChurn: trie nodes first=%d last=%d flushed=%d, found %u/%u %s",
+	first,last,empty,found,rounds,ok ? "passed" : "FAILED");
+}
+
+void CacheChurn::initialize()
+{
+    Output("Initializing module CacheChurn");
+    if (m_init)
+	return;
+    m_init = true;
+    Engine::install(new StartHandler);
+}
+
+}; // anonymous namespace
+
+/* vi: set ts=8 sw=4 sts=4 noet: */
@@ -0,0 +1,124 @@
+/**
+ * g711bench.cpp
+ * This file is part of the YATE Project http://YATE.null.ro
+ *
+ * G.711 and slin conversion benchmark
+ *
+ * Yet Another Telephony Engine - a fully featured software PBX and IVR
+ * Copyright (C) 2004-2014 Null Team
+ *
+ * This software is distributed under multiple licenses;
+ * see the COPYING file in the main directory for licensing
+ * information for this specific distribution.
+ *
+ * This use of this software may be subject to additional restrictions.
+ * See the LEGAL file in the main directory for details.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+#include <yatengine.h>
+
+#include <string.h>
+
+using namespace TelEngine;
+namespace { // anonymous
+
+static const char* s_pairs[][2] = {
+    { "slin", "alaw" },
+    { "slin", "mulaw" },
+    { "alaw", "slin" },
+    { "mulaw", "slin" },
+    { "alaw", "mulaw" },
+    { "mulaw", "alaw" },
+    { 0, 0 }
+};
+
+class G711Bench : public Plugin
+{
+public:
+    G711Bench();
+    virtual void initialize();
+private:
+    bool check(const String& sFmt, const String& dFmt);
+    u_int64_t runBench(DataBlock::Converter func, unsigned int sSize, unsigned int dSize,
+	unsigned int samples, unsigned int frames);
+};
+
+INIT_PLUGIN(G711Bench);
+
+
+G711Bench::G711Bench()
+    : Plugin("g711bench","misc")
+{
+    Output("Loaded module G711Bench");
+}
+
+// Convert every possible input value with both paths and compare results
+bool G711Bench::check(const String& sFmt, const String& dFmt)
+{
+    unsigned int sSize = 0;
+    unsigned int dSize = 0;
+    DataBlock::Converter table = DataBlock::converter(sFmt,dFmt,sSize,dSize,false);
+    DataBlock::Converter simd = DataBlock::converter(sFmt,dFmt,sSize,dSize,true);
+    if (!(table && simd))
+	return false;
+    unsigned int n = (sSize == 2) ? 65536 : 256;
+    DataBlock src(0,n * sSize);
+    for (unsigned int i = 0; i < n; i++) {
+	if (sSize == 2)
+	    ((u_int16_t*)src.data())[i] = i;
+	else
+	    ((u_int8_t*)src.data())[i] = i;
+    }
+    DataBlock d1;
+    DataBlock d2;
+    d1.convert(src,table,sSize,dSize);
+    d2.convert(src,simd,sSize,dSize);
+    return (d1.length() == d2.length()) && !::memcmp(d1.data(),d2.data(),d1.length());
+}
+
+// Convert a number of frames of the given size, return the time it took
+u_int64_t G711Bench::runBench(DataBlock::Converter func, unsigned int sSize, unsigned int dSize,
+    unsigned int samples, unsigned int frames)
+{
+    DataBlock src(0,samples * sSize);
+    for (unsigned int i = 0; i < src.length(); i++)
+	((u_int8_t*)src.data())[i] = (i * 37) ^ (i >> 3);
+    DataBlock dst;
+    u_int64_t start = Time::now();
+    for (unsigned int i = 0; i < frames; i++)
+	dst.convert(src,func,sSize,dSize);
+    u_int64_t t = Time::now() - start;
+    return t ? t : 1;
+}
+
+void G711Bench::initialize()
+{
+    Output("Initializing module G711Bench");
+    const NamedList* s = Engine::config().getSection("g711bench");
+    const NamedList& sect = s ? *s : NamedList::empty();
+    unsigned int samples = sect.getIntValue(YSTRING("samples"),160,1);
+    unsigned int frames = sect.getIntValue(YSTRING("frames"),200000,1);
+    for (int i = 0; s_pairs[i][0]; i++) {
+	String sFmt = s_pairs[i][0];
+	String dFmt = s_pairs[i][1];
+	unsigned int sSize = 0;
+	unsigned int dSize = 0;
+	DataBlock::Converter table = DataBlock::converter(sFmt,dFmt,sSize,dSize,false);
+	DataBlock::Converter simd = DataBlock::converter(sFmt,dFmt,sSize,dSize,true);
+	bool same = check(sFmt,dFmt);
+	u_int64_t t1 = runBench(table,sSize,dSize,samples,frames);
+	u_int64_t t2 = runBench(simd,sSize,dSize,samples,frames);
+	Output("G711Bench: %s -> %s %u x %u samples: table " FMT64U " usec, best " FMT64U " usec (%u.%02ux)%s%s",
+	    sFmt.c_str(),dFmt.c_str(),frames,samples,t1,t2,
+	    (unsigned int)(t1 / t2),(unsigned int)((t1 * 100 / t2) % 100),
+	    (table == simd) ? ", same function" : "",same ? "" : ", RESULTS DIFFER");
+    }
+}
+
+}; // anonymous namespace
+
+/* vi: set ts=8 sw=4 sts=4 noet: */
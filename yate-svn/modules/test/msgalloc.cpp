@@ -0,0 +1,153 @@
+/**
+ * msgalloc.cpp
+ * This file is part of the YATE Project http://YATE.null.ro
+ *
+ * Message parameter allocation benchmark
+ *
+ * Yet Another Telephony Engine - a fully featured software PBX and IVR
+ * Copyright (C) 2004-2014 Null Team
+ *
+ * This software is distributed under multiple licenses;
+ * see the COPYING file in the main directory for licensing
+ * information for this specific distribution.
+ *
+ * This use of this software may be subject to additional restrictions.
+ * See the LEGAL file in the main directory for details.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+#include <yatengine.h>
+
+#ifdef __GLIBC__
+#include <malloc.h>
+#if (__GLIBC__ > 2) || (__GLIBC_MINOR__ >= 33)
+#define HAVE_MALLINFO2
+#endif
+#endif
+
+using namespace TelEngine;
+namespace { // anonymous
+
+class MsgAlloc : public Plugin
+{
+public:
+    MsgAlloc();
+    virtual void initialize();
+private:
+    void runBench(unsigned int messages, unsigned int keep, unsigned int arena);
+};
+
+INIT_PLUGIN(MsgAlloc);
+
+// Parameters similar to the ones of a chan.startup message
+static const char* s_params[] = {
+    "id", "sip/12345",
+    "module", "sip",
+    "status", "incoming",
+    "address", "192.168.1.10:5060",
+    "billid", "1428756311-48",
+    "answered", "false",
+    "direction", "incoming",
+    "caller", "1234567890",
+    "called", "0987654321",
+    "callername", "Some Caller",
+    "callid", "sip/a84f2e97c1b0@192.168.1.10/1234/",
+    "sip_uri", "sip:0987654321@192.168.1.1",
+    "sip_from", "sip:1234567890@192.168.1.10",
+    "sip_to", "sip:0987654321@192.168.1.1",
+    "sip_callid", "a84f2e97c1b0@192.168.1.10",
+    "device", "Some SIP phone/1.0",
+    "sip_contact", "<sip:1234567890@192.168.1.10:5060>",
+    "sip_user-agent", "Some SIP phone/1.0",
+    "rtp_addr", "192.168.1.10",
+    "rtp_port", "16384",
+    0
+};
+
+// Bytes of heap in use, zero if it can't be found
+static u_int64_t heapUsed()
+{
+#ifdef HAVE_MALLINFO2
+    return mallinfo2().uordblks;
+#elif defined(__GLIBC__)
+    return (unsigned int)mallinfo().uordblks;
+#else
+    return 0;
+#endif
+}
+
+static Message* buildMessage(unsigned int arena)
+{
+    Message* m = new Message("chan.startup");
+    if (arena)
+	m->setArena(arena);
+    for (const char** p = s_params; *p; p += 2)
+	m->addParam(p[0],p[1]);
+    return m;
+}
+
+void MsgAlloc::runBench(unsigned int messages, unsigned int keep, unsigned int arena)
+{
+    const char* mode = arena ? "arena" : "heap";
+    // build and destroy messages
+    u_int64_t start = Time::now();
+    for (unsigned int i = 0; i < messages; i++)
+	TelEngine::destruct(buildMessage(arena));
+    u_int64_t tBuild = Time::now() - start;
+    // copy the parameters of a message in new messages
+    Message* orig = buildMessage(arena);
+    start = Time::now();
+    for (unsigned int i = 0; i < messages; i++) {
+	Message m("chan.notify");
+	if (arena)
+	    m.setArena(arena);
+	m.copyParams(*orig);
+    }
+    u_int64_t tCopy = Time::now() - start;
+    TelEngine::destruct(orig);
+    // memory held by live messages, measured from the heap itself so arena
+    //  blocks, heap fallbacks and per parameter buffers are all accounted
+    Message** live = new Message*[keep];
+    u_int64_t mem = heapUsed();
+    for (unsigned int i = 0; i < keep; i++)
+	live[i] = buildMessage(arena);
+    mem = heapUsed() - mem;
+    for (unsigned int i = 0; i < keep; i++)
+	TelEngine::destruct(live[i]);
+    delete[] live;
+    if (!tBuild)
+	tBuild = 1;
+    if (!tCopy)
+	tCopy = 1;
+    Output("MsgAlloc: %s %u messages built in " FMT64U " usec (" FMT64U " msg/s), copied in "
+	FMT64U " usec (" FMT64U " msg/s)",mode,messages,
+	tBuild,((u_int64_t)messages * 1000000) / tBuild,
+	tCopy,((u_int64_t)messages * 1000000) / tCopy);
+    Output("MsgAlloc: %s " FMT64U " heap bytes per message, " FMT64U " for %u live messages",
+	mode,mem / keep,mem,keep);
+}
+
+MsgAlloc::MsgAlloc()
+    : Plugin("msgalloc","misc")
+{
+    Output("Loaded module MsgAlloc");
+}
+
+void MsgAlloc::initialize()
+{
+    Output("Initializing module MsgAlloc");
+    const NamedList* s = Engine::config().getSection("msgalloc");
+    const NamedList& sect = s ? *s : NamedList::empty();
+    unsigned int messages = sect.getIntValue(YSTRING("messages"),100000,1);
+    unsigned int keep = sect.getIntValue(YSTRING("keep"),1000,1);
+    unsigned int arena = sect.getIntValue(YSTRING("arena"),2048,256);
+    runBench(messages,keep,0);
+    runBench(messages,keep,arena);
+}
+
+}; // anonymous namespace
+
+/* vi: set ts=8 sw=4 sts=4 noet: */
@@ -0,0 +1,158 @@
+/**
+ * msgbench.cpp
+ * This file is part of the YATE Project http://YATE.null.ro
+ *
+ * Message dispatcher benchmark
+ *
+ * Yet Another Telephony Engine - a fully featured software PBX and IVR
+ * Copyright (C) 2004-2014 Null Team
+ *
+ * This software is distributed under multiple licenses;
+ * see the COPYING file in the main directory for licensing
+ * information for this specific distribution.
+ *
+ * This use of this software may be subject to additional restrictions.
+ * See the LEGAL file in the main directory for details.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+
+#include <yatengine.h>
+
+using namespace TelEngine;
+namespace { // anonymous
+
+class BenchHandler : public MessageHandler
+{
+public:
+    inline BenchHandler(const char* name, unsigned int prio)
+	: MessageHandler(name,prio), m_calls(0)
+	{ }
+    virtual bool received(Message& msg)
+	{ m_calls++; return false; }
+    unsigned int m_calls;
+};
+
+// Handler that renames the message like chan.masquerade does
+class RenameHandler : public BenchHandler
+{
+public:
+    inline RenameHandler(const char* name, unsigned int prio, const char* newName)
+	: BenchHandler(name,prio), m_newName(newName)
+	{ }
+    virtual bool received(Message& msg)
+	{ m_calls++; msg = m_newName; return false; }
+    String m_newName;
+};
+
+class MsgBench : public Plugin
+{
+public:
+    MsgBench();
+    virtual void initialize();
+private:
+    void runBench(unsigned int handlers, unsigned int broadcast, unsigned int messages);
+    void runRename();
+};
+
+INIT_PLUGIN(MsgBench);
+
+
+MsgBench::MsgBench()
+    : Plugin("msgbench","misc")
+{
+    Output("Loaded module MsgBench");
+}
+
+// Dispatch messages with names spread over all installed handler names
+void MsgBench::runBench(unsigned int handlers, unsigned int broadcast, unsigned int messages)
+{
+    MessageDispatcher disp;
+    ObjList names;
+    ObjList installed;
+    for (unsigned int i = 0; i < handlers; i++) {
+	String name("bench.msg");
+	name << (i / 4);
+	if (!(i % 4))
+	    names.append(new String(name));
+	BenchHandler* h = new BenchHandler(name,10 + (i * 7) % 100);
+	installed.append(h);
+	disp.install(h);
+    }
+    for (unsigned int i = 0; i < broadcast; i++) {
+	BenchHandler* h = new BenchHandler(0,5 + (i * 13) % 100);
+	installed.append(h);
+	disp.install(h);
+    }
+    unsigned int nameCount = names.count();
+    ObjList* crt = names.skipNull();
+    u_int64_t start = Time::now();
+    for (unsigned int i = 0; i < messages; i++) {
+	Message m(crt ? static_cast<String*>(crt->get())->c_str() : "bench.none");
+	disp.dispatch(m);
+	if (crt)
+	    crt = crt->skipNext();
+	if (!crt)
+	    crt = names.skipNull();
+    }
+    u_int64_t t = Time::now() - start;
+    if (!t)
+	t = 1;
+    Output("MsgBench: %u handlers (%u names, %u catch-all), %u messages in " FMT64U " usec, " FMT64U " msg/s",
+	handlers + broadcast,nameCount,broadcast,messages,t,((u_int64_t)messages * 1000000) / t);
+    unsigned int calls = 0;
+    for (ObjList* o = installed.skipNull(); o; o = o->skipNext())
+	calls += static_cast<BenchHandler*>(o->get())->m_calls;
+    Output("MsgBench: %u handler calls",calls);
+    // handlers must be removed before the dispatcher goes away
+    for (ObjList* o = installed.skipNull(); o; o = o->skipNext())
+	disp.uninstall(static_cast<BenchHandler*>(o->get()));
+}
+
+// Check that handlers of a name set during dispatch are followed
+void MsgBench::runRename()
+{
+    MessageDispatcher disp;
+    BenchHandler early("bench.new",5);
+    RenameHandler rename("bench.old",10,"bench.new");
+    BenchHandler old("bench.old",20);
+    BenchHandler late("bench.new",20);
+    BenchHandler all(0,30);
+    disp.install(&early);
+    disp.install(&rename);
+    disp.install(&old);
+    disp.install(&late);
+    disp.install(&all);
+    Message m("bench.old");
+    disp.dispatch(m);
+    bool ok = (m == YSTRING("bench.new")) && !early.m_calls && (rename.m_calls == 1)
+	&& !old.m_calls && (late.m_calls == 1) && (all.m_calls == 1);
+    Output("MsgBench: rename during dispatch %s (early=%u rename=%u old=%u late=%u all=%u)",
+	ok ? "passed" : "FAILED",early.m_calls,rename.m_calls,old.m_calls,late.m_calls,all.m_calls);
+    disp.uninstall(&early);
+    disp.uninstall(&rename);
+    disp.uninstall(&old);
+    disp.uninstall(&late);
+    disp.uninstall(&all);
+}
+
+void MsgBench::initialize()
+{
+    Output("Initializing module MsgBench");
+    runRename();
+    const NamedList* s = Engine::config().getSection("msgbench");
+    const NamedList& sect = s ? *s : NamedList::empty();
+    unsigned int messages = sect.getIntValue(YSTRING("messages"),100000,1);
+    unsigned int broadcast = sect.getIntValue(YSTRING("broadcast"),4,0);
+    String list = sect.getValue(YSTRING("handlers"),"10,100,500,1000");
+    ObjList* counts = list.split(',',false);
+    for (ObjList* o = counts->skipNull(); o; o = o->skipNext())
+	runBench(static_cast<String*>(o->get())->toInteger(0,0,0),broadcast,messages);
+    TelEngine::destruct(counts);
+}
+
+}; // anonymous namespace
+
+/* vi: set ts=8 sw=4 sts=4 noet: */
@@ -33,11 +33,17 @@
 #define DTMF_LEN 2010
 #define DTMF_GAP 520
 
+// Samples in each 20ms frame of tone
+#define FRAME_SAMPLES 160
+// Longest cadence cycle pre-rendered, 60s
+#define MAX_FRAMES 3000
+
 using namespace TelEngine;
 namespace { // anonymous
 
 static ObjList tones;
 static ObjList datas;
+static ObjList frames;
 
 typedef struct {
     int nsamples;
@@ -118,6 +124,33 @@ private:
     const short* m_data;
 };
 
+// A tone cadence rendered once in one format, played by pointing into it
+class ToneFrames : public RefObject
+{
+public:
+    ToneFrames(const String& name, const String& format);
+    inline const String& name() const
+	{ return m_name; }
+    inline const String& format() const
+	{ return m_format; }
+    inline unsigned int count() const
+	{ return m_count; }
+    inline int loop() const
+	{ return m_loop; }
+    inline unsigned int frameLen() const
+	{ return m_frameLen; }
+    inline void* frame(unsigned int index) const
+	{ return (unsigned char*)m_data.data() + index * m_frameLen; }
+    void setData(const DataBlock& data, unsigned int count, int loop);
+private:
+    String m_name;
+    String m_format;
+    DataBlock m_data;
+    unsigned int m_frameLen;
+    unsigned int m_count;
+    int m_loop;
+};
+
 class ToneSource : public ThreadedSource
 {
 public:
@@ -126,27 +159,40 @@ public:
     inline const String& name()
 	{ return m_name; }
     bool startup();
-    static ToneSource* getTone(String& tone, const String& prefix);
+    static ToneSource* getTone(String& tone, const String& prefix,
+	const String& format = String::empty());
     static const ToneDesc* getBlock(String& tone, const String& prefix, bool oneShot = false);
     static Tone* buildCadence(const String& desc);
     static Tone* buildDtmf(const String& dtmf, int len = DTMF_LEN, int gap = DTMF_GAP);
 protected:
-    ToneSource(const ToneDesc* tone = 0);
+    ToneSource(const ToneDesc* tone = 0, const String& format = String::empty());
     virtual bool noChan() const
 	{ return false; }
     virtual void cleanup();
+    virtual bool clockTick(u_int64_t when);
     void advanceTone(const Tone*& tone);
+    void fillData();
+    void sendData();
     static const ToneDesc* getBlock(String& tone, const ToneDesc* table);
     static const ToneDesc* findToneDesc(String& tone, const String& prefix);
+    static ToneFrames* getFrames(const ToneDesc* tone, const String& format);
     String m_name;
     const Tone* m_tone;
     int m_repeat;
     bool m_firstPass;
 private:
+    void initPlay();
     DataBlock m_data;
     unsigned m_brate;
     unsigned m_total;
+    unsigned long m_stamp;
     u_int64_t m_time;
+    const Tone* m_playing;
+    int m_samp;
+    int m_dpos;
+    int m_nsam;
+    RefPointer<ToneFrames> m_frames;
+    unsigned int m_frame;
 };
 
 class TempSource : public ToneSource
@@ -653,16 +699,39 @@ bool ToneData::decode(const String& desc, int& samples, const short*& data, bool
     return td != 0;
 }
 
-ToneSource::ToneSource(const ToneDesc* tone)
+ToneFrames::ToneFrames(const String& name, const String& format)
+    : m_name(name), m_format(format),
+      m_frameLen(FRAME_SAMPLES * ((format == "slin") ? 2 : 1)), m_count(0), m_loop(-1)
+{
+}
+
+void ToneFrames::setData(const DataBlock& data, unsigned int count, int loop)
+{
+    m_data = data;
+    m_count = count;
+    m_loop = loop;
+}
+
+ToneSource::ToneSource(const ToneDesc* tone, const String& format)
     : m_tone(0), m_repeat(tone == 0), m_firstPass(true),
-      m_data(0,320), m_brate(16000), m_total(0), m_time(0)
+      m_data(0,2*FRAME_SAMPLES), m_brate(16000), m_total(0), m_stamp(0), m_time(0),
+      m_playing(0), m_samp(0), m_dpos(1), m_nsam(0), m_frame(0)
 {
     if (tone) {
 	m_tone = tone->tones();
 	m_name = *tone;
+	bool convert = format && (format != m_format);
+	m_frames = getFrames(tone,convert ? format : m_format);
+	if (m_frames && !m_frames->count())
+	    m_frames = 0;
+	// fillData() generates only slin so switch format only if rendering worked
+	if (convert && m_frames) {
+	    m_format = format;
+	    m_brate = 8000;
+	}
     }
-    Debug(&__plugin,DebugAll,"ToneSource::ToneSource(%p) '%s' [%p]",
-	tone,m_name.c_str(),this);
+    Debug(&__plugin,DebugAll,"ToneSource::ToneSource(%p,'%s') '%s'%s [%p]",
+	tone,m_format.c_str(),m_name.c_str(),(m_frames ? " pre-rendered" : ""),this);
 }
 
 void ToneSource::destroyed()
@@ -677,7 +746,88 @@ void ToneSource::destroyed()
 bool ToneSource::startup()
 {
     DDebug(&__plugin,DebugAll,"ToneSource::startup(\"%s\") tone=%p",m_name.c_str(),m_tone);
-    return m_tone && start("Tone Source");
+    if (!m_tone)
+	return false;
+    initPlay();
+    return startClock() || start("Tone Source");
+}
+
+void ToneSource::initPlay()
+{
+    m_playing = m_tone;
+    m_nsam = m_playing ? m_playing->nsamples : 0;
+    if (m_nsam < 0)
+	m_nsam = -m_nsam;
+}
+
+// Get the cadence of a tone pre-rendered in a format, render it if needed
+// Must be called with the plugin locked
+ToneFrames* ToneSource::getFrames(const ToneDesc* tone, const String& format)
+{
+    for (ObjList* l = frames.skipNull(); l; l = l->skipNext()) {
+	ToneFrames* f = static_cast<ToneFrames*>(l->get());
+	if (f->name() == *tone && f->format() == format)
+	    return f;
+    }
+    ToneFrames* f = new ToneFrames(*tone,format);
+    frames.append(f);
+    // run a private generator until it ends or comes back to a state it had
+    ToneSource* gen = new ToneSource(tone);
+    gen->initPlay();
+    struct State {
+	const Tone* tone;
+	const Tone* playing;
+	int samp;
+	int dpos;
+	bool firstPass;
+    };
+    State* states = new State[MAX_FRAMES];
+    unsigned int len = gen->m_data.length();
+    DataBlock buf(0,MAX_FRAMES * len);
+    unsigned int count = 0;
+    int loop = -1;
+    while (gen->m_tone) {
+	State st = { gen->m_tone, gen->m_playing, gen->m_samp, gen->m_dpos, gen->m_firstPass };
+	// position in data matters only while playing some
+	if (!(st.playing && st.playing->data))
+	    st.dpos = 0;
+	else if (st.dpos > st.playing->data[0])
+	    st.dpos = 1;
+	for (unsigned int i = 0; i < count; i++) {
+	    const State& o = states[i];
+	    if (o.tone == st.tone && o.playing == st.playing && o.samp == st.samp &&
+		o.dpos == st.dpos && o.firstPass == st.firstPass) {
+		loop = i;
+		break;
+	    }
+	}
+	if (loop >= 0 || count >= MAX_FRAMES)
+	    break;
+	states[count] = st;
+	gen->fillData();
+	::memcpy((unsigned char*)buf.data() + count * len,gen->m_data.data(),len);
+	count++;
+    }
+    delete[] states;
+    bool ended = !gen->m_tone;
+    TelEngine::destruct(gen);
+    if (loop < 0 && !ended) {
+	Debug(&__plugin,DebugNote,"Tone '%s' cadence is too long to pre-render",tone->c_str());
+	return f;
+    }
+    DataBlock data(buf.data(),count * len);
+    if (format != "slin") {
+	DataBlock conv;
+	if (!conv.convert(data,"slin",format)) {
+	    Debug(&__plugin,DebugNote,"Can't pre-render tone '%s' as %s",tone->c_str(),format.c_str());
+	    return f;
+	}
+	data = conv;
+    }
+    f->setData(data,count,loop);
+    Debug(&__plugin,DebugAll,"Pre-rendered tone '%s' as %s: %u frames, loop at %d",
+	tone->c_str(),format.c_str(),count,loop);
+    return f;
 }
 
 void ToneSource::cleanup()
@@ -820,7 +970,7 @@ Tone* ToneSource::buildDtmf(const String& dtmf, int len, int gap)
     return tmp;
 }
 
-ToneSource* ToneSource::getTone(String& tone, const String& prefix)
+ToneSource* ToneSource::getTone(String& tone, const String& prefix, const String& format)
 {
     const ToneDesc* td = ToneSource::getBlock(tone,prefix);
     bool repeat = !td || td->repeatAll();
@@ -831,56 +981,80 @@ ToneSource* ToneSource::getTone(String& tone, const String& prefix)
     ObjList* l = repeat ? &tones : 0;
     for (; l; l = l->next()) {
 	ToneSource* t = static_cast<ToneSource*>(l->get());
-	if (t && (t->name() == tone) && t->running() && (t->refcount() > 1)) {
+	if (t && (t->name() == tone) && t->running() && (t->refcount() > 1) &&
+		(format.null() || (t->getFormat() == format))) {
 	    t->ref();
 	    return t;
 	}
     }
     if (!td)
 	return 0;
-    ToneSource* t = new ToneSource(td);
+    ToneSource* t = new ToneSource(td,format);
     tones.append(t);
     t->startup();
     return t;
 }
 
+// Fill the data block with the next samples of the tone
+void ToneSource::fillData()
+{
+    short *d = (short *) m_data.data();
+    for (unsigned int i = m_data.length()/2; i--; m_samp++,m_dpos++) {
+	if (m_samp >= m_nsam) {
+	    // go to the start of the next tone
+	    m_samp = 0;
+	    const Tone *otone = m_playing;
+	    advanceTone(m_playing);
+	    m_nsam = m_playing ? m_playing->nsamples : 32000;
+	    if (m_nsam < 0) {
+		m_nsam = -m_nsam;
+		// reset repeat point here
+		m_tone = m_playing;
+	    }
+	    if (m_playing != otone)
+		m_dpos = 1;
+	}
+	if (m_playing && m_playing->data) {
+	    if (m_dpos > m_playing->data[0])
+		m_dpos = 1;
+	    *d++ = m_playing->data[m_dpos];
+	}
+	else
+	    *d++ = 0;
+    }
+}
+
+// Forward the next frame, pointing into the pre-rendered cadence if there is one
+void ToneSource::sendData()
+{
+    unsigned int len = m_data.length();
+    if (m_frames) {
+	len = m_frames->frameLen();
+	DataBlock buf(m_frames->frame(m_frame),len,false);
+	Forward(buf,m_stamp);
+	buf.clear(false);
+	if (++m_frame >= m_frames->count()) {
+	    if (m_frames->loop() < 0)
+		m_tone = 0;
+	    else
+		m_frame = m_frames->loop();
+	}
+    }
+    else {
+	fillData();
+	Forward(m_data,m_stamp);
+    }
+    m_total += len;
+    m_stamp += FRAME_SAMPLES;
+}
+
 void ToneSource::run()
 {
     Debug(&__plugin,DebugAll,"ToneSource::run() [%p]",this);
     u_int64_t tpos = Time::now();
     m_time = tpos;
-    int samp = 0; // sample number
-    int dpos = 1; // position in data
-    const Tone* tone = m_tone;
-    int nsam = tone->nsamples;
-    if (nsam < 0)
-	nsam = -nsam;
     while (m_tone && looping(noChan())) {
 	Thread::check();
-	short *d = (short *) m_data.data();
-	for (unsigned int i = m_data.length()/2; i--; samp++,dpos++) {
-	    if (samp >= nsam) {
-		// go to the start of the next tone
-		samp = 0;
-		const Tone *otone = tone;
-		advanceTone(tone);
-		nsam = tone ? tone->nsamples : 32000;
-		if (nsam < 0) {
-		    nsam = -nsam;
-		    // reset repeat point here
-		    m_tone = tone;
-		}
-		if (tone != otone)
-		    dpos = 1;
-	    }
-	    if (tone && tone->data) {
-		if (dpos > tone->data[0])
-		    dpos = 1;
-		*d++ = tone->data[dpos];
-	    }
-	    else
-		*d++ = 0;
-	}
 	int64_t dly = tpos - Time::now();
 	if (dly > 0) {
 	    XDebug(&__plugin,DebugAll,"ToneSource sleeping for " FMT64 " usec",dly);
@@ -888,13 +1062,26 @@ void ToneSource::run()
 	}
 	if (!looping(noChan()))
 	    break;
-	Forward(m_data,m_total/2);
-	m_total += m_data.length();
-	tpos += (m_data.length()*(u_int64_t)1000000/m_brate);
+	sendData();
+	tpos += (FRAME_SAMPLES*(u_int64_t)1000000/8000);
+    }
+    Debug(&__plugin,DebugAll,"ToneSource [%p] end, total=%u (%u b/s)",
+	this,m_total,byteRate(m_time,m_total));
+    m_time = 0;
+}
+
+bool ToneSource::clockTick(u_int64_t when)
+{
+    if (!m_time)
+	m_time = when;
+    if (m_tone && looping(noChan())) {
+	sendData();
+	return true;
     }
     Debug(&__plugin,DebugAll,"ToneSource [%p] end, total=%u (%u b/s)",
 	this,m_total,byteRate(m_time,m_total));
     m_time = 0;
+    return false;
 }
 
 
@@ -1050,7 +1237,15 @@ bool AttachHandler::received(Message& msg)
 
     Lock lock(__plugin);
     if (src) {
-	ToneSource* t = ToneSource::getTone(src,msg["lang"]);
+	// play straight in the G.711 law the peer consumes to skip the translator
+	String format;
+	DataEndpoint::commonMutex().lock();
+	DataEndpoint* peer = de->getPeer();
+	DataConsumer* c = peer ? peer->getConsumer() : 0;
+	if (c && ((c->getFormat() == YSTRING("alaw")) || (c->getFormat() == YSTRING("mulaw"))))
+	    format = c->getFormat();
+	DataEndpoint::commonMutex().unlock();
+	ToneSource* t = ToneSource::getTone(src,msg["lang"],format);
 	if (t) {
 	    de->setSource(t);
 	    t->deref();
@@ -36,9 +36,13 @@ public:
     virtual void cleanup();
     virtual void attached(bool added);
     void setNotify(const String& id);
+protected:
+    virtual bool clockTick(u_int64_t when);
 private:
     WaveSource(const char* file, CallEndpoint* chan, bool autoclose);
     void init(const String& file, bool autorepeat);
+    void startPlay();
+    int readData(unsigned int blen);
     void detectAuFormat();
     void detectWavFormat();
     void detectIlbcFormat();
@@ -53,6 +57,8 @@ private:
     int64_t m_repeatPos;
     unsigned m_total;
     u_int64_t m_time;
+    unsigned long m_ts;
+    unsigned int m_blen;
     String m_id;
     bool m_autoclose;
     bool m_nodata;
@@ -211,7 +217,7 @@ void WaveSource::init(const String& file, bool autorepeat)
 	    m_nodata = true;
 	    m_rate = 8000;
 	    m_brate = 8000;
-	    start("Wave Source");
+	    startPlay();
 	    return;
 	}
 	m_stream = new File;
@@ -254,7 +260,7 @@ void WaveSource::init(const String& file, bool autorepeat)
     if (computeDataRate()) {
 	if (autorepeat)
 	    m_repeatPos = m_stream->seek(Stream::SeekCurrent);
-	start("Wave Source");
+	startPlay();
     }
     else {
 	Debug(DebugWarn,"Unable to compute data rate for file '%s'",file.c_str());
@@ -264,7 +270,7 @@ void WaveSource::init(const String& file, bool autorepeat)
 
 WaveSource::WaveSource(const char* file, CallEndpoint* chan, bool autoclose)
     : m_chan(chan), m_stream(0), m_swap(false), m_rate(8000), m_brate(0), m_repeatPos(-1),
-      m_total(0), m_time(0), m_autoclose(autoclose),
+      m_total(0), m_time(0), m_ts(0), m_blen(0), m_autoclose(autoclose),
       m_nodata(false)
 {
     Debug(&__plugin,DebugAll,"WaveSource::WaveSource(\"%s\",%p) [%p]",file,chan,this);
@@ -355,6 +361,48 @@ bool WaveSource::computeDataRate()
     return (m_brate != 0);
 }
 
+// Use the shared media clock if whole 20 ms blocks can be played at each tick
+void WaveSource::startPlay()
+{
+    if (((m_brate * 20) % 1000) || !startClock(20))
+	start("Wave Source");
+}
+
+// Read the next block of data, rewind once at end if autorepeating
+// Returns length read, zero at end of data, negative on error
+int WaveSource::readData(unsigned int blen)
+{
+    int r = m_stream ? m_stream->readData(m_data.data(),m_data.length()) : m_data.length();
+    if (!r && m_stream && (m_repeatPos >= 0)) {
+	DDebug(&__plugin,DebugAll,"Autorepeating from offset " FMT64 " [%p]",
+	    m_repeatPos,this);
+	m_stream->seek(m_repeatPos);
+	m_data.assign(0,blen);
+	r = m_stream->readData(m_data.data(),m_data.length());
+    }
+    if (r <= 0)
+	return r;
+    if (r < (int)m_data.length()) {
+	// if desired and possible extend last byte to fill buffer
+	if (s_dataPadding && ((m_format == "mulaw") || (m_format == "alaw"))) {
+	    unsigned char* d = (unsigned char*)m_data.data();
+	    unsigned char last = d[r-1];
+	    while (r < (int)m_data.length())
+		d[r++] = last;
+	}
+	else
+	    m_data.assign(m_data.data(),r);
+    }
+    if (m_swap) {
+	uint16_t* p = (uint16_t*)m_data.data();
+	for (int i = 0; i < r; i+= 2) {
+	    *p = ntohs(*p);
+	    ++p;
+	}
+    }
+    return r;
+}
+
 void WaveSource::run()
 {
     unsigned long ts = 0;
@@ -386,7 +434,7 @@ void WaveSource::run()
     u_int64_t tpos = 0;
     m_time = tpos;
     while ((r > 0) && looping(noChan)) {
-	r = m_stream ? m_stream->readData(m_data.data(),m_data.length()) : m_data.length();
+	r = readData(blen);
 	if (r < 0) {
 	    if (m_stream->canRetry()) {
 		if (looping(noChan)) {
@@ -400,35 +448,8 @@ void WaveSource::run()
 	// start counting time after the first successful read
 	if (!tpos)
 	    m_time = tpos = Time::now();
-	if (!r) {
-	    if (m_repeatPos >= 0) {
-		DDebug(&__plugin,DebugAll,"Autorepeating from offset " FMT64 " [%p]",
-		    m_repeatPos,this);
-		m_stream->seek(m_repeatPos);
-		m_data.assign(0,blen);
-		r = 1;
-		continue;
-	    }
+	if (!r)
 	    break;
-	}
-	if (r < (int)m_data.length()) {
-	    // if desired and possible extend last byte to fill buffer
-	    if (s_dataPadding && ((m_format == "mulaw") || (m_format == "alaw"))) {
-		unsigned char* d = (unsigned char*)m_data.data();
-		unsigned char last = d[r-1];
-		while (r < (int)m_data.length())
-		    d[r++] = last;
-	    }
-	    else
-		m_data.assign(m_data.data(),r);
-	}
-	if (m_swap) {
-	    uint16_t* p = (uint16_t*)m_data.data();
-	    for (int i = 0; i < r; i+= 2) {
-		*p = ntohs(*p);
-		++p;
-	    }
-	}
 	int64_t dly = tpos - Time::now();
 	if (dly > 0) {
 	    XDebug(&__plugin,DebugAll,"WaveSource sleeping for " FMT64 " usec",dly);
@@ -450,6 +471,48 @@ void WaveSource::run()
     }
 }
 
+// Play one 20 ms block from the media clock
+bool WaveSource::clockTick(u_int64_t when)
+{
+    bool noChan = (0 == m_chan);
+    if (!looping(noChan)) {
+	notify(0,"replaced");
+	return false;
+    }
+    if (!m_blen) {
+	// wait until at least one consumer is attached
+	lock();
+	bool found = (0 != m_consumers.count());
+	unlock();
+	if (!found)
+	    return true;
+	m_blen = (m_brate*20)/1000;
+	DDebug(&__plugin,DebugAll,"Consumer found, starting to play data with rate %d [%p]",m_brate,this);
+	m_data.assign(0,m_blen);
+    }
+    int r = readData(m_blen);
+    if (r < 0) {
+	// try again at the next tick
+	if (m_stream->canRetry())
+	    return true;
+	notify(0,"replaced");
+	return false;
+    }
+    // start counting time after the first successful read
+    if (!m_time)
+	m_time = Time::now();
+    if (!r) {
+	Debug(&__plugin,DebugAll,"WaveSource '%s' end of data (%u played) chan=%p [%p]",
+	    m_id.c_str(),m_total,m_chan,this);
+	notify(this,"eof");
+	return false;
+    }
+    Forward(m_data,m_ts);
+    m_ts += m_data.length()*m_rate/m_brate;
+    m_total += r;
+    return true;
+}
+
 void WaveSource::cleanup()
 {
     RefPointer<CallEndpoint> chan;
@@ -90,6 +90,8 @@ static bool s_warnLater = false;
 static bool s_monitor   = false;
 static bool s_rtcp  = true;
 static bool s_drill = false;
+static bool s_eventLoop = false;
+static bool s_txBatch = false;
 
 static Thread::Priority s_priority = Thread::Normal;
 static int s_tos     = Socket::Normal;
@@ -699,7 +701,9 @@ bool YRTPWrapper::startRTP(const char* raddr, unsigned int rport, Message& msg)
 	    m_consumer->deref();
 	}
     }
-    if (!(m_rtp->initGroup(msec,Thread::priority(msg.getValue(YSTRING("thread")),s_priority)) &&
+    if (!(m_rtp->initGroup(msec,Thread::priority(msg.getValue(YSTRING("thread")),s_priority),
+	    msg.getBoolValue(YSTRING("eventloop"),s_eventLoop),
+	    msg.getBoolValue(YSTRING("txbatch"),s_txBatch)) &&
 	 m_rtp->direction(m_dir)))
 	return false;
 
@@ -759,7 +763,9 @@ bool YRTPWrapper::startUDPTL(const char* raddr, unsigned int rport, Message& msg
     int msec = msg.getIntValue(YSTRING("msleep"),s_sleep);
     if (!setRemote(raddr,rport,msg))
 	return false;
-    if (!m_udptl->initGroup(msec,Thread::priority(msg.getValue(YSTRING("thread")),s_priority)))
+    if (!m_udptl->initGroup(msec,Thread::priority(msg.getValue(YSTRING("thread")),s_priority),
+	    msg.getBoolValue(YSTRING("eventloop"),s_eventLoop),
+	    msg.getBoolValue(YSTRING("txbatch"),s_txBatch)))
 	return false;
 
     m_udptl->setTOS(tos);
@@ -1283,7 +1289,7 @@ YRTPReflector::YRTPReflector(const String& id, bool passiveA, bool passiveB)
     : m_idA(id)
 {
     DDebug(&splugin,DebugInfo,"YRTPReflector::YRTPReflector('%s') [%p]",id.c_str(),this);
-    m_group = new RTPGroup(s_sleep,s_priority);
+    m_group = new RTPGroup(s_sleep,s_priority,s_eventLoop);
     m_rtpA = new RTPTransport;
     m_rtpB = new RTPTransport;
     m_rtpA->setProcessor(m_rtpB);
@@ -1575,7 +1581,40 @@ void YRTPPlugin::statusParams(String& str)
 {
     s_mutex.lock();
     str.append("chans=",",") << s_calls.count();
+    // counters of groups sending in batches, read without locking them
+    ObjList groups;
+    u_int64_t batches = 0;
+    u_int64_t packets = 0;
+    u_int64_t dropped = 0;
+    u_int64_t flushes = 0;
+    u_int64_t latency = 0;
+    u_int64_t maxLatency = 0;
+    unsigned int maxBatch = 0;
+    for (ObjList* l = s_calls.skipNull(); l; l = l->skipNext()) {
+	UDPSession* sess = static_cast<YRTPWrapper*>(l->get())->session();
+	RTPGroup* g = sess ? sess->group() : 0;
+	if (!(g && g->txBatch()) || groups.find(g))
+	    continue;
+	groups.append(g)->setDelete(false);
+	batches += g->txBatches();
+	packets += g->txPackets();
+	dropped += g->txDropped();
+	flushes += g->txFlushes();
+	latency += g->txLatency();
+	if (maxLatency < g->txMaxLatency())
+	    maxLatency = g->txMaxLatency();
+	if (maxBatch < g->txMaxBatch())
+	    maxBatch = g->txMaxBatch();
+    }
     s_mutex.unlock();
+    if (groups.skipNull()) {
+	str << ",txgroups=" << groups.count();
+	str << ",txpackets=" << packets << ",txbatches=" << batches << ",txdropped=" << dropped;
+	str << ",txavgbatch=" << (batches ? (unsigned int)((packets + batches / 2) / batches) : 0);
+	str << ",txmaxbatch=" << maxBatch;
+	str << ",txavglatency=" << (flushes ? (unsigned int)(latency / flushes) : 0);
+	str << ",txmaxlatency=" << (unsigned int)maxLatency;
+    }
     s_refMutex.lock();
     str.append("mirrors=",",") << s_mirrors.count();
     s_refMutex.unlock();
@@ -1868,6 +1907,8 @@ void YRTPPlugin::initialize()
     s_sleep = cfg.getIntValue("general","defsleep",5);
     RTPGroup::setMinSleep(cfg.getIntValue("general","minsleep"));
     s_priority = Thread::priority(cfg.getValue("general","thread"));
+    s_eventLoop = cfg.getBoolValue("general","eventloop",false);
+    s_txBatch = cfg.getBoolValue("general","txbatch",false);
     s_rtpWarnSeq = cfg.getBoolValue("general","rtp_warn_seq",true);
     s_timeout = cfg.getIntValue("timeouts","timeout",3000);
     s_udptlTimeout = cfg.getIntValue("timeouts","udptl_timeout",25000);
@@ -25,6 +25,12 @@
 
 #include <string.h>
 
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <unistd.h>
+#define SIP_REACTOR
+#endif
+
 
 using namespace TelEngine;
 namespace { // anonymous
@@ -35,6 +41,7 @@ class YateSIPTransport;                  // SIP transport: keeps a socket, read/
 class YateSIPUDPTransport;               // UDP transport
 class YateSIPTCPTransport;               // TCP/TLS transport
 class YateSIPTransportWorker;            // A transport worker
+class YateSIPTCPReactor;                 // Event loop shared by incoming TCP/TLS transports
 class YateSIPTCPListener;                // A TCP listener
 class YateUDPParty;                      // A SIP UDP party
 class YateTCPParty;                      // A SIP TCP/TLS party
@@ -58,6 +65,11 @@ class SIPDriver;
 // 1 minute
 #define BIND_RETRY_MAX 60000
 
+// Interval in milliseconds to check the timers of TCP transports in a reactor
+#define REACTOR_TICK 100
+// Maximum number of socket events handled by a reactor in one wait
+#define REACTOR_EVENTS 64
+
 static const TokenDict dict_errors[] = {
     { "incomplete", 484 },
     { "noroute", 404 },
@@ -324,6 +336,7 @@ class YateSIPTransport : public Mutex, public RefObject, public ProtocolHolder
     friend class SIPDriver;
     friend class YateSIPEndPoint;
     friend class YateSIPTransportWorker;
+    friend class YateSIPTCPReactor;
 public:
     enum Status {
 	Idle = 0,
@@ -417,6 +430,7 @@ protected:
     String m_rtpLocalAddr;               // RTP local address
     String m_rtpNatAddr;                 // NAT IP to override RTP local address
     YateSIPTransportWorker* m_worker;    // Transport worker
+    YateSIPTCPReactor* m_reactor;        // Reactor watching the transport instead of a worker
     bool m_initialized;                  // Flag reset when initializing by the module and set in init()
     String m_protoAddr;                  // Proto + addr: used for debug (send/recv msg)
 private:
@@ -452,7 +466,9 @@ protected:
 class YateSIPTCPTransport : public YateSIPTransport
 {
     YCLASS(YateSIPTCPTransport,YateSIPTransport);
+    friend class YateSIPTransport;
     friend class YateTCPParty;
+    friend class YateSIPTCPReactor;
 public:
     // Build an outgoing transport
     YateSIPTCPTransport(bool tls, const String& laddr, const String& raddr, int rport);
@@ -506,6 +522,11 @@ protected:
 	    m_keepAlivePending = false;
 	    return sendKeepAlive(false);
 	}
+    // Check if a reactor must process the transport without socket events
+    bool timerDue(u_int64_t now) const;
+    // Ask the reactor to watch for writability if there is data to send
+    // Must be called with the transport locked
+    void updatePoll();
 
     bool m_outgoing;                     // Direction
     YateTCPParty* m_party;               // Transport party
@@ -519,7 +540,8 @@ protected:
     bool m_flowTimer;                    // Flow timer flag (RFC5626)
     bool m_keepAlivePending;             // Pending keep alive response
     SIPMessage* m_msg;                   // Partially received SIP message (expecting body)
-    DataBlock m_sipBuffer;               // Accumulated read data
+    DataBlock m_sipBuffer;               // Read buffer, starts with unparsed data
+    unsigned int m_sipBufLen;            // Length of unparsed data in sip buffer
     unsigned int m_sipBufOffs;           // Offset in sip buffer for partial sip message
     unsigned int m_contentLen;           // Expected content length for partial sip message
     // Outgoing (re-connect info)
@@ -528,6 +550,9 @@ protected:
     String m_localAddr;                  // Optional local address to bind to
     unsigned int m_connectRetry;         // Number of re-connect
     u_int64_t m_nextConnect;             // Interval to try ro re-connect
+    // Reactor state
+    bool m_pollOut;                      // Reactor watches for writability
+    bool m_pollGone;                     // Reactor must release the transport
 };
 
 // Transport worker
@@ -543,6 +568,36 @@ private:
     YateSIPTransport* m_transport;
 };
 
+#ifdef SIP_REACTOR
+// Event loop multiplexing incoming TCP/TLS transports with epoll
+// Each reactor owns the reference a worker would hold on its transports
+class YateSIPTCPReactor : public Thread, public GenObject, public Mutex
+{
+public:
+    YateSIPTCPReactor(Thread::Priority prio);
+    ~YateSIPTCPReactor();
+    inline bool valid() const
+	{ return m_poll >= 0; }
+    virtual void run();
+    // Change the events watched on the socket of a transport
+    // Must be called with the transport locked
+    void watch(YateSIPTCPTransport* trans, bool out);
+    // Hand a transport to the least loaded reactor, start one if needed
+    // Return false if reactors are disabled or none could be started
+    static bool attach(YateSIPTCPTransport* trans, Thread::Priority prio);
+private:
+    bool add(YateSIPTCPTransport* trans);
+    void process(YateSIPTCPTransport* trans);
+    void release(YateSIPTCPTransport* trans);
+    int m_poll;                          // The epoll handle
+    unsigned int m_count;                // Number of transports handled
+    ObjList m_added;                     // Transports added since last wait
+    ObjList m_transports;                // Transports handled, used only by the reactor
+    ObjList m_again;                     // Transports to process again without waiting
+    ObjList m_gone;                      // Transports to release after processing
+};
+#endif
+
 class YateSIPTCPListener : public Thread, public GenObject, public ProtocolHolder, public YateSIPListener
 {
     friend class SIPDriver;
@@ -643,11 +698,6 @@ public:
     bool hasActiveTransaction(YateSIPTransport* trans);
     // Check if the engine has pending transactions
     bool hasInitialTransaction();
-    // Clear transactions
-    inline void clearTransactions() {
-	    Lock lck(this);
-	    m_transList.clear();
-	}
     inline bool prack() const
 	{ return m_prack; }
     inline bool info() const
@@ -1227,6 +1277,8 @@ static unsigned int s_tcpConnectRetry = 3; // Number of TCP connect attempts
 static u_int64_t s_tcpConnectInterval = 1000000; // The interval to attempt tcp connect
 static unsigned int s_tcpIdle = TCP_IDLE_DEF; // TCP transport idle interval
 static unsigned int s_tcpMaxpkt = 1500;  // Maximum packet to accept on TCP connections
+static unsigned int s_tcpReactors = 0;   // Reactor threads for incoming TCP/TLS, 0 for a thread each
+static ObjList s_reactors;               // Running reactors (protected by s_globalMutex)
 static String s_tcpOutRtpip;             // RTP ip for outgoing tcp/tls transports (protected by plugin mutex)
 static bool s_lineKeepTcpOffline = true; // Lines: keep TCP transports when offline
 static String s_sslCertFile;             // File containing the SSL client certificate to present if requested by the server
@@ -1703,7 +1755,7 @@ static bool matchAny(const String& name, const char** strs)
 // Copy headers from SIP message to Yate message
 static void copySipHeaders(NamedList& msg, const SIPMessage& sip, bool filter = true, bool auth = false)
 {
-    const ObjList* l = sip.header.skipNull();
+    const ObjList* l = sip.allHeaders().skipNull();
     for (; l; l = l->skipNext()) {
 	const MimeHeaderLine* t = static_cast<const MimeHeaderLine*>(l->get());
 	String name(t->name());
@@ -2760,7 +2812,7 @@ YateSIPTransport::YateSIPTransport(int proto, const String& id, Socket* sock, in
     ProtocolHolder(proto),
     m_id(id), m_status(stat), m_statusChgTime(Time::secNow()),
     m_sock(sock), m_maxpkt(1500),
-    m_worker(0), m_initialized(false)
+    m_worker(0), m_reactor(0), m_initialized(false)
 {
 }
 
@@ -2852,6 +2904,27 @@ void YateSIPTransport::terminate(const char* reason)
 {
     XDebug(&plugin,DebugInfo,"YateSIPTransport::terminate(%s) [%p]",reason,this);
     changeStatus(Terminating);
+#ifdef SIP_REACTOR
+    if (m_reactor) {
+	bool wait = false;
+	lock();
+	YateSIPTCPTransport* tcp = tcpTransport();
+	if (m_reactor && tcp) {
+	    // The reactor will release us when done processing
+	    tcp->m_pollGone = true;
+	    wait = (Thread::current() != m_reactor);
+	}
+	unlock();
+	if (wait) {
+	    unsigned int n = 500;
+	    while (m_reactor && n--)
+		Thread::idle();
+	    if (m_reactor)
+		Debug(&plugin,DebugFail,"Transport(%s) terminating while in reactor [%p]",
+		    m_id.c_str(),this);
+	}
+    }
+#endif
     if (m_worker) {
 	bool wait = false;
 	lock();
@@ -3215,9 +3288,10 @@ YateSIPTCPTransport::YateSIPTCPTransport(bool tls, const String& laddr, const St
     m_outgoing(true), m_party(0), m_sent(-1),
     m_idleInterval(TCP_IDLE_DEF), m_idleTimeout(0),
     m_flowTimer(false), m_keepAlivePending(false),
-    m_msg(0), m_sipBufOffs(0), m_contentLen(0),
+    m_msg(0), m_sipBufLen(0), m_sipBufOffs(0), m_contentLen(0),
     m_remoteAddr(raddr), m_remotePort(rport), m_localAddr(laddr),
-    m_connectRetry(s_tcpConnectRetry), m_nextConnect(0)
+    m_connectRetry(s_tcpConnectRetry), m_nextConnect(0),
+    m_pollOut(false), m_pollGone(false)
 {
     m_maxpkt = s_tcpMaxpkt;
     if (m_remotePort <= 0)
@@ -3235,8 +3309,9 @@ YateSIPTCPTransport::YateSIPTCPTransport(Socket* sock, bool tls)
     m_outgoing(false), m_party(0), m_sent(-1),
     m_idleInterval(TCP_IDLE_DEF), m_idleTimeout(0),
     m_flowTimer(false), m_keepAlivePending(false),
-    m_msg(0), m_sipBufOffs(0), m_contentLen(0),
-    m_remotePort(0), m_connectRetry(0), m_nextConnect(0)
+    m_msg(0), m_sipBufLen(0), m_sipBufOffs(0), m_contentLen(0),
+    m_remotePort(0), m_connectRetry(0), m_nextConnect(0),
+    m_pollOut(false), m_pollGone(false)
 {
     m_maxpkt = s_tcpMaxpkt;
     m_id << (tls ? "tls:" : "tcp:");
@@ -3268,8 +3343,14 @@ bool YateSIPTCPTransport::init(const NamedList& params, bool first, Thread::Prio
     Debug(&plugin,DebugAll,
 	"Transport(%s) initialized maxpkt=%u rtp_localip=%s nat_address=%s tcp_idle=%u [%p]",
 	m_id.c_str(),m_maxpkt,m_rtpLocalAddr.c_str(),m_rtpNatAddr.c_str(),m_idleInterval,this);
-    if (ok && first)
+    if (ok && first) {
+#ifdef SIP_REACTOR
+	// Outgoing transports keep a worker as connecting may block
+	if (!m_outgoing && YateSIPTCPReactor::attach(this,prio))
+	    return true;
+#endif
 	ok = startWorker(prio);
+    }
     return ok;
 }
 
@@ -3302,6 +3383,7 @@ bool YateSIPTCPTransport::send(SIPEvent* event)
     if (!msg->ref())
 	return false;
     m_queue.append(msg);
+    updatePoll();
 #ifdef XDEBUG
     String tmp;
     getMsgLine(tmp,msg);
@@ -3659,8 +3741,18 @@ bool YateSIPTCPTransport::sendPending(const Time& time, bool& sent)
 bool YateSIPTCPTransport::readData(const Time& time, bool& read)
 {
     read = false;
-    m_buffer.resize(m_maxpkt);
-    int res = m_sock->readData((void*)m_buffer.data(),m_buffer.length() - 1);
+    // Read after any unparsed data, messages are parsed straight from the buffer
+    unsigned int size = 2 * m_maxpkt;
+    if (size < m_sipBufLen + m_maxpkt)
+	size = m_sipBufLen + m_maxpkt;
+    if (m_sipBuffer.length() < size) {
+	DataBlock tmp(m_sipBuffer.data(),m_sipBufLen);
+	m_sipBuffer.assign(0,size);
+	if (m_sipBufLen)
+	    ::memcpy(m_sipBuffer.data(),tmp.data(),m_sipBufLen);
+    }
+    char* buf = (char*)m_sipBuffer.data();
+    int res = m_sock->readData(buf + m_sipBufLen,m_maxpkt - 1);
     if (res < 0) {
 	printReadError();
 	return m_sock->canRetry();
@@ -3673,23 +3765,18 @@ bool YateSIPTCPTransport::readData(const Time& time, bool& read)
     read = true;
 #ifdef XDEBUG
 #if 0
-    String nb((const char*)m_buffer.data(),res);
-    String ob((const char*)m_sipBuffer.data(),m_sipBuffer.length());
+    String nb(buf + m_sipBufLen,res);
+    String ob(buf,m_sipBufLen);
 #else
     String nb, ob;
-    nb.hexify(m_buffer.data(),res,' ');
-    ob.hexify(m_sipBuffer.data(),m_sipBuffer.length(),' ');
+    nb.hexify(buf + m_sipBufLen,res,' ');
+    ob.hexify(buf,m_sipBufLen,' ');
 #endif
     Debug(&plugin,DebugAll,"%s current buffer %u '%s' read %d '%s' [%p]",
-	m_id.c_str(),m_sipBuffer.length(),ob.safe(),res,nb.safe(),this);
+	m_id.c_str(),m_sipBufLen,ob.safe(),res,nb.safe(),this);
 #endif
-    const char* data = (const char*)m_buffer.data();
-    unsigned int len = res;
-    if (m_sipBuffer.length()) {
-	m_sipBuffer.append(m_buffer.data(),len);
-	len = m_sipBuffer.length();
-	data = (const char*)m_sipBuffer.data();
-    }
+    const char* data = buf;
+    unsigned int len = m_sipBufLen + res;
     bool ok = true;
     unsigned int over = 0;
     bool respond = false;
@@ -3756,10 +3843,10 @@ bool YateSIPTCPTransport::readData(const Time& time, bool& read)
 	len -= m_sipBufOffs;
 	m_sipBufOffs = 0;
     }
-    if (!len)
-	m_sipBuffer.clear();
-    else
-	m_sipBuffer.assign((void*)data,len);
+    // Keep unparsed data at buffer start
+    if (len && (data != buf))
+	::memmove(buf,data,len);
+    m_sipBufLen = len;
     if (!ok) {
 	if (over) {
 	    m_reason = "Buffer overflow (message too long)";
@@ -3789,6 +3876,7 @@ void YateSIPTCPTransport::resetConnection(Socket* sock)
     TelEngine::destruct(m_msg);
     m_sent = -1;
     m_sipBuffer.clear();
+    m_sipBufLen = 0;
     m_sipBufOffs = 0;
     m_contentLen = 0;
     m_keepAlivePending = false;
@@ -3822,6 +3910,24 @@ void YateSIPTCPTransport::setIdleTimeout(u_int64_t time)
 	m_id.c_str(),(unsigned int)(m_idleTimeout / 1000000),this);
 }
 
+// Check if a reactor must process the transport without socket events
+bool YateSIPTCPTransport::timerDue(u_int64_t now) const
+{
+    return s_engineHalt || !(m_sock && m_sock->valid()) || (m_idleTimeout <= now);
+}
+
+// Ask the reactor to watch for writability if there is data to send
+void YateSIPTCPTransport::updatePoll()
+{
+#ifdef SIP_REACTOR
+    if (!(m_reactor && m_sock && m_sock->valid()))
+	return;
+    bool out = m_keepAlivePending || m_queue.skipNull();
+    if (out != m_pollOut)
+	m_reactor->watch(this,out);
+#endif
+}
+
 bool YateSIPTCPTransport::sendKeepAlive(bool request)
 {
     XDebug(&plugin,DebugAll,"Transport(%s) sending keep alive%s [%p]",
@@ -3899,6 +4005,213 @@ void YateSIPTransportWorker::cleanupTransport(bool final, bool terminate)
 }
 
 
+#ifdef SIP_REACTOR
+YateSIPTCPReactor::YateSIPTCPReactor(Thread::Priority prio)
+    : Thread("YSIP Reactor",prio), Mutex(false,"YateSIPTCPReactor"),
+    m_poll(-1), m_count(0)
+{
+    m_poll = ::epoll_create1(EPOLL_CLOEXEC);
+    if (m_poll < 0)
+	Debug(&plugin,DebugWarn,"Reactor could not create event poll: %d [%p]",errno,this);
+    XDebug(&plugin,DebugAll,"YateSIPTCPReactor created [%p]",this);
+}
+
+YateSIPTCPReactor::~YateSIPTCPReactor()
+{
+    s_globalMutex.lock();
+    s_reactors.remove(this,false);
+    s_globalMutex.unlock();
+    if (m_poll >= 0)
+	::close(m_poll);
+    XDebug(&plugin,DebugAll,"YateSIPTCPReactor destroyed [%p]",this);
+}
+
+void YateSIPTCPReactor::run()
+{
+    DDebug(&plugin,DebugAll,"YateSIPTCPReactor started [%p]",this);
+    struct epoll_event events[REACTOR_EVENTS];
+    u_int64_t tick = 0;
+    while (!Thread::check(false)) {
+	lock();
+	for (ObjList* o = m_added.skipNull(); o; o = o->skipNext())
+	    m_transports.append(o->get())->setDelete(false);
+	m_added.clear();
+	bool done = s_engineHalt && !m_count;
+	unlock();
+	if (done) {
+	    // Make sure no transport is handed to us while leaving
+	    Lock lck(s_globalMutex);
+	    Lock myLck(this);
+	    if (!m_count) {
+		s_reactors.remove(this,false);
+		break;
+	    }
+	    continue;
+	}
+	int msec = 0;
+	if (!m_again.skipNull()) {
+	    u_int64_t now = Time::now();
+	    if (tick > now)
+		msec = (int)((tick - now + 999) / 1000);
+	}
+	int n = ::epoll_wait(m_poll,events,REACTOR_EVENTS,msec);
+	if (n < 0) {
+	    if (errno != EINTR) {
+		Debug(&plugin,DebugWarn,"Reactor wait failed: %d [%p]",errno,this);
+		Thread::idle();
+	    }
+	    continue;
+	}
+	for (int i = 0; i < n; i++)
+	    process(static_cast<YateSIPTCPTransport*>(events[i].data.ptr));
+	// Transports that may have more data buffered in the socket layer (TLS)
+	if (m_again.skipNull()) {
+	    ObjList again;
+	    for (ObjList* o = m_again.skipNull(); o; o = o->skipNext())
+		again.append(o->get())->setDelete(false);
+	    m_again.clear();
+	    for (ObjList* o = again.skipNull(); o; o = o->skipNext())
+		process(static_cast<YateSIPTCPTransport*>(o->get()));
+	}
+	// Shared timer: idle timeouts, termination requests, engine halt
+	u_int64_t now = Time::now();
+	if (now >= tick) {
+	    tick = now + (s_engineHalt ? Thread::idleUsec() : REACTOR_TICK * 1000);
+	    for (ObjList* o = m_transports.skipNull(); o; o = o->skipNext()) {
+		YateSIPTCPTransport* trans = static_cast<YateSIPTCPTransport*>(o->get());
+		if (trans->m_pollGone || trans->timerDue(now))
+		    process(trans);
+	    }
+	}
+	while (GenObject* gone = m_gone.remove(false))
+	    release(static_cast<YateSIPTCPTransport*>(gone));
+    }
+    // Cancelled: release the transports without terminating them
+    lock();
+    for (ObjList* o = m_added.skipNull(); o; o = o->skipNext())
+	m_transports.append(o->get())->setDelete(false);
+    m_added.clear();
+    unlock();
+    m_gone.clear();
+    while (ObjList* o = m_transports.skipNull())
+	release(static_cast<YateSIPTCPTransport*>(o->get()));
+    DDebug(&plugin,DebugAll,"YateSIPTCPReactor terminated [%p]",this);
+}
+
+// Change the events watched on the socket of a transport
+void YateSIPTCPReactor::watch(YateSIPTCPTransport* trans, bool out)
+{
+    struct epoll_event ev;
+    ::memset(&ev,0,sizeof(ev));
+    ev.events = out ? (EPOLLIN | EPOLLOUT) : EPOLLIN;
+    ev.data.ptr = trans;
+    if (::epoll_ctl(m_poll,EPOLL_CTL_MOD,trans->m_sock->handle(),&ev))
+	Debug(&plugin,DebugMild,"Reactor could not watch transport (%p,%s): %d [%p]",
+	    trans,trans->toString().c_str(),errno,this);
+    else
+	trans->m_pollOut = out;
+}
+
+// Hand a transport to the least loaded reactor, start one if needed
+bool YateSIPTCPReactor::attach(YateSIPTCPTransport* trans, Thread::Priority prio)
+{
+    Lock lck(s_globalMutex);
+    if (!s_tcpReactors)
+	return false;
+    YateSIPTCPReactor* reactor = 0;
+    unsigned int n = 0;
+    for (ObjList* o = s_reactors.skipNull(); o; o = o->skipNext()) {
+	YateSIPTCPReactor* r = static_cast<YateSIPTCPReactor*>(o->get());
+	n++;
+	if (!reactor || r->m_count < reactor->m_count)
+	    reactor = r;
+    }
+    if (!reactor || (reactor->m_count && n < s_tcpReactors)) {
+	YateSIPTCPReactor* r = new YateSIPTCPReactor(prio);
+	if (r->valid() && r->startup()) {
+	    s_reactors.append(r)->setDelete(false);
+	    reactor = r;
+	    Debug(&plugin,DebugInfo,"Started reactor %u of %u [%p]",n + 1,s_tcpReactors,r);
+	}
+	else {
+	    Debug(&plugin,DebugWarn,"Failed to start TCP reactor thread");
+	    delete r;
+	}
+    }
+    return reactor && reactor->add(trans);
+}
+
+// Start watching a transport, take over the reference owned by a worker
+bool YateSIPTCPReactor::add(YateSIPTCPTransport* trans)
+{
+    Lock lck(this);
+    Lock lckTrans(trans);
+    if (!(trans->m_sock && trans->m_sock->valid()))
+	return false;
+    struct epoll_event ev;
+    ::memset(&ev,0,sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.ptr = trans;
+    if (::epoll_ctl(m_poll,EPOLL_CTL_ADD,trans->m_sock->handle(),&ev)) {
+	Debug(&plugin,DebugWarn,"Reactor could not watch transport (%p,%s): %d [%p]",
+	    trans,trans->toString().c_str(),errno,this);
+	return false;
+    }
+    trans->m_reactor = this;
+    trans->m_pollOut = false;
+    trans->m_pollGone = false;
+    m_added.append(trans)->setDelete(false);
+    m_count++;
+    // Data may have been queued before we were watching the socket
+    trans->updatePoll();
+    DDebug(&plugin,DebugAll,"Reactor handling transport (%p,%s) count=%u [%p]",
+	trans,trans->toString().c_str(),m_count,this);
+    return true;
+}
+
+// Read and send data, the worker loop for one transport
+void YateSIPTCPReactor::process(YateSIPTCPTransport* trans)
+{
+    if (!trans->m_pollGone) {
+	// Keep the transport alive while calling its method
+	RefPointer<YateSIPTransport> tmp = trans;
+	int n = trans->process();
+	if (n < 0)
+	    trans->terminate();
+	else if (!(n || m_again.find(trans)))
+	    m_again.append(trans)->setDelete(false);
+	if (!trans->m_pollGone) {
+	    Lock lck(trans);
+	    trans->updatePoll();
+	    return;
+	}
+    }
+    if (!m_gone.find(trans))
+	m_gone.append(trans)->setDelete(false);
+}
+
+// Stop watching a transport and drop our reference to it
+void YateSIPTCPReactor::release(YateSIPTCPTransport* trans)
+{
+    DDebug(&plugin,DebugAll,"Reactor releasing transport (%p,%s) [%p]",
+	trans,trans->toString().c_str(),this);
+    trans->lock();
+    trans->m_reactor = 0;
+    // A closed socket was already removed from the poll
+    if (trans->m_sock && trans->m_sock->valid())
+	::epoll_ctl(m_poll,EPOLL_CTL_DEL,trans->m_sock->handle(),0);
+    trans->unlock();
+    m_transports.remove(trans,false);
+    m_again.remove(trans,false);
+    lock();
+    m_added.remove(trans,false);
+    m_count--;
+    unlock();
+    trans->deref();
+}
+#endif
+
+
 YateSIPTCPListener::YateSIPTCPListener(int proto, const String& name, const NamedList& params)
     : Thread("YSIP Listener",Thread::priority(params.getValue("thread"))),
     ProtocolHolder(proto),
@@ -4559,7 +4872,7 @@ bool YateSIPEngine::checkUser(String& username, const String& realm, const Strin
 	hl = message->getHeader("User-Agent");
 	if (hl)
 	    m.addParam("device",*hl);
-	for (const ObjList* l = message->header.skipNull(); l; l = l->skipNext()) {
+	for (const ObjList* l = message->allHeaders().skipNull(); l; l = l->skipNext()) {
 	    hl = static_cast<const MimeHeaderLine*>(l->get());
 	    String name(hl->name());
 	    name.toLower();
@@ -8907,6 +9220,11 @@ void SIPDriver::initialize()
     }
     s_printMsg = s_cfg.getBoolValue("general","printmsg",true);
     s_tcpMaxpkt = getMaxpkt(s_cfg.getIntValue("general","tcp_maxpkt",4096),4096);
+#ifdef SIP_REACTOR
+    s_globalMutex.lock();
+    s_tcpReactors = s_cfg.getIntValue("general","tcp_reactors",0,0,64);
+    s_globalMutex.unlock();
+#endif
     s_lineKeepTcpOffline = s_cfg.getBoolValue("general","line_keeptcpoffline",!Engine::clientMode());
     s_defEncoding = s_cfg.getIntValue("general","body_encoding",SipHandler::s_bodyEnc,SipHandler::BodyBase64);
     s_gen_async = s_cfg.getBoolValue("general","async_generic",true);
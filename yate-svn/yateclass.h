@@ -225,7 +225,9 @@ namespace TelEngine {
 #define YIGNORE(v) while (v) { break; }
 
 #ifdef HAVE_BLOCK_RETURN
-#define YSTRING(s) (*({static const String str(s);&str;}))
+// Constant strings are interned as atoms so matching them against interned
+//  parameter or message names succeeds on the address compare
+#define YSTRING(s) (*({static const String* str(0);str ? str : String::atom(str,s);}))
 #define YATOM(s) (*({static const String* str(0);str ? str : String::atom(str,s);}))
 #else
 #define YSTRING(s) (s)
@@ -2764,6 +2766,26 @@ public:
      */
     static const String* atom(const String*& str, const char* val);
 
+    /**
+     * Find or create an atom string.
+     * Atoms are never released, lookups of existing ones don't lock.
+     * The returned pointer is a stable identifier: two atoms are equal
+     *  if and only if they are the same object
+     * @param val String value of the atom
+     * @param limit True to refuse creating more atoms once the table is
+     *  large or for long values
+     * @return Pointer to shared atom string, NULL if a limit prevented creation
+     */
+    static const String* atom(const char* val, bool limit = false);
+
+    /**
+     * Find an existing atom string without creating it.
+     * The lookup never locks so it fails if atomic operations are not available
+     * @param val String value of the atom
+     * @return Pointer to shared atom string, NULL if not found
+     */
+    static const String* atomLookup(const char* val);
+
 protected:
     /**
      * Called whenever the value changed (except in constructors).
@@ -2867,6 +2889,7 @@ YATE_API int lookup(const char* str, const TokenDict* tokens, int defvalue = 0,
 YATE_API const char* lookup(int value, const TokenDict* tokens, const char* defvalue = 0);
 
 class NamedList;
+class ParamArena;
 
 /**
  * Utility method to return from a chan.control handler
@@ -3093,12 +3116,35 @@ public:
      */
     explicit NamedString(const char* name, const char* value = 0);
 
+    /**
+     * Creates a new named string sharing an atom as name.
+     * The name is not copied so it must never be modified
+     * @param name Pointer to an atom string obtained from String::atom()
+     * @param value Initial value of the string
+     */
+    NamedString(const String* name, const char* value);
+
     /**
      * Retrieve the name of this string.
      * @return A hashed string with the name of the string
      */
     inline const String& name() const
-	{ return m_name; }
+	{ return m_atom ? *m_atom : m_name; }
+
+    /**
+     * Retrieve the shared atom used as name, if any
+     * @return Pointer to the atom string, NULL if the name is owned
+     */
+    inline const String* atom() const
+	{ return m_atom; }
+
+    /**
+     * Change the name of this string.
+     * A shared atom name is dropped and replaced by an owned copy, the name
+     *  must never be modified through the reference returned by name()
+     * @param name New name of the string
+     */
+    void rename(const char* name);
 
     /**
      * Get a string representation of this object
@@ -3119,9 +3165,39 @@ public:
     inline NamedString& operator=(const char* value)
 	{ String::operator=(value); return *this; }
 
+    /**
+     * Allocate memory for a named string from the heap
+     * @param size Size of the object to allocate
+     * @return Pointer to the allocated memory
+     */
+    static void* operator new(size_t size);
+
+    /**
+     * Allocate memory for a named string from a parameter arena.
+     * Falls back to the heap if the arena is missing or exhausted
+     * @param size Size of the object to allocate
+     * @param arena Arena to allocate from, it gets referenced by the object
+     * @return Pointer to the allocated memory
+     */
+    static void* operator new(size_t size, ParamArena* arena);
+
+    /**
+     * Release memory of a named string to the heap or the arena it came from
+     * @param ptr Pointer to the memory to release
+     */
+    static void operator delete(void* ptr);
+
+    /**
+     * Release memory if construction failed after an arena allocation
+     * @param ptr Pointer to the memory to release
+     * @param arena Arena used for allocation
+     */
+    static void operator delete(void* ptr, ParamArena* arena);
+
 private:
     NamedString(); // no default constructor please
     String m_name;
+    const String* m_atom;
 };
 
 /**
@@ -3303,13 +3379,28 @@ public:
     inline ObjList* getList(unsigned int index) const
 	{ return (index < m_size) ? m_lists[index] : 0; }
 
+    /**
+     * Retrieve the index of the internal list that holds a given hash value
+     * @param hash Hash value to locate
+     * @return Index of the internal list, less than the number of hash entries
+     */
+    inline unsigned int index(unsigned int hash) const
+    {
+	if (m_maxLoad)
+	    hash = spread(hash);
+	if (!m_split)
+	    return hash % m_size;
+	unsigned int i = hash % (m_base << 1);
+	return (i < m_size) ? i : (i - m_base);
+    }
+
     /**
      * Retrieve one of the internal object lists knowing the hash value.
      * @param hash Hash of the internal list to retrieve
      * @return Pointer to the list or NULL if never filled
      */
     inline ObjList* getHashList(unsigned int hash) const
-	{ return getList(hash % m_size); }
+	{ return getList(index(hash)); }
 
     /**
      * Retrieve one of the internal object lists knowing the String value.
@@ -3397,9 +3488,59 @@ public:
      */
     bool resync();
 
+    /**
+     * Enable or disable automatic growth of the list. When the average number
+     *  of items in a hash entry exceeds the load factor the list grows
+     *  incrementally, splitting a few hash entries on each insert.
+     * Objects moved to a new hash entry are held by new list items so any
+     *  previously retrieved item and internal list iteration may be invalidated
+     *  by insertions
+     * @param load Maximum average number of items per hash entry, 0 to disable growth
+     * @param maxSize Maximum number of hash entries to grow to
+     */
+    void setMaxLoad(unsigned int load, unsigned int maxSize = 65536);
+
+    /**
+     * Retrieve the maximum load factor of the list
+     * @return Maximum average number of items per hash entry, 0 if growth is disabled
+     */
+    inline unsigned int maxLoad() const
+	{ return m_maxLoad; }
+
+    /**
+     * Check the list load and grow it if needed. This method is called by append(),
+     *  it must be called after objects are inserted directly in internal lists
+     * @param added Number of objects that were inserted
+     * @return True if the list grew
+     */
+    bool checkLoad(unsigned int added = 1);
+
+    /**
+     * Retrieve the distribution of objects in the internal lists
+     * @param used Filled with the number of non empty hash entries
+     * @param longest Filled with the number of objects in the longest hash entry
+     * @return Count of items
+     */
+    unsigned int stats(unsigned int& used, unsigned int& longest) const;
+
 private:
+    // Mix hash bits, growing lists split entries using the low bits
+    static inline unsigned int spread(unsigned int hash)
+    {
+	hash ^= hash >> 16;
+	hash *= 0x45d9f3b;
+	return hash ^ (hash >> 16);
+    }
+    bool split();
     unsigned int m_size;
+    unsigned int m_base;
+    unsigned int m_split;
+    unsigned int m_alloc;
     ObjList** m_lists;
+    unsigned int m_maxLoad;
+    unsigned int m_maxSize;
+    unsigned int m_check;
+    unsigned int m_splits;
 };
 
 /**
@@ -3749,6 +3890,14 @@ class YATE_API DataBlock : public GenObject
 {
 public:
 
+    /**
+     * Function converting a number of samples from one format to another
+     * @param dest Buffer receiving the converted samples
+     * @param src Buffer holding the samples to convert
+     * @param samples Number of samples to convert
+     */
+    typedef void (*Converter)(void* dest, const void* src, unsigned int samples);
+
     /**
      * Constructs an empty data block
      * @param overAlloc How many bytes of memory to overallocate
@@ -3794,6 +3943,15 @@ public:
      */
     static const DataBlock& empty();
 
+    /**
+     * Append the statistics of the small buffers pool to a string.
+     * Small data blocks are allocated from size classes cached per thread so
+     *  media buffers can be reused without calling the system allocator.
+     * @param str String to append the statistics to
+     * @param details True to append the statistics of each size class
+     */
+    static void poolStatus(String& str, bool details = true);
+
     /**
      * Get a pointer to the stored data.
      * @return A pointer to the data or NULL.
@@ -3956,6 +4114,33 @@ public:
     bool convert(const DataBlock& src, const String& sFormat,
 	const String& dFormat, unsigned maxlen = 0);
 
+    /**
+     * Convert data using a function obtained from @ref converter()
+     * @param src Source data block
+     * @param func Function converting samples between the two formats
+     * @param sSize Size in bytes of a source sample
+     * @param dSize Size in bytes of a destination sample
+     * @param maxlen Maximum amount to convert, 0 to use source
+     * @return True if converted successfully, false on failure
+     */
+    bool convert(const DataBlock& src, Converter func, unsigned int sSize,
+	unsigned int dSize, unsigned maxlen = 0);
+
+    /**
+     * Find the function that converts samples between two formats supported
+     *  by @ref convert(). Resolve it once and keep it to avoid comparing the
+     *  format names for each block of data.
+     * @param sFormat Name of the source format
+     * @param dFormat Name of the destination format
+     * @param sSize Filled with the size in bytes of a source sample
+     * @param dSize Filled with the size in bytes of a destination sample
+     * @param simd True to pick the fastest implementation the CPU supports,
+     *  false to use the plain table lookup
+     * @return Pointer to the conversion function, NULL if not supported
+     */
+    static Converter converter(const String& sFormat, const String& dFormat,
+	unsigned int& sSize, unsigned int& dSize, bool simd = true);
+
     /**
      * Build this data block from a hexadecimal string representation.
      * Each octet must be represented in the input string with 2 hexadecimal characters.
@@ -4519,9 +4704,14 @@ public:
 };
 
 class NamedIterator;
+class NamedListIndex;
 
 /**
- * This class holds a named list of named strings
+ * This class holds a named list of named strings.
+ * Lists that are searched past a small number of parameters get a lazily
+ *  built hash index of parameter names so lookups don't walk the whole list.
+ * Names of parameters created by the list are interned as shared atoms when
+ *  possible so lookups with atom names (like YSTRING) match by address.
  * @short A named string container class
  */
 class YATE_API NamedList : public String
@@ -4555,6 +4745,11 @@ public:
      */
     NamedList& operator=(const NamedList& value);
 
+    /**
+     * Destructor, releases the name index if one was built
+     */
+    virtual ~NamedList();
+
     /**
      * Get a pointer to a derived class given that class name
      * @param name Name of the class we are asking for
@@ -4580,7 +4775,7 @@ public:
      * Clear all parameters
      */
     inline void clearParams()
-	{ m_params.clear(); }
+	{ dropIndex(); m_params.clear(); }
 
     /**
      * Add a named string to the parameter list.
@@ -4603,12 +4798,7 @@ public:
      * @param param Parameter to set or add
      * @return Reference to this NamedList
      */
-    inline NamedList& setParam(NamedString* param)
-    {
-	if (param)
-	    m_params.setUnique(param);
-	return *this;
-    }
+    NamedList& setParam(NamedString* param);
 
     /**
      * Set a named string in the parameter list.
@@ -4806,11 +4996,14 @@ public:
     static const NamedList& empty();
 
     /**
-     * Get the parameters list
+     * Get the parameters list for direct manipulation.
+     * This discards the name index as the caller may reorder, remove or
+     *  rename parameters behind the list's back, read only walks should
+     *  use the const version which keeps it
      * @return Pointer to the parameters list
      */
     inline ObjList* paramList()
-	{ return &m_params; }
+	{ dropIndex(); return &m_params; }
 
     /**
      * Get the parameters list
@@ -4819,9 +5012,32 @@ public:
     inline const ObjList* paramList() const
 	{ return &m_params; }
 
+    /**
+     * Allocate parameters added from now on in an arena instead of the heap.
+     * All memory of the arena is released at once when the list and all its
+     *  parameters are gone
+     * @param size Size of each arena block in bytes, zero to stop using arenas
+     */
+    void setArena(unsigned int size = 2048);
+
+    /**
+     * Check if parameters are allocated in an arena
+     * @return True if new parameters go into an arena
+     */
+    inline bool hasArena() const
+	{ return m_arenaSize != 0; }
+
 private:
     NamedList(); // no default constructor please
+    inline void dropIndex()
+	{ if (m_index) clearIndex(); }
+    void clearIndex();
+    NamedString* makeParam(const char* name, const char* value, const String* atom = 0);
+    NamedList& putParam(const String& name, const char* value, const String* atom);
     ObjList m_params;
+    mutable NamedListIndex* m_index;
+    ParamArena* m_arena;
+    unsigned int m_arenaSize;
 };
 
 /**
@@ -5181,6 +5397,35 @@ public:
      */
     static bool efficientTimedLock();
 
+    /**
+     * Enable or disable the lock contention profiler. When enabled each
+     *  thread counts acquisitions, contention, wait and hold times of the
+     *  mutexes it locks, aggregated per mutex name only when requested.
+     * Profiling is not supported on Windows
+     * @param enable True to start profiling, false to stop it
+     */
+    static void enableProfiling(bool enable = true);
+
+    /**
+     * Check if the lock contention profiler is enabled
+     * @return True if mutex lock operations are being profiled
+     */
+    static bool profiling();
+
+    /**
+     * Discard all the contention statistics gathered so far
+     */
+    static void resetProfiling();
+
+    /**
+     * Retrieve the aggregated contention statistics of named mutexes
+     * @param str String to append the statistics to
+     * @param details True to append the most contended mutexes as
+     *  name=Acquired|Contended|WaitTotal|WaitMax|HoldMax, times in usec
+     * @param count Maximum number of mutex names to list
+     */
+    static void profilingStatus(String& str, bool details = true, unsigned int count = 20);
+
 private:
     MutexPrivate* privDataCopy() const;
     MutexPrivate* m_private;
@@ -7193,6 +7438,23 @@ public:
     inline int sendTo(const void* buffer, int length, const SocketAddr& addr, int flags = 0)
 	{ return sendTo(buffer, length, addr.address(), addr.length(), flags); }
 
+    /**
+     * Send several messages to the same address in a single operation if the
+     *  platform supports it (sendmmsg), one by one otherwise.
+     * Equal sized messages can be handed to the kernel as a single UDP
+     *  datagram to be split in segments (UDP GSO) where supported.
+     * @param buffer Buffer holding the messages stored back to back
+     * @param lengths Array of count integers holding the length of each message
+     * @param count Number of messages to send, at most 16 per call
+     * @param addr Address to send the messages to
+     * @param flags Operating system specific bit flags that change the behaviour
+     * @param segment Optional pointer to a flag requesting segmentation offload,
+     *  it is reset if the socket or kernel does not support it
+     * @return Number of messages sent, @ref socketError() if an error occurred
+     */
+    int sendToMulti(const void* buffer, const int* lengths, int count, const SocketAddr& addr,
+	int flags = 0, bool* segment = 0);
+
     /**
      * Send a message over a connected socket
      * @param buffer Buffer for data transfer
@@ -7231,6 +7493,21 @@ public:
      */
     int recvFrom(void* buffer, int length, SocketAddr& addr, int flags = 0);
 
+    /**
+     * Receive several messages from an unconnected socket in a single operation
+     *  if the platform supports it (recvmmsg), one by one otherwise.
+     * Installed filters are applied to each message, a length of zero is
+     *  returned for messages claimed by a filter.
+     * @param buffer Buffer holding count consecutive slots of size bytes each
+     * @param size Size of each buffer slot
+     * @param count Maximum number of messages to receive, at most 16 per call
+     * @param lengths Array of count integers to fill with the received lengths
+     * @param addrs Array of count addresses to fill with the source of each message
+     * @param flags Operating system specific bit flags that change the behaviour
+     * @return Number of messages received, @ref socketError() if an error occurred
+     */
+    int recvFromMulti(void* buffer, int size, int count, int* lengths, SocketAddr* addrs, int flags = 0);
+
     /**
      * Receive a message from a connected socket
      * @param buffer Buffer for data transfer
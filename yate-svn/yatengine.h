@@ -302,6 +302,7 @@ private:
 
 class MessageDispatcher;
 class MessageRelay;
+class MessageShard;
 class Engine;
 
 /**
@@ -311,6 +312,7 @@ class Engine;
 class YATE_API Message : public NamedList
 {
     friend class MessageDispatcher;
+    friend class MessageShard;
 public:
     /**
      * Creates a new message.
@@ -415,12 +417,26 @@ public:
     inline const Time& msgTime() const
 	{ return m_time; }
 
+    /**
+     * Check if the message is currently waiting in a dispatcher queue
+     * @return True if the message was enqueued and not yet dequeued
+     */
+    inline bool enqueued() const
+	{ return m_queued != 0; }
+
     /**
      * Name assignment operator
      */
     inline Message& operator=(const char* value)
 	{ String::operator=(value); return *this; }
 
+    /**
+     * Retrieve the interned atom of the message name, interns it on first use
+     * @return Pointer to the atom of the name, NULL if it could not be interned
+     */
+    inline const String* atom() const
+	{ return m_atomSet ? m_atom : findAtom(); }
+
     /**
      * Encode the message into a string adequate for sending for processing
      * to an external communication interface
@@ -466,14 +482,23 @@ protected:
      */
     virtual void dispatched(bool accepted);
 
+    /**
+     * Called whenever the name changed, drops the cached name atom
+     */
+    virtual void changed();
+
 private:
     Message(); // no default constructor please
     Message& operator=(const Message& value); // no assignment please
+    const String* findAtom() const;
     String m_return;
     Time m_time;
     RefObject* m_data;
+    u_int64_t m_queued;
     bool m_notify;
     bool m_broadcast;
+    mutable const String* m_atom;
+    mutable bool m_atomSet;
     void commonEncode(String& str) const;
     int commonDecode(const char* str, int offs);
 };
@@ -564,8 +589,7 @@ public:
      * @param name Name of the parameter to filter
      * @param value Value of the parameter to filter
      */
-    inline void setFilter(const char* name, const char* value)
-	{ setFilter(new NamedString(name,value)); }
+    void setFilter(const char* name, const char* value);
 
     /**
      * Remove and destroy any filter associated to this handler
@@ -771,7 +795,8 @@ public:
      * Clear all the message handlers and post-dispatch hooks
      */
     inline void clear()
-	{ m_handlers.clear(); m_hookAppend = &m_hooks; m_hooks.clear(); }
+	{ m_handlerIndex.clear(); m_nullHandlers.clear(); m_handlers.clear();
+	  m_hookAppend = &m_hooks; m_hooks.clear(); }
 
     /**
      * Get the number of messages waiting in the queue
@@ -779,6 +804,20 @@ public:
      */
     unsigned int messageCount();
 
+    /**
+     * Get the number of shards the waiting queue is split into
+     * @return Count of message queue shards
+     */
+    inline unsigned int queueShards() const
+	{ return m_shardCount; }
+
+    /**
+     * Append the status of the message queue shards to a string
+     * @param str String to append the status parameters to
+     * @param details Also append per shard depth and wait time details
+     */
+    void queueStatus(String& str, bool details = true);
+
     /**
      * Get the number of handlers in this dispatcher
      * @return Count of handlers
@@ -806,12 +845,25 @@ protected:
     inline void trackParam(const char* paramName)
 	{ m_trackParam = paramName; }
 
+    /**
+     * Split the waiting queue in several shards, each with its own lock.
+     * Producers and dequeuing threads spread over the shards so they rarely
+     *  contend but messages are no longer dispatched in strict FIFO order.
+     * The shards can be changed only before any message is queued or dequeued.
+     * @param count Number of shards, 1 to keep a single FIFO queue
+     * @return True if the queue has the requested number of shards
+     */
+    bool queueShards(unsigned int count);
+
 private:
     ObjList m_handlers;
-    ObjList m_messages;
+    HashList m_handlerIndex;
+    ObjList m_nullHandlers;
+    MessageShard* m_shards;
+    unsigned int m_shardCount;
+    unsigned int m_deqIndex;
     ObjList m_hooks;
     Mutex m_hookMutex;
-    ObjList* m_msgAppend;
     ObjList* m_hookAppend;
     String m_trackParam;
     unsigned int m_changes;
@@ -1459,6 +1511,14 @@ public:
     inline unsigned int messageCount()
 	{ return m_dispatcher.messageCount(); }
 
+    /**
+     * Append the status of the dispatcher message queue shards to a string
+     * @param str String to append the status parameters to
+     * @param details Also append per shard details
+     */
+    inline void messageQueueStatus(String& str, bool details = true)
+	{ m_dispatcher.queueStatus(str,details); }
+
     /**
      * Get the number of handlers in the dispatcher
      * @return Count of handlers
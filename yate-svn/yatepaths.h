@@ -0,0 +1,3 @@
+#define CFG_PATH "/etc/yate"
+#define MOD_PATH "/usr/local/lib/yate"
+#define SHR_PATH "/usr/local/share/yate"
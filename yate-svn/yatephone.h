@@ -390,6 +390,8 @@ class DataSource;
 class DataTranslator;
 class TranslatorFactory;
 class ThreadedSourcePrivate;
+class MediaClock;
+class MediaClockEntry;
 
 /**
  * A data consumer
@@ -574,6 +576,7 @@ private:
 class YATE_API ThreadedSource : public DataSource
 {
     friend class ThreadedSourcePrivate;
+    friend class MediaClock;
 public:
     /**
      * The destruction notification, checks that the thread is gone
@@ -589,7 +592,19 @@ public:
     bool start(const char* name = "ThreadedSource", Thread::Priority prio = Thread::Normal);
 
     /**
-     * Stops and destroys the worker thread if running
+     * Attach the source to the engine's shared media clock instead of starting
+     *  a worker thread. Clock threads tick at 10 ms boundaries and call
+     *  clockTick() of all sources due in that tick in one batch
+     * @param interval Interval between ticks of this source in milliseconds,
+     *  must be a multiple of 10
+     * @return True if attached, false if the clock is disabled or the
+     *  source already has a worker thread
+     */
+    bool startClock(unsigned int interval = 20);
+
+    /**
+     * Stops and destroys the worker thread if running or detaches the source
+     *  from the media clock
      */
     void stop();
 
@@ -601,17 +616,32 @@ public:
 
     /**
      * Check if the data thread is running
-     * @return True if the data thread was started and is running
+     * @return True if the data thread was started and is running or the
+     *  source is attached to the media clock
      */
     bool running() const;
 
+    /**
+     * Check if the source is driven by the shared media clock
+     * @return True if the source is attached to the media clock
+     */
+    inline bool clocked() const
+	{ return m_clock != 0; }
+
+    /**
+     * Append the statistics of the media clock threads to a string
+     * @param str String to append the statistics to
+     * @param details True to append the tick lateness and duration histograms
+     */
+    static void clockStatus(String& str, bool details = true);
+
 protected:
     /**
      * Threaded Source constructor
      * @param format Name of the data format, default "slin" (Signed Linear)
      */
     inline explicit ThreadedSource(const char* format = "slin")
-	: DataSource(format), m_thread(0)
+	: DataSource(format), m_thread(0), m_clock(0)
 	{ }
 
     /**
@@ -619,6 +649,15 @@ protected:
      */
     virtual void run() = 0;
 
+    /**
+     * Produce the data of one media clock tick. Called from a clock thread
+     *  without holding any lock, it must not sleep or block for long as it
+     *  delays all other sources sharing that thread
+     * @param when Scheduled time of the tick in microseconds
+     * @return True to keep receiving ticks, false to detach from the clock
+     */
+    virtual bool clockTick(u_int64_t when);
+
     /**
      * The cleanup after thread method, deletes the source if already
      *  dereferenced and set for asynchronous deletion
@@ -626,7 +665,8 @@ protected:
     virtual void cleanup();
 
     /**
-     * Check if the calling thread should keep looping the worker method
+     * Check if the calling thread should keep looping the worker method or,
+     *  for a source attached to the media clock, keep producing ticks
      * @param runConsumers True to keep running as long consumers are attached
      * @return True if the calling thread should remain in the run() method
      */
@@ -634,6 +674,7 @@ protected:
 
 private:
     ThreadedSourcePrivate* m_thread;
+    MediaClockEntry* m_clock;
 };
 
 /**